@@ -13,9 +13,163 @@
 
 #include "3d.h"
 #include "globvars.h"
+#include "d_range.h"
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 namespace dcx {
 
+namespace {
+
+/* The batch kernels below must produce exactly what g3_rotate_point and
+ * g3_code_point produce.  Rotation is vm_vec_rotate applied to
+ * (src - View_position): each output is the sum of three 64-bit
+ * products, shifted right by 16, truncated to 32 bits.  Since only the
+ * low 32 bits of the shifted sum are kept, a logical shift gives the
+ * same answer as the arithmetic shift used by the scalar code.
+ */
+#if defined(__AVX2__)
+using batch_vector = __m256i;
+constexpr std::size_t batch_width = 8;
+
+static inline batch_vector batch_load(const fix *p)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+static inline void batch_store(fix *p, const batch_vector v)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+static inline batch_vector batch_set1(const int32_t i)
+{
+	return _mm256_set1_epi32(i);
+}
+
+static inline batch_vector batch_dot3(const batch_vector x, const batch_vector y, const batch_vector z, const vms_vector &m)
+{
+	const auto mx = _mm256_set1_epi32(m.x), my = _mm256_set1_epi32(m.y), mz = _mm256_set1_epi32(m.z);
+	/* _mm256_mul_epi32 multiplies only the even 32-bit lanes, so the odd
+	 * lanes are shifted down and multiplied separately.
+	 */
+	const auto even = _mm256_srli_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(x, mx), _mm256_mul_epi32(y, my)), _mm256_mul_epi32(z, mz)), 16);
+	const auto ox = _mm256_srli_epi64(x, 32), oy = _mm256_srli_epi64(y, 32), oz = _mm256_srli_epi64(z, 32);
+	const auto odd = _mm256_slli_epi64(_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epi32(ox, mx), _mm256_mul_epi32(oy, my)), _mm256_mul_epi32(oz, mz)), 16);
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+#define batch_sub	_mm256_sub_epi32
+#define batch_or	_mm256_or_si256
+#define batch_and	_mm256_and_si256
+#define batch_cmpgt	_mm256_cmpgt_epi32
+#define batch_zero	_mm256_setzero_si256
+#elif defined(__SSE4_1__)
+using batch_vector = __m128i;
+constexpr std::size_t batch_width = 4;
+
+static inline batch_vector batch_load(const fix *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+static inline void batch_store(fix *p, const batch_vector v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+static inline batch_vector batch_set1(const int32_t i)
+{
+	return _mm_set1_epi32(i);
+}
+
+static inline batch_vector batch_dot3(const batch_vector x, const batch_vector y, const batch_vector z, const vms_vector &m)
+{
+	const auto mx = _mm_set1_epi32(m.x), my = _mm_set1_epi32(m.y), mz = _mm_set1_epi32(m.z);
+	const auto even = _mm_srli_epi64(_mm_add_epi64(_mm_add_epi64(_mm_mul_epi32(x, mx), _mm_mul_epi32(y, my)), _mm_mul_epi32(z, mz)), 16);
+	const auto ox = _mm_srli_epi64(x, 32), oy = _mm_srli_epi64(y, 32), oz = _mm_srli_epi64(z, 32);
+	const auto odd = _mm_slli_epi64(_mm_add_epi64(_mm_add_epi64(_mm_mul_epi32(ox, mx), _mm_mul_epi32(oy, my)), _mm_mul_epi32(oz, mz)), 16);
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+#define batch_sub	_mm_sub_epi32
+#define batch_or	_mm_or_si128
+#define batch_and	_mm_and_si128
+#define batch_cmpgt	_mm_cmpgt_epi32
+#define batch_zero	_mm_setzero_si128
+#endif
+
+#ifdef batch_sub
+static_assert(g3s_point_batch::capacity % batch_width == 0, "batch capacity must be a multiple of the vector width");
+
+static void rotate_point_batch(g3s_point_batch &batch, const std::size_t n)
+{
+	/* Clear the unused lanes of the last vector, so that the kernel
+	 * never reads uninitialized values.  Their results are ignored.
+	 */
+	const std::size_t padded = (n + batch_width - 1) & ~(batch_width - 1);
+	for (auto i = n; i != padded; ++i)
+		batch.x[i] = batch.y[i] = batch.z[i] = 0;
+	const auto vpx = batch_set1(View_position.x), vpy = batch_set1(View_position.y), vpz = batch_set1(View_position.z);
+	const auto off_right = batch_set1(CC_OFF_RIGHT), off_top = batch_set1(CC_OFF_TOP), off_left = batch_set1(CC_OFF_LEFT), off_bot = batch_set1(CC_OFF_BOT), behind = batch_set1(CC_BEHIND);
+	const auto zero = batch_zero();
+	for (std::size_t i = 0; i != padded; i += batch_width)
+	{
+		const auto tx = batch_sub(batch_load(&batch.x[i]), vpx);
+		const auto ty = batch_sub(batch_load(&batch.y[i]), vpy);
+		const auto tz = batch_sub(batch_load(&batch.z[i]), vpz);
+		const auto rx = batch_dot3(tx, ty, tz, View_matrix.rvec);
+		const auto ry = batch_dot3(tx, ty, tz, View_matrix.uvec);
+		const auto rz = batch_dot3(tx, ty, tz, View_matrix.fvec);
+		batch_store(&batch.x[i], rx);
+		batch_store(&batch.y[i], ry);
+		batch_store(&batch.z[i], rz);
+		const auto nz = batch_sub(zero, rz);
+		const auto cc = batch_or(
+			batch_or(
+				batch_and(batch_cmpgt(rx, rz), off_right),
+				batch_and(batch_cmpgt(ry, rz), off_top)
+			),
+			batch_or(
+				batch_or(
+					batch_and(batch_cmpgt(nz, rx), off_left),
+					batch_and(batch_cmpgt(nz, ry), off_bot)
+				),
+				batch_and(batch_cmpgt(zero, rz), behind)
+			)
+		);
+		alignas(batch_vector) std::array<int32_t, batch_width> codes;
+		batch_store(codes.data(), cc);
+		for (const auto j : xrange(batch_width))
+			batch.codes[i + j] = codes[j];
+	}
+}
+
+#undef batch_sub
+#undef batch_or
+#undef batch_and
+#undef batch_cmpgt
+#undef batch_zero
+#else
+static void rotate_point_batch(g3s_point_batch &batch, const std::size_t n)
+{
+	for (const auto i : xrange(n))
+	{
+		g3s_point p;
+		g3_rotate_point(p, vms_vector{batch.x[i], batch.y[i], batch.z[i]});
+		batch.x[i] = p.p3_x;
+		batch.y[i] = p.p3_y;
+		batch.z[i] = p.p3_z;
+		batch.codes[i] = p.p3_codes;
+	}
+}
+#endif
+
+}
+
 //code a point.  fills in the p3_codes field of the point, and returns the codes
 ubyte g3_code_point(g3s_point &p)
 {
@@ -49,6 +203,50 @@ ubyte g3_rotate_point(g3s_point &dest,const vms_vector &src)
 	return g3_code_point(dest);
 }
 
+g3s_codes g3_rotate_point_batch(g3s_point_batch &batch, const std::size_t n)
+{
+	rotate_point_batch(batch, n);
+	g3s_codes cc;
+	for (const auto i : xrange(n))
+	{
+		cc.uand &= batch.codes[i];
+		cc.uor |= batch.codes[i];
+	}
+	return cc;
+}
+
+g3s_codes g3_rotate_points(g3s_point *dest, const vms_vector *src, std::size_t n)
+{
+	g3s_codes cc;
+	g3s_point_batch batch;
+	for (; n; )
+	{
+		const auto count = std::min(n, g3s_point_batch::capacity);
+		for (const auto i : xrange(count))
+		{
+			batch.x[i] = src[i].x;
+			batch.y[i] = src[i].y;
+			batch.z[i] = src[i].z;
+		}
+		const auto bc = g3_rotate_point_batch(batch, count);
+		cc.uand &= bc.uand;
+		cc.uor |= bc.uor;
+		for (const auto i : xrange(count))
+		{
+			auto &d = dest[i];
+			d.p3_x = batch.x[i];
+			d.p3_y = batch.y[i];
+			d.p3_z = batch.z[i];
+			d.p3_codes = batch.codes[i];
+			d.p3_flags = 0;	//no projected
+		}
+		dest += count;
+		src += count;
+		n -= count;
+	}
+	return cc;
+}
+
 //checks for overflow & divides if ok, fillig in r
 //returns true if div is ok, else false
 int checkmuldiv(fix *r,fix a,fix b,fix c)
@@ -108,6 +306,15 @@ void g3_project_point(g3s_point &p)
 #endif
 }
 
+/* Projection needs a 64-bit division per coordinate, which no SIMD
+ * instruction set in use provides, so this stays a scalar loop.
+ */
+void g3_project_points(g3s_point *const points, const std::size_t n)
+{
+	for (const auto i : xrange(n))
+		g3_project_point(points[i]);
+}
+
 //from a 2d point, compute the vector through that point
 void g3_point_2_vec(vms_vector &v,short sx,short sy)
 {
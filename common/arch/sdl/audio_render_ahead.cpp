@@ -0,0 +1,103 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Worker thread which renders music ahead of the audio callback.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "audio_render_ahead.h"
+
+namespace dcx {
+
+void audio_render_ahead::start(render_function render, const std::size_t ahead, const std::size_t c)
+{
+	stop();
+	std::size_t size = 1;
+	while (size < ahead)
+		size <<= 1;
+	ring.assign(size, 0);
+	mask = size - 1;
+	chunk = std::min(c, size);
+	write_pos.store(0, std::memory_order_relaxed);
+	read_pos.store(0, std::memory_order_relaxed);
+	ended.store(false, std::memory_order_relaxed);
+	stopping = false;
+	worker = std::thread(&audio_render_ahead::run, this, std::move(render));
+}
+
+void audio_render_ahead::stop()
+{
+	if (!worker.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+std::size_t audio_render_ahead::read(int16_t *out, const std::size_t count)
+{
+	if (ring.empty())
+		return 0;
+	const auto r = read_pos.load(std::memory_order_relaxed);
+	const auto n = std::min(count, write_pos.load(std::memory_order_acquire) - r);
+	const auto at = r & mask;
+	const auto first = std::min(n, ring.size() - at);
+	memcpy(out, &ring[at], first * sizeof(int16_t));
+	memcpy(out + first, ring.data(), (n - first) * sizeof(int16_t));
+	read_pos.store(r + n, std::memory_order_release);
+	return n;
+}
+
+bool audio_render_ahead::finished() const
+{
+	return ended.load(std::memory_order_acquire) && read_pos.load(std::memory_order_relaxed) == write_pos.load(std::memory_order_acquire);
+}
+
+void audio_render_ahead::run(render_function render)
+{
+	const auto size = ring.size();
+	for (;;)
+	{
+		const auto w = write_pos.load(std::memory_order_relaxed);
+		if (size - (w - read_pos.load(std::memory_order_acquire)) < chunk)
+		{
+			/* The ring is full.  The callback takes a few milliseconds
+			 * of audio at a time, so look again after that long.
+			 */
+			std::unique_lock<std::mutex> l(lock);
+			if (wake.wait_for(l, std::chrono::milliseconds(2), [this]{ return stopping; }))
+				return;
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> l(lock);
+			if (stopping)
+				return;
+		}
+		/* The ring size is a multiple of chunk, so a chunk never wraps
+		 * around its end.
+		 */
+		const auto n = std::min(render(&ring[w & mask], chunk), chunk);
+		write_pos.store(w + n, std::memory_order_release);
+		if (n < chunk)
+		{
+			ended.store(true, std::memory_order_release);
+			std::unique_lock<std::mutex> l(lock);
+			wake.wait(l, [this]{ return stopping; });
+			return;
+		}
+	}
+}
+
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Mixing of sound samples for the SDL digital audio backend.  The sums
+ * use SSE2 or NEON where the compiler targets them.  Every path gives
+ * the same result as the plain loops, which also handle what is left
+ * at the end of a block.
+ *
+ */
+
+#include "digi_audio_mix.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace dcx {
+
+unsigned digi_audio_resample(const uint8_t *const samples, const uint32_t length, const bool looped, const uint32_t step, uint32_t &position, uint32_t &frac, int16_t *const out, const unsigned frames)
+{
+	uint32_t p = position, f = frac;
+	unsigned i = 0;
+	for (; i < frames; ++i)
+	{
+		if (p >= length)
+		{
+			if (!looped || !length)
+				break;
+			p %= length;
+		}
+		const int a = samples[p] - 0x80;
+		const uint32_t n = p + 1;
+		const int b = (n < length ? samples[n] : looped ? samples[0] : 0x80) - 0x80;
+		out[i] = static_cast<int16_t>(a * 256 + (((b - a) * static_cast<int>(f)) >> 8));
+		f += step;
+		p += f >> 16;
+		f &= 0xffff;
+	}
+	position = p;
+	frac = f;
+	return i;
+}
+
+void digi_audio_mix_stereo(int32_t *const acc, const int16_t *const mono, const unsigned frames, const int16_t vl, const int16_t vr)
+{
+	unsigned i = 0;
+#if defined(__SSE2__)
+	/* Each 32-bit lane of x holds one sample twice.  madd multiplies it
+	 * by the volume in the low half of the matching lane of vol.
+	 */
+	const __m128i vol = _mm_set_epi16(0, vr, 0, vl, 0, vr, 0, vl);
+	for (; i + 8 <= frames; i += 8)
+	{
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mono + i));
+		const __m128i lo = _mm_unpacklo_epi16(s, s), hi = _mm_unpackhi_epi16(s, s);
+		const __m128i x[4] = {
+			_mm_unpacklo_epi32(lo, lo),
+			_mm_unpackhi_epi32(lo, lo),
+			_mm_unpacklo_epi32(hi, hi),
+			_mm_unpackhi_epi32(hi, hi),
+		};
+		for (unsigned j = 0; j < 4; ++j)
+		{
+			const auto a = reinterpret_cast<__m128i *>(acc + 2 * i + 4 * j);
+			_mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_srai_epi32(_mm_madd_epi16(x[j], vol), 14)));
+		}
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 4 <= frames; i += 4)
+	{
+		const int16x4_t s = vld1_s16(mono + i);
+		int32x4x2_t a = vld2q_s32(acc + 2 * i);
+		a.val[0] = vaddq_s32(a.val[0], vshrq_n_s32(vmull_n_s16(s, vl), 14));
+		a.val[1] = vaddq_s32(a.val[1], vshrq_n_s32(vmull_n_s16(s, vr), 14));
+		vst2q_s32(acc + 2 * i, a);
+	}
+#endif
+	for (; i < frames; ++i)
+	{
+		acc[2 * i] += (mono[i] * vl) >> 14;
+		acc[2 * i + 1] += (mono[i] * vr) >> 14;
+	}
+}
+
+void digi_audio_mix_output(int16_t *const out, const int32_t *const acc, const unsigned samples)
+{
+	unsigned i = 0;
+#if defined(__SSE2__)
+	for (; i + 8 <= samples; i += 8)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a, b));
+	}
+#elif defined(__ARM_NEON)
+	for (; i + 8 <= samples; i += 8)
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vld1q_s32(acc + i)), vqmovn_s32(vld1q_s32(acc + i + 4))));
+#endif
+	for (; i < samples; ++i)
+	{
+		const int32_t s = acc[i];
+		out[i] = s > INT16_MAX ? INT16_MAX : s < INT16_MIN ? INT16_MIN : s;
+	}
+}
+
+}
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include "args.h"
+#include "audio_render_ahead.h"
 #include "hmp.h"
 #include "adlmidi_dynamic.h"
 #include "digi_mixer_music.h"
@@ -113,6 +114,13 @@ static ADL_MIDIPlayer *get_adlmidi()
 	return adlmidi;
 }
 
+/* OPL emulation takes much longer for some notes than for others, so it
+ * runs ahead of the audio callback on a worker, which starts with the song.
+ * Declared after current_adlmidi so that its worker stops before the
+ * player is freed at exit.
+ */
+static audio_render_ahead current_adlmidi_ahead;
+static void start_adlmidi_ahead(ADL_MIDIPlayer *adlmidi);
 static void mix_adlmidi(void *udata, Uint8 *stream, int len);
 #endif
 
@@ -202,6 +210,7 @@ int mix_play_file(const char *filename, int loop, void (*hook_finished_track)())
 	{
 		ADL_MIDIPlayer *adlmidi = get_adlmidi();
 		adl_setLoopEnabled(adlmidi, loop);
+		start_adlmidi_ahead(adlmidi);
 		Mix_HookMusic(&mix_adlmidi, nullptr);
 		Mix_HookMusicFinished(hook_finished_track ? hook_finished_track : mix_free_music);
 		return 1;
@@ -238,6 +247,7 @@ void mix_free_music()
 	 * whether the music type requires it.
 	 */
 	Mix_HookMusic(nullptr, nullptr);
+	current_adlmidi_ahead.stop();
 #endif
 	current_music.reset();
 	current_music_hndlbuf.clear();
@@ -319,20 +329,35 @@ static int16_t sat16(int32_t x)
 	return x;
 }
 
-static void mix_adlmidi(void *, Uint8 *stream, int len)
+static void start_adlmidi_ahead(ADL_MIDIPlayer *const adlmidi)
 {
-	ADLMIDI_AudioFormat format;
-	format.containerSize = sizeof(int16_t);
-	format.sampleOffset = 2 * format.containerSize;
-	format.type = ADLMIDI_SampleType_S16;
-
-	ADL_MIDIPlayer *adlmidi = get_adlmidi();
-	int sampleCount = len / format.containerSize;
-	adl_playFormat(adlmidi, sampleCount, stream, stream + format.containerSize, &format);
+	int sample_rate;
+	Mix_QuerySpec(&sample_rate, nullptr, nullptr);
+	/* Stereo samples for 300ms, made 512 frames at a time. */
+	const std::size_t ahead = sample_rate * 2 * 3 / 10;
+	current_adlmidi_ahead.start([adlmidi](int16_t *const samples, const std::size_t count) -> std::size_t {
+		ADLMIDI_AudioFormat format;
+		format.containerSize = sizeof(int16_t);
+		format.sampleOffset = 2 * format.containerSize;
+		format.type = ADLMIDI_SampleType_S16;
+
+		const auto stream = reinterpret_cast<uint8_t *>(samples);
+		const int sampleCount = adl_playFormat(adlmidi, count, stream, stream + format.containerSize, &format);
+		if (sampleCount <= 0)
+			return 0;
+		const auto amplify = [](int16_t i) { return sat16(2 * i); };
+		std::transform(samples, samples + sampleCount, samples, amplify);
+		return sampleCount;
+	}, ahead, 1024);
+}
 
+static void mix_adlmidi(void *, Uint8 *stream, int len)
+{
 	const auto samples = reinterpret_cast<int16_t *>(stream);
-	const auto amplify = [](int16_t i) { return sat16(2 * i); };
-	std::transform(samples, samples + sampleCount, samples, amplify);
+	const std::size_t sampleCount = len / sizeof(int16_t);
+	const auto n = current_adlmidi_ahead.read(samples, sampleCount);
+	/* Silence if the worker fell behind, or after the song ended. */
+	std::fill(samples + n, samples + sampleCount, 0);
 }
 #endif
 
@@ -239,6 +239,13 @@ window_event_result event_process(void)
 	if ((highest_result == window_event_result::deleted) || (window_get_front() != wind))
 		return highest_result;
 
+	/* A dedicated host has nothing to draw on, so nothing is drawn.  Its
+	 * windows do their other work of the frame on EVENT_IDLE instead, see
+	 * event_is_frame.
+	 */
+	if (CGameArg.MplDedicated)
+		return highest_result;
+
 	const d_event event{EVENT_WINDOW_DRAW};	// then draw all visible windows
 	for (wind = window_get_first(); wind != nullptr;)
 	{
@@ -265,6 +272,11 @@ window_event_result event_process(void)
 	return highest_result;
 }
 
+bool event_is_frame(const d_event &event)
+{
+	return event.type == (CGameArg.MplDedicated ? EVENT_IDLE : EVENT_WINDOW_DRAW);
+}
+
 template <bool activate_focus>
 static void event_change_focus()
 {
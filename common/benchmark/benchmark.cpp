@@ -0,0 +1,91 @@
+/* The statistics, the JSON output and main() shared by the benchmark
+ * programs.
+ */
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace benchmark {
+
+namespace {
+
+double median(std::vector<double> &v)
+{
+	const auto n = v.size();
+	const auto mid = v.begin() + n / 2;
+	std::nth_element(v.begin(), mid, v.end());
+	if (n & 1)
+		return *mid;
+	return (*mid + *std::max_element(v.begin(), mid)) / 2;
+}
+
+}
+
+bool runner::parse(const int argc, char **const argv)
+{
+	for (int i = 1; i < argc; i += 2)
+	{
+		const char *const a = argv[i];
+		const char *const v = argv[i + 1];
+		if (!v)
+			break;
+		if (!strcmp(a, "--samples"))
+			samples = strtoul(v, nullptr, 10);
+		else if (!strcmp(a, "--warmup"))
+			warmup = strtoul(v, nullptr, 10);
+		else if (!strcmp(a, "--filter"))
+			filter = v;
+		else
+			break;
+		if (i + 2 == argc && samples)
+			return true;
+	}
+	if (argc == 1)
+		return true;
+	fprintf(stderr, "usage: %s [--samples <n>] [--warmup <n>] [--filter <substring of name>]\n", argv[0]);
+	return false;
+}
+
+bool runner::wanted(const char *const name) const
+{
+	return !filter || strstr(name, filter);
+}
+
+void runner::record(const char *const name, const std::size_t calls, std::vector<double> &ns)
+{
+	const auto min = *std::min_element(ns.begin(), ns.end());
+	const auto m = median(ns);
+	for (auto &t : ns)
+		t = std::fabs(t - m);
+	results.push_back({name, calls, static_cast<unsigned>(ns.size()), m, median(ns), min});
+}
+
+int runner::report() const
+{
+	/* Names are identifiers chosen by the benchmarks, so they need no
+	 * escaping.
+	 */
+	printf("{\n\t\"benchmarks\": [");
+	const char *sep = "\n";
+	for (auto &r : results)
+	{
+		printf("%s\t\t{\"name\": \"%s\", \"calls_per_sample\": %zu, \"samples\": %u, \"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f}", sep, r.name.c_str(), r.calls_per_sample, r.samples, r.median_ns, r.mad_ns, r.min_ns);
+		sep = ",\n";
+	}
+	printf("\n\t]\n}\n");
+	return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	benchmark::runner r;
+	if (!r.parse(argc, argv))
+		return 1;
+	benchmark::run_benchmarks(r);
+	return r.report();
+}
@@ -0,0 +1,87 @@
+/* A small harness for timing hot code outside the game, so that a change
+ * which makes it slower is found before it ships.
+ *
+ * Each benchmark calls a function in batches sized so that one batch
+ * takes about a millisecond, discards the first batches as warmup, and
+ * reports the median and the median absolute deviation of the time per
+ * call.  A few batches slowed by the rest of the system move neither.
+ * The results are written as JSON on stdout, for a script to compare
+ * two builds.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+
+/* Keep the compiler from discarding a result which is never used. */
+template <typename T>
+static inline void do_not_optimize(const T &v)
+{
+	asm volatile("" : : "g"(&v) : "memory");
+}
+
+struct result
+{
+	std::string name;
+	std::size_t calls_per_sample;
+	unsigned samples;
+	double median_ns;
+	double mad_ns;
+	double min_ns;
+};
+
+class runner
+{
+	using clock = std::chrono::steady_clock;
+	unsigned warmup = 5;
+	unsigned samples = 31;
+	const char *filter = nullptr;
+	std::vector<result> results;
+	bool wanted(const char *name) const;
+	void record(const char *name, std::size_t calls, std::vector<double> &ns);
+	template <typename F>
+		static double time_batch(F &f, const std::size_t calls)
+		{
+			const auto start = clock::now();
+			for (std::size_t i = calls; i; --i)
+				f();
+			return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		}
+public:
+	/* Read --samples, --warmup and --filter.  Return false and print the
+	 * usage if the arguments are not understood.
+	 */
+	bool parse(int argc, char **argv);
+	template <typename F>
+		void run(const char *const name, F &&f)
+		{
+			if (!wanted(name))
+				return;
+			/* Grow the batch until it takes a millisecond, so that the
+			 * resolution of the clock does not matter.
+			 */
+			std::size_t calls = 1;
+			while (time_batch(f, calls) < 1e6 && calls < (std::size_t{1} << 30))
+				calls *= 2;
+			std::vector<double> ns;
+			ns.reserve(samples);
+			for (unsigned s = 0; s < warmup + samples; ++s)
+			{
+				const auto t = time_batch(f, calls);
+				if (s >= warmup)
+					ns.push_back(t / calls);
+			}
+			record(name, calls, ns);
+		}
+	/* Write the results as JSON on stdout, and return the exit status. */
+	int report() const;
+};
+
+/* Each benchmark program defines this to run its benchmarks. */
+void run_benchmarks(runner &);
+
+}
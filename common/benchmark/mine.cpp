@@ -0,0 +1,285 @@
+/* Benchmarks of the searches through the segments of a mine which robots
+ * and weapons make every frame: find_vector_intersection and
+ * create_path_points.  They run on a small mine made here rather than a
+ * level read from the game data.
+ */
+#include "dxxsconf.h"
+
+#include "benchmark.h"
+#include "inferno.h"
+#include "object.h"
+#include "ai.h"
+#include "console.h"
+#include "fvi.h"
+#include "game.h"
+#include "gameseg.h"
+#include "laser.h"
+#include "lighting.h"
+#include "mission.h"
+#include "morph.h"
+#if defined(DXX_BUILD_DESCENT_II)
+#include "movie.h"
+#endif
+#include "piggy.h"
+#include "player.h"
+#include "rle.h"
+#include "segment.h"
+#include "texmerge.h"
+#include "textures.h"
+#include "wall.h"
+#include "d_levelstate.h"
+#include <array>
+#include <cstdlib>
+
+/* fvi.cpp, aipath.cpp and gameseg.cpp reach into most of the rest of the
+ * game.  The mine here has no walls, no textures and no objects other
+ * than the player, so define the tables they read, stand in for
+ * WALL_IS_DOORWAY with its answer for a side without a wall, and stand in
+ * for everything else the benchmarks do not reach.
+ */
+unsigned NumTextures;
+const object *old_viewer;
+
+grs_bitmap &texmerge_get_cached_bitmap(texture1_value, texture2_value)
+{
+	abort();
+}
+
+namespace dcx {
+
+game_mode_flags Game_mode;
+playernum_t Player_num;
+point_seg_array_t Point_segs;
+point_seg_array_t::iterator Point_segs_free_ptr;
+
+d_level_unique_morph_object_state::~d_level_unique_morph_object_state() = default;
+
+void (check_warn_object_type)(const object_base &, object_type_t, const char *, unsigned)
+{
+}
+
+void (con_printf)(con_priority_wrapper, const char *, ...)
+{
+}
+
+void con_puts(con_priority_wrapper, const char *, size_t)
+{
+}
+
+grs_bitmap *_rle_expand_texture(const grs_bitmap &)
+{
+	abort();
+}
+
+#if defined(DXX_BUILD_DESCENT_I)
+color_palette_index gr_gpixel(const grs_bitmap &, unsigned, unsigned)
+{
+	abort();
+}
+#endif
+
+}
+
+namespace dsx {
+
+GameBitmaps_array GameBitmaps;
+Textures_array Textures;
+const collision_outer_array_t CollisionResult{};
+object *ConsoleObject;
+Mission_ptr Current_mission;
+game_cheats cheats;
+#if defined(DXX_BUILD_DESCENT_II)
+segnum_t Believed_player_seg;
+#endif
+
+/* No mission is loaded, so there is none to unload. */
+Mission::~Mission() = default;
+#if defined(DXX_BUILD_DESCENT_II)
+LoadedMovie::~LoadedMovie() = default;
+#endif
+
+WALL_IS_DOORWAY_result_t WALL_IS_DOORWAY(const GameBitmaps_array &, const Textures_array &, fvcwallptr &, const cscusegment seg, const sidenum_t side)
+{
+	const auto child = seg.s.children[side];
+	if (child == segment_none)
+		return WID_WALL;
+	if (child == segment_exit)
+		return WID_EXTERNAL;
+	if (seg.s.sides[side].wall_num != wall_none)
+		abort();
+	return WID_NO_WALL;
+}
+
+#if defined(DXX_BUILD_DESCENT_I)
+int ai_door_is_openable(vmobjptr_t, const shared_segment &, sidenum_t)
+#elif defined(DXX_BUILD_DESCENT_II)
+int ai_door_is_openable(vmobjptr_t, player_flags, const shared_segment &, sidenum_t)
+#endif
+{
+	abort();
+}
+
+void ai_turn_towards_vector(const vms_vector &, object_base &, fix)
+{
+	abort();
+}
+
+void move_towards_segment_center(const d_level_shared_segment_state &, object_base &)
+{
+	abort();
+}
+
+bool laser_are_related(vcobjptridx_t, vcobjptridx_t)
+{
+	abort();
+}
+
+void obj_relink(fvmobjptr &, fvmsegptr &, vmobjptridx_t, vmsegptridx_t)
+{
+	abort();
+}
+
+void piggy_bitmap_page_in(bitmap_index)
+{
+	abort();
+}
+
+#if defined(DXX_BUILD_DESCENT_II)
+const player &get_player_controlling_guidebot(const d_unique_buddy_state &, const valptridx<player>::array_managed_type &Players)
+{
+	return *Players.vcptr(Player_num);
+}
+
+void update_light_probes(const visited_segment_bitarray_t &)
+{
+	abort();
+}
+#endif
+
+}
+
+namespace {
+
+/* A straight corridor of cubes, 20 units on a side, along the z axis.
+ * Each segment is joined to the next by its back side.
+ */
+constexpr unsigned corridor_length = 8;
+constexpr fix half_width = F1_0 * 10;
+constexpr fix segment_length = F1_0 * 20;
+
+struct fixture
+{
+	fixture();
+	vms_vector center(unsigned segnum) const;
+};
+
+fixture::fixture()
+{
+	auto &Segments = LevelSharedSegmentState.get_segments();
+	auto &LevelSharedVertexState = LevelSharedSegmentState.get_vertex_state();
+	auto &Vertices = LevelSharedVertexState.get_vertices();
+	/* Four vertices at each end of each segment, in the order of
+	 * vertices 0 through 3 of med_create_new_segment.
+	 */
+	for (unsigned ring = 0; ring <= corridor_length; ++ring)
+	{
+		const fix z = ring * segment_length;
+		const std::array<vms_vector, 4> corners{{
+			{+half_width, +half_width, z},
+			{+half_width, -half_width, z},
+			{-half_width, -half_width, z},
+			{-half_width, +half_width, z},
+		}};
+		for (unsigned i = 0; i < 4; ++i)
+			*Vertices.vmptr(vertnum_t{ring * 4 + i}) = vertex{corners[i]};
+	}
+	Vertices.set_count((corridor_length + 1) * 4);
+	LevelSharedSegmentState.Num_segments = corridor_length;
+	for (segnum_t s = 0; s < corridor_length; ++s)
+	{
+		const msmusegment segp = Segments.vmptr(s);
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			segp.s.verts[static_cast<segment_relative_vertnum>(i)] = vertnum_t{s * 4u + i};
+			segp.s.verts[static_cast<segment_relative_vertnum>(i + 4)] = vertnum_t{(s + 1u) * 4 + i};
+		}
+		for (auto &c : segp.s.children)
+			c = segment_none;
+		if (s + 1 < corridor_length)
+			segp.s.children[sidenum_t::WBACK] = s + 1;
+		if (s)
+			segp.s.children[sidenum_t::WFRONT] = s - 1;
+		for (auto &side : segp.s.sides)
+			side.wall_num = wall_none;
+		for (auto &side : segp.u.sides)
+		{
+			side.tmap_num = build_texture1_value(texture_index{});
+			side.tmap_num2 = texture2_value::None;
+		}
+		segp.u.objects = object_none;
+	}
+	Segments.set_count(corridor_length);
+	NumTextures = 1;
+	validate_segment_all(LevelSharedSegmentState);
+	LevelUniqueWallSubsystemState.Walls.set_count(0);
+	/* create_path_points in Descent 2 looks at the player, so place one
+	 * at the start of the corridor.
+	 */
+	auto &Objects = LevelUniqueObjectState.Objects;
+	Objects.set_count(1);
+	auto &plrobj = *Objects.vmptr(object_first);
+	plrobj = {};
+	plrobj.type = OBJ_PLAYER;
+	plrobj.segnum = segnum_t{0};
+	plrobj.pos = center(0);
+	plrobj.size = F1_0 * 4;
+	Player_num = 0;
+	Players.set_count(1);
+	Players.vmptr(playernum_t{0})->objnum = object_first;
+	Point_segs_free_ptr = Point_segs.begin();
+}
+
+vms_vector fixture::center(const unsigned segnum) const
+{
+	return {0, 0, static_cast<fix>(segnum * segment_length + segment_length / 2)};
+}
+
+}
+
+void benchmark::run_benchmarks(runner &r)
+{
+	const fixture f;
+	const auto start = f.center(0);
+	const auto end = f.center(corridor_length - 1);
+	const vms_vector outside{half_width * 2, 0, end.z};
+	auto &Objects = LevelUniqueObjectState.Objects;
+	const auto &&objp = Objects.vmptridx(object_first);
+	fvi_query fq;
+	fq.p0 = &start;
+	fq.startseg = segnum_t{0};
+	fq.thisobjnum = object_none;
+	fq.ignore_obj_list.first = nullptr;
+	fq.flags = FQ_CHECK_OBJS;
+	r.run("find_vector_intersection/corridor/through", [&]{
+		fvi_info hit_data;
+		fq.p1 = &end;
+		fq.rad = 0;
+		do_not_optimize(find_vector_intersection(fq, hit_data));
+		do_not_optimize(hit_data);
+	});
+	r.run("find_vector_intersection/corridor/wall", [&]{
+		fvi_info hit_data;
+		fq.p1 = &outside;
+		fq.rad = F1_0;
+		do_not_optimize(find_vector_intersection(fq, hit_data));
+		do_not_optimize(hit_data);
+	});
+	r.run("create_path_points/corridor", [&]{
+		do_not_optimize(create_path_points(objp, segnum_t{0}, segnum_t{corridor_length - 1}, Point_segs.begin(), MAX_PATH_LENGTH, create_path_random_flag::nonrandom, create_path_safety_flag::unsafe, segment_none));
+		do_not_optimize(Point_segs);
+	});
+	r.run("create_path_points/corridor/safe", [&]{
+		do_not_optimize(create_path_points(objp, segnum_t{0}, segnum_t{corridor_length - 1}, Point_segs.begin(), MAX_PATH_LENGTH, create_path_random_flag::nonrandom, create_path_safety_flag::safe, segment_none));
+		do_not_optimize(Point_segs);
+	});
+}
@@ -0,0 +1,100 @@
+/* Benchmarks of expanding RLE bitmaps, as the game does for each RLE
+ * texture and sprite drawn.
+ */
+#include "benchmark.h"
+#include "rle.h"
+#include <array>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/* rle.cpp also holds the cache of expanded textures, which allocates
+ * through the rest of the 2D library, and without OpenGL, the expansion
+ * into a canvas, which draws through it.  The benchmarks reach neither,
+ * so stand in for them rather than link that library.
+ */
+namespace dcx {
+
+void gr_bm_pixel(grs_canvas &, grs_bitmap &, uint_fast32_t, uint_fast32_t, uint8_t)
+{
+	abort();
+}
+
+void gr_free_bitmap_data(grs_bitmap &)
+{
+	abort();
+}
+
+grs_bitmap_ptr gr_create_bitmap(uint16_t, uint16_t)
+{
+	abort();
+}
+
+}
+
+namespace {
+
+constexpr unsigned width = 64;
+constexpr unsigned height = 64;
+
+/* A texture with runs of a few pixels, encoded one line after another as
+ * gr_bitmap_rle_compress does, without the table of line sizes.
+ */
+struct fixture
+{
+	std::vector<uint8_t> rle;
+	std::array<const uint8_t *, height> line;
+	std::array<uint8_t, width * height> pixels;
+	fixture()
+	{
+		std::minstd_rand engine(1);
+		std::uniform_int_distribution<unsigned> run_length{1, 6};
+		std::uniform_int_distribution<unsigned> color{0, 255};
+		std::vector<std::size_t> offset;
+		for (unsigned y = 0; y < height; ++y)
+		{
+			offset.push_back(rle.size());
+			for (unsigned x = 0; x < width;)
+			{
+				const uint8_t c = color(engine);
+				const unsigned n = std::min(run_length(engine), width - x);
+				if (n > 1 || (c & 0xe0) == 0xe0)
+				{
+					rle.push_back(0xe0 | n);
+					rle.push_back(c);
+				}
+				else
+					rle.push_back(c);
+				x += n;
+			}
+			rle.push_back(0xe0);
+		}
+		for (unsigned y = 0; y < height; ++y)
+			line[y] = &rle[offset[y]];
+	}
+};
+
+}
+
+void benchmark::run_benchmarks(runner &r)
+{
+	fixture f;
+	r.run("gr_rle_decode/64x64", [&]{
+		auto db = f.pixels.data();
+		for (unsigned y = 0; y < height; ++y, db += width)
+			gr_rle_decode(f.line[y], db, {f.rle.data() + f.rle.size(), f.pixels.data() + f.pixels.size()});
+		do_not_optimize(f.pixels);
+	});
+	r.run("gr_rle_expand_scanline/64x64", [&]{
+		auto db = f.pixels.data();
+		for (unsigned y = 0; y < height; ++y, db += width)
+			gr_rle_expand_scanline(db, f.line[y], 0, width - 1);
+		do_not_optimize(f.pixels);
+	});
+	r.run("gr_rle_expand_scanline/64x64/clipped", [&]{
+		auto db = f.pixels.data();
+		for (unsigned y = 0; y < height; ++y, db += width)
+			gr_rle_expand_scanline(db, f.line[y], width / 4, width * 3 / 4);
+		do_not_optimize(f.pixels);
+	});
+}
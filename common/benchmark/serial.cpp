@@ -0,0 +1,43 @@
+/* Benchmarks of packing and unpacking network messages with serial.h. */
+#include "dxxsconf.h"
+
+#include "benchmark.h"
+#include "serial.h"
+#include <array>
+
+namespace {
+
+/* Shaped like the position updates sent for each object many times a
+ * second.
+ */
+struct packed_object
+{
+	uint8_t type;
+	uint16_t segnum;
+	std::array<int32_t, 3> pos;
+	std::array<int16_t, 9> orient;
+	std::array<int32_t, 3> velocity;
+	int32_t shields;
+};
+
+DEFINE_SERIAL_UDT_TO_MESSAGE(packed_object, o, (o.type, serial::pad<1>(), o.segnum, o.pos, o.orient, o.velocity, o.shields));
+
+constexpr std::size_t message_size = serial::message_type<packed_object>::maximum_size;
+
+}
+
+void benchmark::run_benchmarks(runner &r)
+{
+	packed_object o{1, 1234, {{1, 2, 3}}, {{4, 5, 6, 7, 8, 9, 10, 11, 12}}, {{13, 14, 15}}, 100};
+	std::array<uint8_t, message_size> buf{};
+	r.run("serial/write", [&]{
+		serial::writer::bytebuffer_t b(buf.data());
+		serial::process_buffer(b, o);
+		do_not_optimize(buf);
+	});
+	r.run("serial/read", [&]{
+		serial::reader::bytebuffer_t b(buf.data());
+		serial::process_buffer(b, o);
+		do_not_optimize(o);
+	});
+}
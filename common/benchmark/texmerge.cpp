@@ -0,0 +1,122 @@
+/* Benchmarks of merging the two textures of a side, as the game does
+ * when the cache of merged textures misses.
+ */
+#include "dxxsconf.h"
+
+#include "benchmark.h"
+#include "dxxerror.h"
+#include "gr.h"
+#include "piggy.h"
+#include "rle.h"
+#include "segment.h"
+#include "texmerge.h"
+#include "textures.h"
+#include "timer.h"
+#include <array>
+#include <cstdlib>
+#include <random>
+
+#if DXX_USE_OGL
+#include "ogl_init.h"
+#endif
+
+/* texmerge.cpp reads the textures from the tables that bm.cpp and
+ * piggy.cpp load, which the benchmark fills in itself.  It also calls
+ * into the rest of the game for pages of the piggy file, expanded RLE
+ * textures, the time and fatal errors, none of which the benchmark
+ * reaches.
+ */
+namespace dsx {
+
+GameBitmaps_array GameBitmaps;
+Textures_array Textures;
+
+void piggy_bitmap_page_in(bitmap_index)
+{
+	abort();
+}
+
+}
+
+namespace dcx {
+
+fix64 timer_query()
+{
+	return 0;
+}
+
+grs_bitmap *_rle_expand_texture(const grs_bitmap &)
+{
+	abort();
+}
+
+void (Error)(const char *, unsigned, const char *, const char *, ...)
+{
+	abort();
+}
+
+color_palette_index gr_find_closest_color(int, int, int)
+{
+	abort();
+}
+
+#if DXX_USE_OGL
+void ogl_freebmtexture(grs_bitmap &)
+{
+}
+#endif
+
+}
+
+namespace {
+
+constexpr unsigned wh = 64;
+
+/* A wall texture, and a decal over it which is transparent in places,
+ * as texmerge_get_cached_bitmap gets them once they are paged in.
+ */
+struct fixture
+{
+	std::array<std::array<uint8_t, wh * wh>, 3> pixels;
+	fixture()
+	{
+		std::minstd_rand engine(1);
+		std::uniform_int_distribution<unsigned> color{0, 255};
+		for (auto &p : pixels)
+			for (auto &c : p)
+			{
+				c = color(engine);
+				/* About a third of the decal is transparent. */
+				if (&p != &pixels[0] && c < 85)
+					c = TRANSPARENCY_COLOR;
+			}
+		for (const uint16_t i : {0, 1, 2})
+		{
+			auto &bm = GameBitmaps[i + 1];
+			gr_init_bitmap(bm, bm_mode::linear, 0, 0, wh, wh, wh, pixels[i].data());
+			Textures[i + 1] = bitmap_index{static_cast<uint16_t>(i + 1)};
+		}
+		GameBitmaps[3].set_flags(BM_FLAG_TRANSPARENT | BM_FLAG_SUPER_TRANSPARENT);
+	}
+};
+
+}
+
+void benchmark::run_benchmarks(runner &r)
+{
+	fixture f;
+	texmerge_init();
+	const auto bottom = build_texture1_value(texture_index{1});
+	r.run("texmerge_get_cached_bitmap/64x64/miss", [&]{
+		texmerge_flush();
+		do_not_optimize(texmerge_get_cached_bitmap(bottom, build_texture2_value(texture_index{2}, texture2_rotation_high::_1)));
+	});
+	r.run("texmerge_get_cached_bitmap/64x64/miss/supertransparent", [&]{
+		texmerge_flush();
+		do_not_optimize(texmerge_get_cached_bitmap(bottom, build_texture2_value(texture_index{3}, texture2_rotation_high::_1)));
+	});
+	r.run("texmerge_get_cached_bitmap/64x64/hit", [&]{
+		do_not_optimize(texmerge_get_cached_bitmap(bottom, build_texture2_value(texture_index{2}, texture2_rotation_high::_1)));
+	});
+	texmerge_close();
+}
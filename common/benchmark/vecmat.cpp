@@ -0,0 +1,59 @@
+/* Benchmarks of the vector and matrix functions which run for every
+ * vertex and object drawn.
+ */
+#include "benchmark.h"
+#include "vecmat.h"
+#include <array>
+#include <random>
+
+namespace {
+
+constexpr std::size_t count = 256;
+
+/* Vectors of the size found in a mine, and orientations made from them. */
+struct fixture
+{
+	std::array<vms_vector, count> v;
+	std::array<vms_matrix, count> m;
+	fixture()
+	{
+		std::minstd_rand engine(1);
+		std::uniform_int_distribution<int32_t> d{-F1_0 * 1000, F1_0 * 1000};
+		for (auto &i : v)
+			i = {d(engine), d(engine), d(engine)};
+		for (std::size_t i = 0; i < count; ++i)
+			vm_vector_2_matrix(m[i], v[i], &v[(i + 1) % count], nullptr);
+	}
+};
+
+}
+
+void benchmark::run_benchmarks(runner &r)
+{
+	const fixture f;
+	std::size_t i = 0;
+	r.run("vm_vec_rotate", [&]{
+		i = (i + 1) % count;
+		vms_vector dest;
+		vm_vec_rotate(dest, f.v[i], f.m[i]);
+		do_not_optimize(dest);
+	});
+	r.run("vm_vector_2_matrix/fvec", [&]{
+		i = (i + 1) % count;
+		vms_matrix dest;
+		vm_vector_2_matrix(dest, f.v[i], nullptr, nullptr);
+		do_not_optimize(dest);
+	});
+	r.run("vm_vector_2_matrix/fvec+uvec", [&]{
+		i = (i + 1) % count;
+		vms_matrix dest;
+		vm_vector_2_matrix(dest, f.v[i], &f.v[(i + 1) % count], nullptr);
+		do_not_optimize(dest);
+	});
+	r.run("vm_vec_normalize", [&]{
+		i = (i + 1) % count;
+		auto v = f.v[i];
+		vm_vec_normalize(v);
+		do_not_optimize(v);
+	});
+}
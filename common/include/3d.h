@@ -169,9 +169,32 @@ static inline g3s_point g3_rotate_point(const vms_vector &src)
 	return g3_rotate_point(dest, src), dest;
 }
 
+//Structure-of-arrays block of points for batch rotation.  Fill x,y,z
+//with world coordinates, then g3_rotate_point_batch replaces them with
+//the rotated coordinates and fills in codes.
+struct g3s_point_batch
+{
+	static constexpr std::size_t capacity = 8;
+	std::array<fix, capacity> x, y, z;
+	std::array<uint8_t, capacity> codes;
+};
+
+//rotates and codes the first n points of a batch, n <= capacity.
+//Results are identical to calling g3_rotate_point on each point.
+//returns codes_and & codes_or of the n points.
+g3s_codes g3_rotate_point_batch(g3s_point_batch &batch, std::size_t n);
+
+//rotates n points from src into dest.  returns codes_and & codes_or.
+//does not check if already rotated
+g3s_codes g3_rotate_points(g3s_point *dest, const vms_vector *src, std::size_t n);
+
 //projects a point
 void g3_project_point(g3s_point &point);
 
+//projects n points.  Points which are already projected or are behind
+//the viewer are skipped, as in g3_project_point.
+void g3_project_points(g3s_point *points, std::size_t n);
+
 //calculate the depth of a point - returns the z coord of the rotated point
 fix g3_calc_point_depth(const vms_vector &pnt);
 
@@ -111,12 +111,27 @@ struct CArg : prohibit_void_ptr<CArg>
 	bool DbgNoDoubleBuffer;
 	bool DbgNoCompressPigBitmap;
 	bool DbgRenderStats;
+	bool DbgUseOldDynamicLight;
+	unsigned DbgStateHash;
+	bool MplUdpDeltaPos;
+	bool MplUdpInterest;
+	bool MplUdpRelay;
+	unsigned MplUdpRelayDelay;
+#if DXX_USE_UDP
+	bool MplDedicated;
+	unsigned MplDedicatedTick;
+#else
+	static constexpr std::false_type MplDedicated{};
+#endif
 	uint8_t DbgBpp;
 	int8_t DbgVerbose;
 	bool SysNoNiceFPS;
 	int SysMaxFPS;
+	unsigned SysRewindInterval;
+	unsigned SysRewindMemory;
 	uint16_t MplUdpHostPort;
 	uint16_t MplUdpMyPort;
+	uint16_t MplUdpRelayPort;
 #if DXX_USE_TRACKER
 	uint16_t MplTrackerPort;
 	std::string MplTrackerAddr;
@@ -126,6 +141,10 @@ struct CArg : prohibit_void_ptr<CArg>
 	std::string SysPilot;
 	std::string SysRecordDemoNameTemplate;
 	std::string MplUdpHostAddr;
+	std::string MplUdpRelayWatch;
+#if DXX_USE_UDP
+	std::string MplDedicatedRotation;
+#endif
 	std::string DbgAltTex;
 #if !DXX_USE_OGL
 	std::string DbgTexMap;
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Rendering of music ahead of the audio callback.  A worker thread calls
+ * a render function to fill a ring of samples, and the audio callback
+ * only copies out of the ring, so a slow render cannot make the audio
+ * drop out unless it falls behind by the whole ring.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dcx {
+
+class audio_render_ahead
+{
+public:
+	/* Write up to count samples to the given buffer, and return how many
+	 * were written.  Returning less than count ends the stream.  count
+	 * is always the chunk given to start.
+	 */
+	using render_function = std::function<std::size_t(int16_t *samples, std::size_t count)>;
+	~audio_render_ahead()
+	{
+		stop();
+	}
+	/* Stop what runs, then render with render up to ahead samples in
+	 * advance, chunk samples at a time.  chunk must divide ahead rounded
+	 * up to a power of two, which it does if it is a power of two no
+	 * greater than ahead.
+	 */
+	void start(render_function render, std::size_t ahead, std::size_t chunk);
+	/* Wait for the worker to exit.  Nothing is read after this. */
+	void stop();
+	/* Copy up to count samples to out without ever waiting, and return
+	 * how many were copied.  Less than count means the worker fell
+	 * behind or the stream ended.  Only one thread may read.
+	 */
+	std::size_t read(int16_t *out, std::size_t count);
+	/* True once the render function ended the stream and read returned
+	 * all it rendered.
+	 */
+	bool finished() const;
+private:
+	std::vector<int16_t> ring;
+	std::size_t mask = 0, chunk = 0;
+	/* Count every sample ever written and read, so write_pos - read_pos
+	 * is how many samples wait in the ring.
+	 */
+	std::atomic<std::size_t> write_pos{0}, read_pos{0};
+	std::atomic<bool> ended{false};
+	bool stopping = false;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread worker;
+	void run(render_function render);
+};
+
+}
+#endif
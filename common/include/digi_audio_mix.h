@@ -0,0 +1,42 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Mixing of sound samples for the SDL digital audio backend: resampling
+ * of the unsigned 8-bit samples to the output rate, and the sum of all
+ * channels in 32 bits, which becomes signed 16-bit stereo at the end.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+
+namespace dcx {
+
+// frames the mixer works on at once
+constexpr unsigned digi_audio_mix_block = 256;
+
+/* Write up to frames samples of the 8-bit sample of length bytes to
+ * out, from position and frac on, stepping step / 65536 bytes each.
+ * Neighbouring bytes are interpolated linearly.  A looped sample goes
+ * on from the start.  Returns the number written, less than frames if
+ * the sample ended.
+ */
+unsigned digi_audio_resample(const uint8_t *samples, uint32_t length, bool looped, uint32_t step, uint32_t &position, uint32_t &frac, int16_t *out, unsigned frames);
+
+/* Add mono, scaled by vl and vr (1 << 14 is full volume), to the
+ * stereo sums in acc.
+ */
+void digi_audio_mix_stereo(int32_t *acc, const int16_t *mono, unsigned frames, int16_t vl, int16_t vr);
+
+/* Write the sums in acc to out, clipped to 16 bits. */
+void digi_audio_mix_output(int16_t *out, const int32_t *acc, unsigned samples);
+
+}
+#endif
@@ -133,6 +133,13 @@ struct d_event_begin_loop : d_event
 fix event_get_idle_seconds();
 #endif
 
+/* Whether a window does the work of a frame which is not drawing, such
+ * as running the game or polling the network, for this event.  That is
+ * EVENT_WINDOW_DRAW, except at a dedicated host, which is sent no
+ * EVENT_WINDOW_DRAW and does that work on EVENT_IDLE.
+ */
+bool event_is_frame(const d_event &event);
+
 // Process all events until the front window is deleted
 // Won't work if there's the possibility of another window on top
 // without its own event loop
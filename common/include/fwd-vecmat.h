@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include "maths.h"
 #include "dxxsconf.h"
 #include "dsx-ns.h"
@@ -12,6 +13,7 @@
 namespace dcx {
 
 struct vms_vector;
+struct vms_vector_batch;
 class vm_distance_squared;
 
 class vm_distance;
@@ -59,6 +61,10 @@ vm_magnitude vm_vec_mag_quick(const vms_vector &v);
 [[nodiscard]]
 vm_distance vm_vec_dist_quick(const vms_vector &v0, const vms_vector &v1);
 
+//compute vm_vec_dist_quick(v0, points[i]) for the first n points of the
+//batch, storing the results in dest[0..n-1]
+void vm_vec_dist_quick_batch(fix *dest, const vms_vector &v0, const vms_vector_batch &points, std::size_t n);
+
 [[nodiscard]]
 vm_magnitude vm_vec_copy_normalize(vms_vector &dest, const vms_vector &src);
 
@@ -27,6 +27,9 @@ void d_srand (unsigned int seed);
 [[nodiscard]]
 int d_rand ();			// Random number function which returns in the range 0-0x7FFF
 
+[[nodiscard]]
+unsigned d_rand_state();	// The seed d_rand goes on from, for logs which compare two games
+
 
 //=============================== FIXED POINT ===============================
 
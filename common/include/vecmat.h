@@ -26,6 +26,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #pragma once
 
 #ifdef __cplusplus
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <utility>
@@ -39,6 +40,13 @@ struct vms_vector
 	fix x, y, z;
 };
 
+//A block of vectors stored by component, for the batch functions
+struct vms_vector_batch
+{
+	static constexpr std::size_t capacity = 8;
+	std::array<fix, capacity> x{}, y{}, z{};
+};
+
 class vm_distance
 {
 public:
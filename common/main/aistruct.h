@@ -199,6 +199,7 @@ struct ai_local : public prohibit_void_ptr<ai_local>
 #endif
 	fix        player_awareness_time = 0;         // time in seconds robot will be aware of player, 0 means not aware of player
 	fix        time_since_processed = 0;          // time since this robot last processed in do_ai_frame
+	fix        lod_skipped_time = 0;              // frame time skipped by the AI level of detail scheduler, not saved
 	fix64      time_player_seen = 0;              // absolute time in seconds at which player was last seen, might cause to go into follow_path mode
 	fix64      time_player_sound_attacked = 0;    // absolute time in seconds at which player was last seen with visibility of 2.
 	fix64      next_misc_sound_time = 0;          // absolute time in seconds at which this robot last made an angry or lurking sound.
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Dedicated host: runs UDP netgames without video, sound or input, from
+ * a rotation of missions, controlled from the console on stdin.
+ *
+ */
+
+#pragma once
+
+#include "dxxsconf.h"
+
+#if DXX_USE_UDP
+#ifdef dsx
+namespace dsx {
+/* Host the games listed in the rotation file given to -dedicated, one
+ * after the other and starting over after the last, until the quit
+ * command or until no game of the rotation can start.
+ */
+void dedicated_host_run();
+}
+#endif
+#endif
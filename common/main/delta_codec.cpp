@@ -0,0 +1,97 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Encoding of a buffer as the difference to the buffer before it.
+ *
+ */
+
+#include "delta_codec.h"
+
+namespace dcx {
+
+namespace {
+
+// shorter runs of equal bytes are sent as part of the bytes which differ
+constexpr std::size_t delta_min_copy = 4;
+
+void put_varint(std::vector<uint8_t> &out, std::size_t v)
+{
+	for (; v >= 0x80; v >>= 7)
+		out.push_back((v & 0x7f) | 0x80);
+	out.push_back(v);
+}
+
+bool get_varint(const uint8_t *const data, const std::size_t len, std::size_t &pos, std::size_t &v)
+{
+	v = 0;
+	for (unsigned bits = 0;; bits += 7)
+	{
+		if (pos >= len || bits > 28)
+			return false;
+		const uint8_t b = data[pos++];
+		v |= static_cast<std::size_t>(b & 0x7f) << bits;
+		if (!(b & 0x80))
+			return true;
+	}
+}
+
+std::size_t equal_run(const uint8_t *const prev, const std::size_t prev_len, const uint8_t *const cur, const std::size_t cur_len, const std::size_t pos, const std::size_t limit)
+{
+	std::size_t n = 0;
+	while (n < limit && pos + n < cur_len && pos + n < prev_len && cur[pos + n] == prev[pos + n])
+		++n;
+	return n;
+}
+
+}
+
+void delta_encode(const uint8_t *const prev, const std::size_t prev_len, const uint8_t *const cur, const std::size_t cur_len, std::vector<uint8_t> &out)
+{
+	put_varint(out, cur_len);
+	for (std::size_t pos = 0; pos < cur_len;)
+	{
+		const auto copy = equal_run(prev, prev_len, cur, cur_len, pos, cur_len);
+		const auto literal = pos + copy;
+		auto end = literal;
+		while (end < cur_len && equal_run(prev, prev_len, cur, cur_len, end, delta_min_copy) < delta_min_copy)
+			++end;
+		put_varint(out, copy);
+		put_varint(out, end - literal);
+		out.insert(out.end(), cur + literal, cur + end);
+		pos = end;
+	}
+}
+
+bool delta_decode(const uint8_t *const prev, const std::size_t prev_len, const uint8_t *const data, const std::size_t len, std::vector<uint8_t> &out)
+{
+	std::size_t pos = 0, cur_len;
+	if (!get_varint(data, len, pos, cur_len))
+		return false;
+	std::vector<uint8_t> cur;
+	cur.reserve(cur_len);
+	while (cur.size() < cur_len)
+	{
+		std::size_t copy, literal;
+		if (!get_varint(data, len, pos, copy) || !get_varint(data, len, pos, literal))
+			return false;
+		const auto at = cur.size();
+		if (!copy && !literal)
+			return false;
+		if (copy > cur_len - at || at + copy > prev_len || literal > cur_len - at - copy || literal > len - pos)
+			return false;
+		cur.insert(cur.end(), prev + at, prev + at + copy);
+		cur.insert(cur.end(), data + pos, data + pos + literal);
+		pos += literal;
+	}
+	if (pos != len)
+		return false;
+	out = std::move(cur);
+	return true;
+}
+
+}
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Encoding of a buffer as the difference to the buffer before it, used
+ * for demo frames sent by the spectator relay and for rewind snapshots.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dcx {
+
+/* Append to out the encoding of cur as runs copied from prev at the same
+ * offset, each followed by the bytes which differ.
+ */
+void delta_encode(const uint8_t *prev, std::size_t prev_len, const uint8_t *cur, std::size_t cur_len, std::vector<uint8_t> &out);
+
+/* Read what delta_encode wrote, replacing out.  Returns false
+ * if the data is malformed or does not fill exactly len bytes.
+ */
+bool delta_decode(const uint8_t *prev, std::size_t prev_len, const uint8_t *data, std::size_t len, std::vector<uint8_t> &out);
+
+}
+#endif
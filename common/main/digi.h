@@ -42,6 +42,7 @@ namespace dcx {
 enum class sound_pan : int;
 struct sound_object;
 extern int digi_volume;
+extern unsigned digi_voices;	// sounds the backend plays at once, set when it starts
 
 enum class sound_stack : uint8_t
 {
@@ -35,6 +35,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "dxxsconf.h"
 #include "dsx-ns.h"
 #include <array>
+#include <vector>
 
 namespace dcx {
 struct segmasks
@@ -174,6 +175,27 @@ icsegptridx_t find_point_seg(const d_level_shared_segment_state &, const vms_vec
 //      Return the distance.
 vm_distance find_connected_distance(const vms_vector &p0, vcsegptridx_t seg0, const vms_vector &p1, vcsegptridx_t seg1, int max_depth, WALL_IS_DOORWAY_mask_t wid_flag);
 
+//      Find the distances from p0 in seg0 to many segments with one search,
+//      as find_connected_distance would find each of them with its own.
+//      Call start_connected_distances, then want_connected_distance for
+//      each segment, then find_connected_distances, then read each distance
+//      with connected_distance, which gives up, answers from and fills the
+//      cache the same way find_connected_distance does.
+void start_connected_distances();
+void want_connected_distance(segnum_t seg1, unsigned max_depth);
+void find_connected_distances(const vms_vector &p0, vcsegptridx_t seg0, WALL_IS_DOORWAY_mask_t wid_flag);
+vm_distance connected_distance(const vms_vector &p1, segnum_t seg1, unsigned max_depth);
+
+//	Fill result with every segment whose bounding box comes within radius
+//	of p.  The segments are found through a uniform grid of segment
+//	bounding boxes, built on first use after the grid is invalidated.
+//	The order of the result is unspecified.
+void find_segments_near_point(const vms_vector &p, fix radius, std::vector<segnum_t> &result);
+
+//	Discard the grid used by find_segments_near_point.  Call this whenever
+//	segment geometry changes, such as after loading a level.
+void invalidate_segment_grid();
+
 //create a matrix that describes the orientation of the given segment
 void extract_orient_from_segment(fvcvertptr &vcvertptr, vms_matrix &m, const shared_segment &seg);
 
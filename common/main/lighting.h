@@ -73,6 +73,18 @@ namespace dsx {
 // object's center point is rotated.
 g3s_lrgb compute_object_light(const d_level_unique_light_state &LevelUniqueLightState, vcobjptridx_t obj);
 
+// Clear all dynamic light and forget the lights which cast it.  Call this
+// whenever the vertices change, such as after loading a level.
+void reset_dynamic_light();
+
+// Discard the light probes used by compute_object_light.  Call this whenever
+// segment geometry or static light changes.
+void invalidate_light_probes();
+
+// Update the light probes of the segments in visited, and of those sharing
+// a vertex with them, after their static light changed.
+void update_light_probes(const visited_segment_bitarray_t &visited);
+
 // turn headlight boost on & off
 #if defined(DXX_BUILD_DESCENT_II)
 void toggle_headlight_active(object &);
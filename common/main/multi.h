@@ -108,7 +108,7 @@ enum class network_game_type : uint8_t
 #define MULTI_PROTO_UDP 1 // UDP protocol
 
 // What version of the multiplayer protocol is this? Increment each time something drastic changes in Multiplayer without the version number changes. Reset to 0 each time the version of the game changes
-#define MULTI_PROTO_VERSION	static_cast<uint16_t>(12)
+#define MULTI_PROTO_VERSION	static_cast<uint16_t>(14)
 // PROTOCOL VARIABLES AND DEFINES - END
 
 // limits for Packets (i.e. positional updates) per sec
@@ -505,8 +505,13 @@ void multi_prep_level_objects(const d_powerup_info_array &Powerup_info, const d_
 void multi_prep_level_player();
 void multi_leave_game(void);
 void multi_process_bigdata(playernum_t pnum, const uint8_t *buf, uint_fast32_t len);
+// Size of a message of this type in a multi buffer and its name, 0 and nullptr if there is no such type.
+unsigned multi_message_length(uint8_t type);
+const char *multi_message_name(uint8_t type);
 void multi_make_ghost_player(playernum_t);
 void multi_make_player_ghost(playernum_t);
+void multi_make_observer_ghost(playernum_t);
+bool multi_is_observer(playernum_t);
 }
 #endif
 void multi_define_macro(int key);
@@ -848,6 +853,12 @@ struct netgame_info : prohibit_void_ptr<netgame_info>
 	uint8_t ShowEnemyNames;
 	uint8_t BrightPlayers;
 	uint8_t InvulAppear;
+	/* Set when the host runs with -dedicated.  Its pilot has no ship. */
+	uint8_t DedicatedHost;
+	/* Bit n is set when the pilot in slot n joined with -udp_relay.  It
+	 * only watches, so it has no ship either.
+	 */
+	uint8_t ObserverPlayers;
 	ushort						segments_checksum;
 	int						KillGoal;
 	/* The UI enforces that this steps in units of 5 minutes, but for
@@ -856,7 +867,7 @@ struct netgame_info : prohibit_void_ptr<netgame_info>
 	 * impossible.
 	 */
 	d_time_fix PlayTimeAllowed;
-	fix						level_time;
+	fix						level_time;				// time_level of the host, with hours_level in it
 	int						control_invul_time;
 	int						monitor_vector;
 	short						PacketsPerSec;
@@ -18,7 +18,9 @@
 #include "pack.h"
 #include "ntstring.h"
 #include "fwd-window.h"
+#include "net_udp_wire.h"
 #include <array>
+#include <bitset>
 
 // Exported functions
 #ifdef dsx
@@ -45,6 +47,20 @@ using udp::dispatch;
 }
 
 window_event_result net_udp_setup_game(void);
+/* Host a game of Current_mission at levelnum without the menus, for
+ * -dedicated.  name and mode override the netgame profile unless they
+ * are nullptr.  Returns whether the game started.
+ */
+int net_udp_start_dedicated_game(int levelnum, const network_game_type *mode, const char *name);
+/* Play the game sent by the relay given with -udp_relay_watch, until
+ * the user leaves it.
+ */
+void net_udp_relay_watch();
+/* Receive more of the game while it is played.  Returns
+ * window_event_result::close after stopping playback if it must start
+ * over.
+ */
+window_event_result net_udp_relay_watch_frame();
 }
 #endif
 void net_udp_manual_join_game();
@@ -83,6 +99,23 @@ constexpr std::integral_constant<unsigned, 12> UDP_NETGAMES_PPAGE{}; // Netgames
 #define UDP_MDATA_STOR_MIN_FREE_2JOIN 384 // have at least this many free packet slots before we let someone join the game
 #define UDP_MDATA_PKT_NUM_MIN 1 // start from pkt_num 1 (0 is used to initialize the trace list)
 #define UDP_MDATA_PKT_NUM_MAX (UDP_MDATA_STOR_QUEUE_SIZE*100) // the max value for pkt_num. roll over when we go any higher. this should be smaller than INT_MAX
+#define UDP_MDATA_RESEND_TIME (F1_0/4) // resend MDATA which was not ACK'd within this time
+#define UDP_MDATA_WHEEL_SIZE 64 // slots in the timer wheel keeping MDATA resend times. Must cover more than UDP_MDATA_RESEND_TIME.
+#define UDP_MDATA_WHEEL_TICK (F1_0/32) // time covered by one slot of the timer wheel
+#define UDP_INTEREST_DEPTH 8 // with -udp_interest, robots at most this many segments away from a player always send their position to that player
+#define UDP_INTEREST_DISTANCE (F1_0*200) // ... and so do robots closer than this
+#define UDP_INTEREST_FAR_INTERVAL (F1_0/2) // other robots send their position to that player at most this often
+#define UDP_DEDICATED_TICK_DEFAULT 30 // frames per second which -dedicated simulates, unless -dedicated_tick is given
+constexpr uint16_t UDP_RELAY_PORT_DEFAULT = 42425; // port of the spectator relay
+#define UDP_RELAY_DELAY_DEFAULT 30 // seconds the relay holds the game back from spectators
+#define UDP_RELAY_KEYFRAME_INTERVAL (F1_0*5) // how often the relay writes a header, where spectators may start watching
+#define UDP_RELAY_SUBSCRIBE_INTERVAL (F1_0/4) // how often a spectator tells the relay what it received
+#define UDP_RELAY_RESEND_INTERVAL (F1_0/2) // how long the relay waits for that before it sends again
+#define UDP_RELAY_TIMEOUT (F1_0*10) // the relay forgets spectators it has not heard from for this long
+#define UDP_RELAY_MAX_VIEWERS 64
+#define UDP_RELAY_MAX_UNACKED (32*1024) // bytes the relay sends a spectator beyond what it ACKed
+#define UDP_RELAY_WATCH_PREROLL 20 // frames a spectator collects before it starts playing
+#define UDP_RELAY_DEMO "relay.dem" // file in DEMO_DIR where a spectator keeps the stream
 
 // UDP-Packet identificators (ubyte) and their (max. sizes).
 #define UPID_VERSION_DENY			  1 // Netgame join or info has been denied due to version difference.
@@ -100,7 +133,7 @@ constexpr std::integral_constant<unsigned, 12> UDP_NETGAMES_PPAGE{}; // Netgames
 #define UPID_ADDPLAYER				  7 // Packet from Host containing info about a new player.
 #define UPID_REQUEST				  8 // New player says: "I want to be inside of you!" (haha, sorry I could not resist) / Packet containing request to join the game actually.
 #define UPID_QUIT_JOINING			  9 // Packet from a player who suddenly quits joining.
-#define UPID_SEQUENCE_SIZE			 (3 + (CALLSIGN_LEN+1))
+#define UPID_SEQUENCE_SIZE			 (4 + (CALLSIGN_LEN+1))
 #define UPID_SYNC				 10 // Packet from host containing full netgame info to sync players up.
 #define UPID_OBJECT_DATA			 11 // Packet from host containing object buffer.
 #define UPID_PING				 12 // Packet from host containing his GameTime and the Ping list. Client returns this time to host as UPID_PONG and adapts the ping list.
@@ -109,13 +142,7 @@ constexpr std::integral_constant<unsigned, 12> UDP_NETGAMES_PPAGE{}; // Netgames
 #define UPID_PONG_SIZE				 10
 #define UPID_ENDLEVEL_H				 14 // Packet from Host to all Clients containing connect-states and kills information about everyone in the game.
 #define UPID_ENDLEVEL_C				 15 // Packet from Client to Host containing connect-state and kills information from this Client.
-#define UPID_PDATA				 16 // Packet from player containing his movement data.
-#define UPID_PDATA_SIZE				 49
-#define UPID_MDATA_PNORM			 17 // Packet containing multi buffer from a player. Priority 0,1 - no ACK needed.
-#define UPID_MDATA_PNEEDACK			 18 // Packet containing multi buffer from a player. Priority 2 - ACK needed. Also contains pkt_num
-#define UPID_MDATA_ACK				 19 // ACK packet for UPID_MDATA_P1.
-#define UPID_MAX_SIZE			       1024 // Max size for a packet
-#define UPID_MDATA_BUF_SIZE			454
+// UPID 16 to 20, 27 and 28 carry per-frame game traffic and are in net_udp_wire.h.
 #if DXX_USE_TRACKER
 #define UPID_TRACKER_REGISTER			 21 // Register or update a game on the tracker.
 #define UPID_TRACKER_REMOVE			 22 // Remove our game from the tracker.
@@ -124,6 +151,9 @@ constexpr std::integral_constant<unsigned, 12> UDP_NETGAMES_PPAGE{}; // Netgames
 #define UPID_TRACKER_ACK			 25 // An ACK packet from the tracker
 #define UPID_TRACKER_HOLEPUNCH			 26 // Hole punching process. Sent from client to tracker to request hole punching from game host and received by host from tracker to initiate hole punching to requesting client
 #endif
+// UPID 29 and 30 belong to the spectator relay and are in net_udp_relay.h.
+#define UPID_STATE_HASH				 31 // With -state_hash, hashes of the game state. Clients send theirs to the host, and the host sends its own to every client.
+#define UPID_STATE_HASH_SIZE			 22 // UPID_STATE_HASH, pnum, 32-bit interval, 32-bit hash of each state_hash_subsystem.
 
 // Structure keeping lite game infos (for netlist, etc.)
 #if defined(DXX_BUILD_DESCENT_I) || defined(DXX_BUILD_DESCENT_II)
@@ -151,6 +181,7 @@ struct UDP_sequence_packet : prohibit_void_ptr<UDP_sequence_packet>
 {
 	ubyte           		type;
 	netplayer_info  		player;
+	uint8_t				observer;	// set when the player joins with -udp_relay, so it only watches
 };
 
 // packet structure for multi-buffer
@@ -167,22 +198,68 @@ struct UDP_mdata_info : prohibit_void_ptr<UDP_mdata_info>
 struct UDP_mdata_store : prohibit_void_ptr<UDP_mdata_store>
 {
 	fix64				pkt_initial_timestamp;			// initial timestamp to see if packet is outdated
-	std::array<fix64, MAX_PLAYERS>		pkt_timestamp;		// Packet timestamp
+	fix64				pkt_timestamp;				// when the packet was last sent to the players which have not ACK'd it
 	std::array<uint32_t, MAX_PLAYERS>	pkt_num;			// Packet number
 	sbyte				used;
 	ubyte				Player_num;				// sender of this packet
 	uint16_t			data_size;
-	std::array<uint8_t, MAX_PLAYERS>		player_ack; 		// 0 if player has not ACK'd this packet, 1 if ACK'd or not connected
+	std::bitset<MAX_PLAYERS>	player_ack_pending;			// set for each player which has not ACK'd this packet
+	uint16_t			wheel_prev, wheel_next;			// neighbours in the same timer wheel slot, UDP_MDATA_STOR_QUEUE_SIZE if none
 	std::array<uint8_t, UPID_MDATA_BUF_SIZE> data;		// extra data of a packet - contains all multibuf data we don't want to loose
 };
 
+// first and last packet in the MDATA store whose next resend falls into one slot of the timer wheel, UDP_MDATA_STOR_QUEUE_SIZE if none
+struct UDP_mdata_wheel_slot
+{
+	uint16_t			head;
+	uint16_t			tail;
+};
+
 // structure to keep track of MDATA packets we already got, which we expect from another player and the pkt_num for the next packet we want to send to another player
 struct UDP_mdata_check : public prohibit_void_ptr<UDP_mdata_check>
 {
-	std::array<uint32_t, UDP_MDATA_STOR_QUEUE_SIZE>			pkt_num; 	// all those we got just recently, so we can ignore them if we get them again
-	int				cur_slot; 				// index we can use for a new pkt_num
+	uint32_t			pkt_num_received;			// how many packets we got in order since the trace was cleared, at most UDP_MDATA_STOR_QUEUE_SIZE. The ones before pkt_num_torecv are repeats.
 	uint32_t			pkt_num_torecv; 			// the next pkt_num we await for this player
 	uint32_t			pkt_num_tosend; 			// the next pkt_num we want to send to another player
+	std::array<uint16_t, UDP_MDATA_STOR_QUEUE_SIZE>	pkt_queue_slot;	// [pkt_num % UDP_MDATA_STOR_QUEUE_SIZE] where in the MDATA store a packet we sent to this player is
+};
+
+// per-peer buffer collecting the packets of one network frame for a single UPID_BUNDLE datagram
+struct UDP_bundle_peer : public prohibit_void_ptr<UDP_bundle_peer>
+{
+	uint8_t				capable;				// 1 if this peer sent us a UPID_BUNDLE of our UPID_BUNDLE_VERSION
+	uint8_t				features;				// UPID_BUNDLE_FEATURE_* flags from the last bundle of this peer
+	uint8_t				count;					// number of packets in buf
+	uint16_t			len;					// used bytes of buf, including the header
+	std::array<uint8_t, UPID_MAX_SIZE>	buf;
 };
 
+#define UDP_TELEMETRY_TYPES 128 // UPID and MULTI_* types which are counted
+#define UDP_TELEMETRY_PEERS (MAX_PLAYERS + 1) // one per player, the last for traffic which is not with a player in the game
+#define UDP_TELEMETRY_TOP 8 // types shown on the overlay
+
+// traffic of one type of packet or multi message, to or from one peer
+struct UDP_telemetry_counter
+{
+	uint32_t			packets;
+	uint32_t			bytes;
+	uint32_t			resends;				// MDATA resent because it was not ACK'd, counted in addition to packets and bytes
+};
+
+using UDP_telemetry_table = std::array<std::array<UDP_telemetry_counter, UDP_TELEMETRY_TYPES>, UDP_TELEMETRY_PEERS>;
+
+// traffic of one type during the last second, for the overlay
+struct UDP_telemetry_rate
+{
+	const char			*name;
+	uint32_t			packets;
+	uint32_t			bytes;
+	uint32_t			resends;
+};
+
+extern uint8_t UDP_telemetry_overlay;
+extern std::array<UDP_telemetry_rate, UDP_TELEMETRY_TOP> UDP_telemetry_top; // busiest types of the last second, most bytes first
+extern unsigned UDP_telemetry_top_count;
+void net_udp_telemetry_init();
+
 #endif
@@ -0,0 +1,192 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Worker thread for name resolution and tracker traffic.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "net_udp_async.h"
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#endif
+
+namespace dcx {
+
+namespace {
+
+#ifdef DXX_HAVE_GETADDRINFO
+struct addrinfo_deleter
+{
+	void operator()(addrinfo *p) const
+	{
+		freeaddrinfo(p);
+	}
+};
+#endif
+
+/* Resolve host, like udp_dns_filladdr in net_udp.cpp, but without
+ * reporting the error to the user, since this runs on the worker.
+ */
+int udp_async_resolve(const char *const host, const uint16_t port, const int family, const bool numeric_only, sockaddr_storage &addr, socklen_t &addrlen)
+{
+	addrlen = 0;
+#ifdef DXX_HAVE_GETADDRINFO
+	char sPort[6];
+	snprintf(sPort, sizeof(sPort), "%hu", port);
+	addrinfo hints{};
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
+#ifdef AI_NUMERICSERV
+	hints.ai_flags |= AI_NUMERICSERV;
+#endif
+#ifdef AF_INET6
+	if (family == AF_INET6)
+		hints.ai_flags |= AI_V4MAPPED | AI_ALL;
+#endif
+	if (numeric_only)
+		hints.ai_flags |= AI_NUMERICHOST;
+	addrinfo *p = nullptr;
+	const int r = getaddrinfo(host, sPort, &hints, &p);
+	std::unique_ptr<addrinfo, addrinfo_deleter> result(p);
+	if (r != 0)
+		return r;
+	if (result->ai_addrlen > sizeof(addr))
+		return -1;
+	memcpy(&addr, result->ai_addr, addrlen = result->ai_addrlen);
+#else
+	(void)numeric_only;
+	/* Only the worker calls gethostbyname, so its static result is
+	 * safe to use here.
+	 */
+	const auto he = gethostbyname(host);
+	if (!he)
+		return -1;
+	sockaddr_in sai{};
+	sai.sin_family = family;
+	sai.sin_port = htons(port);
+	sai.sin_addr = *reinterpret_cast<const in_addr *>(he->h_addr);
+	memcpy(&addr, &sai, addrlen = sizeof(sai));
+#endif
+	return 0;
+}
+
+}
+
+udp_async_io::~udp_async_io()
+{
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	if (worker.joinable())
+		worker.join();
+}
+
+unsigned udp_async_io::enqueue(request &&r)
+{
+	unsigned id;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		if (!++next_id)
+			++next_id;
+		id = r.id = next_id;
+		requests.emplace_back(std::move(r));
+		if (!worker.joinable())
+			worker = std::thread(&udp_async_io::run, this);
+	}
+	wake.notify_one();
+	return id;
+}
+
+unsigned udp_async_io::resolve(const char *const host, const uint16_t port, const int family, const bool numeric_only)
+{
+	return enqueue(request{0, port, family, numeric_only, udp_async_no_socket, host, {}});
+}
+
+unsigned udp_async_io::send(const udp_async_socket socket, const char *const host, const uint16_t port, const int family, const uint8_t *const data, const std::size_t len)
+{
+	return enqueue(request{0, port, family, false, socket, host, std::vector<uint8_t>(data, data + len)});
+}
+
+std::size_t udp_async_io::poll(std::vector<udp_async_completion> &out)
+{
+	std::lock_guard<std::mutex> l(lock);
+	const auto n = completions.size();
+	out.insert(out.end(), completions.begin(), completions.end());
+	completions.clear();
+	return n;
+}
+
+bool udp_async_io::wait_idle(const std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> l(lock);
+	return idle.wait_for(l, timeout, [this]{ return requests.empty() && !busy; });
+}
+
+void udp_async_io::cancel_sends()
+{
+	std::lock_guard<std::mutex> l(lock);
+	requests.erase(std::remove_if(requests.begin(), requests.end(), [](const request &r) { return r.socket != udp_async_no_socket; }), requests.end());
+	/* A send which was already taken from the queue checks this, while
+	 * holding the lock, before it calls sendto.
+	 */
+	++send_generation;
+}
+
+void udp_async_io::process(request &r, udp_async_completion &c)
+{
+	auto &ca = cache;
+	if (r.socket == udp_async_no_socket || ca.host != r.host || ca.port != r.port || ca.family != r.family || !ca.addrlen)
+	{
+		ca.addrlen = 0;
+		c.resolve_error = udp_async_resolve(r.host.c_str(), r.port, r.family, r.numeric_only, ca.addr, ca.addrlen);
+		if (c.resolve_error)
+			return;
+		ca.host = r.host;
+		ca.port = r.port;
+		ca.family = r.family;
+	}
+	c.addrlen = ca.addrlen;
+	memcpy(&c.addr, &ca.addr, ca.addrlen);
+}
+
+void udp_async_io::run()
+{
+	std::unique_lock<std::mutex> l(lock);
+	for (;;)
+	{
+		wake.wait(l, [this]{ return stopping || !requests.empty(); });
+		if (stopping)
+			break;
+		auto r = std::move(requests.front());
+		requests.pop_front();
+		busy = true;
+		const auto generation = send_generation;
+		l.unlock();
+		udp_async_completion c{};
+		c.id = r.id;
+		c.sent = -1;
+		process(r, c);
+		l.lock();
+		if (r.socket != udp_async_no_socket && c.addrlen && generation == send_generation)
+			c.sent = sendto(r.socket, reinterpret_cast<const char *>(r.payload.data()), r.payload.size(), 0, reinterpret_cast<const sockaddr *>(&c.addr), c.addrlen);
+		completions.emplace_back(c);
+		busy = false;
+		if (requests.empty())
+			idle.notify_all();
+	}
+}
+
+}
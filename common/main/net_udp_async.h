@@ -0,0 +1,120 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * A worker thread for the network operations of the UDP protocol which
+ * can block: name resolution, and traffic to the tracker, which needs
+ * the address of the tracker first.  The game queues requests and polls
+ * for their completions from its event loop, so a slow resolver cannot
+ * freeze the menus or the game.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif
+
+namespace dcx {
+
+#ifdef _WIN32
+using udp_async_socket = SOCKET;
+constexpr udp_async_socket udp_async_no_socket = INVALID_SOCKET;
+#else
+using udp_async_socket = int;
+constexpr udp_async_socket udp_async_no_socket = -1;
+#endif
+
+struct udp_async_completion
+{
+	unsigned id;			// what udp_async_io::resolve or udp_async_io::send returned
+	int resolve_error;		// 0 if the host was resolved, otherwise the error of the resolver
+	ssize_t sent;			// for a send, what sendto returned, or -1 if it was not called
+	socklen_t addrlen;		// 0 if the host was not resolved
+	sockaddr_storage addr;
+};
+
+class udp_async_io
+{
+	struct request
+	{
+		unsigned id;
+		uint16_t port;
+		int family;
+		bool numeric_only;
+		udp_async_socket socket;	// udp_async_no_socket if only resolving
+		std::string host;
+		std::vector<uint8_t> payload;
+	};
+	struct cached_address
+	{
+		std::string host;
+		uint16_t port = 0;
+		int family = 0;
+		socklen_t addrlen = 0;
+		sockaddr_storage addr;
+	};
+	std::mutex lock;
+	std::condition_variable wake, idle;
+	std::deque<request> requests;
+	std::vector<udp_async_completion> completions;
+	std::thread worker;
+	unsigned next_id = 0;
+	unsigned send_generation = 0;
+	bool busy = false, stopping = false;
+	/* Only used by the worker. */
+	cached_address cache;
+	unsigned enqueue(request &&);
+	void run();
+	void process(request &, udp_async_completion &);
+public:
+	udp_async_io() = default;
+	udp_async_io(const udp_async_io &) = delete;
+	udp_async_io &operator=(const udp_async_io &) = delete;
+	~udp_async_io();
+	/* Queue a lookup of host.  With numeric_only, names are refused, so
+	 * the lookup never waits for the network.  Returns the id of the
+	 * request, which is never 0.
+	 */
+	unsigned resolve(const char *host, uint16_t port, int family, bool numeric_only);
+	/* Queue a datagram for host, sent from socket.  The worker keeps
+	 * the last address it resolved, so sending to the same host again
+	 * does not resolve it again.
+	 */
+	unsigned send(udp_async_socket socket, const char *host, uint16_t port, int family, const uint8_t *data, std::size_t len);
+	/* Append the completed requests to out, in the order they were
+	 * queued.  Returns how many were added.
+	 */
+	std::size_t poll(std::vector<udp_async_completion> &out);
+	/* Wait up to timeout for every queued request to complete.
+	 * Returns whether they did.
+	 */
+	bool wait_idle(std::chrono::milliseconds timeout);
+	/* Drop the queued sends.  No send is in progress after this
+	 * returns, so the caller may close the sockets.
+	 */
+	void cancel_sends();
+};
+
+}
+#endif
@@ -0,0 +1,31 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Cookies of the spectator relay.
+ *
+ */
+
+#include "net_udp_relay.h"
+
+namespace dcx {
+
+uint32_t udp_relay_cookie(const uint64_t secret, const void *const addr, const std::size_t addr_len)
+{
+	// FNV-1a, keyed by starting from the secret, then mixed so that every bit of the address moves every bit of the cookie.
+	uint64_t h = secret ^ UINT64_C(0xcbf29ce484222325);
+	const auto a = static_cast<const uint8_t *>(addr);
+	for (std::size_t i = 0; i < addr_len; ++i)
+		h = (h ^ a[i]) * UINT64_C(0x100000001b3);
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	const auto cookie = static_cast<uint32_t>(h ^ (h >> 32));
+	return cookie ? cookie : 1;
+}
+
+}
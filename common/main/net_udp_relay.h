@@ -0,0 +1,48 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Packets of the spectator relay, which sends the demo recording of a
+ * netgame to viewers.  Each demo frame is sent as the difference to the
+ * frame before it, encoded by delta_codec.h.  Nothing here depends on
+ * game state.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+
+#define UPID_RELAY_SUBSCRIBE			 29 // Viewer to relay: send me the stream. Repeated every UDP_RELAY_SUBSCRIBE_INTERVAL as the ACK of what arrived.
+#define UPID_RELAY_SUBSCRIBE_SIZE		 10 // UPID_RELAY_SUBSCRIBE, UDP_RELAY_VERSION, 32-bit sequence number of the next entry the viewer needs, 32-bit cookie from UPID_RELAY_CHALLENGE.
+#define UPID_RELAY_DATA				 30 // Relay to viewer: one part of one entry of the stream.
+#define UPID_RELAY_DATA_HEADER_SIZE		 10 // UPID_RELAY_DATA, udp_relay_kind, 32-bit sequence number, 16-bit part, 16-bit number of parts. The part follows.
+#define UPID_RELAY_CHALLENGE			 32 // Relay to viewer: the cookie to subscribe with, in answer to a subscription without it.
+#define UPID_RELAY_CHALLENGE_SIZE		  6 // UPID_RELAY_CHALLENGE, UDP_RELAY_VERSION, 32-bit cookie.
+#define UDP_RELAY_VERSION			  2
+
+namespace dcx {
+
+enum class udp_relay_kind : uint8_t
+{
+	keyframe,	// header of a recording, for viewers who start watching here; sent without data to the others
+	restart,	// header of a new recording, which every viewer starts again from
+	intra,		// a frame of the recording, complete
+	delta,		// a frame of the recording, as the difference to the frame before it
+};
+
+/* The cookie which a viewer at the address addr must subscribe with.
+ * Only who receives at addr learns it, and the relay keeps no state
+ * for an address until the cookie comes back.  It is never 0, which a
+ * viewer sends until it has a cookie.
+ */
+uint32_t udp_relay_cookie(uint64_t secret, const void *addr, std::size_t addr_len);
+
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Encoding of position deltas for the UDP protocol.
+ *
+ */
+
+#include "net_udp_wire.h"
+#include "d_range.h"
+
+namespace dcx {
+
+std::size_t udp_write_pdata_delta(uint8_t *const buf, const pdata_delta_values &from, const pdata_delta_values &to, pdata_delta_values &rounded)
+{
+	uint16_t mask = 0;
+	std::size_t len = 2;
+	for (const auto i : xrange(pdata_delta_fields))
+	{
+		const unsigned shift = pdata_delta_shift[i];
+		// Differences are taken modulo 2^32, so they always fit and add back to the same value.
+		const auto difference = static_cast<int32_t>(static_cast<uint32_t>(to[i]) - static_cast<uint32_t>(from[i]));
+		const auto q = shift ? static_cast<int32_t>((int64_t{difference} + (int64_t{1} << (shift - 1))) >> shift) : difference;
+		rounded[i] = static_cast<int32_t>(static_cast<uint32_t>(from[i]) + (static_cast<uint32_t>(q) << shift));
+		if (!q)
+			continue;
+		mask |= 1 << i;
+		// zigzag coded, 7 bits per byte, lowest bits first
+		auto z = (static_cast<uint32_t>(q) << 1) ^ static_cast<uint32_t>(q >> 31);
+		for (; z >= 0x80; z >>= 7)
+			buf[len++] = (z & 0x7f) | 0x80;
+		buf[len++] = z;
+	}
+	PUT_INTEL_SHORT(buf, mask);
+	return len;
+}
+
+bool udp_read_pdata_delta(const uint8_t *const buf, const std::size_t len, const pdata_delta_values &from, pdata_delta_values &result)
+{
+	if (len < 2)
+		return false;
+	const uint16_t mask = GET_INTEL_SHORT(buf);
+	pdata_delta_values v;
+	std::size_t pos = 2;
+	for (const auto i : xrange(pdata_delta_fields))
+	{
+		int32_t q = 0;
+		if (mask & (1 << i))
+		{
+			uint32_t z = 0;
+			for (unsigned bits = 0;; bits += 7)
+			{
+				if (pos >= len || bits > 28)
+					return false;
+				const uint8_t b = buf[pos++];
+				z |= static_cast<uint32_t>(b & 0x7f) << bits;
+				if (!(b & 0x80))
+					break;
+			}
+			q = static_cast<int32_t>((z >> 1) ^ (0u - (z & 1)));
+		}
+		v[i] = static_cast<int32_t>(static_cast<uint32_t>(from[i]) + (static_cast<uint32_t>(q) << pdata_delta_shift[i]));
+	}
+	if (pos != len)
+		return false;
+	result = v;
+	return true;
+}
+
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Packets of the UDP protocol which carry per-frame game traffic, and
+ * the encoding of bundles and position deltas.  Nothing here depends on
+ * game state, so tools such as the loopback soak test can speak the same
+ * protocol as net_udp.cpp.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "byteutil.h"
+
+#define UPID_PDATA				 16 // Packet from player containing his movement data.
+#define UPID_PDATA_SIZE				 49
+#define UPID_MDATA_PNORM			 17 // Packet containing multi buffer from a player. Priority 0,1 - no ACK needed.
+#define UPID_MDATA_PNEEDACK			 18 // Packet containing multi buffer from a player. Priority 2 - ACK needed. Also contains pkt_num
+#define UPID_MDATA_ACK				 19 // ACK packet for UPID_MDATA_P1.
+#define UPID_BUNDLE				 20 // Several PDATA, MDATA and ACK packets for one peer packed into a single datagram.
+#define UPID_BUNDLE_VERSION			  1 // Format of UPID_BUNDLE. A peer only receives bundles after it sent one with this version.
+#define UPID_BUNDLE_HEADER_SIZE			  3 // UPID_BUNDLE, UPID_BUNDLE_VERSION, UPID_BUNDLE_FEATURE_* flags. Each packet then follows as a 16-bit length and its data.
+#define UPID_BUNDLE_FEATURE_PDATA_DELTA		  1 // Sender of the bundle can read UPID_PDATA_DELTA.
+#define UPID_MAX_SIZE			       1024 // Max size for a packet
+#define UPID_MDATA_BUF_SIZE			454
+#define UPID_PDATA_DELTA			 27 // Player movement data as quantized differences to a state the receiver has ACK'd. Only sent to peers with UPID_BUNDLE_FEATURE_PDATA_DELTA.
+#define UPID_PDATA_DELTA_HEADER_SIZE		  9 // UPID_PDATA_DELTA, pnum, connected, 16-bit seq, 16-bit seq of the base state, 16-bit mask of the fields which follow.
+#define UPID_PDATA_DELTA_SIZE_MAX		 79 // 9 byte header and up to 5 bytes for each of the 14 fields.
+#define UPID_PDATA_ACK				 28 // ACK packet for UPID_PDATA_DELTA.
+#define UPID_PDATA_ACK_SIZE			  5
+#define UDP_PDATA_HISTORY			 32 // How many sent and received states are kept to encode and decode UPID_PDATA_DELTA.
+
+namespace dcx {
+
+// orient w, x, y, z, pos x, y, z, segment, vel x, y, z, rotvel x, y, z
+constexpr std::size_t pdata_delta_fields = 14;
+using pdata_delta_values = std::array<int32_t, pdata_delta_fields>;
+
+// how many low bits of the difference of each field are rounded away
+constexpr std::array<uint8_t, pdata_delta_fields> pdata_delta_shift{{
+	0, 0, 0, 0,	// orient
+	4, 4, 4,	// pos
+	0,		// segment
+	4, 4, 4,	// vel
+	4, 4, 4,	// rotvel
+}};
+
+/* Write the mask and the fields of a UPID_PDATA_DELTA which changes
+ * `from` to `to`.  buf must have room for
+ * UPID_PDATA_DELTA_SIZE_MAX - UPID_PDATA_DELTA_HEADER_SIZE + 2 bytes.
+ * rounded gets the state the receiver will have after reading it.
+ * Returns the number of bytes written.
+ */
+std::size_t udp_write_pdata_delta(uint8_t *buf, const pdata_delta_values &from, const pdata_delta_values &to, pdata_delta_values &rounded);
+
+/* Read what udp_write_pdata_delta wrote, applying it to `from`.
+ * Returns false if the data is malformed or does not fill exactly len
+ * bytes.
+ */
+bool udp_read_pdata_delta(const uint8_t *buf, std::size_t len, const pdata_delta_values &from, pdata_delta_values &result);
+
+/* Append one packet to a bundle of len bytes, writing the bundle header
+ * first if the bundle is empty.  Returns false, leaving the bundle
+ * unchanged, if there is no room for the packet.
+ */
+template <std::size_t N>
+bool udp_bundle_append(std::array<uint8_t, N> &bundle, uint16_t &len, const uint8_t features, const uint8_t *const data, const std::size_t data_len)
+{
+	const std::size_t used = len ? len : UPID_BUNDLE_HEADER_SIZE;
+	if (used + 2 + data_len > N)
+		return false;
+	if (!len)
+	{
+		bundle[0] = UPID_BUNDLE;
+		bundle[1] = UPID_BUNDLE_VERSION;
+		bundle[2] = features;
+	}
+	PUT_INTEL_SHORT(&bundle[used], static_cast<uint16_t>(data_len));
+	std::copy(data, data + data_len, &bundle[used + 2]);
+	len = used + 2 + data_len;
+	return true;
+}
+
+/* Call f(packet, packet_len) for every packet of a bundle, stopping at
+ * the first one whose length does not fit.  The caller checks the header.
+ */
+template <typename F>
+void udp_bundle_for_each(uint8_t *const data, const std::size_t data_len, F &&f)
+{
+	for (std::size_t len = UPID_BUNDLE_HEADER_SIZE; len + 2 <= data_len;)
+	{
+		const std::size_t packet_len = GET_INTEL_SHORT(&data[len]);
+		len += 2;
+		if (!packet_len || packet_len > data_len - len)
+			break;
+		f(&data[len], packet_len);
+		len += packet_len;
+	}
+}
+
+}
+#endif
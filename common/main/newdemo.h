@@ -33,6 +33,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "fwd-weapon.h"
 #include "fwd-window.h"
 #include "dsx-ns.h"
+#include <vector>
 
 #define ND_STATE_NORMAL			0
 #define ND_STATE_RECORDING		1
@@ -65,6 +66,19 @@ extern int Newdemo_show_percentage;
 extern int Auto_demo;
 extern int Newdemo_num_written;
 
+// A copy of the recording, which the spectator relay sends to its viewers
+struct newdemo_relay_tap
+{
+	std::vector<uint8_t> stream;	// bytes recorded since the relay last took them
+	std::size_t header_end = 0;	// if restarted, where the header of the recording ends in stream
+	std::size_t frame_end = 0;	// where the last ND_EVENT_START_FRAME ends in stream, or 0
+	bool restarted = false;		// a new recording started, and stream starts with its header
+};
+extern newdemo_relay_tap *Newdemo_relay_tap;
+// While a relay stream is played, playback reads no further than this
+// offset of the demo file.  0 when playing an ordinary demo.
+extern PHYSFS_sint64 Newdemo_live_end;
+
 namespace dcx {
 enum class sound_pan : int;
 }
@@ -85,6 +99,9 @@ icobjptridx_t newdemo_find_object(object_signature_t signature);
 void newdemo_record_kill_sound_linked_to_object(vcobjptridx_t);
 void newdemo_start_playback(const char *filename);
 void newdemo_record_morph_frame(vcobjptridx_t);
+// Write the header of a new recording of the current game into out,
+// without disturbing the recording in progress.
+void newdemo_relay_keyframe(std::vector<uint8_t> &out);
 }
 #endif
 void newdemo_record_sound_3d_once( int soundno, sound_pan angle, int volume );
@@ -203,6 +203,7 @@ struct player_config : prohibit_void_ptr<player_config>
 		int AlphaBlendEClips;
 	};
 	int DynLightColor;
+	int ObjectLightProbes;
 	d_sp_gameplay_options SPGameplayOptions;
 };
 
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Rewinding a single player game to a snapshot taken a few seconds ago.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "dsx-ns.h"
+
+#define REWIND_MEMORY_DEFAULT 64 // megabytes of snapshots kept for rewind
+
+#ifdef dsx
+namespace dcx {
+
+/* Copy game state into a snapshot, or back out of it.  Saving and
+ * restoring make the same calls in the same order, so the two cannot
+ * disagree about the layout.
+ */
+class rewind_state
+{
+	std::vector<uint8_t> &data;
+	std::size_t pos = 0;
+	const bool restoring;
+public:
+	rewind_state(std::vector<uint8_t> &d, const bool r) :
+		data(d), restoring(r)
+	{
+	}
+	bool is_restoring() const
+	{
+		return restoring;
+	}
+	void bytes(void *const p, const std::size_t n)
+	{
+		if (!restoring)
+		{
+			const auto b = reinterpret_cast<const uint8_t *>(p);
+			data.insert(data.end(), b, b + n);
+		}
+		else if (pos <= data.size() && n <= data.size() - pos)
+			memcpy(p, &data[pos], n);
+		pos += n;
+	}
+	template <typename T>
+		void operator()(T &t)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "snapshots copy the raw bytes of the state");
+			bytes(&t, sizeof(t));
+		}
+	template <typename T>
+		void operator()(T *const t, const std::size_t n)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "snapshots copy the raw bytes of the state");
+			bytes(t, n * sizeof(T));
+		}
+};
+
+/* Size the arena from -rewind_memory and add the rewind command. */
+void rewind_init();
+
+}
+
+namespace dsx {
+
+/* Copy the AI state which ai.cpp keeps to itself. */
+void ai_rewind_state(rewind_state &);
+/* Take a snapshot if -rewind seconds of game time passed since the last. */
+void rewind_poll_capture();
+
+}
+#endif
@@ -0,0 +1,124 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Ring of snapshots for rewinding the game.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "rewind_buffer.h"
+#include "delta_codec.h"
+
+namespace dcx {
+
+void rewind_buffer::reset(const std::size_t c, const unsigned k)
+{
+	arena.assign(c, 0);
+	arena.shrink_to_fit();
+	keyframe_interval = std::max(k, 1u);
+	clear();
+}
+
+void rewind_buffer::clear()
+{
+	entries.clear();
+	newest.clear();
+	head = used = 0;
+	since_keyframe = 0;
+}
+
+void rewind_buffer::drop_oldest()
+{
+	/* The differences which follow a keyframe cannot be read without it,
+	 * so they go with it.
+	 */
+	do {
+		used -= entries.front().length;
+		entries.pop_front();
+	} while (!entries.empty() && !entries.front().keyframe);
+	if (entries.empty())
+		head = 0;
+}
+
+bool rewind_buffer::push(const uint8_t *const data, const std::size_t len)
+{
+	const bool keyframe = entries.empty() || since_keyframe + 1 >= keyframe_interval || newest.size() != len;
+	scratch.clear();
+	if (keyframe)
+		delta_encode(nullptr, 0, data, len, scratch);
+	else
+		delta_encode(newest.data(), newest.size(), data, len, scratch);
+	const auto n = scratch.size();
+	if (n > arena.size())
+	{
+		clear();
+		return false;
+	}
+	auto at = head;
+	if (at + n > arena.size())
+	{
+		/* Leave the end of the arena unused.  The entries there are the
+		 * oldest, and go before those at the start.
+		 */
+		while (!entries.empty() && entries.front().offset >= at)
+			drop_oldest();
+		at = 0;
+	}
+	while (!entries.empty() && entries.front().offset < at + n && at < entries.front().offset + entries.front().length)
+		drop_oldest();
+	/* A difference whose keyframe was just dropped is stored whole. */
+	if (!keyframe && entries.empty())
+		return push(data, len);
+	memcpy(&arena[at], scratch.data(), n);
+	entries.push_back({at, n, keyframe});
+	head = at + n;
+	used += n;
+	since_keyframe = keyframe ? 0 : since_keyframe + 1;
+	newest.assign(data, data + len);
+	return true;
+}
+
+bool rewind_buffer::decode(const entry &e, std::vector<uint8_t> &prev, std::vector<uint8_t> &out) const
+{
+	if (e.keyframe)
+		return delta_decode(nullptr, 0, &arena[e.offset], e.length, out);
+	return delta_decode(prev.data(), prev.size(), &arena[e.offset], e.length, out);
+}
+
+bool rewind_buffer::restore(const std::size_t back, std::vector<uint8_t> &out)
+{
+	if (back >= entries.size())
+		return false;
+	const auto target = entries.size() - 1 - back;
+	auto first = target;
+	while (!entries[first].keyframe)
+		--first;
+	std::vector<uint8_t> prev;
+	for (auto i = first; i <= target; ++i)
+	{
+		if (!decode(entries[i], prev, out))
+		{
+			clear();
+			return false;
+		}
+		prev = out;
+	}
+	while (entries.size() > target + 1)
+	{
+		used -= entries.back().length;
+		entries.pop_back();
+	}
+	const auto &last = entries.back();
+	head = last.offset + last.length;
+	since_keyframe = target - first;
+	newest = std::move(prev);
+	return true;
+}
+
+}
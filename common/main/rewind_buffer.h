@@ -0,0 +1,79 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Ring of snapshots for rewinding the game, kept in one arena allocated
+ * up front.  Each snapshot is stored as the difference to the one before
+ * it, except every few, which are stored whole so that the oldest can be
+ * dropped.  Nothing here depends on game state.
+ *
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace dcx {
+
+class rewind_buffer
+{
+public:
+	/* Drop every snapshot, then hold snapshots in capacity bytes, storing
+	 * one whole after every keyframe_interval - 1 differences.
+	 */
+	void reset(std::size_t capacity, unsigned keyframe_interval);
+	/* Drop every snapshot, but keep the arena. */
+	void clear();
+	/* Add a snapshot of len bytes as the newest, dropping the oldest until
+	 * it fits.  Returns false, and holds nothing, if it cannot fit even
+	 * in an empty arena.
+	 */
+	bool push(const uint8_t *data, std::size_t len);
+	/* Replace out with the snapshot back steps before the newest, and drop
+	 * the snapshots newer than it, so the next push follows it.  Returns
+	 * false if there are not that many snapshots.
+	 */
+	bool restore(std::size_t back, std::vector<uint8_t> &out);
+	std::size_t size() const
+	{
+		return entries.size();
+	}
+	/* Bytes of the arena which snapshots use. */
+	std::size_t memory_used() const
+	{
+		return used;
+	}
+	std::size_t capacity() const
+	{
+		return arena.size();
+	}
+private:
+	struct entry
+	{
+		std::size_t offset, length;
+		bool keyframe;
+	};
+	std::vector<uint8_t> arena;
+	/* Oldest first.  The entries lie in the arena in the same order,
+	 * wrapping around its end, so the oldest always follows where the
+	 * newest ends.
+	 */
+	std::deque<entry> entries;
+	/* The newest snapshot, whole, for the next difference. */
+	std::vector<uint8_t> newest, scratch;
+	std::size_t head = 0, used = 0;
+	unsigned keyframe_interval = 1, since_keyframe = 0;
+	void drop_oldest();
+	bool decode(const entry &e, std::vector<uint8_t> &prev, std::vector<uint8_t> &out) const;
+};
+
+}
+#endif
@@ -81,6 +81,11 @@ enum class deny_save_result
 
 int state_get_game_id(const d_game_unique_state::savegame_file_path &filename);
 
+/* Wait until the savegame which state_save_all_sub is still writing in
+ * the background is on disk.
+ */
+void state_wait_for_pending_save();
+
 }
 
 #ifdef dsx
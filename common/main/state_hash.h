@@ -0,0 +1,98 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Hashes of the game state, to find where two copies of a game went
+ * apart.  With -state_hash, each peer of a netgame hashes the state every
+ * few seconds and compares with the host, and a recorded demo carries the
+ * hashes so that playback can compare with them.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "dsx-ns.h"
+
+#define STATE_HASH_HISTORY 8 // hashes kept to compare with a peer which is that many intervals behind
+
+namespace dcx {
+
+/* Only state which every copy of the game agrees on once the messages in
+ * flight arrived.  Positions are not hashed, since every peer sees the
+ * others where they were one ping ago.  A dump of robots shows them.
+ */
+enum class state_hash_subsystem : uint8_t
+{
+	walls,
+	triggers,
+	reactor,
+	robots,
+};
+
+constexpr std::size_t state_hash_subsystems = 4;
+using state_hash = std::array<uint32_t, state_hash_subsystems>;
+
+constexpr unsigned state_hash_bit(const state_hash_subsystem s)
+{
+	return 1u << static_cast<unsigned>(s);
+}
+
+constexpr unsigned state_hash_all = (1u << state_hash_subsystems) - 1;
+
+/* What one source of hashes, a peer or a demo, disagreed on so far. */
+struct state_hash_source
+{
+	int level = 0;
+	/* Subsystems which differed at the last check.  A subsystem must
+	 * differ twice in a row to be reported, since a message in flight
+	 * makes it differ for a moment.
+	 */
+	unsigned differing = 0;
+	/* Subsystems already reported on level. */
+	unsigned reported = 0;
+	/* The last hash received, until ours of the same interval exists. */
+	bool has_pending = false;
+	uint32_t pending_seq = 0;
+	state_hash pending{};
+};
+
+}
+
+#ifdef dsx
+namespace dsx {
+
+state_hash state_hash_compute();
+/* The -state_hash interval of the level which the local player is in.
+ * It counts from the level time, which a player who joins a running
+ * netgame takes from the host, so that every peer numbers the same
+ * interval the same.
+ */
+uint32_t state_hash_interval();
+/* Hash the state if the level entered the next -state_hash interval
+ * since the last call, keep the hash to compare later, and return true
+ * with the interval in seq.
+ */
+bool state_hash_poll(uint32_t &seq, state_hash &);
+/* Our hash of interval seq of this level, or nullptr if it is not kept. */
+const state_hash *state_hash_find(uint32_t seq);
+/* Compare the subsystems in mask, and when the first of them differs a
+ * second time, report it and write its state to the console log.
+ */
+void state_hash_check(state_hash_source &, const char *source_name, const state_hash &ours, const state_hash &theirs, unsigned mask);
+/* Check the pending hash of a peer against ours of the same interval, if
+ * we have that one yet.  Call it when a hash arrives and when
+ * state_hash_poll hashed, since a peer may be ahead or behind.  A hash
+ * of an interval which we already passed, and no longer keep or never
+ * hashed, is dropped.
+ */
+void state_hash_match(state_hash_source &, const char *source_name);
+
+}
+#endif
@@ -28,6 +28,11 @@ int d_rand()
 	return rand() & 0x7fff;
 }
 
+unsigned d_rand_state()
+{
+	return 0;
+}
+
 #else
 
 static unsigned int d_rand_seed;
@@ -42,6 +47,11 @@ void d_srand(unsigned int seed)
 	d_rand_seed = seed;
 }
 
+unsigned d_rand_state()
+{
+	return d_rand_seed;
+}
+
 #endif
 
 }
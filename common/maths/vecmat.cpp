@@ -18,6 +18,11 @@
 #include "maths.h"
 #include "vecmat.h"
 #include "dxxerror.h"
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 namespace dcx {
 
@@ -221,6 +226,103 @@ vm_distance vm_vec_dist_quick(const vms_vector &v0,const vms_vector &v1)
 	return vm_vec_mag_quick(vm_vec_sub(v0,v1));
 }
 
+namespace {
+
+/* The batch kernel must produce exactly what vm_vec_mag_quick produces.
+ * The swaps in vm_vec_mag_quick sort the absolute values of the
+ * components, so the kernel computes the largest, middle and smallest
+ * with signed min/max.  labs(INT32_MIN) truncated back to a fix is
+ * INT32_MIN, which is also what the vector absolute value gives.
+ */
+#if defined(__AVX2__)
+using batch_vector = __m256i;
+constexpr std::size_t batch_width = 8;
+
+static inline batch_vector batch_load(const fix *p)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+static inline void batch_store(fix *p, const batch_vector v)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+static inline batch_vector batch_set1(const int32_t i)
+{
+	return _mm256_set1_epi32(i);
+}
+
+#define batch_abs	_mm256_abs_epi32
+#define batch_add	_mm256_add_epi32
+#define batch_sub	_mm256_sub_epi32
+#define batch_min	_mm256_min_epi32
+#define batch_max	_mm256_max_epi32
+#define batch_srai	_mm256_srai_epi32
+#elif defined(__SSE4_1__)
+using batch_vector = __m128i;
+constexpr std::size_t batch_width = 4;
+
+static inline batch_vector batch_load(const fix *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+static inline void batch_store(fix *p, const batch_vector v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+static inline batch_vector batch_set1(const int32_t i)
+{
+	return _mm_set1_epi32(i);
+}
+
+#define batch_abs	_mm_abs_epi32
+#define batch_add	_mm_add_epi32
+#define batch_sub	_mm_sub_epi32
+#define batch_min	_mm_min_epi32
+#define batch_max	_mm_max_epi32
+#define batch_srai	_mm_srai_epi32
+#endif
+
+}
+
+#ifdef batch_sub
+static_assert(vms_vector_batch::capacity % batch_width == 0, "batch capacity must be a multiple of the vector width");
+
+void vm_vec_dist_quick_batch(fix *const dest, const vms_vector &v0, const vms_vector_batch &points, const std::size_t n)
+{
+	std::array<fix, vms_vector_batch::capacity> result;
+	const auto px = batch_set1(v0.x), py = batch_set1(v0.y), pz = batch_set1(v0.z);
+	for (std::size_t i = 0; i < n; i += batch_width)
+	{
+		const auto a = batch_abs(batch_sub(px, batch_load(&points.x[i])));
+		const auto b = batch_abs(batch_sub(py, batch_load(&points.y[i])));
+		const auto c = batch_abs(batch_sub(pz, batch_load(&points.z[i])));
+		const auto hi = batch_max(batch_max(a, b), c);
+		const auto mid = batch_max(batch_min(a, b), batch_min(batch_max(a, b), c));
+		const auto lo = batch_min(batch_min(a, b), c);
+		const auto bc = batch_add(batch_srai(mid, 2), batch_srai(lo, 3));
+		batch_store(&result[i], batch_add(batch_add(hi, bc), batch_srai(bc, 1)));
+	}
+	std::copy_n(result.begin(), n, dest);
+}
+
+#undef batch_abs
+#undef batch_add
+#undef batch_sub
+#undef batch_min
+#undef batch_max
+#undef batch_srai
+#else
+void vm_vec_dist_quick_batch(fix *const dest, const vms_vector &v0, const vms_vector_batch &points, const std::size_t n)
+{
+	for (std::size_t i = 0; i != n; ++i)
+		dest[i] = vm_vec_dist_quick(v0, vms_vector{points.x[i], points.y[i], points.z[i]});
+}
+#endif
+
 //normalize a vector. returns mag of source vec
 vm_magnitude vm_vec_copy_normalize(vms_vector &dest,const vms_vector &src)
 {
@@ -12,6 +12,7 @@
  * Based on work of Arne de Bruijn and the JFFEE project
  */
 #include <stdexcept>
+#include <string>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -693,8 +694,52 @@ struct midhdr
 
 DEFINE_SERIAL_CONST_UDT_TO_MESSAGE(midhdr, m, (magic_header, m.num_trks, m.time_div, tempo));
 
+namespace {
+
+struct hmp2mid_cache_entry
+{
+	std::string key;	// where the song came from, as hmp2mid_cache_key makes it
+	std::vector<uint8_t> midbuf;
+};
+
+/* Levels share few songs, so the last conversions are kept for the rest
+ * of the session instead of converting the song again at each level.
+ */
+static std::array<hmp2mid_cache_entry, 8> hmp2mid_cache;
+static unsigned hmp2mid_cache_next;
+
+/* The name, the length and the search path element of the song, so that a
+ * mission which replaces a song with its own does not get the old one.
+ */
+static std::string hmp2mid_cache_key(const char *const hmp_name)
+{
+	const auto realdir = PHYSFS_getRealDir(hmp_name);
+	if (!realdir)
+		return {};
+	const auto fp = PHYSFSX_openReadBuffered(hmp_name).first;
+	if (!fp)
+		return {};
+	std::string key(hmp_name);
+	key += '\0';
+	key += realdir;
+	key += '\0';
+	key += std::to_string(PHYSFS_fileLength(fp));
+	return key;
+}
+
+}
+
 void hmp2mid(const char *hmp_name, std::vector<uint8_t> &midbuf)
 {
+	auto key = hmp2mid_cache_key(hmp_name);
+	if (key.empty())
+		return;
+	range_for (auto &c, hmp2mid_cache)
+		if (c.key == key)
+		{
+			midbuf = c.midbuf;
+			return;
+		}
 	std::unique_ptr<hmp_file> hmp = hmp_open(hmp_name);
 	if (!hmp)
 		return;
@@ -716,6 +761,9 @@ void hmp2mid(const char *hmp_name, std::vector<uint8_t> &midbuf)
 		be_bytebuffer_t bbmi(&midbuf[midtrklenpos]);
 		serial::process_buffer(bbmi, static_cast<int32_t>(size_after - size_before));
 	}
+	auto &c = hmp2mid_cache[hmp2mid_cache_next++ % hmp2mid_cache.size()];
+	c.key = std::move(key);
+	c.midbuf = midbuf;
 }
 
 }
@@ -0,0 +1,76 @@
+/* Test of the ring which renders music ahead of the audio callback,
+ * read in pieces which do not match the chunks of the worker.
+ */
+#include "audio_render_ahead.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth audio render ahead
+#include <boost/test/unit_test.hpp>
+
+using namespace dcx;
+
+namespace {
+
+/* Read until total samples arrived or the stream finished, as the
+ * audio callback would, in pieces of the given size.
+ */
+std::vector<int16_t> read_all(audio_render_ahead &a, const std::size_t total, const std::size_t piece)
+{
+	std::vector<int16_t> out;
+	std::vector<int16_t> buf(piece);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (out.size() < total && !a.finished() && std::chrono::steady_clock::now() < deadline)
+	{
+		const auto n = a.read(buf.data(), piece);
+		out.insert(out.end(), buf.begin(), buf.begin() + n);
+		if (!n)
+			std::this_thread::yield();
+	}
+	return out;
+}
+
+}
+
+/* Test that every sample arrives once and in order, across many turns
+ * of the ring.
+ */
+BOOST_AUTO_TEST_CASE(in_order)
+{
+	audio_render_ahead a;
+	int16_t next = 0;
+	a.start([&next](int16_t *const samples, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i)
+			samples[i] = next++;
+		return count;
+	}, 1000, 64);
+	const auto out = read_all(a, 100000, 300);
+	a.stop();
+	BOOST_TEST_REQUIRE(out.size() >= 100000u);
+	for (std::size_t i = 0; i < out.size(); ++i)
+		BOOST_TEST_REQUIRE(out[i] == static_cast<int16_t>(i));
+	BOOST_TEST(!a.finished());
+}
+
+/* Test that a short final chunk is read, and then the stream ends. */
+BOOST_AUTO_TEST_CASE(end_of_stream)
+{
+	audio_render_ahead a;
+	std::size_t left = 1000;
+	a.start([&left](int16_t *const samples, const std::size_t count) {
+		const auto n = std::min(count, left);
+		for (std::size_t i = 0; i < n; ++i)
+			samples[i] = static_cast<int16_t>(left - i);
+		left -= n;
+		return n;
+	}, 256, 64);
+	const auto out = read_all(a, 2000, 100);
+	BOOST_TEST(a.finished());
+	BOOST_TEST_REQUIRE(out.size() == 1000u);
+	BOOST_TEST(out.front() == 1000);
+	BOOST_TEST(out.back() == 1);
+	int16_t buf[4];
+	BOOST_TEST(a.read(buf, 4) == 0u);
+}
@@ -0,0 +1,88 @@
+/* Test of the encoding of a buffer as the difference to the buffer
+ * before it, which demo frames of the spectator relay and rewind
+ * snapshots are stored in.
+ */
+#include "delta_codec.h"
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth delta codec
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using namespace dcx;
+
+std::vector<uint8_t> round_trip(const std::vector<uint8_t> &prev, const std::vector<uint8_t> &cur)
+{
+	std::vector<uint8_t> data, out;
+	delta_encode(prev.data(), prev.size(), cur.data(), cur.size(), data);
+	BOOST_TEST_REQUIRE(delta_decode(prev.data(), prev.size(), data.data(), data.size(), out));
+	return out;
+}
+
+std::vector<uint8_t> frame(const std::size_t len, const unsigned seed)
+{
+	std::vector<uint8_t> r(len);
+	for (std::size_t i = 0; i < len; ++i)
+		r[i] = static_cast<uint8_t>((i * 31 + seed) ^ (i >> 3));
+	return r;
+}
+
+}
+
+/* Test that frames come back the same after changes, growing and
+ * shrinking, and that a frame like the one before costs little.
+ */
+BOOST_AUTO_TEST_CASE(delta_round_trip)
+{
+	const auto prev = frame(3000, 1);
+	auto cur = prev;
+	cur[10] ^= 0xff;
+	cur[11] ^= 0xff;
+	cur[2000] = 7;
+	BOOST_TEST(round_trip(prev, cur) == cur);
+	std::vector<uint8_t> data;
+	delta_encode(prev.data(), prev.size(), cur.data(), cur.size(), data);
+	BOOST_TEST(data.size() < 32u);
+
+	cur.insert(cur.begin() + 100, 5, 42);
+	BOOST_TEST(round_trip(prev, cur) == cur);
+	const auto longer = frame(5000, 2);
+	BOOST_TEST(round_trip(prev, longer) == longer);
+	const std::vector<uint8_t> shorter(prev.begin(), prev.begin() + 700);
+	BOOST_TEST(round_trip(prev, shorter) == shorter);
+	BOOST_TEST(round_trip(prev, {}).empty());
+}
+
+/* Test that a frame after a header, which has no frame before it, is
+ * sent whole.
+ */
+BOOST_AUTO_TEST_CASE(intra)
+{
+	const auto cur = frame(1500, 3);
+	BOOST_TEST(round_trip({}, cur) == cur);
+}
+
+/* Test that damaged data is refused, and that the frame passed in is
+ * left alone then.
+ */
+BOOST_AUTO_TEST_CASE(malformed)
+{
+	const auto prev = frame(400, 4);
+	auto cur = prev;
+	cur[200] = 0;
+	std::vector<uint8_t> data;
+	delta_encode(prev.data(), prev.size(), cur.data(), cur.size(), data);
+	std::vector<uint8_t> out{1, 2, 3};
+	for (std::size_t len = 0; len < data.size(); ++len)
+		BOOST_TEST(!delta_decode(prev.data(), prev.size(), data.data(), len, out));
+	auto extra = data;
+	extra.push_back(0);
+	BOOST_TEST(!delta_decode(prev.data(), prev.size(), extra.data(), extra.size(), out));
+	// copies more than the frame before has
+	BOOST_TEST(!delta_decode(prev.data(), 100, data.data(), data.size(), out));
+	const uint8_t endless[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+	BOOST_TEST(!delta_decode(prev.data(), prev.size(), endless, sizeof(endless), out));
+	BOOST_TEST((out == std::vector<uint8_t>{1, 2, 3}));
+}
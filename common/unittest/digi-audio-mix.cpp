@@ -0,0 +1,70 @@
+/* Test of the sound mixer kernels against plain loops, for every
+ * length around the block sizes of SSE2 and NEON.
+ */
+#include "digi_audio_mix.h"
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth digi audio mix
+#include <boost/test/unit_test.hpp>
+
+using namespace dcx;
+
+BOOST_AUTO_TEST_CASE(mix_stereo)
+{
+	for (unsigned frames = 0; frames < 40; ++frames)
+	{
+		std::vector<int16_t> mono(frames);
+		std::vector<int32_t> acc(2 * frames), expect(2 * frames);
+		for (unsigned i = 0; i < frames; ++i)
+		{
+			mono[i] = static_cast<int16_t>(i * 2731 - 32768);
+			acc[2 * i] = expect[2 * i] = i * 7;
+			acc[2 * i + 1] = expect[2 * i + 1] = -static_cast<int32_t>(i);
+		}
+		const int16_t vl = 16384, vr = 5000;
+		for (unsigned i = 0; i < frames; ++i)
+		{
+			expect[2 * i] += (mono[i] * vl) >> 14;
+			expect[2 * i + 1] += (mono[i] * vr) >> 14;
+		}
+		digi_audio_mix_stereo(acc.data(), mono.data(), frames, vl, vr);
+		BOOST_TEST(acc == expect);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mix_output_clips)
+{
+	const std::vector<int32_t> acc{0, 1, -1, 32767, 32768, -32768, -32769, 100000, -100000, 12345, -12345};
+	std::vector<int16_t> out(acc.size());
+	digi_audio_mix_output(out.data(), acc.data(), acc.size());
+	const std::vector<int16_t> expect{0, 1, -1, 32767, 32767, -32768, -32768, 32767, -32768, 12345, -12345};
+	BOOST_TEST(out == expect);
+}
+
+BOOST_AUTO_TEST_CASE(resample)
+{
+	const uint8_t samples[] = {0x80, 0x90, 0x70, 0xff};
+	std::vector<int16_t> out(16);
+	uint32_t position = 0, frac = 0;
+	// At the rate of the sound, every byte is taken as it is.
+	BOOST_TEST(digi_audio_resample(samples, sizeof(samples), false, 0x10000, position, frac, out.data(), out.size()) == 4u);
+	BOOST_TEST(out[0] == 0);
+	BOOST_TEST(out[1] == 0x10 * 256);
+	BOOST_TEST(out[2] == -0x10 * 256);
+	BOOST_TEST(out[3] == 0x7f * 256);
+
+	// At twice the rate, every other sample is between two bytes.
+	position = frac = 0;
+	BOOST_TEST(digi_audio_resample(samples, sizeof(samples), false, 0x8000, position, frac, out.data(), out.size()) == 8u);
+	BOOST_TEST(out[1] == 0x08 * 256);
+	BOOST_TEST(out[3] == 0);
+
+	// A looped sound goes on from the start, and interpolates towards it.
+	position = 3;
+	frac = 0x8000;
+	BOOST_TEST(digi_audio_resample(samples, sizeof(samples), true, 0x10000, position, frac, out.data(), 3) == 3u);
+	BOOST_TEST(out[0] == (0x7f * 256 + ((-0x7f * 0x8000) >> 8)));
+	BOOST_TEST(out[1] == (0 + ((0x10 * 0x8000) >> 8)));
+	BOOST_TEST(position == 2u);
+}
@@ -0,0 +1,164 @@
+#include "3d.h"
+#include "common/3d/globvars.h"
+#include "d_range.h"
+#include <array>
+#include <limits>
+#include <random>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth points
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+constexpr std::size_t test_point_count = 1000;
+
+/* Pick values which exercise both ordinary mine coordinates and the
+ * extremes of the fix range, where the intermediate 64-bit sums and the
+ * 32-bit truncation matter.
+ */
+struct fix_generator
+{
+	std::minstd_rand engine;
+	std::uniform_int_distribution<int32_t> full{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()};
+	std::uniform_int_distribution<int32_t> mine{-F1_0 * 4000, F1_0 * 4000};
+	std::uniform_int_distribution<int32_t> unit{-F1_0, F1_0};
+	std::uniform_int_distribution<unsigned> selector{0, 7};
+	fix_generator(const unsigned seed) :
+		engine(seed)
+	{
+	}
+	fix operator()()
+	{
+		switch (selector(engine))
+		{
+			case 0:
+				return full(engine);
+			case 1:
+				return std::numeric_limits<int32_t>::min();
+			case 2:
+				return std::numeric_limits<int32_t>::max();
+			case 3:
+				return 0;
+			default:
+				return mine(engine);
+		}
+	}
+	vms_vector vector()
+	{
+		const auto x = (*this)();
+		const auto y = (*this)();
+		const auto z = (*this)();
+		return {x, y, z};
+	}
+	vms_vector unit_vector()
+	{
+		const auto x = unit(engine);
+		const auto y = unit(engine);
+		const auto z = unit(engine);
+		return {x, y, z};
+	}
+};
+
+void set_random_view(fix_generator &g, const bool extreme_matrix)
+{
+	View_position = g.vector();
+	View_matrix.rvec = extreme_matrix ? g.vector() : g.unit_vector();
+	View_matrix.uvec = extreme_matrix ? g.vector() : g.unit_vector();
+	View_matrix.fvec = extreme_matrix ? g.vector() : g.unit_vector();
+}
+
+void check_batch_matches_scalar(fix_generator &g)
+{
+	std::array<vms_vector, test_point_count> src;
+	for (auto &s : src)
+		s = g.vector();
+	std::array<g3s_point, test_point_count> batch_result, scalar_result;
+	g3s_codes scalar_cc;
+	for (const auto i : xrange(test_point_count))
+	{
+		const auto c = g3_rotate_point(scalar_result[i], src[i]);
+		scalar_cc.uand &= c;
+		scalar_cc.uor |= c;
+	}
+	const auto batch_cc = g3_rotate_points(batch_result.data(), src.data(), test_point_count);
+	BOOST_TEST(batch_cc.uand == scalar_cc.uand);
+	BOOST_TEST(batch_cc.uor == scalar_cc.uor);
+	for (const auto i : xrange(test_point_count))
+	{
+		auto &b = batch_result[i];
+		auto &s = scalar_result[i];
+		BOOST_TEST(b.p3_x == s.p3_x);
+		BOOST_TEST(b.p3_y == s.p3_y);
+		BOOST_TEST(b.p3_z == s.p3_z);
+		BOOST_TEST(b.p3_codes == s.p3_codes);
+		BOOST_TEST(b.p3_flags == s.p3_flags);
+	}
+}
+
+}
+
+/* Test that batch rotation is bit-exact with g3_rotate_point for a
+ * normal (unit length) view matrix.
+ */
+BOOST_AUTO_TEST_CASE(rotate_points_unit_matrix)
+{
+	fix_generator g(1);
+	for (const auto i : xrange(16u))
+	{
+		(void)i;
+		set_random_view(g, false);
+		check_batch_matches_scalar(g);
+	}
+}
+
+/* Test that batch rotation is bit-exact with g3_rotate_point when the
+ * matrix and positions are arbitrary, so that products overflow 32 bits
+ * and truncation of the result matters.
+ */
+BOOST_AUTO_TEST_CASE(rotate_points_extreme_matrix)
+{
+	fix_generator g(2);
+	for (const auto i : xrange(16u))
+	{
+		(void)i;
+		set_random_view(g, true);
+		check_batch_matches_scalar(g);
+	}
+}
+
+/* Test that partial batches, including counts which are not a multiple
+ * of the vector width, only report codes for the points requested.
+ */
+BOOST_AUTO_TEST_CASE(rotate_point_batch_partial)
+{
+	fix_generator g(3);
+	set_random_view(g, false);
+	for (const auto n : xrange(std::size_t{1}, g3s_point_batch::capacity + 1))
+	{
+		g3s_point_batch batch;
+		std::array<vms_vector, g3s_point_batch::capacity> src;
+		for (const auto i : xrange(n))
+		{
+			src[i] = g.vector();
+			batch.x[i] = src[i].x;
+			batch.y[i] = src[i].y;
+			batch.z[i] = src[i].z;
+		}
+		const auto batch_cc = g3_rotate_point_batch(batch, n);
+		g3s_codes scalar_cc;
+		for (const auto i : xrange(n))
+		{
+			g3s_point s;
+			const auto c = g3_rotate_point(s, src[i]);
+			scalar_cc.uand &= c;
+			scalar_cc.uor |= c;
+			BOOST_TEST(batch.x[i] == s.p3_x);
+			BOOST_TEST(batch.y[i] == s.p3_y);
+			BOOST_TEST(batch.z[i] == s.p3_z);
+			BOOST_TEST(batch.codes[i] == c);
+		}
+		BOOST_TEST(batch_cc.uand == scalar_cc.uand);
+		BOOST_TEST(batch_cc.uor == scalar_cc.uor);
+	}
+}
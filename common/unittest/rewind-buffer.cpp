@@ -0,0 +1,86 @@
+/* Test of the ring of snapshots for rewinding, as it fills, wraps around
+ * its arena and is rewound.
+ */
+#include "rewind_buffer.h"
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth rewind buffer
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using namespace dcx;
+
+/* A snapshot which changes a little from one step to the next, as game
+ * state does.
+ */
+std::vector<uint8_t> snapshot(const unsigned step)
+{
+	std::vector<uint8_t> r(4000);
+	for (std::size_t i = 0; i < r.size(); ++i)
+		r[i] = static_cast<uint8_t>(i * 7 + (i % 97 == 0 ? step : 0));
+	return r;
+}
+
+}
+
+/* Test that every snapshot held comes back the same, that the arena
+ * wraps without corrupting what remains, and that memory stays bounded.
+ */
+BOOST_AUTO_TEST_CASE(wrap_and_restore)
+{
+	rewind_buffer b;
+	b.reset(20000, 4);
+	for (unsigned step = 0; step < 100; ++step)
+	{
+		const auto s = snapshot(step);
+		BOOST_TEST_REQUIRE(b.push(s.data(), s.size()));
+		BOOST_TEST_REQUIRE(b.memory_used() <= b.capacity());
+	}
+	/* Differences are small, so more fit than whole snapshots would. */
+	BOOST_TEST(b.size() > 5u);
+	const auto held = b.size();
+	for (std::size_t back = 0; back < held; ++back)
+	{
+		rewind_buffer c = b;
+		std::vector<uint8_t> out;
+		BOOST_TEST_REQUIRE(c.restore(back, out));
+		BOOST_TEST_REQUIRE(out == snapshot(99 - back));
+		BOOST_TEST(c.size() == held - back);
+	}
+	std::vector<uint8_t> out;
+	BOOST_TEST(!b.restore(held, out));
+}
+
+/* Test that pushing after a rewind continues from the restored snapshot. */
+BOOST_AUTO_TEST_CASE(push_after_restore)
+{
+	rewind_buffer b;
+	b.reset(50000, 8);
+	for (unsigned step = 0; step < 10; ++step)
+	{
+		const auto s = snapshot(step);
+		b.push(s.data(), s.size());
+	}
+	std::vector<uint8_t> out;
+	BOOST_TEST_REQUIRE(b.restore(3, out));
+	BOOST_TEST(out == snapshot(6));
+	const auto s = snapshot(50);
+	BOOST_TEST_REQUIRE(b.push(s.data(), s.size()));
+	BOOST_TEST_REQUIRE(b.restore(0, out));
+	BOOST_TEST(out == s);
+	BOOST_TEST_REQUIRE(b.restore(1, out));
+	BOOST_TEST(out == snapshot(6));
+}
+
+/* Test that a snapshot too large for the arena is refused. */
+BOOST_AUTO_TEST_CASE(too_large)
+{
+	rewind_buffer b;
+	b.reset(1000, 4);
+	const auto s = snapshot(0);
+	BOOST_TEST(!b.push(s.data(), s.size()));
+	BOOST_TEST(b.size() == 0u);
+	BOOST_TEST(b.memory_used() == 0u);
+}
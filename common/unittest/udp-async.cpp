@@ -0,0 +1,175 @@
+/* Test of the worker for name resolution and tracker traffic against a
+ * stand-in tracker, which is a UDP socket on 127.0.0.1.
+ */
+#include "net_udp_async.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth udp async
+#include <boost/test/unit_test.hpp>
+
+#ifndef _WIN32
+namespace {
+
+using namespace dcx;
+
+// as in net_udp.h
+constexpr uint8_t UPID_TRACKER_REGISTER = 21;
+constexpr uint8_t UPID_TRACKER_REQGAMES = 23;
+constexpr uint8_t UPID_TRACKER_ACK = 25;
+
+struct loopback_socket
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	uint16_t port = 0;
+	loopback_socket()
+	{
+		sockaddr_in a{};
+		a.sin_family = AF_INET;
+		a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(fd, reinterpret_cast<const sockaddr *>(&a), sizeof(a));
+		socklen_t len = sizeof(a);
+		getsockname(fd, reinterpret_cast<sockaddr *>(&a), &len);
+		port = ntohs(a.sin_port);
+		// Never hang the test if a datagram does not come.
+		timeval tv{};
+		tv.tv_sec = 2;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+	~loopback_socket()
+	{
+		close(fd);
+	}
+	ssize_t receive(std::vector<uint8_t> &buf, sockaddr_in *from = nullptr) const
+	{
+		buf.resize(1024);
+		sockaddr_in a{};
+		socklen_t len = sizeof(a);
+		const auto r = recvfrom(fd, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr *>(&a), &len);
+		buf.resize(r > 0 ? r : 0);
+		if (from)
+			*from = a;
+		return r;
+	}
+};
+
+/* Poll like the event loop does, until n requests completed. */
+std::vector<udp_async_completion> poll_until(udp_async_io &io, const std::size_t n)
+{
+	std::vector<udp_async_completion> done;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (io.poll(done), done.size() < n && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return done;
+}
+
+}
+
+/* Test that the tracker is resolved, that the packets for it arrive in
+ * the order they were queued, and that its ACK comes back to the game
+ * socket which sent them.
+ */
+BOOST_AUTO_TEST_CASE(tracker_round_trip)
+{
+	loopback_socket tracker, game;
+	udp_async_io io;
+	const uint8_t reg[] = {UPID_TRACKER_REGISTER, 'b', '=', '1'};
+	const uint8_t req[] = {UPID_TRACKER_REQGAMES, '1'};
+	const auto resolve_id = io.resolve("localhost", tracker.port, AF_INET, false);
+	const auto reg_id = io.send(game.fd, "localhost", tracker.port, AF_INET, reg, sizeof(reg));
+	const auto req_id = io.send(game.fd, "localhost", tracker.port, AF_INET, req, sizeof(req));
+	BOOST_TEST(resolve_id != 0u);
+	BOOST_TEST(reg_id != resolve_id);
+	BOOST_TEST(req_id != reg_id);
+
+	const auto done = poll_until(io, 3);
+	BOOST_TEST_REQUIRE(done.size() == 3u);
+	BOOST_TEST(done[0].id == resolve_id);
+	BOOST_TEST(done[1].id == reg_id);
+	BOOST_TEST(done[2].id == req_id);
+	BOOST_TEST(done[0].resolve_error == 0);
+	BOOST_TEST(done[0].sent == -1);
+	BOOST_TEST_REQUIRE(done[0].addrlen == sizeof(sockaddr_in));
+	sockaddr_in resolved;
+	memcpy(&resolved, &done[0].addr, sizeof(resolved));
+	BOOST_TEST(ntohs(resolved.sin_port) == tracker.port);
+	BOOST_TEST(ntohl(resolved.sin_addr.s_addr) == INADDR_LOOPBACK);
+	BOOST_TEST(done[1].sent == static_cast<ssize_t>(sizeof(reg)));
+	BOOST_TEST(done[2].sent == static_cast<ssize_t>(sizeof(req)));
+
+	std::vector<uint8_t> buf;
+	sockaddr_in from;
+	BOOST_TEST_REQUIRE(tracker.receive(buf, &from) == static_cast<ssize_t>(sizeof(reg)));
+	BOOST_TEST(std::equal(buf.begin(), buf.end(), reg));
+	BOOST_TEST(ntohs(from.sin_port) == game.port);
+	BOOST_TEST_REQUIRE(tracker.receive(buf) == static_cast<ssize_t>(sizeof(req)));
+	BOOST_TEST(std::equal(buf.begin(), buf.end(), req));
+
+	const uint8_t ack[] = {UPID_TRACKER_ACK, 0};
+	sendto(tracker.fd, ack, sizeof(ack), 0, reinterpret_cast<const sockaddr *>(&from), sizeof(from));
+	BOOST_TEST_REQUIRE(game.receive(buf) == static_cast<ssize_t>(sizeof(ack)));
+	BOOST_TEST(buf[0] == UPID_TRACKER_ACK);
+}
+
+/* Test that a host which cannot be resolved is reported.  The lookup
+ * is numeric only, so it never waits for the network.
+ */
+BOOST_AUTO_TEST_CASE(resolve_failure)
+{
+	loopback_socket game;
+	udp_async_io io;
+	const auto id = io.resolve("tracker.invalid", 42420, AF_INET, true);
+	const auto done = poll_until(io, 1);
+	BOOST_TEST_REQUIRE(done.size() == 1u);
+	BOOST_TEST(done[0].id == id);
+	BOOST_TEST(done[0].resolve_error != 0);
+	BOOST_TEST(done[0].addrlen == 0u);
+	BOOST_TEST(io.wait_idle(std::chrono::milliseconds(100)));
+}
+
+/* Test that after cancel_sends, the tracker got exactly the packets
+ * which the completions report as sent.
+ */
+BOOST_AUTO_TEST_CASE(cancel_sends)
+{
+	loopback_socket tracker, game;
+	udp_async_io io;
+	constexpr unsigned queued = 200;
+	for (unsigned i = 0; i < queued; ++i)
+	{
+		const uint8_t p[] = {UPID_TRACKER_REQGAMES, static_cast<uint8_t>(i)};
+		io.send(game.fd, "127.0.0.1", tracker.port, AF_INET, p, sizeof(p));
+	}
+	io.cancel_sends();
+	BOOST_TEST(io.wait_idle(std::chrono::seconds(5)));
+	std::vector<udp_async_completion> done;
+	io.poll(done);
+	const auto sent = std::count_if(done.begin(), done.end(), [](const udp_async_completion &c) { return c.sent > 0; });
+	BOOST_TEST(done.size() <= queued);
+
+	timeval tv{};
+	tv.tv_usec = 100000;
+	setsockopt(tracker.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	std::vector<uint8_t> buf;
+	long received = 0;
+	while (tracker.receive(buf) > 0)
+		++received;
+	BOOST_TEST(received == sent);
+}
+#else
+BOOST_AUTO_TEST_CASE(udp_async)
+{
+	BOOST_TEST_MESSAGE("udp async test needs POSIX sockets");
+}
+#endif
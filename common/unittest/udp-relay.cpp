@@ -0,0 +1,24 @@
+/* Test of the cookie spectators subscribe to the relay with.
+ */
+#include "net_udp_relay.h"
+#include <array>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth udp relay
+#include <boost/test/unit_test.hpp>
+
+using namespace dcx;
+
+/* Test that the cookie stays the same for one address and secret, and
+ * changes with either.
+ */
+BOOST_AUTO_TEST_CASE(cookie)
+{
+	std::array<uint8_t, 16> addr{{2, 0, 0x1f, 0x90, 192, 168, 1, 10}};
+	const auto c = udp_relay_cookie(1234, addr.data(), addr.size());
+	BOOST_TEST(c != 0u);
+	BOOST_TEST(udp_relay_cookie(1234, addr.data(), addr.size()) == c);
+	BOOST_TEST(udp_relay_cookie(1235, addr.data(), addr.size()) != c);
+	addr[7] = 11;
+	BOOST_TEST(udp_relay_cookie(1234, addr.data(), addr.size()) != c);
+}
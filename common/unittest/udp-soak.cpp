@@ -0,0 +1,629 @@
+/* Loopback soak test of the UDP game traffic.
+ *
+ * One host and several clients, each with its own UDP socket on
+ * 127.0.0.1, exchange position updates and multi messages for a number of
+ * network frames.  Clients send to the host, which relays to every other
+ * client, as in a real game.  Datagrams are dropped at random to exercise
+ * resends and the fallback to full position updates.  Nothing is drawn and
+ * nothing is played.
+ *
+ * The game keeps its multiplayer state in globals, so several players
+ * cannot run in one process.  Each simulated player follows the rules of
+ * net_udp.cpp for this traffic instead, and shares the packet encoding with
+ * the game through net_udp_wire.h.
+ *
+ * Settings come from the environment:
+ *	DXX_UDP_SOAK_CLIENTS	number of clients, 1 to 7 (default 7)
+ *	DXX_UDP_SOAK_FRAMES	network frames, 30 per second (default 900)
+ *	DXX_UDP_SOAK_LOSS	percent of datagrams dropped (default 5)
+ *	DXX_UDP_SOAK_DELTA	0 to send UPID_PDATA instead of UPID_PDATA_DELTA
+ *
+ * The report gives the time the host spent per frame, the bytes and
+ * packets per second of each packet type the host sent and received, and
+ * the number of resends.  After the last frame, every player must have
+ * the positions and the reliable multi messages of every other player.
+ */
+#include "net_udp_wire.h"
+#include "d_range.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth udp soak
+#include <boost/test/unit_test.hpp>
+
+#ifndef _WIN32
+namespace {
+
+using namespace dcx;
+
+constexpr unsigned max_players = 8;
+constexpr unsigned frames_per_second = 30;
+constexpr unsigned resend_frames = frames_per_second / 4;	// UDP_MDATA_RESEND_TIME
+constexpr unsigned settle_frames = frames_per_second * 2;	// frames without loss or movement before the checks
+
+unsigned soak_setting(const char *const name, const unsigned fallback, const unsigned low, const unsigned high)
+{
+	const auto s = std::getenv(name);
+	if (!s || !*s)
+		return fallback;
+	return std::clamp<unsigned long>(std::strtoul(s, nullptr, 10), low, high);
+}
+
+struct soak_settings
+{
+	const unsigned clients = soak_setting("DXX_UDP_SOAK_CLIENTS", max_players - 1, 1, max_players - 1);
+	const unsigned frames = soak_setting("DXX_UDP_SOAK_FRAMES", frames_per_second * 30, 1, 1000000);
+	const unsigned loss = soak_setting("DXX_UDP_SOAK_LOSS", 5, 0, 50);
+	const bool delta = soak_setting("DXX_UDP_SOAK_DELTA", 1, 0, 1);
+};
+
+/* Rough sizes and rates of common multi messages.  Every player adds
+ * each kind to its multi buffer in one frame out of `one_in`.
+ */
+struct soak_message
+{
+	uint8_t needack;
+	uint8_t size;
+	uint8_t one_in;
+};
+
+constexpr std::array<soak_message, 4> soak_messages{{
+	{0, 20, 3},	// MULTI_FIRE
+	{0, 31, 2},	// MULTI_ROBOT_POSITION
+	{1, 9, 40},	// MULTI_KILL
+	{1, 5, 120},	// MULTI_DOOR_OPEN
+}};
+
+struct pdata_state
+{
+	uint16_t seq;		// 0 if unused
+	pdata_delta_values v;
+};
+
+struct pdata_stream
+{
+	uint16_t next_seq = 1;
+	uint16_t acked_seq = 0;
+	std::array<pdata_state, UDP_PDATA_HISTORY> sent{};
+};
+
+struct mdata_pending
+{
+	uint32_t pkt_num;
+	unsigned sent_frame;
+	std::vector<uint8_t> packet;
+};
+
+// What a player keeps about one peer it talks to
+struct peer_link
+{
+	sockaddr_in addr{};
+	std::array<uint8_t, UPID_MAX_SIZE> bundle;
+	uint16_t bundle_len = 0;
+	std::array<pdata_stream, max_players> pdata;	// states sent to this peer, [player the state belongs to]
+	uint32_t pkt_num_tosend = 1, pkt_num_torecv = 1;
+	std::deque<mdata_pending> unacked;
+};
+
+struct soak_player
+{
+	unsigned pnum;
+	int fd = -1;
+	std::minstd_rand rng;
+	pdata_delta_values truth{};
+	std::array<std::array<pdata_state, UDP_PDATA_HISTORY>, max_players> recv{};	// states received, [player the state belongs to]
+	std::array<pdata_delta_values, max_players> view{};
+	std::array<uint16_t, max_players> view_seq{};
+	std::array<peer_link, max_players> links;	// the host talks to every client, a client only to links[0]
+	uint32_t messages_sent = 0;
+	std::array<uint32_t, max_players> messages_received{};	// [player which sent them]
+	unsigned message_errors = 0;
+	soak_player(const unsigned p) :
+		pnum(p), rng(p + 1)
+	{
+	}
+	~soak_player()
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+	soak_player(const soak_player &) = delete;
+	soak_player &operator=(const soak_player &) = delete;
+};
+
+struct traffic
+{
+	uint64_t packets = 0, bytes = 0;
+};
+
+struct soak_net
+{
+	const soak_settings settings;
+	std::vector<std::unique_ptr<soak_player>> players;
+	std::minstd_rand loss_rng{1};
+	unsigned frame = 0;
+	bool settling = false;
+	// everything below is counted for the host only
+	std::array<traffic, 256> out, in;	// by packet type
+	traffic datagrams_out, datagrams_in;
+	unsigned resends = 0, dropped = 0;
+	std::chrono::steady_clock::duration frame_time{}, frame_time_max{};
+};
+
+void count(std::array<traffic, 256> &t, const uint8_t *const packet, const std::size_t len)
+{
+	auto &c = t[packet[0]];
+	++c.packets;
+	c.bytes += len;
+}
+
+void flush(soak_net &net, soak_player &p, peer_link &link)
+{
+	if (!link.bundle_len)
+		return;
+	if (!net.settling && std::uniform_int_distribution<unsigned>(0, 99)(net.loss_rng) < net.settings.loss)
+		++net.dropped;
+	else
+		sendto(p.fd, link.bundle.data(), link.bundle_len, 0, reinterpret_cast<const sockaddr *>(&link.addr), sizeof(link.addr));
+	if (!p.pnum)
+	{
+		++net.datagrams_out.packets;
+		net.datagrams_out.bytes += link.bundle_len;
+	}
+	link.bundle_len = 0;
+}
+
+void send_packet(soak_net &net, soak_player &p, const unsigned dest, const uint8_t *const data, const std::size_t len)
+{
+	auto &link = p.links[dest];
+	if (!udp_bundle_append(link.bundle, link.bundle_len, UPID_BUNDLE_FEATURE_PDATA_DELTA, data, len))
+	{
+		flush(net, p, link);
+		udp_bundle_append(link.bundle, link.bundle_len, UPID_BUNDLE_FEATURE_PDATA_DELTA, data, len);
+	}
+	if (!p.pnum)
+		count(net.out, data, len);
+}
+
+/* Send the state of player `owner` to player dest, as net_udp_send_pdata_to does. */
+void send_pdata(soak_net &net, soak_player &p, const unsigned dest, const unsigned owner, const pdata_delta_values &v)
+{
+	if (!net.settings.delta)
+	{
+		std::array<uint8_t, UPID_PDATA_SIZE> buf;
+		std::size_t len = 0;
+		buf[len] = UPID_PDATA;								len++;
+		buf[len] = owner;								len++;
+		buf[len] = 1;									len++;
+		for (const auto i : xrange(pdata_delta_fields))
+		{
+			if (i < 4 || i == 7)
+			{
+				PUT_INTEL_SHORT(&buf[len], static_cast<uint16_t>(v[i]));		len += 2;
+			}
+			else
+			{
+				PUT_INTEL_INT(&buf[len], static_cast<uint32_t>(v[i]));		len += 4;
+			}
+		}
+		send_packet(net, p, dest, buf.data(), len);
+		return;
+	}
+	auto &stream = p.links[dest].pdata[owner];
+	const uint16_t seq = stream.next_seq;
+	if (!++stream.next_seq)
+		stream.next_seq = 1;
+	const pdata_state *base = nullptr;
+	if (stream.acked_seq && static_cast<uint16_t>(seq - stream.acked_seq) < UDP_PDATA_HISTORY)
+	{
+		auto &b = stream.sent[stream.acked_seq % UDP_PDATA_HISTORY];
+		if (b.seq == stream.acked_seq)
+			base = &b;
+	}
+	std::array<uint8_t, UPID_PDATA_DELTA_SIZE_MAX> buf;
+	std::size_t len = 0;
+	buf[len] = UPID_PDATA_DELTA;							len++;
+	buf[len] = owner;								len++;
+	buf[len] = 1;									len++;
+	PUT_INTEL_SHORT(&buf[len], seq);						len += 2;
+	PUT_INTEL_SHORT(&buf[len], static_cast<uint16_t>(base ? base->seq : 0));	len += 2;
+	auto &sent = stream.sent[seq % UDP_PDATA_HISTORY];
+	len += udp_write_pdata_delta(&buf[len], base ? base->v : pdata_delta_values{}, v, sent.v);
+	sent.seq = seq;
+	send_packet(net, p, dest, buf.data(), len);
+}
+
+void send_mdata(soak_net &net, soak_player &p, const unsigned dest, const unsigned origin, const bool needack, const std::vector<uint8_t> &mbuf)
+{
+	std::vector<uint8_t> buf;
+	buf.reserve(6 + mbuf.size());
+	buf.push_back(needack ? UPID_MDATA_PNEEDACK : UPID_MDATA_PNORM);
+	buf.push_back(origin);
+	auto &link = p.links[dest];
+	if (needack)
+	{
+		buf.resize(6);
+		PUT_INTEL_INT(&buf[2], link.pkt_num_tosend);
+	}
+	buf.insert(buf.end(), mbuf.begin(), mbuf.end());
+	send_packet(net, p, dest, buf.data(), buf.size());
+	if (needack)
+		link.unacked.push_back({link.pkt_num_tosend++, net.frame, std::move(buf)});
+}
+
+/* The host sends to every client but the one a packet came from. */
+template <typename F>
+void relay(soak_net &net, const unsigned from, F &&f)
+{
+	for (const auto c : xrange(1u, net.settings.clients + 1))
+		if (c != from)
+			f(c);
+}
+
+void deliver_message(soak_player &p, const unsigned origin, const uint8_t *const mbuf, const std::size_t len)
+{
+	if (len < 4 || origin >= max_players)
+	{
+		++p.message_errors;
+		return;
+	}
+	const uint32_t msg_num = GET_INTEL_INT(mbuf);
+	if (msg_num != p.messages_received[origin])
+		++p.message_errors;
+	p.messages_received[origin] = msg_num + 1;
+}
+
+void update_view(soak_player &p, const unsigned owner, const uint16_t seq, const pdata_delta_values &v)
+{
+	// states are applied in order; an older one which arrives late is ignored
+	if (seq && p.view_seq[owner] && static_cast<int16_t>(seq - p.view_seq[owner]) <= 0)
+		return;
+	p.view_seq[owner] = seq;
+	p.view[owner] = v;
+}
+
+void process_packet(soak_net &net, soak_player &p, const unsigned from, const uint8_t *const packet, const std::size_t len)
+{
+	if (!p.pnum)
+		count(net.in, packet, len);
+	const bool host = !p.pnum;
+	switch (packet[0])
+	{
+		case UPID_PDATA:
+		{
+			const unsigned owner = packet[1];
+			if (len != UPID_PDATA_SIZE || owner >= max_players)
+				break;
+			pdata_delta_values v;
+			std::size_t pos = 3;
+			for (const auto i : xrange(pdata_delta_fields))
+			{
+				if (i < 4 || i == 7)
+				{
+					v[i] = static_cast<int16_t>(GET_INTEL_SHORT(&packet[pos]));	pos += 2;
+				}
+				else
+				{
+					v[i] = static_cast<int32_t>(GET_INTEL_INT(&packet[pos]));	pos += 4;
+				}
+			}
+			update_view(p, owner, 0, v);
+			if (host)
+				relay(net, from, [&](const unsigned c) { send_pdata(net, p, c, owner, v); });
+			break;
+		}
+		case UPID_PDATA_DELTA:
+		{
+			const unsigned owner = packet[1];
+			if (len < UPID_PDATA_DELTA_HEADER_SIZE || len > UPID_PDATA_DELTA_SIZE_MAX || owner >= max_players)
+				break;
+			const uint16_t seq = GET_INTEL_SHORT(&packet[3]);
+			const uint16_t base_seq = GET_INTEL_SHORT(&packet[5]);
+			if (!seq)
+				break;
+			auto &history = p.recv[owner];
+			pdata_delta_values v;
+			if (base_seq)
+			{
+				const auto &base = history[base_seq % UDP_PDATA_HISTORY];
+				if (base.seq != base_seq || !udp_read_pdata_delta(&packet[7], len - 7, base.v, v))
+					break;
+			}
+			else if (!udp_read_pdata_delta(&packet[7], len - 7, pdata_delta_values{}, v))
+				break;
+			history[seq % UDP_PDATA_HISTORY] = {seq, v};
+			std::array<uint8_t, UPID_PDATA_ACK_SIZE> ack;
+			ack[0] = UPID_PDATA_ACK;
+			ack[1] = p.pnum;
+			ack[2] = owner;
+			PUT_INTEL_SHORT(&ack[3], seq);
+			send_packet(net, p, from, ack.data(), ack.size());
+			update_view(p, owner, seq, v);
+			if (host)
+				relay(net, from, [&](const unsigned c) { send_pdata(net, p, c, owner, v); });
+			break;
+		}
+		case UPID_PDATA_ACK:
+		{
+			if (len != UPID_PDATA_ACK_SIZE || packet[2] >= max_players)
+				break;
+			auto &stream = p.links[from].pdata[packet[2]];
+			const uint16_t seq = GET_INTEL_SHORT(&packet[3]);
+			if (!seq || stream.sent[seq % UDP_PDATA_HISTORY].seq != seq)
+				break;
+			if (!stream.acked_seq || static_cast<int16_t>(seq - stream.acked_seq) > 0)
+				stream.acked_seq = seq;
+			break;
+		}
+		case UPID_MDATA_PNORM:
+			if (host && len > 2)
+			{
+				const std::vector<uint8_t> mbuf(packet + 2, packet + len);
+				relay(net, from, [&](const unsigned c) { send_mdata(net, p, c, packet[1], false, mbuf); });
+			}
+			break;
+		case UPID_MDATA_PNEEDACK:
+		{
+			if (len < 6)
+				break;
+			auto &link = p.links[from];
+			const uint32_t pkt_num = GET_INTEL_INT(&packet[2]);
+			// as net_udp_noloss_validate_mdata: only the next packet is taken, repeats are ACK'd again
+			if (pkt_num > link.pkt_num_torecv)
+				break;
+			std::array<uint8_t, 7> ack;
+			ack[0] = UPID_MDATA_ACK;
+			ack[1] = p.pnum;
+			ack[2] = packet[1];
+			PUT_INTEL_INT(&ack[3], pkt_num);
+			send_packet(net, p, from, ack.data(), ack.size());
+			if (pkt_num < link.pkt_num_torecv)
+				break;
+			++link.pkt_num_torecv;
+			deliver_message(p, packet[1], &packet[6], len - 6);
+			if (host)
+			{
+				const std::vector<uint8_t> mbuf(packet + 6, packet + len);
+				relay(net, from, [&](const unsigned c) { send_mdata(net, p, c, packet[1], true, mbuf); });
+			}
+			break;
+		}
+		case UPID_MDATA_ACK:
+		{
+			if (len != 7)
+				break;
+			auto &unacked = p.links[from].unacked;
+			const uint32_t pkt_num = GET_INTEL_INT(&packet[3]);
+			const auto i = std::find_if(unacked.begin(), unacked.end(), [pkt_num](const mdata_pending &m) { return m.pkt_num == pkt_num; });
+			if (i != unacked.end())
+				unacked.erase(i);
+			break;
+		}
+		default:
+			BOOST_ERROR("unexpected packet type " << unsigned{packet[0]});
+			break;
+	}
+}
+
+void receive(soak_net &net, soak_player &p)
+{
+	std::array<uint8_t, UPID_MAX_SIZE> buf;
+	for (;;)
+	{
+		sockaddr_in sender{};
+		socklen_t sender_len = sizeof(sender);
+		const auto r = recvfrom(p.fd, buf.data(), buf.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&sender), &sender_len);
+		if (r <= 0)
+			return;
+		const std::size_t len = r;
+		unsigned from = 0;
+		if (!p.pnum)
+		{
+			for (from = 1; from <= net.settings.clients; ++from)
+				if (p.links[from].addr.sin_port == sender.sin_port)
+					break;
+			if (from > net.settings.clients)
+				continue;
+			++net.datagrams_in.packets;
+			net.datagrams_in.bytes += len;
+		}
+		else if (sender.sin_port != p.links[0].addr.sin_port)
+			continue;
+		if (len < UPID_BUNDLE_HEADER_SIZE || buf[0] != UPID_BUNDLE || buf[1] != UPID_BUNDLE_VERSION)
+		{
+			BOOST_ERROR("player " << p.pnum << " got a datagram which is not a bundle");
+			continue;
+		}
+		udp_bundle_for_each(buf.data(), len, [&](const uint8_t *const packet, const std::size_t packet_len) {
+			process_packet(net, p, from, packet, packet_len);
+		});
+	}
+}
+
+template <typename T>
+T random_walk(std::minstd_rand &rng, const T value, const T step, const T limit)
+{
+	return std::clamp<T>(value + std::uniform_int_distribution<T>(-step, step)(rng), -limit, limit);
+}
+
+void move_player(soak_player &p)
+{
+	auto &t = p.truth;
+	for (const auto i : xrange(4u))
+		t[i] = random_walk<int32_t>(p.rng, t[i], 600, INT16_MAX);
+	for (const auto i : xrange(3u))
+	{
+		t[8 + i] = random_walk<int32_t>(p.rng, t[8 + i], 65536 * 4, 65536 * 100);
+		t[4 + i] = static_cast<int32_t>(static_cast<uint32_t>(t[4 + i]) + static_cast<uint32_t>(t[8 + i] / static_cast<int32_t>(frames_per_second)));
+		t[11 + i] = random_walk<int32_t>(p.rng, t[11 + i], 65536 / 8, 65536 * 2);
+	}
+	if (!std::uniform_int_distribution<unsigned>(0, 19)(p.rng))
+		t[7] = std::uniform_int_distribution<int32_t>(0, 899)(p.rng);
+}
+
+/* One network frame of one player, in the order of net_udp_do_frame: read, send position, send multi buffer, resend, flush. */
+void run_frame(soak_net &net, soak_player &p)
+{
+	receive(net, p);
+	const unsigned first = p.pnum ? 0 : 1, last = p.pnum ? 1 : net.settings.clients + 1;
+	const auto dests = xrange(first, last);
+	if (!net.settling)
+		move_player(p);
+	for (const auto d : dests)
+		send_pdata(net, p, d, p.pnum, p.truth);
+	if (!net.settling)
+	{
+		std::vector<uint8_t> normal, reliable;
+		for (const auto &m : soak_messages)
+		{
+			if (std::uniform_int_distribution<unsigned>(1, m.one_in)(p.rng) != 1)
+				continue;
+			auto &mbuf = m.needack ? reliable : normal;
+			if (m.needack && mbuf.empty())
+			{
+				mbuf.resize(4);
+				PUT_INTEL_INT(mbuf.data(), p.messages_sent++);
+			}
+			mbuf.resize(mbuf.size() + m.size, m.size);
+		}
+		for (const auto d : dests)
+		{
+			if (!normal.empty())
+				send_mdata(net, p, d, p.pnum, false, normal);
+			if (!reliable.empty())
+				send_mdata(net, p, d, p.pnum, true, reliable);
+		}
+	}
+	for (const auto d : dests)
+	{
+		auto &link = p.links[d];
+		for (auto &m : link.unacked)
+		{
+			if (net.frame - m.sent_frame < resend_frames)
+				continue;
+			m.sent_frame = net.frame;
+			send_packet(net, p, d, m.packet.data(), m.packet.size());
+			if (!p.pnum)
+				++net.resends;
+		}
+		flush(net, p, link);
+	}
+}
+
+const char *packet_name(const unsigned type)
+{
+	switch (type)
+	{
+		case UPID_PDATA:		return "PDATA";
+		case UPID_MDATA_PNORM:		return "MDATA_PNORM";
+		case UPID_MDATA_PNEEDACK:	return "MDATA_PNEEDACK";
+		case UPID_MDATA_ACK:		return "MDATA_ACK";
+		case UPID_PDATA_DELTA:		return "PDATA_DELTA";
+		case UPID_PDATA_ACK:		return "PDATA_ACK";
+		default:			return "?";
+	}
+}
+
+void report(const soak_net &net)
+{
+	const double seconds = static_cast<double>(net.frame) / frames_per_second;
+	std::printf("udp soak: 1 host, %u clients, %u frames (%.1f s), %u%% loss, %s\n", net.settings.clients, net.frame, seconds, net.settings.loss, net.settings.delta ? "position deltas" : "full positions");
+	std::printf("host frame time: %.1f us average, %.1f us max\n",
+		std::chrono::duration<double, std::micro>(net.frame_time).count() / net.frame,
+		std::chrono::duration<double, std::micro>(net.frame_time_max).count());
+	std::printf("%-16s %12s %10s %12s %10s\n", "host", "out B/s", "out pkt/s", "in B/s", "in pkt/s");
+	for (const auto type : xrange(256u))
+	{
+		const auto &o = net.out[type], &i = net.in[type];
+		if (o.packets || i.packets)
+			std::printf("%-16s %12.0f %10.1f %12.0f %10.1f\n", packet_name(type), o.bytes / seconds, o.packets / seconds, i.bytes / seconds, i.packets / seconds);
+	}
+	std::printf("%-16s %12.0f %10.1f %12.0f %10.1f\n", "datagrams", net.datagrams_out.bytes / seconds, net.datagrams_out.packets / seconds, net.datagrams_in.bytes / seconds, net.datagrams_in.packets / seconds);
+	std::printf("host resends: %u, datagrams dropped by all players: %u\n", net.resends, net.dropped);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(udp_soak)
+{
+	soak_net net;
+	const auto players = net.settings.clients + 1;
+	for (const auto i : xrange(players))
+	{
+		auto &p = *net.players.emplace_back(std::make_unique<soak_player>(i));
+		p.fd = socket(AF_INET, SOCK_DGRAM, 0);
+		BOOST_REQUIRE(p.fd >= 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addr_len = sizeof(addr);
+		BOOST_REQUIRE(!bind(p.fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)));
+		BOOST_REQUIRE(!getsockname(p.fd, reinterpret_cast<sockaddr *>(&addr), &addr_len));
+		if (i)
+		{
+			p.links[0].addr = net.players[0]->links[0].addr;
+			net.players[0]->links[i].addr = addr;
+		}
+		else
+			p.links[0].addr = addr;	// only used to give the clients the address of the host
+	}
+	auto &host = *net.players[0];
+	for (const auto total = net.settings.frames + settle_frames; net.frame < total; ++net.frame)
+	{
+		net.settling = net.frame >= net.settings.frames;
+		for (const auto c : xrange(1u, players))
+			run_frame(net, *net.players[c]);
+		const auto start = std::chrono::steady_clock::now();
+		run_frame(net, host);
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		net.frame_time += elapsed;
+		net.frame_time_max = std::max(net.frame_time_max, elapsed);
+	}
+	for (const auto c : xrange(1u, players))
+		receive(net, *net.players[c]);
+	report(net);
+
+	// Each hop of a delta may round a field by half of its step.
+	unsigned desyncs = 0;
+	for (const auto &p : net.players)
+	{
+		BOOST_TEST(p->message_errors == 0);
+		for (const auto &link : p->links)
+			BOOST_TEST(link.unacked.empty());
+		for (const auto o : xrange(players))
+		{
+			if (o == p->pnum)
+				continue;
+			const auto &theirs = net.players[o]->truth;
+			const auto &mine = p->view[o];
+			for (const auto i : xrange(pdata_delta_fields))
+			{
+				const int64_t tolerance = net.settings.delta && pdata_delta_shift[i] ? int64_t{1} << pdata_delta_shift[i] : 0;
+				if (std::abs(int64_t{static_cast<int32_t>(static_cast<uint32_t>(mine[i]) - static_cast<uint32_t>(theirs[i]))}) > tolerance)
+					++desyncs;
+			}
+			BOOST_TEST(p->messages_received[o] == net.players[o]->messages_sent);
+		}
+	}
+	std::printf("desynced position fields: %u\n", desyncs);
+	BOOST_TEST(desyncs == 0);
+}
+#else
+BOOST_AUTO_TEST_CASE(udp_soak)
+{
+	BOOST_TEST_MESSAGE("udp soak test needs POSIX sockets");
+}
+#endif
@@ -0,0 +1,54 @@
+#include "vecmat.h"
+#include "d_range.h"
+#include <array>
+#include <limits>
+#include <random>
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Rebirth vecmat
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+void check_dist_quick_batch(const vms_vector &v0, const vms_vector_batch &points, const std::size_t n)
+{
+	std::array<fix, vms_vector_batch::capacity> batch_result;
+	vm_vec_dist_quick_batch(batch_result.data(), v0, points, n);
+	for (const auto i : xrange(n))
+	{
+		const fix scalar_result = vm_vec_dist_quick(v0, vms_vector{points.x[i], points.y[i], points.z[i]});
+		BOOST_TEST(batch_result[i] == scalar_result);
+	}
+}
+
+}
+
+/* Test that batch quick distance is bit-exact with vm_vec_dist_quick for
+ * mine coordinates, for arbitrary coordinates where the component
+ * differences overflow, and for every partial batch size.
+ */
+BOOST_AUTO_TEST_CASE(dist_quick_batch)
+{
+	std::minstd_rand engine(1);
+	std::uniform_int_distribution<int32_t> full{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()};
+	std::uniform_int_distribution<int32_t> mine{-F1_0 * 4000, F1_0 * 4000};
+	for (const auto i : xrange(4096u))
+	{
+		auto &d = (i & 1) ? full : mine;
+		const vms_vector v0{d(engine), d(engine), d(engine)};
+		vms_vector_batch points;
+		for (const auto j : xrange(vms_vector_batch::capacity))
+		{
+			points.x[j] = d(engine);
+			points.y[j] = d(engine);
+			points.z[j] = d(engine);
+		}
+		check_dist_quick_batch(v0, points, 1 + (i % vms_vector_batch::capacity));
+	}
+	vms_vector_batch extremes;
+	extremes.x = {{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), 0, -1, 1, F1_0, -F1_0, 0}};
+	extremes.y = {{0, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), F1_0, -F1_0, 1, -1, 0}};
+	extremes.z = {{std::numeric_limits<int32_t>::max(), 0, std::numeric_limits<int32_t>::min(), 1, -1, -F1_0, F1_0, 0}};
+	check_dist_quick_batch(vms_vector{}, extremes, vms_vector_batch::capacity);
+	check_dist_quick_batch(vms_vector{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), -1}, extremes, vms_vector_batch::capacity);
+}
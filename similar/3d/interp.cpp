@@ -231,8 +231,11 @@ protected:
 private:
 	void rotate(uint_fast32_t i, const vms_vector *const src, const uint_fast32_t n)
 	{
-		for (auto &&[dest, src] : zip(partial_range(Interp_point_list, i, i + n), unchecked_partial_range(src, n)))
-			g3_rotate_point(dest, src);
+		/* partial_range only checks that the points fit in
+		 * Interp_point_list.  Its iterator need not be a pointer.
+		 */
+		if (!partial_range(Interp_point_list, i, i + n).empty())
+			g3_rotate_points(&Interp_point_list[i], src, n);
 	}
 	void set_color_by_model_light(fix g3s_lrgb::*const c, g3s_lrgb &o, const fix color) const
 	{
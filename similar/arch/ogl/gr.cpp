@@ -722,13 +722,16 @@ int gr_set_mode(screen_mode mode)
 	grd_curscreen->sc_aspect = fixdiv(grd_curscreen->get_screen_width() * GameCfg.AspectX, grd_curscreen->get_screen_height() * GameCfg.AspectY);
 	gr_init_canvas(grd_curscreen->sc_canvas, gr_new_bm_data, bm_mode::ogl, w, h);
 
-	ogl_init_window(w,h);//platform specific code
-	ogl_extensions_init();
-	ogl_tune_for_current();
-	sync_helper.init(CGameArg.OglSyncMethod, CGameArg.OglSyncWait);
+	if (!CGameArg.MplDedicated)
+	{
+		ogl_init_window(w,h);//platform specific code
+		ogl_extensions_init();
+		ogl_tune_for_current();
+		sync_helper.init(CGameArg.OglSyncMethod, CGameArg.OglSyncWait);
 
-	OGL_VIEWPORT(0,0,w,h);
-	ogl_init_state();
+		OGL_VIEWPORT(0,0,w,h);
+		ogl_init_state();
+	}
 	gamefont_choose_game_font(w,h);
 	gr_remap_color_fonts();
 
@@ -822,34 +825,40 @@ int gr_init()
 	ogl_init_load_library();
 #endif
 
+	/* A dedicated host gets no window and no GL context.  It still needs
+	 * the screen canvas, which the game and the menus draw on.
+	 */
+	if (!CGameArg.MplDedicated)
+	{
 #if SDL_MAJOR_VERSION == 1
-	if (!CGameCfg.WindowMode && !CGameArg.SysWindow)
-		sdl_video_flags|=SDL_FULLSCREEN;
+		if (!CGameCfg.WindowMode && !CGameArg.SysWindow)
+			sdl_video_flags|=SDL_FULLSCREEN;
 
-	if (CGameArg.SysNoBorders)
-		sdl_video_flags|=SDL_NOFRAME;
+		if (CGameArg.SysNoBorders)
+			sdl_video_flags|=SDL_NOFRAME;
 #elif SDL_MAJOR_VERSION == 2
-	assert(!g_pRebirthSDLMainWindow);
-	unsigned sdl_window_flags = SDL_WINDOW_OPENGL;
-	if (CGameArg.SysNoBorders)
-		sdl_window_flags |= SDL_WINDOW_BORDERLESS;
-	if (!CGameCfg.WindowMode && !CGameArg.SysWindow)
-		sdl_window_flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+		assert(!g_pRebirthSDLMainWindow);
+		unsigned sdl_window_flags = SDL_WINDOW_OPENGL;
+		if (CGameArg.SysNoBorders)
+			sdl_window_flags |= SDL_WINDOW_BORDERLESS;
+		if (!CGameCfg.WindowMode && !CGameArg.SysWindow)
+			sdl_window_flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
 #if defined(__APPLE__) && defined(__MACH__)
-	sdl_window_flags |= SDL_WINDOW_ALLOW_HIGHDPI;
+		sdl_window_flags |= SDL_WINDOW_ALLOW_HIGHDPI;
 #endif
-	const auto mode = Game_screen_mode;
-	const auto SDLWindow = SDL_CreateWindow(DESCENT_VERSION, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SM_W(mode), SM_H(mode), sdl_window_flags);
-	if (!SDLWindow)
-		return -1;
-	SDL_GetWindowPosition(SDLWindow, &g_iRebirthWindowX, &g_iRebirthWindowY);
-	g_pRebirthSDLMainWindow = SDLWindow;
-	SDL_GL_CreateContext(SDLWindow);
-	if (const auto window_icon = SDL_LoadBMP(DXX_SDL_WINDOW_ICON_BITMAP))
-		SDL_SetWindowIcon(SDLWindow, window_icon);
+		const auto mode = Game_screen_mode;
+		const auto SDLWindow = SDL_CreateWindow(DESCENT_VERSION, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SM_W(mode), SM_H(mode), sdl_window_flags);
+		if (!SDLWindow)
+			return -1;
+		SDL_GetWindowPosition(SDLWindow, &g_iRebirthWindowX, &g_iRebirthWindowY);
+		g_pRebirthSDLMainWindow = SDLWindow;
+		SDL_GL_CreateContext(SDLWindow);
+		if (const auto window_icon = SDL_LoadBMP(DXX_SDL_WINDOW_ICON_BITMAP))
+			SDL_SetWindowIcon(SDLWindow, window_icon);
 #endif
 
-	gr_set_attributes();
+		gr_set_attributes();
+	}
 
 	ogl_init_texture_list_internal();
 
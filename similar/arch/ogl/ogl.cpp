@@ -427,6 +427,8 @@ void ogl_cache_level_textures(void)
 	auto &vcobjptridx = Objects.vcptridx;
 	int max_efx=0,ef;
 	
+	if (CGameArg.MplDedicated)
+		return;
 	ogl_reset_texture_stats_internal();//loading a new lev should reset textures
 	
 	range_for (auto &ec, partial_const_range(Effects, Num_effects))
@@ -1384,6 +1386,8 @@ void ogl_end_frame(void){
 
 void gr_flip(void)
 {
+	if (CGameArg.MplDedicated)
+		return;	// no context to swap, see gr_init
 	if (CGameArg.DbgRenderStats)
 	{
 		gr_set_default_canvas();
@@ -1622,6 +1626,9 @@ static int ogl_loadtexture(const palette_array_t &pal, const uint8_t *data, cons
 	tex.u = static_cast<float>(static_cast<double>(tex.w) / static_cast<double>(tex.tw));
 	tex.v = static_cast<float>(static_cast<double>(tex.h) / static_cast<double>(tex.th));
 
+	if (CGameArg.MplDedicated)
+		return 0;	// no context to load into, see gr_init
+
 	auto *bufP = texbuf.get();
 	const uint8_t *outP = texbuf.get();
 	{
@@ -35,6 +35,7 @@
 namespace dcx {
 
 int digi_volume = SOUND_MAX_VOLUME;
+unsigned digi_voices;
 
 /* The values for these three defines are arbitrary and can be changed,
  * provided that they remain unique with respect to each other.
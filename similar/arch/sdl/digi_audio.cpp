@@ -14,8 +14,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <SDL.h>
 #include <digi_audio.h>
+#include "digi_audio_mix.h"
 #include "dxxerror.h"
 #include "fmtcheck.h"
 #include "vecmat.h"
@@ -32,66 +35,18 @@ namespace dcx {
 //changed on 980905 by adb to increase number of concurrent sounds
 //end changes by adb
 #define SOUND_BUFFER_SIZE 1024
+// rate the mixer writes, resampling the sounds to it; SDL converts it to what the device takes
+#define SOUND_OUTPUT_RATE 44100
+// commands from the game to the mixer which may wait for the next callback
+#define MIXER_COMMAND_QUEUE_SIZE 256
 
 #define MIN_VOLUME 10
 
-/* This table is used to add two sound values together and pin
- * the value to avoid overflow.  (used with permission from ARDI)
- * DPH: Taken from SDL/src/SDL_mixer.c.
- */
-constexpr uint8_t mix8[] =
-{
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03,
-  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
-  0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
-  0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
-  0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
-  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
-  0x3B, 0x3C, 0x3D, 0x3E, 0x3F, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45,
-  0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50,
-  0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B,
-  0x5C, 0x5D, 0x5E, 0x5F, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66,
-  0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70, 0x71,
-  0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C,
-  0x7D, 0x7E, 0x7F, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
-  0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91, 0x92,
-  0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D,
-  0x9E, 0x9F, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8,
-  0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF, 0xB0, 0xB1, 0xB2, 0xB3,
-  0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE,
-  0xBF, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9,
-  0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF, 0xD0, 0xD1, 0xD2, 0xD3, 0xD4,
-  0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
-  0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA,
-  0xEB, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5,
-  0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-};
-
 static int digi_initialised = 0;
 
+/* The channels as the game sees them.  Only the game thread uses these.
+ * The mixer has its own copy, which it changes when it gets a command.
+ */
 struct sound_slot {
 	int soundno;
 	bool playing;   // Is there a sample playing on this channel?
@@ -99,23 +54,161 @@ struct sound_slot {
 	bool persistent; // This can't be pre-empted
 	sound_pan pan;       // 0 = far left, 1 = far right
 	fix volume;    // 0 = nothing, 1 = fully on
-	//changed on 980905 by adb from char * to unsigned char *
-	unsigned char *samples;
 	sound_object *soundobj;   // Which soundobject is on this channel
-	//end changes by adb
-	unsigned int length; // Length of the sample
-	unsigned int position; // Position we are at at the moment.
+	uint32_t generation;	// counts the sounds started on this channel
+};
+
+struct mixer_voice
+{
+	const uint8_t *samples;
+	uint32_t length, position, frac;
+	int16_t vl, vr;
+	bool playing, looped;
+	uint32_t generation;
+};
+
+enum class mixer_command_type : uint8_t
+{
+	start,
+	stop,
+	volume,
+};
+
+struct mixer_command
+{
+	mixer_command_type type;
+	uint8_t channel;
+	bool looped;
+	int16_t vl, vr;
+	uint32_t generation;
+	const uint8_t *samples;
+	uint32_t length;
+};
+
+/* Commands from the game thread to the audio callback, without a lock:
+ * only the game thread writes tail and only the callback writes head.
+ */
+class mixer_command_queue
+{
+	std::array<mixer_command, MIXER_COMMAND_QUEUE_SIZE> ring;
+	std::atomic<unsigned> head{0}, tail{0};
+public:
+	bool push(const mixer_command &c)
+	{
+		const auto t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == ring.size())
+			return false;
+		ring[t % ring.size()] = c;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+	template <typename F>
+		void drain(F &&f)
+		{
+			auto h = head.load(std::memory_order_relaxed);
+			for (const auto t = tail.load(std::memory_order_acquire); h != t; ++h)
+				f(ring[h % ring.size()]);
+			head.store(h, std::memory_order_release);
+		}
 };
 
+static std::array<sound_slot, 32> SoundSlots;
+static std::array<mixer_voice, 32> MixerVoices;
+// generation of the sound on each channel which the mixer played to its end
+static std::array<std::atomic<uint32_t>, 32> MixerVoiceEnded;
+static mixer_command_queue MixerCommands;
+static uint32_t MixerStep;	// bytes of a sound per output frame, as 16.16
+
+static void mixer_apply(const mixer_command &c)
+{
+	auto &v = MixerVoices[c.channel];
+	switch (c.type)
+	{
+		case mixer_command_type::start:
+			v.samples = c.samples;
+			v.length = c.length;
+			v.position = v.frac = 0;
+			v.looped = c.looped;
+			v.generation = c.generation;
+			v.playing = true;
+			[[fallthrough]];
+		case mixer_command_type::volume:
+			v.vl = c.vl;
+			v.vr = c.vr;
+			break;
+		case mixer_command_type::stop:
+			v.playing = false;
+			break;
+	}
+}
+
+/* Give a command to the mixer. */
+static void digi_audio_submit(const mixer_command &c)
+{
+	if (!digi_initialised)
+		return;
+	if (MixerCommands.push(c))
+		return;
+	/* The callback did not run for a long time.  Hold it off and apply
+	 * the commands here.
+	 */
+	SDL_LockAudio();
+	MixerCommands.drain(mixer_apply);
+	mixer_apply(c);
+	SDL_UnlockAudio();
+}
+
+static int16_t digi_audio_mixer_volume(const fix v)
+{
+	return std::min<fix>(v >> 2, INT16_MAX);
+}
+
+/* Set the volume of each side of the command from the slot. */
+static void digi_audio_pan_volume(const sound_slot &s, mixer_command &c)
+{
+	fix vl, vr;
+	if (const auto x = static_cast<fix>(s.pan); x & 0x8000) {
+		vl = 0x20000 - x * 2;
+		vr = 0x10000;
+	} else {
+		vl = 0x10000;
+		vr = x * 2;
+	}
+	c.vl = digi_audio_mixer_volume(fixmul(vl, s.volume));
+	c.vr = digi_audio_mixer_volume(fixmul(vr, s.volume));
+}
+
+static void digi_audio_send_volume(const unsigned channel)
+{
+	mixer_command c{};
+	c.type = mixer_command_type::volume;
+	c.channel = channel;
+	digi_audio_pan_volume(SoundSlots[channel], c);
+	digi_audio_submit(c);
+}
+
+/* Whether the sound on the channel still plays, after the mixer may
+ * have played it to its end.
+ */
+static bool digi_audio_slot_playing(const unsigned channel)
+{
+	auto &s = SoundSlots[channel];
+	if (s.playing && MixerVoiceEnded[channel].load(std::memory_order_acquire) == s.generation)
+		s.playing = 0;
+	return s.playing;
+}
+
 static void digi_audio_stop_sound(sound_slot &s)
 {
 	s.playing = 0;
 	s.soundobj = sound_object_none;
 	s.persistent = 0;
+	mixer_command c{};
+	c.type = mixer_command_type::stop;
+	c.channel = &s - SoundSlots.data();
+	digi_audio_submit(c);
 }
 
-static std::array<sound_slot, 32> SoundSlots;
-
 }
 
 namespace dsx {
@@ -123,57 +216,44 @@ namespace dsx {
 static SDL_AudioSpec WaveSpec;
 static int next_channel = 0;
 
-/* Audio mixing callback */
-//changed on 980905 by adb to cleanup, add pan support and optimize mixer
+/* Audio mixing callback.  Sums the channels in 32 bits, a block at a
+ * time, and clips only the result.
+ */
 static void audio_mixcallback(void *, Uint8 *stream, int len)
 {
-	Uint8 *streamend = stream + len;
 	if (!digi_initialised)
+	{
+		memset(stream, 0, len);
 		return;
+	}
 
-	memset(stream, 0x80, len); // fix "static" sound bug on Mac OS X
+	MixerCommands.drain(mixer_apply);
 
-	SDL_LockAudio();
-
-	range_for (auto &sl, SoundSlots)
+	auto out = reinterpret_cast<int16_t *>(stream);
+	std::array<int32_t, digi_audio_mix_block * 2> acc;
+	std::array<int16_t, digi_audio_mix_block> mono;
+	for (unsigned frames = len / (2 * sizeof(int16_t)); frames;)
 	{
-		if (sl.playing) {
-			Uint8 *sldata = sl.samples + sl.position, *slend = sl.samples + sl.length;
-			Uint8 *sp = stream, s;
-			signed char v;
-			fix vl, vr;
-
-			if (const auto x = static_cast<fix>(sl.pan); x & 0x8000) {
-				vl = 0x20000 - x * 2;
-				vr = 0x10000;
-			} else {
-				vl = 0x10000;
-				vr = x * 2;
-			}
-			const auto sl_volume = sl.volume;
-			vl = fixmul(vl, sl_volume);
-			vr = fixmul(vr, sl_volume);
-			while (sp < streamend) {
-				if (sldata == slend) {
-					if (!sl.looped) {
-						sl.playing = 0;
-						break;
-					}
-					sldata = sl.samples;
-				}
-				v = *(sldata++) - 0x80;
-				s = *sp;
-				*(sp++) = mix8[ s + fixmul(v, vl) + 0x80 ];
-				s = *sp;
-				*(sp++) = mix8[ s + fixmul(v, vr) + 0x80 ];
+		const unsigned n = std::min(frames, digi_audio_mix_block);
+		std::fill_n(acc.begin(), 2 * n, 0);
+		for (unsigned i = 0; i < MixerVoices.size(); ++i)
+		{
+			auto &v = MixerVoices[i];
+			if (!v.playing)
+				continue;
+			const auto got = digi_audio_resample(v.samples, v.length, v.looped, MixerStep, v.position, v.frac, mono.data(), n);
+			digi_audio_mix_stereo(acc.data(), mono.data(), got, v.vl, v.vr);
+			if (got < n)
+			{
+				v.playing = false;
+				MixerVoiceEnded[i].store(v.generation, std::memory_order_release);
 			}
-			sl.position = sldata - sl.samples;
 		}
+		digi_audio_mix_output(out, acc.data(), 2 * n);
+		out += 2 * n;
+		frames -= n;
 	}
-
-	SDL_UnlockAudio();
 }
-//end changes by adb
 
 /* Initialise audio devices. */
 int digi_audio_init()
@@ -183,12 +263,16 @@ int digi_audio_init()
 	}
 
 #if defined(DXX_BUILD_DESCENT_I)
-	WaveSpec.freq = digi_sample_rate;
+	const unsigned sample_rate = digi_sample_rate;
 #elif defined(DXX_BUILD_DESCENT_II)
-	WaveSpec.freq = GameArg.SndDigiSampleRate;
+	const unsigned sample_rate = GameArg.SndDigiSampleRate;
 #endif
+	MixerStep = (sample_rate << 16) / SOUND_OUTPUT_RATE;
+	MixerVoices = {};
+	MixerCommands.drain([](const mixer_command &) {});
+	WaveSpec.freq = SOUND_OUTPUT_RATE;
 	//added/changed by Sam Lantinga on 12/01/98 for new SDL version
-	WaveSpec.format = AUDIO_U8;
+	WaveSpec.format = AUDIO_S16SYS;
 	WaveSpec.channels = 2;
 	//end this section addition/change - SL
 	WaveSpec.samples = SOUND_BUFFER_SIZE;
@@ -204,6 +288,7 @@ int digi_audio_init()
 	SDL_PauseAudio(0);
 
 	digi_initialised = 1;
+	digi_voices = digi_max_channels;
 
 	digi_audio_set_digi_volume( (GameCfg.DigiVolume*32768)/8 );
 	return 0;
@@ -218,6 +303,8 @@ void digi_audio_close()
 	SDL_Delay(500); // CloseAudio hangs if it's called too soon after opening?
 #endif
 	SDL_CloseAudio();
+	range_for (auto &i, SoundSlots)
+		i.playing = 0;
 }
 
 void digi_audio_stop_all_channels()
@@ -236,15 +323,13 @@ int digi_audio_start_sound(short soundnum, fix volume, sound_pan pan, int loopin
 
 	if (soundnum < 0) return -1;
 
-	SDL_LockAudio();
-
 	Assert(GameSounds[soundnum].data != reinterpret_cast<void *>(-1));
 
 	starting_channel = next_channel;
 
 	while(1)
 	{
-		if (!SoundSlots[next_channel].playing)
+		if (!digi_audio_slot_playing(next_channel))
 			break;
 
 		if (!SoundSlots[next_channel].persistent)
@@ -254,17 +339,15 @@ int digi_audio_start_sound(short soundnum, fix volume, sound_pan pan, int loopin
 		if (next_channel >= digi_max_channels)
 			next_channel = 0;
 		if (next_channel == starting_channel)
-		{
-			SDL_UnlockAudio();
 			return -1;
-		}
 	}
-	if (SoundSlots[next_channel].playing)
+	auto &slot = SoundSlots[next_channel];
+	if (slot.playing)
 	{
-		SoundSlots[next_channel].playing = 0;
-		if (SoundSlots[next_channel].soundobj != sound_object_none)
+		slot.playing = 0;
+		if (slot.soundobj != sound_object_none)
 		{
-			digi_end_soundobj(*SoundSlots[next_channel].soundobj);
+			digi_end_soundobj(*slot.soundobj);
 		}
 		if (SoundQ_channel == next_channel)
 			SoundQ_end();
@@ -274,26 +357,32 @@ int digi_audio_start_sound(short soundnum, fix volume, sound_pan pan, int loopin
 	verify_sound_channel_free(next_channel);
 #endif
 
-	SoundSlots[next_channel].soundno = soundnum;
-	SoundSlots[next_channel].samples = GameSounds[soundnum].data;
-	SoundSlots[next_channel].length = GameSounds[soundnum].length;
-	SoundSlots[next_channel].volume = fixmul(digi_volume, volume);
-	SoundSlots[next_channel].pan = pan;
-	SoundSlots[next_channel].position = 0;
-	SoundSlots[next_channel].looped = looping;
-	SoundSlots[next_channel].playing = 1;
-	SoundSlots[next_channel].soundobj = soundobj;
-	SoundSlots[next_channel].persistent = 0;
+	slot.soundno = soundnum;
+	slot.volume = fixmul(digi_volume, volume);
+	slot.pan = pan;
+	slot.looped = looping;
+	slot.playing = 1;
+	slot.soundobj = soundobj;
+	slot.persistent = 0;
 	if (soundobj || looping || volume > F1_0)
-		SoundSlots[next_channel].persistent = 1;
+		slot.persistent = 1;
+	++slot.generation;
+
+	mixer_command c{};
+	c.type = mixer_command_type::start;
+	c.channel = next_channel;
+	c.looped = looping;
+	c.generation = slot.generation;
+	c.samples = GameSounds[soundnum].data;
+	c.length = GameSounds[soundnum].length;
+	digi_audio_pan_volume(slot, c);
+	digi_audio_submit(c);
 
 	i = next_channel;
 	next_channel++;
 	if (next_channel >= digi_max_channels)
 		next_channel = 0;
 
-	SDL_UnlockAudio();
-
 	return i;
 }
 
@@ -319,7 +408,7 @@ int digi_audio_is_channel_playing(int channel)
 	if (!digi_initialised)
 		return 0;
 
-	return SoundSlots[channel].playing;
+	return digi_audio_slot_playing(channel);
 }
 
 void digi_audio_set_channel_volume(int channel, int volume)
@@ -327,10 +416,11 @@ void digi_audio_set_channel_volume(int channel, int volume)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	if (!digi_audio_slot_playing(channel))
 		return;
 
 	SoundSlots[channel].volume = fixmuldiv(volume, digi_volume, F1_0);
+	digi_audio_send_volume(channel);
 }
 
 void digi_audio_set_channel_pan(int channel, const sound_pan pan)
@@ -338,10 +428,11 @@ void digi_audio_set_channel_pan(int channel, const sound_pan pan)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	if (!digi_audio_slot_playing(channel))
 		return;
 
 	SoundSlots[channel].pan = pan;
+	digi_audio_send_volume(channel);
 }
 
 void digi_audio_stop_sound(int channel)
@@ -354,7 +445,7 @@ void digi_audio_end_sound(int channel)
 	if (!digi_initialised)
 		return;
 
-	if (!SoundSlots[channel].playing)
+	if (!digi_audio_slot_playing(channel))
 		return;
 
 	SoundSlots[channel].soundobj = sound_object_none;
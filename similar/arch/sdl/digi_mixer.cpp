@@ -14,7 +14,7 @@
  *  -- MD2211 (2006-10-12)
  */
 
-#include <bitset>
+#include <atomic>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -36,7 +36,11 @@
 #include "maths.h"
 #include "piggy.h"
 #include "u_mem.h"
+#include <algorithm>
 #include <memory>
+#include <utility>
+
+#include "compiler-range_for.h"
 
 #define MIX_DIGI_DEBUG 0
 #define MIX_OUTPUT_FORMAT	AUDIO_S16
@@ -52,16 +56,6 @@ namespace dcx {
 
 namespace {
 
-/* channel management */
-static unsigned digi_mixer_find_channel(const std::bitset<64> &channels, const unsigned max_channels)
-{
-	unsigned i = 0;
-	for (; i < max_channels; ++i)
-		if (!channels[i])
-			break;
-	return i;
-}
-
 struct RAIIMix_Chunk : public Mix_Chunk
 {
 	RAIIMix_Chunk() = default;
@@ -84,13 +78,51 @@ static uint8_t fix2byte(const fix f)
 	return f >> 8;
 }
 
+/* What a sound may take the channel of another for.  When every
+ * channel is busy, a sound takes the channel of the sound with the
+ * lowest priority, if that is lower than its own.  Within a priority,
+ * the quieter sound, which is usually the one further away, loses.
+ */
+enum class digi_mixer_priority : uint8_t
+{
+	once,		// plays once and is gone
+	linked,		// linked to an object or a position, which digiobj starts again when it can
+	looping,	// plays until stopped, and digiobj starts it again when it can
+	owned,		// the queued sound or the looping sample, whose channel the caller keeps; never taken
+};
+
+struct digi_mixer_voice
+{
+	std::atomic<bool> playing;	// cleared from the audio thread when the sound ends
+	digi_mixer_priority priority;
+	fix volume;
+	sound_object *soundobj;
+};
+
+// A sound must be this much louder to take the channel of a sound of the same priority, so two sounds do not take it back and forth.
+constexpr fix digi_mixer_steal_margin = F1_0 / 16;
+
 uint8_t digi_initialised;
-std::bitset<64> channels;
-unsigned digi_mixer_max_channels = channels.size();
+std::array<digi_mixer_voice, 256> voices;
+unsigned digi_mixer_max_channels = voices.size();
 
 void digi_mixer_free_channel(const int channel_num)
 {
-	channels.reset(channel_num);
+	voices[channel_num].playing.store(false, std::memory_order_release);
+}
+
+static bool digi_mixer_outranks(const digi_mixer_priority p, const fix volume, const digi_mixer_voice &v)
+{
+	if (v.priority == digi_mixer_priority::owned)
+		return false;
+	if (p != v.priority)
+		return p > v.priority;
+	return volume > v.volume + digi_mixer_steal_margin;
+}
+
+static bool digi_mixer_matters_less(const digi_mixer_voice &a, const digi_mixer_voice &b)
+{
+	return a.priority < b.priority || (a.priority == b.priority && a.volume < b.volume);
 }
 
 }
@@ -122,8 +154,13 @@ int digi_mixer_init()
 		return 1;
 	}
 
-	digi_mixer_max_channels = Mix_AllocateChannels(digi_mixer_max_channels);
-	channels.reset();
+	digi_mixer_max_channels = std::min<unsigned>(Mix_AllocateChannels(voices.size()), voices.size());
+	digi_voices = digi_mixer_max_channels;
+	range_for (auto &v, voices)
+	{
+		v.playing.store(false, std::memory_order_relaxed);
+		v.soundobj = sound_object_none;
+	}
 	Mix_Pause(0);
 	Mix_ChannelFinished(digi_mixer_free_channel);
 
@@ -203,19 +240,55 @@ static void mixdigi_convert_sound(const unsigned i)
 	}
 }
 
+/* Find a free channel, or take one from a sound which matters less.
+ * Returns digi_mixer_max_channels if there is none.
+ */
+static unsigned digi_mixer_find_channel(const digi_mixer_priority priority, const fix volume)
+{
+	const unsigned max_channels = digi_mixer_max_channels;
+	unsigned victim = max_channels;
+	for (unsigned i = 0; i < max_channels; ++i)
+	{
+		auto &v = voices[i];
+		if (!v.playing.load(std::memory_order_acquire))
+		{
+			/* The sound on this channel ended by itself.  A sound
+			 * object which was not told yet learns that here, before
+			 * the channel is used for something else.
+			 */
+			if (const auto so = std::exchange(v.soundobj, sound_object_none))
+				digi_end_soundobj(*so);
+			return i;
+		}
+		if (victim == max_channels || digi_mixer_matters_less(v, voices[victim]))
+			victim = i;
+	}
+	if (victim == max_channels || !digi_mixer_outranks(priority, volume, voices[victim]))
+		return max_channels;
+	auto &v = voices[victim];
+	if (const auto so = std::exchange(v.soundobj, sound_object_none))
+		digi_end_soundobj(*so);
+	Mix_HaltChannel(victim);
+	return victim;
+}
+
 // Volume 0-F1_0
-int digi_mixer_start_sound(short soundnum, const fix volume, const sound_pan pan, const int looping, const int loop_start, const int loop_end, sound_object *)
+int digi_mixer_start_sound(short soundnum, const fix volume, const sound_pan pan, const int looping, const int loop_start, const int loop_end, sound_object *const soundobj)
 {
 	if (!digi_initialised) return -1;
 
 	if (soundnum < 0)
 		return -1;
 
-	const unsigned max_channels = digi_mixer_max_channels;
-	if (max_channels > channels.size())
-		return -1;
-	const auto channel = digi_mixer_find_channel(channels, max_channels);
-	if (channel >= max_channels)
+	const auto priority = volume > F1_0 || (looping && !soundobj)
+		? digi_mixer_priority::owned
+		: looping
+			? digi_mixer_priority::looping
+			: soundobj
+				? digi_mixer_priority::linked
+				: digi_mixer_priority::once;
+	const auto channel = digi_mixer_find_channel(priority, volume);
+	if (channel >= digi_mixer_max_channels)
 		return -1;
 
 	Assert(GameSounds[soundnum].data != reinterpret_cast<void *>(-1));
@@ -231,10 +304,23 @@ int digi_mixer_start_sound(short soundnum, const fix volume, const sound_pan pan
 #endif
 
 	const int mix_loop = looping * -1;
-	Mix_PlayChannel(channel, &(SoundChunks[soundnum]), mix_loop);
 	Mix_SetPanning(channel, 255-mix_pan, mix_pan);
 	Mix_SetDistance(channel, UINT8_MAX - fix2byte(volume));
-	channels.set(channel);
+	/* Mark the voice before the sound starts.  A short sound can end on
+	 * the audio thread before Mix_PlayChannel returns, and the store of
+	 * digi_mixer_free_channel must not be overwritten by this one.
+	 */
+	auto &v = voices[channel];
+	v.priority = priority;
+	v.volume = volume;
+	v.soundobj = soundobj;
+	v.playing.store(true, std::memory_order_release);
+	if (Mix_PlayChannel(channel, &(SoundChunks[soundnum]), mix_loop) < 0)
+	{
+		v.soundobj = sound_object_none;
+		v.playing.store(false, std::memory_order_release);
+		return -1;
+	}
 
 	return channel;
 }
@@ -246,6 +332,7 @@ namespace dcx {
 void digi_mixer_set_channel_volume(int channel, int volume)
 {
 	if (!digi_initialised) return;
+	voices[channel].volume = volume;
 	Mix_SetDistance(channel, UINT8_MAX - fix2byte(volume));
 }
 
@@ -261,13 +348,14 @@ void digi_mixer_stop_sound(int channel) {
 	con_printf(CON_DEBUG, "digi_stop_sound %d", channel);
 #endif
 	Mix_HaltChannel(channel);
-	channels.reset(channel);
+	auto &v = voices[channel];
+	v.soundobj = sound_object_none;
+	v.playing.store(false, std::memory_order_release);
 }
 
 void digi_mixer_end_sound(int channel)
 {
 	digi_mixer_stop_sound(channel);
-	channels.reset(channel);
 }
 
 void digi_mixer_set_digi_volume( int dvolume )
@@ -279,13 +367,17 @@ void digi_mixer_set_digi_volume( int dvolume )
 
 int digi_mixer_is_channel_playing(const int c)
 {
-	return channels[c];
+	return voices[c].playing.load(std::memory_order_acquire);
 }
 
 void digi_mixer_stop_all_channels()
 {
-	channels = {};
 	Mix_HaltChannel(-1);
+	range_for (auto &v, voices)
+	{
+		v.soundobj = sound_object_none;
+		v.playing.store(false, std::memory_order_relaxed);
+	}
 }
 
 }
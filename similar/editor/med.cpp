@@ -72,6 +72,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "screens.h"
 #include "texmap.h"
 #include "object.h"
+#include "lighting.h"
 #include "effects.h"
 #include "info.h"
 #include "console.h"
@@ -861,6 +862,11 @@ static void close_editor()
 #endif
 	
 	close_editor_screen();
+
+	//	The mine may have been edited, so any cached segment grid is stale.
+	invalidate_segment_grid();
+	reset_dynamic_light();
+	invalidate_light_probes();
 	
 	//kill our camera object
 	
@@ -78,6 +78,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "segiter.h"
 #include "d_enumerate.h"
 #include "d_levelstate.h"
+#include "rewind.h"
 #include <utility>
 
 using std::min;
@@ -3206,6 +3207,144 @@ static bool skip_ai_for_time_splice(const vcobjptridx_t robot, const robot_info
 	return false;
 }
 
+/* AI level of detail.  Robots which are unaware of every player, idle, and
+ * many segments away from the nearest player are processed only every
+ * second, fourth or eighth frame.  The frame time they skip is saved in
+ * ai_local::lod_skipped_time and given back when they are next processed,
+ * so timers and movement advance at the same overall rate.
+ *
+ * The decision depends only on game state (segment connectivity, player
+ * positions, object numbers and a frame counter), never on wall clock time
+ * or rendering, so it is the same on every run with the same input.
+ */
+constexpr uint8_t ai_lod_full_rate_depth = 8;
+constexpr uint8_t ai_lod_max_depth = 32;
+constexpr fix ai_lod_max_skipped_time = F1_0/4;
+
+struct ai_lod_state
+{
+	bool valid = false;
+	unsigned frame = 0;
+	//	Segment hops to the nearest player, or 0 if more than
+	//	ai_lod_max_depth.
+	segment_depth_array_t depth;
+};
+
+static ai_lod_state Ai_lod_state;
+
+//	Find the number of segment hops from each segment to the nearest player,
+//	out to ai_lod_max_depth.
+static void compute_ai_lod_depths(fvcobjptr &vcobjptr, fvcsegptr &vcsegptr, ai_lod_state &lod)
+{
+	static std::array<segnum_t, MAX_SEGMENTS> queue;
+	unsigned head = 0, tail = 0;
+	lod.depth = {};
+	range_for (const auto &&objp, vcobjptr)
+	{
+		if (objp->type != OBJ_PLAYER)
+			continue;
+		auto &d = lod.depth[objp->segnum];
+		if (d)
+			continue;
+		d = 1;
+		queue[tail++] = objp->segnum;
+	}
+	while (head < tail)
+	{
+		const auto curseg = queue[head++];
+		const unsigned child_depth = lod.depth[curseg] + 1;
+		if (child_depth > ai_lod_max_depth)
+			continue;
+		for (const auto childnum : vcsegptr(curseg)->shared_segment::children)
+		{
+			if (!IS_CHILD(childnum))
+				continue;
+			auto &d = lod.depth[childnum];
+			if (d)
+				continue;
+			d = child_depth;
+			queue[tail++] = childnum;
+		}
+	}
+	lod.valid = true;
+	++ lod.frame;
+}
+
+//	Return how often this robot needs to be processed: every frame, or
+//	every second, fourth or eighth frame.
+static unsigned get_ai_lod_interval(const vcobjptridx_t robot, const robot_info &robptr, const ai_lod_state &lod)
+{
+	if (!lod.valid || unlikely(is_break_object(robot)))
+		return 1;
+	if (robot->control_source != object::control_type::ai)
+		return 1;
+	const auto &aip = robot->ctype.ai_info;
+	const auto &ailp = aip.ail;
+	if (aip.SKIP_AI_COUNT || aip.CLOAKED)
+		return 1;
+	if (ailp.player_awareness_type != player_awareness_type_t::PA_NONE || player_is_visible(ailp.previous_visibility))
+		return 1;
+	switch (ailp.mode)
+	{
+		case ai_mode::AIM_STILL:
+		case ai_mode::AIM_WANDER:
+		case ai_mode::AIM_FOLLOW_PATH:
+			break;
+		default:
+			return 1;
+	}
+	if (robptr.boss_flag)
+		return 1;
+#if defined(DXX_BUILD_DESCENT_II)
+	if (robot_is_companion(robptr) || robot_is_thief(robptr) || (aip.SUB_FLAGS & SUB_FLAGS_CAMERA_AWAKE) || aip.dying_start_time)
+		return 1;
+#endif
+	const unsigned depth = lod.depth[robot->segnum];
+	if (depth && depth <= ai_lod_full_rate_depth)
+		return 1;
+	if (depth && depth <= ai_lod_full_rate_depth * 2)
+		return 2;
+	if (depth)
+		return 4;
+	return 8;
+}
+
+//	Return true if this robot should not be processed this frame.  Otherwise,
+//	return the frame time which the robot skipped in time_to_add.
+static bool skip_ai_for_level_of_detail(const vcobjptridx_t robot, const robot_info &robptr, ai_local &ailp, fix &time_to_add)
+{
+	auto &lod = Ai_lod_state;
+	const auto interval = get_ai_lod_interval(robot, robptr, lod);
+	if (interval > 1 && (lod.frame + robot.get_unchecked_index()) % interval && ailp.lod_skipped_time + FrameTime < ai_lod_max_skipped_time)
+	{
+		ailp.lod_skipped_time += FrameTime;
+		return true;
+	}
+	time_to_add = std::exchange(ailp.lod_skipped_time, 0);
+	return false;
+}
+
+/* While a robot catches up on the frames it skipped, FrameTime covers
+ * them all, so that every timer and turn in the AI code advances by the
+ * full elapsed time.
+ */
+class ai_lod_frame_time
+{
+	const fix saved_frame_time;
+public:
+	ai_lod_frame_time(const fix skipped_time) :
+		saved_frame_time(FrameTime)
+	{
+		FrameTime += skipped_time;
+	}
+	~ai_lod_frame_time()
+	{
+		FrameTime = saved_frame_time;
+	}
+	ai_lod_frame_time(const ai_lod_frame_time &) = delete;
+	ai_lod_frame_time &operator=(const ai_lod_frame_time &) = delete;
+};
+
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -3224,6 +3363,13 @@ void do_ai_frame(const vmobjptridx_t obj)
 	auto &Objects = LevelUniqueObjectState.Objects;
 	auto &vmobjptr = Objects.vmptr;
 	auto &vmobjptridx = Objects.vmptridx;
+	auto &Robot_info = LevelSharedRobotInfoState.Robot_info;
+	auto &robptr = Robot_info[get_robot_id(obj)];
+
+	fix lod_skipped_time = 0;
+	if (skip_ai_for_level_of_detail(obj, robptr, ailp, lod_skipped_time))
+		return;
+	const ai_lod_frame_time lod_frame_time(lod_skipped_time);
 
 #if defined(DXX_BUILD_DESCENT_II)
 	auto &BuddyState = LevelUniqueObjectState.BuddyState;
@@ -3245,11 +3391,9 @@ void do_ai_frame(const vmobjptridx_t obj)
 		return;
 	}
 
-	auto &Robot_info = LevelSharedRobotInfoState.Robot_info;
 #if defined(DXX_BUILD_DESCENT_II)
 	auto &Station = LevelUniqueFuelcenterState.Station;
 #endif
-	auto &robptr = Robot_info[get_robot_id(obj)];
 	Assert(robptr.always_0xabcd == 0xabcd);
 
 	if (do_any_robot_dying_frame(obj))
@@ -4681,6 +4825,7 @@ void do_ai_frame_all(void)
 #endif
 
 	set_player_awareness_all(vmobjptr, vcsegptridx, LevelUniqueRobotAwarenessState);
+	compute_ai_lod_depths(vmobjptr, vcsegptr, Ai_lod_state);
 
 #if defined(DXX_BUILD_DESCENT_II)
 	auto &BossUniqueState = LevelUniqueObjectState.BossState;
@@ -4718,6 +4863,7 @@ void init_robots_for_level(void)
 	auto &BossUniqueState = LevelUniqueObjectState.BossState;
 	BossUniqueState.Boss_dying_start_time = 0;
 	Overall_agitation = 0;
+	Ai_lod_state.valid = false;
 #if defined(DXX_BUILD_DESCENT_II)
 	GameUniqueState.Final_boss_countdown_time = 0;
 	Ai_last_missile_camera = nullptr;
@@ -5149,4 +5295,17 @@ int ai_restore_state(PHYSFS_File *fp, int version, int swap)
 	return 1;
 }
 
+void ai_rewind_state(rewind_state &r)
+{
+	r(Overall_agitation);
+	r(Ai_cloak_info);
+	r(LevelUniqueRobotAwarenessState);
+	r(Point_segs);
+	/* The first free entry moves with the array, so keep its index. */
+	uint32_t free_point_segs = Point_segs_free_ptr - Point_segs.begin();
+	r(free_point_segs);
+	if (r.is_restoring())
+		Point_segs_free_ptr = Point_segs.begin() + std::min<std::size_t>(free_point_segs, Point_segs.size());
+}
+
 }
@@ -31,6 +31,10 @@
 #include "cli.h"
 #include "cmd.h"
 #include "cvar.h"
+#include "rewind.h"
+#if DXX_USE_UDP
+#include "net_udp.h"
+#endif
 
 #include "dxxsconf.h"
 #include <array>
@@ -455,6 +459,10 @@ void con_init(void)
 	cli_init();
 	cmd_init();
 	cvar_init();
+#if DXX_USE_UDP
+	net_udp_telemetry_init();
+#endif
+	rewind_init();
 }
 
 }
@@ -0,0 +1,288 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Dedicated host: runs UDP netgames without video, sound or input.
+ *
+ * The rotation file given to -dedicated lists the games to host, in
+ * order.  Each game starts with a mission= line, and the lines which
+ * follow it until the next mission= line set its level=, its mode= and
+ * its name=.  Other settings come from the netgame profile of the pilot,
+ * as in the host menu.  For example:
+ *
+ *	mission=firstmiss
+ *	level=1
+ *	mode=cooperative
+ *	mission=mymission
+ *	mode=anarchy
+ *	name=Rebirth anarchy
+ *
+ * Lines starting with ; or # are comments.
+ *
+ */
+
+#include "dxxsconf.h"
+
+#if DXX_USE_UDP
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "dedicated.h"
+#include "args.h"
+#include "cmd.h"
+#include "console.h"
+#include "dxxerror.h"
+#include "event.h"
+#include "game.h"
+#include "gameseq.h"
+#include "mission.h"
+#include "multi.h"
+#include "net_udp.h"
+#include "physfsx.h"
+#include "player.h"
+#include "strutil.h"
+#include "window.h"
+
+#include "compiler-range_for.h"
+#include "d_levelstate.h"
+#include "nvparse.h"
+
+namespace dsx {
+
+namespace {
+
+struct dedicated_game
+{
+	std::string mission;
+	int level = 1;
+	std::optional<network_game_type> mode;
+	std::string name;
+};
+
+struct dedicated_mode_name
+{
+	const char *name;
+	network_game_type mode;
+};
+
+constexpr dedicated_mode_name dedicated_mode_names[] = {
+	{"anarchy", network_game_type::anarchy},
+	{"team_anarchy", network_game_type::team_anarchy},
+	{"robot_anarchy", network_game_type::robot_anarchy},
+	{"cooperative", network_game_type::cooperative},
+#if defined(DXX_BUILD_DESCENT_II)
+	{"capture_flag", network_game_type::capture_flag},
+	{"hoard", network_game_type::hoard},
+	{"team_hoard", network_game_type::team_hoard},
+#endif
+	{"bounty", network_game_type::bounty},
+};
+
+static bool dedicated_quit;
+
+static std::vector<dedicated_game> dedicated_read_rotation(const char *const filename)
+{
+	std::vector<dedicated_game> rotation;
+	auto file = PHYSFSX_openReadBuffered(filename).first;
+	if (!file)
+		return rotation;
+	for (PHYSFSX_gets_line_t<128> line; const char *const eol = PHYSFSX_fgets(line, file);)
+	{
+		const auto lb = line.begin();
+		if (eol == line.end() || *lb == ';' || *lb == '#')
+			continue;
+		const auto eq = std::find(lb, eol, '=');
+		if (eq == eol)
+			continue;
+		const auto value = std::next(eq);
+		if (cmp(lb, eq, "mission"))
+		{
+			rotation.emplace_back();
+			rotation.back().mission.assign(value, eol - value);
+			continue;
+		}
+		if (rotation.empty())
+		{
+			con_printf(CON_URGENT, "dedicated: %s: ignoring \"%s\" before the first mission=", filename, lb);
+			continue;
+		}
+		auto &g = rotation.back();
+		if (cmp(lb, eq, "level"))
+			convert_integer(g.level, value);
+		else if (cmp(lb, eq, "mode"))
+		{
+			const auto i = std::find_if(std::begin(dedicated_mode_names), std::end(dedicated_mode_names), [value](const dedicated_mode_name &m) { return !d_stricmp(m.name, value); });
+			if (i != std::end(dedicated_mode_names))
+				g.mode = i->mode;
+			else
+				con_printf(CON_URGENT, "dedicated: %s: unknown mode \"%s\"", filename, value);
+		}
+		else if (cmp(lb, eq, "name"))
+			g.name.assign(value, eol - value);
+	}
+	return rotation;
+}
+
+static bool dedicated_start_game(const dedicated_game &g)
+{
+	mission_entry_predicate mission_predicate;
+	mission_predicate.filesystem_name = g.mission.c_str();
+#if defined(DXX_BUILD_DESCENT_II)
+	mission_predicate.check_version = false;
+#endif
+	if (const auto errstr = load_mission_by_name(mission_predicate, mission_name_type::guess))
+	{
+		con_printf(CON_URGENT, "dedicated: cannot load mission %s: %s", g.mission.c_str(), errstr);
+		return false;
+	}
+	Game_mode = {};
+	if (!net_udp_start_dedicated_game(g.level, g.mode ? &*g.mode : nullptr, g.name.empty() ? nullptr : g.name.c_str()))
+	{
+		con_printf(CON_URGENT, "dedicated: cannot start a game of mission %s", g.mission.c_str());
+		return false;
+	}
+	con_printf(CON_NORMAL, "dedicated: hosting \"%s\", mission %s, level %i", Netgame.game_name.data(), g.mission.c_str(), Netgame.levelnum);
+	return true;
+}
+
+/* Close the game, which makes the loop of dedicated_host_run go on with
+ * the next game of the rotation.  The commands only run from that loop,
+ * where the game window is in front, unless the game is over.
+ */
+static void dedicated_end_game()
+{
+	if (Game_wind && window_get_front() == Game_wind)
+		window_close(Game_wind);
+}
+
+static void dedicated_cmd_status(unsigned long, const char *const *)
+{
+	if (!(Game_mode & GM_NETWORK))
+	{
+		con_puts(CON_NORMAL, "status: no game is running");
+		return;
+	}
+	con_printf(CON_NORMAL, "status: \"%s\", mission %s, level %i, %u of %u players", Netgame.game_name.data(), &*Current_mission->filename, Current_level_num, N_players, Netgame.max_numplayers);
+	for (unsigned i = 0; i < N_players; ++i)
+	{
+		auto &plr = *vcplayerptr(i);
+		if (plr.connected != CONNECT_DISCONNECTED)
+			con_printf(CON_NORMAL, "  %u. %s%s", i, static_cast<const char *>(plr.callsign), i == Player_num ? " (host)" : "");
+	}
+}
+
+static void dedicated_cmd_next(unsigned long, const char *const *)
+{
+	dedicated_end_game();
+}
+
+static void dedicated_cmd_kick(const unsigned long argc, const char *const *const argv)
+{
+	if (argc < 2)
+	{
+		cmd_insertf("help %s", argv[0]);
+		return;
+	}
+	const auto i = strtoul(argv[1], nullptr, 10);
+	if (!(Game_mode & GM_NETWORK) || i == Player_num || i >= N_players || vcplayerptr(static_cast<unsigned>(i))->connected == CONNECT_DISCONNECTED)
+	{
+		con_printf(CON_NORMAL, "kick: no player %s to kick", argv[1]);
+		return;
+	}
+	con_printf(CON_NORMAL, "kick: dumping %s", static_cast<const char *>(vcplayerptr(static_cast<unsigned>(i))->callsign));
+	multi::dispatch->kick_player(Netgame.players[i].protocol.udp.addr, DUMP_KICKED);
+}
+
+static void dedicated_cmd_quit(unsigned long, const char *const *)
+{
+	dedicated_quit = true;
+	dedicated_end_game();
+}
+
+#ifndef _WIN32
+/* Queue the lines typed on stdin as console commands, without waiting
+ * for input.
+ */
+static void dedicated_read_console()
+{
+	static bool stdin_closed;
+	static std::string pending;
+	if (stdin_closed)
+		return;
+	pollfd p{};
+	p.fd = STDIN_FILENO;
+	p.events = POLLIN;
+	while (poll(&p, 1, 0) > 0 && (p.revents & (POLLIN | POLLHUP)))
+	{
+		char buf[256];
+		const auto r = read(STDIN_FILENO, buf, sizeof(buf));
+		if (r <= 0)
+		{
+			stdin_closed = true;
+			break;
+		}
+		pending.append(buf, r);
+		for (std::size_t eol; (eol = pending.find('\n')) != std::string::npos; pending.erase(0, eol + 1))
+		{
+			pending[eol] = 0;
+			if (eol && pending[eol - 1] == '\r')
+				pending[eol - 1] = 0;
+			if (pending[0])
+				cmd_append(pending.c_str());
+		}
+		if (pending.size() > CMD_MAX_LENGTH)
+			pending.clear();
+	}
+}
+#endif
+
+}
+
+void dedicated_host_run()
+{
+	if (!InterfaceUniqueState.PilotName[0])
+		UserError("-dedicated needs a pilot, given with -pilot.");
+	const auto rotation = dedicated_read_rotation(CGameArg.MplDedicatedRotation.c_str());
+	if (rotation.empty())
+		UserError("-dedicated found no mission= line in \"%s\".", CGameArg.MplDedicatedRotation.c_str());
+	cmd_addcommand("status", dedicated_cmd_status, "status\n"     "    show the game and its players");
+	cmd_addcommand("next",   dedicated_cmd_next,   "next\n"       "    end the game and host the next game of the rotation");
+	cmd_addcommand("kick",   dedicated_cmd_kick,   "kick <n>\n"   "    dump player <n> of status from the game");
+	cmd_addcommand("quit",   dedicated_cmd_quit,   "quit\n"       "    end the game and stop hosting");
+	for (std::size_t i = 0, failed = 0; !dedicated_quit; i = (i + 1) % rotation.size())
+	{
+		if (!dedicated_start_game(rotation[i]))
+		{
+			if (++failed == rotation.size())
+			{
+				con_puts(CON_URGENT, "dedicated: no game of the rotation can start");
+				break;
+			}
+			continue;
+		}
+		failed = 0;
+		while (window_get_front())
+		{
+#ifndef _WIN32
+			dedicated_read_console();
+#endif
+			event_process();
+		}
+	}
+}
+
+}
+#endif
@@ -31,7 +31,6 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "timer.h"
 #include "joy.h"
 #include "digi.h"
-#include "digi_audio.h"
 #include "sounds.h"
 #include "args.h"
 #include "newdemo.h"
@@ -98,6 +97,8 @@ static sound_objects_t SoundObjects;
 static short next_signature=0;
 
 static int N_active_sound_objects;
+// between digi_pause_digi_sounds and digi_resume_digi_sounds, when no sound object may take a channel
+static bool digi_sounds_paused;
 
 static void digi_kill_sound(sound_object &s)
 {
@@ -182,22 +183,31 @@ static int digi_unxlat_sound(int soundno)
 	throw std::invalid_argument("sound not loaded");
 }
 
-static std::pair<int, sound_pan> digi_get_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const vms_vector &sound_pos, const vcsegptridx_t sound_seg, fix max_volume, vm_distance max_distance)
+static vm_distance digi_sound_range(const vm_distance max_distance)
+{
+	return (max_distance*5)/4;		// Make all sounds travel 1.25 times as far.
+}
+
+static int digi_sound_search_depth(const vm_distance range)
+{
+	const int num_search_segs = f2i(range/20);
+	return num_search_segs < 1 ? 1 : num_search_segs;
+}
+
+template <typename F>
+static std::pair<int, sound_pan> digi_get_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vms_vector &sound_pos, const fix max_volume, vm_distance max_distance, F &&get_path_distance)
 {
 
 	vms_vector	vector_to_sound;
 	fix angle_from_ear;
 
-	max_distance = (max_distance*5)/4;		// Make all sounds travel 1.25 times as far.
+	max_distance = digi_sound_range(max_distance);
 
 	//	Warning: Made the vm_vec_normalized_dir be vm_vec_normalized_dir_quick and got illegal values to acos in the fang computation.
 	auto distance = vm_vec_normalized_dir_quick( vector_to_sound, sound_pos, listener_pos );
 
 	if (distance < max_distance )	{
-		int num_search_segs = f2i(max_distance/20);
-		if ( num_search_segs < 1 ) num_search_segs = 1;
-
-		auto path_distance = find_connected_distance(listener_pos, listener_seg, sound_pos, sound_seg, num_search_segs, WALL_IS_DOORWAY_FLAG::rendpast | WALL_IS_DOORWAY_FLAG::fly);
+		const auto path_distance = get_path_distance(digi_sound_search_depth(max_distance));
 		if ( path_distance > -1 )	{
 			const int volume = max_volume - fixdiv(path_distance,max_distance);
 			if (volume > 0)
@@ -212,6 +222,13 @@ static std::pair<int, sound_pan> digi_get_sound_loc(const vms_matrix &listener,
 	return {};
 }
 
+static std::pair<int, sound_pan> digi_get_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const vms_vector &sound_pos, const vcsegptridx_t sound_seg, const fix max_volume, const vm_distance max_distance)
+{
+	return digi_get_sound_loc(listener, listener_pos, sound_pos, max_volume, max_distance, [&](const int num_search_segs) {
+		return find_connected_distance(listener_pos, listener_seg, sound_pos, sound_seg, num_search_segs, WALL_IS_DOORWAY_FLAG::rendpast | WALL_IS_DOORWAY_FLAG::fly);
+	});
+}
+
 static void digi_update_sound_loc(const vms_matrix &listener, const vms_vector &listener_pos, const vcsegptridx_t listener_seg, const vms_vector &sound_pos, const vcsegptridx_t sound_seg, sound_object &so)
 {
 	auto &&[volume, pan] = digi_get_sound_loc(listener, listener_pos, listener_seg, sound_pos, sound_seg, so.max_volume, so.max_distance);
@@ -219,6 +236,18 @@ static void digi_update_sound_loc(const vms_matrix &listener, const vms_vector &
 	so.pan = pan;
 }
 
+/* As digi_update_sound_loc, with the path distance from the search which
+ * digi_sync_sounds ran for all its sounds.
+ */
+static void digi_update_sound_loc_found(const vms_matrix &listener, const vms_vector &listener_pos, const vms_vector &sound_pos, const segnum_t sound_seg, sound_object &so)
+{
+	auto &&[volume, pan] = digi_get_sound_loc(listener, listener_pos, sound_pos, so.max_volume, so.max_distance, [&](const int num_search_segs) {
+		return connected_distance(sound_pos, sound_seg, num_search_segs);
+	});
+	so.volume = volume;
+	so.pan = pan;
+}
+
 void digi_play_sample_once( int soundno, fix max_volume )
 {
 	if ( Newdemo_state == ND_STATE_RECORDING )
@@ -357,7 +386,7 @@ static void digi_start_sound_object(sound_object &s)
 		return;
 
 	// only use up to half the sound channels for "permanent" sounts
-	if ((s.flags & SOF_PERMANENT) && (N_active_sound_objects >= max(1, digi_max_channels / 4)))
+	if ((s.flags & SOF_PERMANENT) && (N_active_sound_objects >= max(1u, digi_voices / 4)))
 		return;
 
 	// start the sample playing
@@ -542,6 +571,50 @@ static void digi_record_sound_objects()
 
 static int was_recording = 0;
 
+/* The object a sound is linked to, or nullptr if that object is gone. */
+static const object *digi_find_sound_object_link(fvcobjptr &vcobjptr, const sound_object &s)
+{
+	const object &objp = [&vcobjptr, &s]{
+		if (Newdemo_state != ND_STATE_PLAYBACK)
+			return vcobjptr(s.link_type.obj.objnum);
+		auto objnum = newdemo_find_object(s.link_type.obj.objsignature);
+		if (objnum != object_none)
+			return static_cast<vcobjptr_t>(objnum);
+		return vcobjptr(object_first);
+	}();
+	if (objp.type == OBJ_NONE || objp.signature != s.link_type.obj.objsignature)
+		return nullptr;
+	return &objp;
+}
+
+/* Find the path distances from the viewer to every sound within range
+ * with one search through the segments, which digi_update_sound_loc_found
+ * then reads.  Every sound searching on its own is slow in levels with
+ * many sounds.
+ */
+static void digi_find_sound_distances(fvcobjptr &vcobjptr, const object_base &viewer)
+{
+	start_connected_distances();
+	const auto want = [&viewer](const vms_vector &pos, const segnum_t segnum, const sound_object &s) {
+		const auto range = digi_sound_range(s.max_distance);
+		if (vm_vec_dist_quick(pos, viewer.pos) < range)
+			want_connected_distance(segnum, digi_sound_search_depth(range));
+	};
+	range_for (auto &s, SoundObjects)
+	{
+		if (!(s.flags & SOF_USED))
+			continue;
+		if (s.flags & SOF_LINK_TO_POS)
+			want(s.link_type.pos.position, s.link_type.pos.segnum, s);
+		else if (s.flags & SOF_LINK_TO_OBJ)
+		{
+			if (const auto objp = digi_find_sound_object_link(vcobjptr, s))
+				want(objp->pos, objp->segnum, s);
+		}
+	}
+	find_connected_distances(viewer.pos, vcsegptridx(viewer.segnum), WALL_IS_DOORWAY_FLAG::rendpast | WALL_IS_DOORWAY_FLAG::fly);
+}
+
 void digi_sync_sounds()
 {
 	int oldvolume;
@@ -561,6 +634,7 @@ void digi_sync_sounds()
 	auto &Objects = LevelUniqueObjectState.Objects;
 	auto &vcobjptr = Objects.vcptr;
 	const auto &&viewer = vcobjptr(Viewer);
+	digi_find_sound_distances(vcobjptr, viewer);
 	range_for (auto &s, SoundObjects)
 	{
 		if (s.flags & SOF_USED)
@@ -581,18 +655,10 @@ void digi_sync_sounds()
 			}
 
 			if ( s.flags & SOF_LINK_TO_POS )	{
-				digi_update_sound_loc(viewer->orient, viewer->pos, vcsegptridx(viewer->segnum), s.link_type.pos.position, vcsegptridx(s.link_type.pos.segnum), s);
+				digi_update_sound_loc_found(viewer->orient, viewer->pos, s.link_type.pos.position, s.link_type.pos.segnum, s);
 			} else if ( s.flags & SOF_LINK_TO_OBJ )	{
-				const object &objp = [&vcobjptr, &s]{
-					if (Newdemo_state != ND_STATE_PLAYBACK)
-						return vcobjptr(s.link_type.obj.objnum);
-					auto objnum = newdemo_find_object(s.link_type.obj.objsignature);
-					if (objnum != object_none)
-						return static_cast<vcobjptr_t>(objnum);
-					return vcobjptr(object_first);
-				}();
-
-				if ((objp.type==OBJ_NONE) || (objp.signature!=s.link_type.obj.objsignature))	{
+				const auto objp = digi_find_sound_object_link(vcobjptr, s);
+				if (!objp)	{
 					// The object that this is linked to is dead, so just end this sound if it is looping.
 					if ( s.channel>-1 )	{
 						if (s.flags & SOF_PLAY_FOREVER)
@@ -604,7 +670,7 @@ void digi_sync_sounds()
 					s.flags = 0;	// Mark as dead, so some other sound can use this sound
 					continue;		// Go on to next sound...
 				} else {
-					digi_update_sound_loc(viewer->orient, viewer->pos, vcsegptridx(viewer->segnum), objp.pos, vcsegptridx(objp.segnum), s);
+					digi_update_sound_loc_found(viewer->orient, viewer->pos, objp->pos, objp->segnum, s);
 				}
 			}
 
@@ -630,12 +696,21 @@ void digi_sync_sounds()
 
 				} else {
 					if (s.channel<0)	{
-						digi_start_sound_object(s);
+						if (!digi_sounds_paused)
+							digi_start_sound_object(s);
 					} else {
 						digi_set_channel_volume( s.channel, s.volume );
 					}
 				}
 			}
+			else if (s.channel < 0 && s.volume > 0 && (s.flags & SOF_PLAY_FOREVER) && !digi_sounds_paused)
+				/* A looping sound which lost its channel to a more
+				 * important sound, or found none free, keeps its place
+				 * here and tries again each frame until it gets one.
+				 * Not while paused, when digi_sync_sounds still runs
+				 * from a change of the volume in the menus.
+				 */
+				digi_start_sound_object(s);
 
 			if (oldpan != s.pan) 	{
 				if (s.channel>-1)
@@ -648,6 +723,7 @@ void digi_sync_sounds()
 
 void digi_pause_digi_sounds()
 {
+	digi_sounds_paused = true;
 	digi_pause_looping_sound();
 	range_for (auto &s, SoundObjects)
 	{
@@ -670,12 +746,15 @@ void digi_pause_digi_sounds()
 
 void digi_resume_digi_sounds()
 {
+	digi_sounds_paused = false;
 	digi_sync_sounds();	//don't think we really need to do this, but can't hurt
 	digi_unpause_looping_sound();
 }
 
 // Called by the code in digi.c when another sound takes this sound object's
-// slot because the sound was done playing.
+// slot because the sound was done playing, or because the other sound is
+// more important.  A sound which plays once is gone then, but a looping
+// sound starts again from digi_sync_sounds when a channel is free.
 void digi_end_soundobj(sound_object &s)
 {
 	Assert(s.flags & SOF_USED);
@@ -683,6 +762,8 @@ void digi_end_soundobj(sound_object &s)
 
 	N_active_sound_objects--;
 	s.channel = -1;
+	if (!(s.flags & SOF_PLAY_FOREVER))
+		s.flags = 0;
 }
 
 void digi_stop_digi_sounds()
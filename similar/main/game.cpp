@@ -89,9 +89,13 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "songs.h"
 
 #include "multi.h"
+#if DXX_USE_UDP
+#include "net_udp.h"
+#endif
 #include "cntrlcen.h"
 #include "pcx.h"
 #include "state.h"
+#include "rewind.h"
 #include "piggy.h"
 #include "ai.h"
 #include "robot.h"
@@ -603,7 +607,7 @@ void calc_frame_time()
 {
 	fix last_frametime = FrameTime;
 
-	const auto vsync = CGameCfg.VSync;
+	const auto vsync = CGameCfg.VSync && !CGameArg.MplDedicated;
 	const auto bound = f1_0 / (likely(vsync) ? MAXIMUM_FPS : CGameArg.SysMaxFPS);
 	const auto may_sleep = !CGameArg.SysNoNiceFPS && !vsync;
 	for (;;)
@@ -626,6 +630,12 @@ void calc_frame_time()
 			timer_delay_ms(1);
 	}
 
+	if (CGameArg.MplDedicated)
+		/* A dedicated host simulates a fixed tick, however late the
+		 * frame was.
+		 */
+		FrameTime = bound;
+
 	if ( cheats.turbo )
 		FrameTime *= 2;
 
@@ -1780,9 +1790,12 @@ window_event_result game_window::event_handler(const d_event &event)
 		case EVENT_MOUSE_MOVED:
 		case EVENT_KEY_COMMAND:
 		case EVENT_KEY_RELEASE:
-		case EVENT_IDLE:
 			return ReadControls(event, Controls);
 
+		case EVENT_IDLE:
+			if (!event_is_frame(event))
+				return ReadControls(event, Controls);
+			[[fallthrough]];
 		case EVENT_WINDOW_DRAW:
 			if (!time_paused)
 			{
@@ -1790,7 +1803,7 @@ window_event_result game_window::event_handler(const d_event &event)
 				result = GameProcessFrame();
 			}
 
-			if (!Automap_active)		// efficiency hack
+			if (!Automap_active && !CGameArg.MplDedicated)		// efficiency hack
 			{
 				if (force_cockpit_redraw) {			//screen need redrawing?
 					init_cockpit();
@@ -1939,6 +1952,7 @@ window_event_result GameProcessFrame()
 	auto result = window_event_result::ignored;
 
 	state_poll_autosave_game(GameUniqueState, LevelUniqueObjectState);
+	rewind_poll_capture();
 	update_player_stats();
 	diminish_palette_towards_normal();		//	Should leave palette effect up for as long as possible by putting right before render.
 	do_afterburner_stuff(Objects);
@@ -2027,6 +2041,11 @@ window_event_result GameProcessFrame()
 
 	if ( Newdemo_state == ND_STATE_PLAYBACK )
 	{
+#if DXX_USE_UDP
+		if (!CGameArg.MplUdpRelayWatch.empty())
+			result = std::max(net_udp_relay_watch_frame(), result);
+		if (Newdemo_state == ND_STATE_PLAYBACK)
+#endif
 		result = std::max(newdemo_playback_one_frame(), result);
 		if ( Newdemo_state != ND_STATE_PLAYBACK )
 		{
@@ -2261,6 +2280,8 @@ bool FireLaser(player_info &player_info, const control_info &Controls)
 	auto &vmobjptridx = Objects.vmptridx;
 	if (!Controls.state.fire_primary)
 		return false;
+	if (multi_is_observer(Player_num))
+		return false;
 	if (!allowed_to_fire_laser(player_info))
 		return false;
 	auto &Primary_weapon = player_info.Primary_weapon;
@@ -2225,6 +2225,9 @@ window_event_result ReadControls(const d_event &event, control_info &Controls)
 		}
 		if (Player_is_dead != player_dead_state::no)
 			return window_event_result::ignored;
+		if (multi_is_observer(Player_num))
+			/* An observer has no ship to fire from. */
+			return window_event_result::ignored;
 		do_weapon_n_item_stuff(Objects, Controls);
 	}
 
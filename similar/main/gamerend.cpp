@@ -56,10 +56,14 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "gameseq.h"
 #include "args.h"
 #include "object.h"
+#if DXX_USE_UDP
+#include "net_udp.h"
+#endif
 
 #include "compiler-range_for.h"
 #include "d_levelstate.h"
 #include "d_range.h"
+#include "partial_range.h"
 
 #if DXX_USE_OGL
 #include "ogl_init.h"
@@ -178,6 +182,24 @@ namespace dsx {
 
 namespace {
 
+#if DXX_USE_UDP
+/* The busiest packet types of the last second, from net_stats overlay. */
+static void show_net_telemetry(grs_canvas &canvas)
+{
+	auto &game_font = *GAME_FONT;
+	const auto &&line_spacing = LINE_SPACING(*canvas.cv_font, game_font);
+	const auto x = FSPACX(1);
+	auto y = line_spacing * 7;
+	gr_set_fontcolor(canvas, BM_XRGB(0, 31, 0), -1);
+	gr_string(canvas, game_font, x, y, "net traffic per second");
+	for (const auto &r : partial_const_range(UDP_telemetry_top, UDP_telemetry_top_count))
+	{
+		y += line_spacing;
+		gr_printf(canvas, game_font, x, y, "%s: %uB %u pkts %u resent", r.name, r.bytes, r.packets, r.resends);
+	}
+}
+#endif
+
 static void show_netplayerinfo(grs_canvas &canvas)
 {
 	auto &Objects = LevelUniqueObjectState.Objects;
@@ -876,6 +898,13 @@ void game_render_frame_mono(const control_info &Controls)
 		gr_set_default_canvas();
 		show_netplayerinfo(*grd_curcanv);
 	}
+#if DXX_USE_UDP
+	if (UDP_telemetry_overlay && Game_mode & GM_NETWORK)
+	{
+		gr_set_default_canvas();
+		show_net_telemetry(*grd_curcanv);
+	}
+#endif
 }
 
 }
@@ -42,6 +42,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "object.h"
 #include "game.h"
 #include "gameseg.h"
+#include "lighting.h"
 #include "wall.h"
 #include "gamemine.h"
 #include "robot.h"
@@ -1515,6 +1516,9 @@ int load_level(
 
 	//======================== CLOSE FILE =============================
 	LoadFile.reset();
+	invalidate_segment_grid();
+	reset_dynamic_light();
+	invalidate_light_probes();
 #if defined(DXX_BUILD_DESCENT_II)
 	set_ambient_sound_flags();
 #endif
@@ -988,6 +988,384 @@ fcd_done1: ;
 
 }
 
+namespace {
+
+struct connected_distance_entry
+{
+	uint32_t visited, wanted;
+	uint32_t queue_index;	//	where the search queued this segment
+	uint8_t depth;
+	segnum_t parent;	//	segment before this one on the path from the origin
+	segnum_t first;		//	segment after the origin on the path from the origin
+	vm_distance chain;	//	distance along the centers of the path from first to this segment
+	vms_vector center;
+};
+
+struct connected_distance_search
+{
+	uint32_t stamp = 0;
+	unsigned remaining, max_depth;
+	vms_vector origin_pos, origin_center;
+	segnum_t origin_seg;
+	WALL_IS_DOORWAY_mask_t wid_flag = WALL_IS_DOORWAY_FLAG::None;
+	/*	For each depth, the place in the queue of the first segment which
+	 *	queued a segment that deep.  find_connected_distance with that
+	 *	max_depth gives up there.
+	 */
+	std::array<uint32_t, MAX_LOC_POINT_SEGS> give_up;
+	std::vector<connected_distance_entry> entries;
+	std::vector<segnum_t> queue;
+};
+
+static connected_distance_search Connected_distances;
+
+}
+
+void start_connected_distances()
+{
+	auto &c = Connected_distances;
+	const std::size_t num_segments = LevelSharedSegmentState.get_segments().get_count();
+	if (c.entries.size() != num_segments)
+	{
+		c.entries.assign(num_segments, {});
+		c.stamp = 0;
+	}
+	if (!++ c.stamp)
+	{
+		for (auto &e : c.entries)
+			e.visited = e.wanted = 0;
+		c.stamp = 1;
+	}
+	c.remaining = 0;
+	c.max_depth = 0;
+}
+
+void want_connected_distance(const segnum_t seg1, unsigned max_depth)
+{
+	auto &c = Connected_distances;
+	if (max_depth > MAX_LOC_POINT_SEGS - 2)
+		max_depth = MAX_LOC_POINT_SEGS - 2;
+	c.max_depth = std::max(c.max_depth, max_depth);
+	auto &e = c.entries[seg1];
+	if (e.wanted != c.stamp)
+	{
+		e.wanted = c.stamp;
+		++ c.remaining;
+	}
+}
+
+void find_connected_distances(const vms_vector &p0, const vcsegptridx_t seg0, const WALL_IS_DOORWAY_mask_t wid_flag)
+{
+	auto &LevelSharedVertexState = LevelSharedSegmentState.get_vertex_state();
+	auto &Vertices = LevelSharedVertexState.get_vertices();
+	auto &vcvertptr = Vertices.vcptr;
+	auto &Walls = LevelUniqueWallSubsystemState.Walls;
+	auto &vcwallptr = Walls.vcptr;
+	auto &c = Connected_distances;
+	const auto stamp = c.stamp;
+	c.origin_pos = p0;
+	c.origin_seg = seg0;
+	c.wid_flag = wid_flag;
+	compute_segment_center(vcvertptr, c.origin_center, seg0);
+	c.give_up.fill(UINT32_MAX);
+	c.queue.clear();
+	{
+		auto &e = c.entries[seg0];
+		e.visited = stamp;
+		e.queue_index = 0;
+		e.depth = 0;
+		e.parent = e.first = seg0;
+		e.chain = {};
+	}
+	/*	The search goes side by side, in the order find_connected_distance
+	 *	goes, so every segment gets the same path that it would find.  A
+	 *	wanted segment is done when the search reaches it in the queue,
+	 *	since find_connected_distance may give up before then.
+	 */
+	c.queue.emplace_back(seg0);
+	for (std::size_t qhead = 0; qhead != c.queue.size() && c.remaining; ++qhead)
+	{
+		const auto cur_seg = c.queue[qhead];
+		const auto &cur = c.entries[cur_seg];
+		if (cur.wanted == stamp && !-- c.remaining)
+			break;
+		const unsigned depth = cur.depth + 1;
+		const cscusegment segp = *vmsegptr(cur_seg);
+		for (const auto snum : MAX_SIDES_PER_SEGMENT)
+		{
+			const auto this_seg = segp.s.children[snum];
+			if (!IS_CHILD(this_seg))
+				continue;
+			if (wid_flag.value && !(WALL_IS_DOORWAY(GameBitmaps, Textures, vcwallptr, segp, snum) & wid_flag))
+				continue;
+			auto &e = c.entries[this_seg];
+			if (e.visited == stamp)
+				continue;
+			if (c.give_up[depth] == UINT32_MAX)
+				c.give_up[depth] = qhead;
+			//	Every search gives up here, and the rest of the queue is too deep for any.
+			if (depth >= c.max_depth)
+				return;
+			e.visited = stamp;
+			e.queue_index = c.queue.size();
+			e.depth = depth;
+			e.parent = cur_seg;
+			compute_segment_center(vcvertptr, e.center, vcsegptr(this_seg));
+			if (depth == 1)
+			{
+				e.first = this_seg;
+				e.chain = {};
+			}
+			else
+			{
+				e.first = cur.first;
+				e.chain = cur.chain + vm_vec_dist_quick(cur.center, e.center);
+			}
+			c.queue.emplace_back(this_seg);
+		}
+	}
+}
+
+vm_distance connected_distance(const vms_vector &p1, const segnum_t seg1, unsigned max_depth)
+{
+	auto &c = Connected_distances;
+	const auto seg0 = c.origin_seg;
+	if (seg0 == seg1)
+		return vm_vec_dist_quick(c.origin_pos, p1);
+	auto &Segments = LevelSharedSegmentState.get_segments();
+	const auto conn_side = find_connect_side(seg0, Segments.vcptr(seg1));
+	if (conn_side != side_none)
+	{
+#if defined(DXX_BUILD_DESCENT_II)
+		auto &Walls = LevelUniqueWallSubsystemState.Walls;
+		auto &vcwallptr = Walls.vcptr;
+		if (WALL_IS_DOORWAY(GameBitmaps, Textures, vcwallptr, Segments.vcptr(seg1), conn_side) & c.wid_flag)
+#endif
+		{
+			return vm_vec_dist_quick(c.origin_pos, p1);
+		}
+	}
+#if defined(DXX_BUILD_DESCENT_II)
+	if ((GameTime64 - Last_fcd_flush_time > F1_0*2) || (GameTime64 < Last_fcd_flush_time)) {
+		flush_fcd_cache();
+		Last_fcd_flush_time = GameTime64;
+	}
+	else
+	range_for (auto &i, Fcd_cache)
+		if (i.seg0 == seg0 && i.seg1 == seg1)
+			return i.dist;
+#endif
+	if (max_depth > MAX_LOC_POINT_SEGS - 2)
+		max_depth = MAX_LOC_POINT_SEGS - 2;
+	auto &e = c.entries[seg1];
+	if (e.visited != c.stamp || e.depth >= max_depth || e.queue_index > c.give_up[max_depth])
+	{
+		constexpr auto Connected_segment_distance = 1000;
+		add_to_fcd_cache(seg0, seg1, Connected_segment_distance, fcd_abort_cache_value);
+		return fcd_abort_return_value;
+	}
+	/*	As find_connected_distance: from p1 to the center of the segment
+	 *	before seg1, along the centers to the first segment, and from there
+	 *	to p0.  Next to the origin, that is the center of the origin and
+	 *	the center of seg1.
+	 */
+	const auto dist = (e.depth == 1)
+		? vm_vec_dist_quick(p1, c.origin_center) + vm_vec_dist_quick(c.origin_pos, e.center)
+		: vm_vec_dist_quick(p1, c.entries[e.parent].center) + vm_vec_dist_quick(c.origin_pos, c.entries[e.first].center) + c.entries[e.parent].chain;
+	add_to_fcd_cache(seg0, seg1, e.depth + 1, dist);
+	return dist;
+}
+
+namespace {
+
+//	Objects are sometimes slightly outside the segment to which they are
+//	linked, so grow each segment's box by this much before it is stored.
+constexpr fix segment_grid_padding = F1_0 * 10;
+constexpr fix segment_grid_min_cell_size = F1_0 * 128;
+//	Very large (usually broken) levels get coarser cells instead of an
+//	unbounded grid.
+constexpr std::size_t segment_grid_max_cells = 1 << 18;
+
+struct segment_grid_bounds
+{
+	vms_vector min, max;
+};
+
+struct segment_grid
+{
+	bool valid = false;
+	uint32_t visit_stamp = 0;
+	fix cell_size;
+	vms_vector origin;
+	std::array<unsigned, 3> dims;
+	/* cell_start[c] through cell_start[c + 1] index into cell_segments
+	 * for the segments overlapping cell c.
+	 */
+	std::vector<uint32_t> cell_start;
+	std::vector<segnum_t> cell_segments;
+	std::vector<segment_grid_bounds> bounds;
+	std::vector<uint32_t> visited;
+	unsigned get_cell_coordinate(const fix p, const fix o, const unsigned dim) const
+	{
+		const fix64 c = (static_cast<fix64>(p) - o) / cell_size;
+		return c < 0 ? 0 : (c >= dim ? dim - 1 : static_cast<unsigned>(c));
+	}
+	std::size_t get_cell_index(const unsigned x, const unsigned y, const unsigned z) const
+	{
+		return (static_cast<std::size_t>(z) * dims[1] + y) * dims[0] + x;
+	}
+};
+
+static segment_grid Segment_grid;
+
+static void build_segment_grid(segment_grid &g)
+{
+	auto &Segments = LevelSharedSegmentState.get_segments();
+	auto &LevelSharedVertexState = LevelSharedSegmentState.get_vertex_state();
+	auto &Vertices = LevelSharedVertexState.get_vertices();
+	auto &vcvertptr = Vertices.vcptr;
+	const std::size_t num_segments = Segments.get_count();
+	g.bounds.resize(num_segments);
+	g.visited.assign(num_segments, 0);
+	g.visit_stamp = 0;
+	vms_vector world_min{INT32_MAX, INT32_MAX, INT32_MAX};
+	vms_vector world_max{INT32_MIN, INT32_MIN, INT32_MIN};
+	range_for (const auto &&segp, Segments.vcptridx)
+	{
+		auto &b = g.bounds[segp];
+		b.min = b.max = vcvertptr(segp->verts.front());
+		range_for (const auto v, segp->verts)
+		{
+			auto &p = *vcvertptr(v);
+			b.min.x = std::min(b.min.x, p.x);
+			b.min.y = std::min(b.min.y, p.y);
+			b.min.z = std::min(b.min.z, p.z);
+			b.max.x = std::max(b.max.x, p.x);
+			b.max.y = std::max(b.max.y, p.y);
+			b.max.z = std::max(b.max.z, p.z);
+		}
+		b.min.x = std::max<fix64>(static_cast<fix64>(b.min.x) - segment_grid_padding, INT32_MIN);
+		b.min.y = std::max<fix64>(static_cast<fix64>(b.min.y) - segment_grid_padding, INT32_MIN);
+		b.min.z = std::max<fix64>(static_cast<fix64>(b.min.z) - segment_grid_padding, INT32_MIN);
+		b.max.x = std::min<fix64>(static_cast<fix64>(b.max.x) + segment_grid_padding, INT32_MAX);
+		b.max.y = std::min<fix64>(static_cast<fix64>(b.max.y) + segment_grid_padding, INT32_MAX);
+		b.max.z = std::min<fix64>(static_cast<fix64>(b.max.z) + segment_grid_padding, INT32_MAX);
+		world_min.x = std::min(world_min.x, b.min.x);
+		world_min.y = std::min(world_min.y, b.min.y);
+		world_min.z = std::min(world_min.z, b.min.z);
+		world_max.x = std::max(world_max.x, b.max.x);
+		world_max.y = std::max(world_max.y, b.max.y);
+		world_max.z = std::max(world_max.z, b.max.z);
+	}
+	if (!num_segments)
+		world_min = world_max = {};
+	g.origin = world_min;
+	const std::array<fix64, 3> extent{{
+		static_cast<fix64>(world_max.x) - world_min.x,
+		static_cast<fix64>(world_max.y) - world_min.y,
+		static_cast<fix64>(world_max.z) - world_min.z,
+	}};
+	for (fix64 cell_size = segment_grid_min_cell_size;; cell_size *= 2)
+	{
+		std::size_t cells = 1;
+		for (auto &&[d, e] : zip(g.dims, extent))
+			cells *= (d = static_cast<unsigned>(e / cell_size) + 1);
+		if (cells <= segment_grid_max_cells || cell_size > INT32_MAX / 2)
+		{
+			g.cell_size = static_cast<fix>(cell_size);
+			g.cell_start.assign(cells + 1, 0);
+			break;
+		}
+	}
+	/* Count the segments in each cell, convert the counts to starting
+	 * offsets, then store each segment in every cell it overlaps.
+	 */
+	const auto visit_cells = [&g](const segment_grid_bounds &b, auto &&f) {
+		const auto x0 = g.get_cell_coordinate(b.min.x, g.origin.x, g.dims[0]), x1 = g.get_cell_coordinate(b.max.x, g.origin.x, g.dims[0]);
+		const auto y0 = g.get_cell_coordinate(b.min.y, g.origin.y, g.dims[1]), y1 = g.get_cell_coordinate(b.max.y, g.origin.y, g.dims[1]);
+		const auto z0 = g.get_cell_coordinate(b.min.z, g.origin.z, g.dims[2]), z1 = g.get_cell_coordinate(b.max.z, g.origin.z, g.dims[2]);
+		for (auto z = z0; z <= z1; ++z)
+			for (auto y = y0; y <= y1; ++y)
+				for (auto x = x0; x <= x1; ++x)
+					f(g.get_cell_index(x, y, z));
+	};
+	for (auto &b : g.bounds)
+		visit_cells(b, [&g](const std::size_t c) { ++ g.cell_start[c + 1]; });
+	std::partial_sum(g.cell_start.begin(), g.cell_start.end(), g.cell_start.begin());
+	g.cell_segments.resize(g.cell_start.back());
+	std::vector<uint32_t> fill(g.cell_start.begin(), std::prev(g.cell_start.end()));
+	for (std::size_t s = 0; s != num_segments; ++s)
+		visit_cells(g.bounds[s], [&g, &fill, s](const std::size_t c) { g.cell_segments[fill[c]++] = static_cast<segnum_t>(s); });
+	g.valid = true;
+}
+
+}
+
+void invalidate_segment_grid()
+{
+	Segment_grid.valid = false;
+}
+
+void find_segments_near_point(const vms_vector &p, const fix radius, std::vector<segnum_t> &result)
+{
+	result.clear();
+	auto &g = Segment_grid;
+	if (!g.valid || g.bounds.size() != LevelSharedSegmentState.get_segments().get_count())
+		build_segment_grid(g);
+	if (g.bounds.empty())
+		return;
+	if (!++ g.visit_stamp)
+	{
+		/* The stamp wrapped.  Clear the old marks so that no segment
+		 * appears to have been visited by this query.
+		 */
+		std::fill(g.visited.begin(), g.visited.end(), 0);
+		g.visit_stamp = 1;
+	}
+	const auto stamp = g.visit_stamp;
+	const auto x0 = g.get_cell_coordinate(static_cast<fix>(std::max<fix64>(static_cast<fix64>(p.x) - radius, INT32_MIN)), g.origin.x, g.dims[0]);
+	const auto x1 = g.get_cell_coordinate(static_cast<fix>(std::min<fix64>(static_cast<fix64>(p.x) + radius, INT32_MAX)), g.origin.x, g.dims[0]);
+	const auto y0 = g.get_cell_coordinate(static_cast<fix>(std::max<fix64>(static_cast<fix64>(p.y) - radius, INT32_MIN)), g.origin.y, g.dims[1]);
+	const auto y1 = g.get_cell_coordinate(static_cast<fix>(std::min<fix64>(static_cast<fix64>(p.y) + radius, INT32_MAX)), g.origin.y, g.dims[1]);
+	const auto z0 = g.get_cell_coordinate(static_cast<fix>(std::max<fix64>(static_cast<fix64>(p.z) - radius, INT32_MIN)), g.origin.z, g.dims[2]);
+	const auto z1 = g.get_cell_coordinate(static_cast<fix>(std::min<fix64>(static_cast<fix64>(p.z) + radius, INT32_MAX)), g.origin.z, g.dims[2]);
+	/* Distance from p to the box along one axis, or -1 if that alone
+	 * puts the box out of range.
+	 */
+	const auto axis_distance = [radius](const fix v, const fix lo, const fix hi) -> fix64 {
+		const fix64 d = v < lo ? static_cast<fix64>(lo) - v : (v > hi ? static_cast<fix64>(v) - hi : 0);
+		return d > radius ? -1 : d;
+	};
+	const fix64 radius2 = static_cast<fix64>(radius) * radius;
+	for (auto z = z0; z <= z1; ++z)
+		for (auto y = y0; y <= y1; ++y)
+			for (auto x = x0; x <= x1; ++x)
+			{
+				const auto c = g.get_cell_index(x, y, z);
+				for (auto i = g.cell_start[c], e = g.cell_start[c + 1]; i != e; ++i)
+				{
+					const auto s = g.cell_segments[i];
+					auto &v = g.visited[s];
+					if (v == stamp)
+						continue;
+					v = stamp;
+					auto &b = g.bounds[s];
+					const auto dx = axis_distance(p.x, b.min.x, b.max.x);
+					if (dx < 0)
+						continue;
+					const auto dy = axis_distance(p.y, b.min.y, b.max.y);
+					if (dy < 0)
+						continue;
+					const auto dz = axis_distance(p.z, b.min.z, b.max.z);
+					if (dz < 0)
+						continue;
+					if (dx * dx + dy * dy + dz * dz > radius2)
+						continue;
+					result.emplace_back(s);
+				}
+			}
+}
+
 }
 
 namespace dcx {
@@ -1729,6 +2107,7 @@ static void change_segment_light(const vmsegptridx_t segp, const sidenum_t siden
 			const auto segment_center = compute_segment_center(vcvertptr, segp);
 			visited_segment_bitarray_t visited;
 			apply_light_to_segment(visited, segp, segment_center, light_intensity * dir, 0);
+			update_light_probes(visited);
 		}
 	}
 
@@ -490,6 +490,9 @@ void gameseq_remove_unused_players()
 				multi_make_player_ghost(i);
 			}
 		}
+		for (playernum_t i = 0; i < N_players; ++i)
+			if (multi_is_observer(i))
+				multi_make_observer_ghost(i);
 	}
 	else
 	{		// Note link to above if!!!
@@ -2357,7 +2360,13 @@ static void StartLevel(int random_flag)
 	{
 		if (Game_mode & GM_MULTI_COOP)
 			multi_send_score();
-	 	multi_send_reappear();
+		if (multi_is_observer(Player_num))
+			/* Nobody flies the ship of an observer, so it never
+			 * reappears.
+			 */
+			multi_make_observer_ghost(Player_num);
+		else
+			multi_send_reappear();
 		multi::dispatch->do_protocol_frame(1, 1);
 	}
 	else // in Singleplayer, after we died ...
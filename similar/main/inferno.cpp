@@ -87,6 +87,8 @@ char copyright[] = "DESCENT II  COPYRIGHT (C) 1994-1996 PARALLAX SOFTWARE CORPOR
 #endif
 #include "playsave.h"
 #include "newdemo.h"
+#include "state.h"
+#include "rewind.h"
 #include "joy.h"
 #if !DXX_USE_OGL
 #include "../texmap/scanline.h" //for select_tmap -MM
@@ -105,6 +107,7 @@ char copyright[] = "DESCENT II  COPYRIGHT (C) 1994-1996 PARALLAX SOFTWARE CORPOR
 #include "vers_id.h"
 #if DXX_USE_UDP
 #include "net_udp.h"
+#include "dedicated.h"
 #endif
 #include "dsx-ns.h"
 
@@ -175,6 +178,8 @@ static void print_commandline_help()
 	VERB("  -add-missions-dir <s>         Add contents of location <s> to the missions directory\n")	\
 	VERB("  -use_players_dir              Put player files and saved games in Players subdirectory\n")	\
 	VERB("  -lowmem                       Lowers animation detail for better performance with\n\t\t\t\tlow memory\n")	\
+	VERB("  -rewind <n>                   In single player, keep a snapshot of the game every <n>\n\t\t\t\tseconds for the console command rewind\n")	\
+	VERB("  -rewind_memory <n>            Keep at most <n> MB of snapshots (default: %u)\n", REWIND_MEMORY_DEFAULT)	\
 	VERB("  -pilot <s>                    Select pilot <s> automatically\n")	\
 	VERB("  -auto-record-demo             Start recording on level entry\n")	\
 	VERB("  -record-demo-format           Set demo name automatically\n")	\
@@ -232,6 +237,14 @@ static void print_commandline_help()
 		VERB("  -udp_hostaddr <s>             Use IP address/Hostname <s> for manual game joining\n\t\t\t\t(default: %s)\n", UDP_MANUAL_ADDR_DEFAULT)	\
 		VERB("  -udp_hostport <n>             Use UDP port <n> for manual game joining (default: %hu)\n", UDP_PORT_DEFAULT)	\
 		VERB("  -udp_myport <n>               Set my own UDP port to <n> (default: %hu)\n", UDP_PORT_DEFAULT)	\
+		VERB("  -udp_deltapos                 Send position updates as differences to peers which support it\n")	\
+		VERB("  -udp_interest                 As host, send positions of far away robots less often\n")	\
+		VERB("  -udp_relay                    Watch the netgame you join without a ship, and send it to spectators who watch with -udp_relay_watch\n")	\
+		VERB("  -udp_relay_watch <s>          Watch the netgame sent by the relay at address <s>\n")	\
+		VERB("  -udp_relay_port <n>           Port of the relay for spectators (default: %hu)\n", UDP_RELAY_PORT_DEFAULT)	\
+		VERB("  -udp_relay_delay <n>          As relay, show the game to spectators <n> seconds late (default: %u)\n", UDP_RELAY_DELAY_DEFAULT)	\
+		VERB("  -dedicated <s>                Host netgames without video, sound or input, with missions from file <s>\n")	\
+		VERB("  -dedicated_tick <n>           Simulate a dedicated host at <n> frames per second (default: %u)\n", UDP_DEDICATED_TICK_DEFAULT)	\
 		DXX_if_defined_01(DXX_USE_TRACKER, (	\
 			VERB("  -no-tracker                   Disable tracker (unless overridden by later -tracker_hostaddr)\n")	\
 			VERB("  -tracker_hostaddr <n>         Address of tracker server to register/query games to/from\n\t\t\t\t(default: %s)\n", TRACKER_ADDR_DEFAULT)	\
@@ -256,6 +269,8 @@ static void print_commandline_help()
 	VERB("  -norun                        Bail out after initialization\n")	\
 	VERB("  -no-grab                      Never grab keyboard/mouse\n")	\
 	VERB("  -renderstats                  Enable renderstats info by default\n")	\
+	VERB("  -olddynlight                  Recompute dynamic light from every light each frame\n")	\
+	VERB("  -state_hash <n>               Every <n> seconds, compare a hash of walls, triggers,\n\t\t\t\treactor and robots with the netgame host, and record it\n\t\t\t\tin demos to compare on playback\n")	\
 	VERB("  -text <s>                     Specify alternate .tex file\n")	\
 	VERB("  -showmeminfo                  Show memory statistics\n")	\
 	VERB("  -nodoublebuffer               Disable Doublebuffering\n")	\
@@ -612,7 +627,11 @@ static int main(int argc, char *argv[])
 
 	con_puts(CON_VERBOSE, "Going into graphics mode...");
 #if DXX_USE_OGL
-	gr_set_mode_from_window_size();
+	if (CGameArg.MplDedicated)
+		/* A dedicated host has no window to take the size of. */
+		gr_set_mode(Game_screen_mode);
+	else
+		gr_set_mode_from_window_size();
 #else
 	gr_set_mode(Game_screen_mode);
 #endif
@@ -737,8 +756,17 @@ static int main(int argc, char *argv[])
 	}
 	else
 #endif
+#endif
+#if DXX_USE_UDP
+	if (CGameArg.MplDedicated)
+		dedicated_host_run();
+	else
 #endif
 	{
+#if DXX_USE_UDP
+		if (!CGameArg.MplUdpRelayWatch.empty())
+			net_udp_relay_watch();
+#endif
 		Game_mode = {};
 		DoMenu();
 	}
@@ -757,6 +785,7 @@ static int main(int argc, char *argv[])
 	}
 
 	WriteConfigFile();
+	state_wait_for_pending_save();
 
 	con_puts(CON_DEBUG, "Cleanup...");
 	close_game();
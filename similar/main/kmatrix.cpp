@@ -365,11 +365,19 @@ window_event_result kmatrix_window::event_handler(const d_event &event)
 			}
 			break;
 			
+		case EVENT_IDLE:
+			if (!event_is_frame(event))
+				break;
+			[[fallthrough]];
 		case EVENT_WINDOW_DRAW:
 			{
 			timer_delay2(50);
-			gr_set_default_canvas();
-			kmatrix_redraw(*grd_curcanv, this);
+			const auto draw = event.type == EVENT_WINDOW_DRAW;
+			if (draw)
+			{
+				gr_set_default_canvas();
+				kmatrix_redraw(*grd_curcanv, this);
+			}
 
 			if (network != kmatrix_network::offline)
 				multi::dispatch->do_protocol_frame(0, 1);
@@ -413,7 +421,10 @@ window_event_result kmatrix_window::event_handler(const d_event &event)
 					}
 				}
 #endif
-				if (playing != kmatrix_status_mode::mission_finished)
+				/* Nobody at a dedicated host can press a key to leave the
+				 * scores of the mission.
+				 */
+				if (playing != kmatrix_status_mode::mission_finished || CGameArg.MplDedicated)
 					return window_event_result::close;
 			}
 
@@ -424,7 +435,8 @@ window_event_result kmatrix_window::event_handler(const d_event &event)
 				multi::dispatch->send_endlevel_packet();
 			}
 
-			kmatrix_status_msg(*grd_curcanv, playing == kmatrix_status_mode::reactor_countdown_running ? LevelUniqueControlCenterState.Countdown_seconds_left : f2i(end_time - timer_query()), playing);
+			if (draw)
+				kmatrix_status_msg(*grd_curcanv, playing == kmatrix_status_mode::reactor_countdown_running ? LevelUniqueControlCenterState.Countdown_seconds_left : f2i(end_time - timer_query()), playing);
 			break;
 			}
 			
@@ -56,6 +56,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "compiler-range_for.h"
 #include "d_levelstate.h"
 #include "partial_range.h"
+#include "segiter.h"
+#include <algorithm>
+#include <vector>
 
 #ifdef NEWHOMER
 #define HOMING_TRACKABLE_DOT_FRAME_TIME	HOMING_TURN_TIME
@@ -1037,6 +1040,25 @@ static int object_is_trackable(const imobjptridx_t objp, const vmobjptridx_t tra
 	}
 }
 
+//	--------------------------------------------------------------------------------------------
+//	Find every object in a segment near curpos.  This is a superset of the
+//	objects within radius of curpos, so callers must still check the
+//	distance.  The result is sorted by object number, so callers visit
+//	candidates in the same order as a scan of the whole object array, and
+//	ties are broken the same way.  The result is reused by the next call.
+static const std::vector<vcobjidx_t> &find_objects_near_point(fvcobjptridx &vcobjptridx, fvcsegptr &vcsegptr, const vms_vector &curpos, const fix radius)
+{
+	static std::vector<segnum_t> segments;
+	static std::vector<vcobjidx_t> objects;
+	find_segments_near_point(curpos, radius, segments);
+	objects.clear();
+	for (const auto segnum : segments)
+		range_for (const auto &&objp, objects_in(vcsegptr(segnum), vcobjptridx, vcsegptr))
+			objects.emplace_back(objp);
+	std::sort(objects.begin(), objects.end());
+	return objects;
+}
+
 //	--------------------------------------------------------------------------------------------
 static imobjptridx_t call_find_homing_object_complete(const vms_vector &curpos, const vmobjptridx_t tracker)
 {
@@ -1103,21 +1125,24 @@ imobjptridx_t find_homing_object_complete(const vms_vector &curpos, const vmobjp
 			throw std::logic_error("tracking without homing_flag");
 	}
 
-	const fix64 HOMING_MAX_TRACKABLE_DIST = F1_0*250;
-	vm_distance_squared max_trackable_dist{HOMING_MAX_TRACKABLE_DIST * HOMING_MAX_TRACKABLE_DIST};
+	constexpr vm_distance HOMING_MAX_TRACKABLE_DIST{F1_0*250};
+	vm_distance max_trackable_radius = HOMING_MAX_TRACKABLE_DIST;
 	fix min_trackable_dot = HOMING_MIN_TRACKABLE_DOT;
 
 #if defined(DXX_BUILD_DESCENT_II)
 	if (tracker_id == weapon_id_type::OMEGA_ID)
 	{
-		max_trackable_dist = OMEGA_MAX_TRACKABLE_DIST * OMEGA_MAX_TRACKABLE_DIST;
+		max_trackable_radius = OMEGA_MAX_TRACKABLE_DIST;
 		min_trackable_dot = OMEGA_MIN_TRACKABLE_DOT;
 	}
 #endif
+	const vm_distance_squared max_trackable_dist = max_trackable_radius * max_trackable_radius;
 
 	imobjptridx_t	best_objnum = object_none;
-	range_for (const auto &&curobjp, vmobjptridx)
+	auto &vcsegptr = LevelSharedSegmentState.get_segments().vcptr;
+	for (const auto objnum : find_objects_near_point(Objects.vcptridx, vcsegptr, curpos, max_trackable_radius))
 	{
+		const auto &&curobjp = vmobjptridx(objnum);
 		int			is_proximity = 0;
 		fix			dot;
 
@@ -2166,8 +2191,10 @@ static void create_smart_children(object_array &Objects, const vmobjptridx_t obj
 		if (Game_mode & GM_MULTI)
 			d_srand(8321L);
 
-		range_for (const auto &&curobjp, vcobjptridx)
+		auto &vcsegptr = LevelSharedSegmentState.get_segments().vcptr;
+		for (const auto objnum : find_objects_near_point(vcobjptridx, vcsegptr, objp->pos, MAX_SMART_DISTANCE))
 		{
+			const auto &&curobjp = vcobjptridx(objnum);
 			if (((curobjp->type == OBJ_ROBOT && !curobjp->ctype.ai_info.CLOAKED) || curobjp->type == OBJ_PLAYER) && curobjp != parent.num)
 			{
 				if (curobjp->type == OBJ_PLAYER)
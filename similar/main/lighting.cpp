@@ -25,9 +25,11 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #include <algorithm>
 #include <bitset>
+#include <limits>
 #include <numeric>
 #include <stdio.h>
 #include <string.h>	// for memset()
+#include <vector>
 
 #include "render_state.h"
 #include "maths.h"
@@ -55,12 +57,15 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "palette.h"
 #include "bm.h"
 #include "wall.h"
+#include "args.h"
 
 #include "compiler-range_for.h"
 #include "d_bitset.h"
+#include "d_enumerate.h"
 #include "d_levelstate.h"
 #include "partial_range.h"
 #include "d_range.h"
+#include "d_zip.h"
 
 using std::min;
 
@@ -73,19 +78,42 @@ namespace {
 static int Do_dynamic_light=1;
 static int use_fcd_lighting;
 
-static void add_light_div(g3s_lrgb &d, const g3s_lrgb &light, const fix &scale)
+static g3s_lrgb light_div(const g3s_lrgb &light, const fix &scale)
 {
-	d.r += fixdiv(light.r, scale);
-	d.g += fixdiv(light.g, scale);
-	d.b += fixdiv(light.b, scale);
+	return {
+		fixdiv(light.r, scale),
+		fixdiv(light.g, scale),
+		fixdiv(light.b, scale)
+	};
 }
 
-static void add_light_dot_square(g3s_lrgb &d, const g3s_lrgb &light, const fix &dot)
+static g3s_lrgb light_dot_square(const g3s_lrgb &light, const fix &dot)
 {
 	auto square = fixmul(dot, dot);
-	d.r += fixmul(square, light.r)/8;
-	d.g += fixmul(square, light.g)/8;
-	d.b += fixmul(square, light.b)/8;
+	return {
+		fixmul(square, light.r)/8,
+		fixmul(square, light.g)/8,
+		fixmul(square, light.b)/8
+	};
+}
+
+static void add_lrgb(g3s_lrgb &d, const g3s_lrgb &light)
+{
+	d.r += light.r;
+	d.g += light.g;
+	d.b += light.b;
+}
+
+static void subtract_lrgb(g3s_lrgb &d, const g3s_lrgb &light)
+{
+	d.r -= light.r;
+	d.g -= light.g;
+	d.b -= light.b;
+}
+
+static fix compute_light_emission_intensity(const g3s_lrgb &light)
+{
+	return (light.r + light.g + light.b) / 3;
 }
 
 static fix compute_player_light_emission_intensity(const object_base &objp)
@@ -117,37 +145,79 @@ static fix compute_fireball_light_emission_intensity(const d_vclip_array &Vclip,
 namespace dsx {
 namespace {
 
-static void apply_light(fvmsegptridx &vmsegptridx, const g3s_lrgb obj_light_emission, const vcsegptridx_t obj_seg, const vms_vector &obj_pos, const unsigned n_render_vertices, std::array<vertnum_t, MAX_VERTICES> &render_vertices, const std::array<segnum_t, MAX_VERTICES> &vert_segnum_list, const icobjptridx_t objnum)
+/* A list of vertices to be lit, with the segment through which each
+ * vertex was found.
+ */
+struct light_vertex_list
+{
+	unsigned count;
+	std::array<vertnum_t, MAX_VERTICES> vertices;
+	std::array<segnum_t, MAX_VERTICES> segnums;
+};
+
+static bool light_only_in_own_segment(const fix obji_64, const icobjptridx_t objnum)
+{
+#if defined(DXX_BUILD_DESCENT_II)
+	//	12/04/95, MK, markers only cast light in own segment.
+	if (objnum && objnum->type == OBJ_MARKER)
+		return true;
+#endif
+	// for pretty dim sources, only process vertices in object's own segment.
+	return abs(obji_64) <= F1_0*8;
+}
+
+static bool light_is_headlight(const icobjptridx_t objnum)
+{
+#if defined(DXX_BUILD_DESCENT_II)
+	if (objnum)
+	{
+		const object &obj = *objnum;
+		return obj.type == OBJ_PLAYER && (obj.ctype.player_info.powerup_flags & PLAYER_FLAGS_HEADLIGHT_ON);
+	}
+#endif
+	return false;
+}
+
+/* Compute the light that this light source casts on each vertex in
+ * range, and pass each nonzero contribution to add_vertex_light.  Dim
+ * sources only consider the vertices of their own segment.  Other sources
+ * consider the vertices in light_vertices.  Distances are computed a
+ * batch at a time with vm_vec_dist_quick_batch.
+ */
+template <typename F>
+static void apply_light(fvmsegptridx &vmsegptridx, const g3s_lrgb obj_light_emission, const vcsegptridx_t obj_seg, const vms_vector &obj_pos, const light_vertex_list &light_vertices, const icobjptridx_t objnum, F &&add_vertex_light)
 {
 	auto &LevelSharedVertexState = LevelSharedSegmentState.get_vertex_state();
 	auto &Vertices = LevelSharedVertexState.get_vertices();
-	if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
+	if (compute_light_emission_intensity(obj_light_emission) > 0)
 	{
-		fix obji_64 = ((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3)*64;
-		sbyte is_marker = 0;
-#if defined(DXX_BUILD_DESCENT_II)
-		if (objnum && objnum->type == OBJ_MARKER)
-				is_marker = 1;
-#endif
+		fix obji_64 = compute_light_emission_intensity(obj_light_emission)*64;
 
-		auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
 		auto &vcvertptr = Vertices.vcptr;
-		// for pretty dim sources, only process vertices in object's own segment.
-		//	12/04/95, MK, markers only cast light in own segment.
-		if ((abs(obji_64) <= F1_0*8) || is_marker) {
+		vms_vector_batch batch;
+		std::array<fix, vms_vector_batch::capacity> batch_dist;
+		if (light_only_in_own_segment(obji_64, objnum)) {
 			auto &vp = obj_seg->verts;
+			static_assert(MAX_VERTICES_PER_SEGMENT <= vms_vector_batch::capacity);
+			for (const auto &&[i, vertnum] : enumerate(vp, std::size_t{}))
+			{
+				auto &vertpos = *vcvertptr(vertnum);
+				batch.x[i] = vertpos.x;
+				batch.y[i] = vertpos.y;
+				batch.z[i] = vertpos.z;
+			}
+			vm_vec_dist_quick_batch(batch_dist.data(), obj_pos, batch, vp.size());
 
-			range_for (const auto vertnum, vp)
+			for (const auto &&[i, vertnum] : enumerate(vp, std::size_t{}))
 			{
 				fix			dist;
-				auto &vertpos = *vcvertptr(vertnum);
-				dist = vm_vec_dist_quick(obj_pos, vertpos);
+				dist = batch_dist[i];
 				dist = fixmul(dist/4, dist/4);
 				if (dist < abs(obji_64)) {
 					if (dist < MIN_LIGHT_DIST)
 						dist = MIN_LIGHT_DIST;
 
-					add_light_div(Dynamic_light[vertnum], obj_light_emission, dist);
+					add_vertex_light(vertnum, light_div(obj_light_emission, dist));
 				}
 			}
 		} else {
@@ -155,84 +225,94 @@ static void apply_light(fvmsegptridx &vmsegptridx, const g3s_lrgb obj_light_emis
 			fix	max_headlight_dist = F1_0*200;
 
 #if defined(DXX_BUILD_DESCENT_II)
-			if (objnum)
+			if (light_is_headlight(objnum))
 			{
 				const object &obj = *objnum;
-				if (obj.type == OBJ_PLAYER)
-					if (obj.ctype.player_info.powerup_flags & PLAYER_FLAGS_HEADLIGHT_ON) {
-						headlight_shift = 3;
-						if (get_player_id(obj) != Player_num)
-						{
-							fvi_query	fq;
-							fvi_info		hit_data;
-							int			fate;
-
-							const auto tvec = vm_vec_scale_add(obj.pos, obj.orient.fvec, F1_0*200);
-
-							fq.startseg				= obj_seg;
-							fq.p0						= &obj.pos;
-							fq.p1						= &tvec;
-							fq.rad					= 0;
-							fq.thisobjnum			= objnum;
-							fq.ignore_obj_list.first = nullptr;
-							fq.flags					= FQ_TRANSWALL;
-
-							fate = find_vector_intersection(fq, hit_data);
-							if (fate != HIT_NONE)
-								max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(hit_data.hit_pnt, obj.pos)) + F1_0*4;
-						}
-					}
+				headlight_shift = 3;
+				if (get_player_id(obj) != Player_num)
+				{
+					fvi_query	fq;
+					fvi_info		hit_data;
+					int			fate;
+
+					const auto tvec = vm_vec_scale_add(obj.pos, obj.orient.fvec, F1_0*200);
+
+					fq.startseg				= obj_seg;
+					fq.p0						= &obj.pos;
+					fq.p1						= &tvec;
+					fq.rad					= 0;
+					fq.thisobjnum			= objnum;
+					fq.ignore_obj_list.first = nullptr;
+					fq.flags					= FQ_TRANSWALL;
+
+					fate = find_vector_intersection(fq, hit_data);
+					if (fate != HIT_NONE)
+						max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(hit_data.hit_pnt, obj.pos)) + F1_0*4;
+				}
 			}
 #endif
-			range_for (const unsigned vv, xrange(n_render_vertices))
+			for (unsigned base = 0; base < light_vertices.count; base += vms_vector_batch::capacity)
 			{
-				fix			dist;
-				int			apply_light = 0;
-
-				const auto vertnum = render_vertices[vv];
-				auto vsegnum = vert_segnum_list[vv];
-				auto &vertpos = *vcvertptr(vertnum);
-
-				if (use_fcd_lighting && abs(obji_64) > F1_0*32)
-				{
-					dist = find_connected_distance(obj_pos, obj_seg, vertpos, vmsegptridx(vsegnum), n_render_vertices, WALL_IS_DOORWAY_FLAG::rendpast | WALL_IS_DOORWAY_FLAG::fly);
-					if (dist >= 0)
-						apply_light = 1;
-				}
-				else
+				const std::size_t n = std::min<std::size_t>(vms_vector_batch::capacity, light_vertices.count - base);
+				for (const auto i : xrange(n))
 				{
-					dist = vm_vec_dist_quick(obj_pos, vertpos);
-					apply_light = 1;
+					auto &vertpos = *vcvertptr(light_vertices.vertices[base + i]);
+					batch.x[i] = vertpos.x;
+					batch.y[i] = vertpos.y;
+					batch.z[i] = vertpos.z;
 				}
+				vm_vec_dist_quick_batch(batch_dist.data(), obj_pos, batch, n);
 
-				if (apply_light && ((dist >> headlight_shift) < abs(obji_64))) {
+				range_for (const auto i, xrange(n))
+				{
+					fix			dist;
+					int			apply_light = 0;
 
-					if (dist < MIN_LIGHT_DIST)
-						dist = MIN_LIGHT_DIST;
+					const auto vertnum = light_vertices.vertices[base + i];
 
-					if (headlight_shift && objnum)
+					if (use_fcd_lighting && abs(obji_64) > F1_0*32)
+					{
+						auto &vertpos = *vcvertptr(vertnum);
+						dist = find_connected_distance(obj_pos, obj_seg, vertpos, vmsegptridx(light_vertices.segnums[base + i]), light_vertices.count, WALL_IS_DOORWAY_FLAG::rendpast | WALL_IS_DOORWAY_FLAG::fly);
+						if (dist >= 0)
+							apply_light = 1;
+					}
+					else
 					{
-						fix dot;
-						// MK, Optimization note: You compute distance about 15 lines up, this is partially redundant
-						const auto vec_to_point = vm_vec_normalized_quick(vm_vec_sub(vertpos, obj_pos));
-						dot = vm_vec_dot(vec_to_point, objnum->orient.fvec);
-						if (dot < F1_0/2)
+						dist = batch_dist[i];
+						apply_light = 1;
+					}
+
+					if (apply_light && ((dist >> headlight_shift) < abs(obji_64))) {
+
+						if (dist < MIN_LIGHT_DIST)
+							dist = MIN_LIGHT_DIST;
+
+						if (headlight_shift && objnum)
 						{
-							// Do the normal thing, but darken around headlight.
-							add_light_div(Dynamic_light[vertnum], obj_light_emission, fixmul(HEADLIGHT_SCALE, dist));
+							fix dot;
+							// The normalization divides, so this stays scalar.
+							auto &vertpos = *vcvertptr(vertnum);
+							const auto vec_to_point = vm_vec_normalized_quick(vm_vec_sub(vertpos, obj_pos));
+							dot = vm_vec_dot(vec_to_point, objnum->orient.fvec);
+							if (dot < F1_0/2)
+							{
+								// Do the normal thing, but darken around headlight.
+								add_vertex_light(vertnum, light_div(obj_light_emission, fixmul(HEADLIGHT_SCALE, dist)));
+							}
+							else
+							{
+								if (!(Game_mode & GM_MULTI) || dist < max_headlight_dist)
+								{
+									add_vertex_light(vertnum, light_dot_square(obj_light_emission, dot));
+								}
+							}
 						}
 						else
 						{
-							if (!(Game_mode & GM_MULTI) || dist < max_headlight_dist)
-							{
-								add_light_dot_square(Dynamic_light[vertnum], obj_light_emission, dot);
-							}
+							add_vertex_light(vertnum, light_div(obj_light_emission, dist));
 						}
 					}
-					else
-					{
-						add_light_div(Dynamic_light[vertnum], obj_light_emission, dist);
-					}
 				}
 			}
 		}
@@ -246,14 +326,17 @@ static void apply_light(fvmsegptridx &vmsegptridx, const g3s_lrgb obj_light_emis
 namespace {
 
 // ----------------------------------------------------------------------------------------------
-static void cast_muzzle_flash_light(fvmsegptridx &vmsegptridx, int n_render_vertices, std::array<vertnum_t, MAX_VERTICES> &render_vertices, const std::array<segnum_t, MAX_VERTICES> &vert_segnum_list)
+//	Call cast_light(index, light, muzzle) for each muzzle flash which is
+//	still lit, and turn off any which have expired.
+template <typename F>
+static void cast_muzzle_flash_light(F &&cast_light)
 {
 	fix64 current_time;
 	short time_since_flash;
 
 	current_time = timer_query();
 
-	range_for (auto &i, Muzzle_data)
+	for (auto &&[idx, i] : enumerate(Muzzle_data))
 	{
 		if (i.create_time)
 		{
@@ -262,7 +345,7 @@ static void cast_muzzle_flash_light(fvmsegptridx &vmsegptridx, int n_render_vert
 			{
 				g3s_lrgb ml;
 				ml.r = ml.g = ml.b = ((FLASH_LEN_FIXED_SECONDS - time_since_flash) * FLASH_SCALE);
-				apply_light(vmsegptridx, ml, vmsegptridx(i.segnum), i.pos, n_render_vertices, render_vertices, vert_segnum_list, object_none);
+				cast_light(idx, ml, i);
 			}
 			else
 			{
@@ -510,6 +593,164 @@ static g3s_lrgb compute_light_emission(const d_level_shared_robot_info_state &Le
 	return white_light();
 }
 
+/* One vertex's share of the light from a dynamic light source.
+ */
+struct light_vertex_contribution
+{
+	vertnum_t vertnum;
+	g3s_lrgb light;
+};
+
+/* The state of a light source when its contributions were last added to
+ * Dynamic_light.  If none of this state changes, neither do the
+ * contributions, so the light source is not recomputed.
+ */
+struct dynamic_light_source
+{
+	bool active = false;
+	bool headlight = false;
+	object_signature_t signature = object_signature_t{0};
+	segnum_t segnum = segment_none;
+	g3s_lrgb emission{};
+	vms_vector pos{};
+	unsigned update = 0;
+	std::vector<light_vertex_contribution> contributions;
+};
+
+struct dynamic_light_cache
+{
+	unsigned update = 0;
+	std::array<dynamic_light_source, MAX_OBJECTS> objects;
+	std::array<dynamic_light_source, MUZZLE_QUEUE_MAX> muzzle_flashes;
+};
+
+static dynamic_light_cache Dynamic_light_cache;
+static light_vertex_list Render_light_vertices, Near_light_vertices;
+
+// ----------------------------------------------------------------------------------------------
+//	Fill Render_light_vertices with the vertices of every rendered segment.
+//	If clear_dynamic_light, also reset the dynamic light of those vertices.
+static void build_render_vertex_list(const render_state_t &rstate, const bool clear_dynamic_light)
+{
+	enumerated_bitset<MAX_VERTICES, vertnum_t> render_vertex_flags;
+
+	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
+	auto &l = Render_light_vertices;
+	l.count = 0;
+	range_for (const auto segnum, partial_const_range(rstate.Render_list, rstate.N_render_segs))
+	{
+		if (segnum != segment_none) {
+			auto &vp = Segments[segnum].verts;
+			range_for (const auto vnum, vp)
+			{
+				auto &&b = render_vertex_flags[vnum];
+				if (!b)
+				{
+					b = true;
+					l.vertices[l.count] = vnum;
+					l.segnums[l.count] = segnum;
+					l.count++;
+					if (clear_dynamic_light)
+						Dynamic_light[vnum] = {};
+				}
+			}
+		}
+	}
+}
+
+//	Fill Near_light_vertices with the vertices of every segment which a
+//	light of the given radius at pos might reach.
+static void build_near_vertex_list(const vms_vector &pos, const fix radius)
+{
+	static std::vector<segnum_t> near_segments;
+	static enumerated_array<unsigned, MAX_VERTICES, vertnum_t> vertex_stamps;
+	static unsigned stamp;
+	/* vm_vec_dist_quick can underestimate the true distance by about
+	 * 10%, so search a larger radius than the light reaches.
+	 */
+	find_segments_near_point(pos, radius > std::numeric_limits<fix>::max() / 5 * 4 ? std::numeric_limits<fix>::max() : radius + radius / 4, near_segments);
+	if (!++stamp)
+	{
+		std::fill(vertex_stamps.begin(), vertex_stamps.end(), 0);
+		stamp = 1;
+	}
+	auto &l = Near_light_vertices;
+	l.count = 0;
+	range_for (const auto segnum, near_segments)
+	{
+		range_for (const auto vnum, Segments[segnum].verts)
+		{
+			auto &s = vertex_stamps[vnum];
+			if (s == stamp)
+				continue;
+			s = stamp;
+			l.vertices[l.count] = vnum;
+			l.segnums[l.count] = segnum;
+			l.count++;
+		}
+	}
+}
+
+static void remove_light_source(dynamic_light_source &source)
+{
+	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
+	range_for (auto &c, source.contributions)
+		subtract_lrgb(Dynamic_light[c.vertnum], c.light);
+	source.contributions.clear();
+	source.active = false;
+}
+
+//	Bring the contribution of one light source up to date.  If it has not
+//	moved or changed since the last update, nothing needs to be done.
+//	Otherwise, remove its old contribution and add the new one.
+static void update_light_source(fvmsegptridx &vmsegptridx, const render_state_t &rstate, bool &render_vertices_built, dynamic_light_source &source, const object_signature_t signature, const g3s_lrgb emission, const vcsegptridx_t segp, const vms_vector &pos, const icobjptridx_t objnum)
+{
+	source.update = Dynamic_light_cache.update;
+	/* Headlights reach most of the level and are cast only on the
+	 * rendered vertices, so they are recomputed every time.
+	 */
+	const auto headlight = light_is_headlight(objnum);
+	if (source.active && !headlight && !source.headlight &&
+		source.signature == signature &&
+		source.segnum == segp &&
+		source.emission.r == emission.r &&
+		source.emission.g == emission.g &&
+		source.emission.b == emission.b &&
+		source.pos.x == pos.x &&
+		source.pos.y == pos.y &&
+		source.pos.z == pos.z)
+		return;
+	remove_light_source(source);
+	source.active = true;
+	source.headlight = headlight;
+	source.signature = signature;
+	source.segnum = segp;
+	source.emission = emission;
+	source.pos = pos;
+
+	const fix obji_64 = compute_light_emission_intensity(emission)*64;
+	const light_vertex_list *light_vertices = &Near_light_vertices;
+	if (headlight)
+	{
+		if (!render_vertices_built)
+		{
+			build_render_vertex_list(rstate, false);
+			render_vertices_built = true;
+		}
+		light_vertices = &Render_light_vertices;
+	}
+	else if (light_only_in_own_segment(obji_64, objnum))
+		Near_light_vertices.count = 0;
+	else
+		build_near_vertex_list(pos, abs(obji_64));
+
+	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
+	apply_light(vmsegptridx, emission, segp, pos, *light_vertices, objnum, [&Dynamic_light, &source](const vertnum_t vertnum, const g3s_lrgb &light) {
+		add_lrgb(Dynamic_light[vertnum], light);
+		source.contributions.emplace_back(light_vertex_contribution{vertnum, light});
+	});
+}
+
 }
 
 // ----------------------------------------------------------------------------------------------
@@ -517,8 +758,6 @@ void set_dynamic_light(render_state_t &rstate)
 {
 	auto &Objects = LevelUniqueObjectState.Objects;
 	auto &vcobjptridx = Objects.vcptridx;
-	std::array<vertnum_t, MAX_VERTICES> render_vertices;
-	std::array<segnum_t, MAX_VERTICES> vert_segnum_list;
 	static fix light_time; 
 
 #if defined(DXX_BUILD_DESCENT_II)
@@ -533,31 +772,42 @@ void set_dynamic_light(render_state_t &rstate)
 		return;
 	light_time = light_time - (F1_0/60);
 
-	enumerated_bitset<MAX_VERTICES, vertnum_t> render_vertex_flags;
-
-	//	Create list of vertices that need to be looked at for setting of ambient light.
-	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
-	uint_fast32_t n_render_vertices = 0;
-	range_for (const auto segnum, partial_const_range(rstate.Render_list, rstate.N_render_segs))
+	if (CGameArg.DbgUseOldDynamicLight)
 	{
-		if (segnum != segment_none) {
-			auto &vp = Segments[segnum].verts;
-			range_for (const auto vnum, vp)
-			{
-				auto &&b = render_vertex_flags[vnum];
-				if (!b)
-				{
-					b = true;
-					render_vertices[n_render_vertices] = vnum;
-					vert_segnum_list[n_render_vertices] = segnum;
-					n_render_vertices++;
-					Dynamic_light[vnum] = {};
-				}
-			}
+		//	Create list of vertices that need to be looked at for setting of ambient light.
+		build_render_vertex_list(rstate, true);
+
+		auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
+		const auto &&add_vertex_light = [&Dynamic_light](const vertnum_t vertnum, const g3s_lrgb &light) {
+			add_lrgb(Dynamic_light[vertnum], light);
+		};
+		cast_muzzle_flash_light([&add_vertex_light](std::size_t, const g3s_lrgb &ml, const muzzle_info &i) {
+			apply_light(vmsegptridx, ml, vmsegptridx(i.segnum), i.pos, Render_light_vertices, object_none, add_vertex_light);
+		});
+
+		range_for (const auto &&obj, vcobjptridx)
+		{
+			const object &objp = obj;
+			if (objp.type == OBJ_NONE)
+				continue;
+			const auto &&obj_light_emission = compute_light_emission(LevelSharedRobotInfoState, LevelUniqueLightState, Vclip, obj);
+
+			if (compute_light_emission_intensity(obj_light_emission) > 0)
+				apply_light(vmsegptridx, obj_light_emission, vcsegptridx(objp.segnum), objp.pos, Render_light_vertices, obj, add_vertex_light);
 		}
+		return;
 	}
 
-	cast_muzzle_flash_light(vmsegptridx, n_render_vertices, render_vertices, vert_segnum_list);
+	/* Dynamic_light holds the sum of the contributions of every light
+	 * source.  Only sources which moved, changed, appeared or vanished
+	 * since the last update need any work.
+	 */
+	auto &cache = Dynamic_light_cache;
+	const auto update = ++cache.update;
+	bool render_vertices_built = false;
+	cast_muzzle_flash_light([&](const std::size_t idx, const g3s_lrgb &ml, const muzzle_info &i) {
+		update_light_source(vmsegptridx, rstate, render_vertices_built, cache.muzzle_flashes[idx], object_signature_t{0}, ml, vmsegptridx(i.segnum), i.pos, object_none);
+	});
 
 	range_for (const auto &&obj, vcobjptridx)
 	{
@@ -566,9 +816,33 @@ void set_dynamic_light(render_state_t &rstate)
 			continue;
 		const auto &&obj_light_emission = compute_light_emission(LevelSharedRobotInfoState, LevelUniqueLightState, Vclip, obj);
 
-		if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
-			apply_light(vmsegptridx, obj_light_emission, vcsegptridx(objp.segnum), objp.pos, n_render_vertices, render_vertices, vert_segnum_list, obj);
+		if (compute_light_emission_intensity(obj_light_emission) > 0)
+			update_light_source(vmsegptridx, rstate, render_vertices_built, cache.objects[obj.get_unchecked_index()], objp.signature, obj_light_emission, vcsegptridx(objp.segnum), objp.pos, obj);
 	}
+
+	//	Remove the contribution of every source which went dark or vanished.
+	const auto &&remove_if_stale = [update](dynamic_light_source &source) {
+		if (source.active && source.update != update)
+			remove_light_source(source);
+	};
+	range_for (auto &source, cache.objects)
+		remove_if_stale(source);
+	range_for (auto &source, cache.muzzle_flashes)
+		remove_if_stale(source);
+}
+
+void reset_dynamic_light()
+{
+	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
+	std::fill(Dynamic_light.begin(), Dynamic_light.end(), g3s_lrgb{});
+	const auto &&reset = [](dynamic_light_source &source) {
+		source.contributions.clear();
+		source.active = false;
+	};
+	range_for (auto &source, Dynamic_light_cache.objects)
+		reset(source);
+	range_for (auto &source, Dynamic_light_cache.muzzle_flashes)
+		reset(source);
 }
 
 // ---------------------------------------------------------
@@ -651,6 +925,213 @@ void start_lighting_frame(const object &viewer)
 
 namespace dsx {
 
+namespace {
+
+/* Light probes for object lighting.  Each segment has a probe at its
+ * centre, holding its own static light, and one at each corner, holding
+ * the average static light of every segment which shares that vertex.
+ * Since neighbouring segments agree on their shared corners, the blended
+ * light does not jump when an object crosses from one segment to the
+ * next.  The probes are baked on first use after being invalidated.
+ */
+struct segment_light_probe
+{
+	vms_vector center;
+	//	Scaled so that the dot product with (pos - center) is -F1_0 on the
+	//	left, bottom or front face and F1_0 on the right, top or back face.
+	vms_vector right, up, forward;
+	//	The centre light, less the average of the corners.
+	g3s_lrgb center_offset;
+	std::array<g3s_lrgb, 8> corner_light;
+};
+
+struct light_probe_set
+{
+	bool valid = false;
+	std::vector<segment_light_probe> probes;
+	//	Kept from the bake, so that when the static light of a few segments
+	//	changes, only the probes which share their vertices are updated.
+	std::vector<fix> static_light;
+	std::vector<fix64> vertex_light_sum;
+	//	The segments sharing vertex v are vertex_segments[vertex_segment_start[v]]
+	//	up to vertex_segments[vertex_segment_start[v + 1]].
+	std::vector<unsigned> vertex_segment_start;
+	std::vector<segnum_t> vertex_segments;
+	std::vector<unsigned> changed_vertices;
+};
+
+static light_probe_set Light_probes;
+
+//	For each corner of a segment, whether it is on the (right, top, back)
+//	face rather than the (left, bottom, front) face.  See Side_to_verts.
+constexpr std::array<std::array<uint8_t, 3>, 8> Light_probe_corner_faces{{
+	{{1, 1, 0}},
+	{{1, 0, 0}},
+	{{0, 0, 0}},
+	{{0, 1, 0}},
+	{{1, 1, 1}},
+	{{1, 0, 1}},
+	{{0, 0, 1}},
+	{{0, 1, 1}},
+}};
+
+static vms_vector compute_light_probe_axis(fvcvertptr &vcvertptr, const shared_segment &seg, const sidenum_t from, const sidenum_t to)
+{
+	auto axis = vm_vec_sub(compute_center_point_on_side(vcvertptr, seg, to), compute_center_point_on_side(vcvertptr, seg, from));
+	const fix half = vm_vec_normalize(axis) / 2;
+	if (half <= 0)
+		return {};
+	return vm_vec_copy_scale(axis, fixdiv(F1_0, half));
+}
+
+static void bake_light_probe_light(segment_light_probe &probe, const cscusegment seg)
+{
+	auto &vertex_light_sum = Light_probes.vertex_light_sum;
+	auto &vertex_segment_start = Light_probes.vertex_segment_start;
+	fix64 corner_sum = 0;
+	for (auto &&[corner, v] : zip(probe.corner_light, seg.s.verts))
+	{
+		const std::size_t i = static_cast<std::size_t>(v);
+		const fix l = vertex_light_sum[i] / (vertex_segment_start[i + 1] - vertex_segment_start[i]);
+		corner = {l, l, l};
+		corner_sum += l;
+	}
+	const fix offset = seg.u.static_light - static_cast<fix>(corner_sum / probe.corner_light.size());
+	probe.center_offset = {offset, offset, offset};
+}
+
+static void bake_light_probes()
+{
+	auto &Segments = LevelSharedSegmentState.get_segments();
+	auto &LevelSharedVertexState = LevelSharedSegmentState.get_vertex_state();
+	auto &Vertices = LevelSharedVertexState.get_vertices();
+	auto &vcvertptr = Vertices.vcptr;
+	const std::size_t num_vertices = Vertices.get_count();
+	auto &static_light = Light_probes.static_light;
+	auto &vertex_light_sum = Light_probes.vertex_light_sum;
+	auto &vertex_segment_start = Light_probes.vertex_segment_start;
+	auto &vertex_segments = Light_probes.vertex_segments;
+	static_light.assign(Segments.get_count(), 0);
+	vertex_light_sum.assign(num_vertices, 0);
+	vertex_segment_start.assign(num_vertices + 1, 0);
+	range_for (const auto &&segp, Segments.vcptridx)
+	{
+		const cscusegment seg = segp;
+		static_light[segp] = seg.u.static_light;
+		range_for (const auto v, seg.s.verts)
+		{
+			vertex_light_sum[static_cast<std::size_t>(v)] += seg.u.static_light;
+			++ vertex_segment_start[static_cast<std::size_t>(v) + 1];
+		}
+	}
+	std::partial_sum(vertex_segment_start.begin(), vertex_segment_start.end(), vertex_segment_start.begin());
+	vertex_segments.resize(vertex_segment_start.back());
+	{
+		std::vector<unsigned> next(vertex_segment_start.begin(), vertex_segment_start.end() - 1);
+		range_for (const auto &&segp, Segments.vcptridx)
+			range_for (const auto v, segp->verts)
+				vertex_segments[next[static_cast<std::size_t>(v)]++] = segp;
+	}
+	auto &probes = Light_probes.probes;
+	probes.resize(Segments.get_count());
+	range_for (const auto &&segp, Segments.vcptridx)
+	{
+		const cscusegment seg = segp;
+		auto &probe = probes[segp];
+		probe.center = compute_segment_center(vcvertptr, seg);
+		probe.right = compute_light_probe_axis(vcvertptr, seg, WLEFT, WRIGHT);
+		probe.up = compute_light_probe_axis(vcvertptr, seg, WBOTTOM, WTOP);
+		probe.forward = compute_light_probe_axis(vcvertptr, seg, WFRONT, WBACK);
+		bake_light_probe_light(probe, seg);
+	}
+	Light_probes.valid = true;
+}
+
+struct light_probe_sample
+{
+	g3s_lrgb static_light, dynamic_light;
+};
+
+//	Blend the probes of the segment containing pos, and the dynamic light at
+//	its vertices, by where pos lies within the segment.
+static light_probe_sample sample_light_probe(const enumerated_array<g3s_lrgb, MAX_VERTICES, vertnum_t> &Dynamic_light, const vcsegidx_t segnum, const shared_segment &seg, const vms_vector &pos)
+{
+	if (!Light_probes.valid || Light_probes.probes.size() != LevelSharedSegmentState.get_segments().get_count())
+		bake_light_probes();
+	auto &probe = Light_probes.probes[segnum];
+	const auto d = vm_vec_sub(pos, probe.center);
+	const std::array<fix, 3> t{{
+		std::clamp(vm_vec_dot(d, probe.right), -F1_0, F1_0),
+		std::clamp(vm_vec_dot(d, probe.up), -F1_0, F1_0),
+		std::clamp(vm_vec_dot(d, probe.forward), -F1_0, F1_0),
+	}};
+	//	Trilinear weights toward the (left, bottom, front) and
+	//	(right, top, back) faces.
+	std::array<std::array<fix, 2>, 3> w;
+	for (const auto &&[wa, ta] : zip(w, t))
+	{
+		wa[1] = (F1_0 + ta) / 2;
+		wa[0] = F1_0 - wa[1];
+	}
+	light_probe_sample r{};
+	for (const auto &&[faces, corner, v] : zip(Light_probe_corner_faces, probe.corner_light, seg.verts))
+	{
+		const fix wc = fixmul(fixmul(w[0][faces[0]], w[1][faces[1]]), w[2][faces[2]]);
+		r.static_light.r += fixmul(wc, corner.r);
+		r.static_light.g += fixmul(wc, corner.g);
+		r.static_light.b += fixmul(wc, corner.b);
+		auto &dl = Dynamic_light[v];
+		r.dynamic_light.r += fixmul(wc, dl.r);
+		r.dynamic_light.g += fixmul(wc, dl.g);
+		r.dynamic_light.b += fixmul(wc, dl.b);
+	}
+	//	The centre probe has full weight at the centre and none on the
+	//	faces, so it does not disturb continuity across segments.
+	const fix center_weight = fixmul(fixmul(F1_0 - abs(t[0]), F1_0 - abs(t[1])), F1_0 - abs(t[2]));
+	r.static_light.r += fixmul(center_weight, probe.center_offset.r);
+	r.static_light.g += fixmul(center_weight, probe.center_offset.g);
+	r.static_light.b += fixmul(center_weight, probe.center_offset.b);
+	return r;
+}
+
+}
+
+void invalidate_light_probes()
+{
+	Light_probes.valid = false;
+}
+
+void update_light_probes(const visited_segment_bitarray_t &visited)
+{
+	if (!Light_probes.valid)
+		return;
+	auto &Segments = LevelSharedSegmentState.get_segments();
+	if (Light_probes.probes.size() != Segments.get_count())
+		return;
+	auto &changed_vertices = Light_probes.changed_vertices;
+	changed_vertices.clear();
+	range_for (const auto &&segp, Segments.vcptridx)
+	{
+		if (!visited[segp])
+			continue;
+		const cscusegment seg = segp;
+		auto &baked = Light_probes.static_light[segp];
+		const fix d = seg.u.static_light - baked;
+		if (!d)
+			continue;
+		baked = seg.u.static_light;
+		range_for (const auto v, seg.s.verts)
+		{
+			Light_probes.vertex_light_sum[static_cast<std::size_t>(v)] += d;
+			changed_vertices.emplace_back(static_cast<unsigned>(v));
+		}
+	}
+	auto &vertex_segment_start = Light_probes.vertex_segment_start;
+	range_for (const auto v, changed_vertices)
+		range_for (const auto s, partial_const_range(Light_probes.vertex_segments, vertex_segment_start[v], vertex_segment_start[v + 1]))
+			bake_light_probe_light(Light_probes.probes[s], Segments.vcptr(s));
+}
+
 //compute the lighting for an object.  Takes a pointer to the object,
 //and possibly a rotated 3d point.  If the point isn't specified, the
 //object's center point is rotated.
@@ -658,10 +1139,22 @@ g3s_lrgb compute_object_light(const d_level_unique_light_state &LevelUniqueLight
 {
 	g3s_lrgb light;
 	const vcobjidx_t objnum = obj;
+	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
 
-	//First, get static (mono) light for this segment
+	//First, get static light for this segment, and the dynamic light of its vertices
 	const cscusegment objsegp = vcsegptr(obj->segnum);
-	light.r = light.g = light.b = objsegp.u.static_light;
+	g3s_lrgb seg_dl;
+	if (PlayerCfg.ObjectLightProbes)
+	{
+		const auto &&probe_light = sample_light_probe(Dynamic_light, obj->segnum, objsegp, obj->pos);
+		light = probe_light.static_light;
+		seg_dl = probe_light.dynamic_light;
+	}
+	else
+	{
+		light.r = light.g = light.b = objsegp.u.static_light;
+		seg_dl = compute_seg_dynamic_light(Dynamic_light, objsegp);
+	}
 
 	auto &os = object_sig[objnum];
 	auto &ol = object_light[objnum];
@@ -698,9 +1191,6 @@ g3s_lrgb compute_object_light(const d_level_unique_light_state &LevelUniqueLight
 		ol = light;
 	}
 
-	//Finally, add in dynamic light for this segment
-	auto &Dynamic_light = LevelUniqueLightState.Dynamic_light;
-	const auto &&seg_dl = compute_seg_dynamic_light(Dynamic_light, objsegp);
 #if defined(DXX_BUILD_DESCENT_II)
 	//Next, add in (NOTE: WHITE) headlight on this object
 	const fix mlight = compute_headlight_light_on_object(LevelUniqueLightState, obj);
@@ -709,6 +1199,7 @@ g3s_lrgb compute_object_light(const d_level_unique_light_state &LevelUniqueLight
 	light.b += mlight;
 #endif
  
+	//Finally, add in dynamic light for this segment
 	light.r += seg_dl.r;
 	light.g += seg_dl.g;
 	light.b += seg_dl.b;
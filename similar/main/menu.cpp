@@ -2019,6 +2019,7 @@ void hud_config()
 	DXX_MENUITEM(VERB, TEXT, "", blank1)	\
 	DXX_OGL0_GRAPHICS_MENU(VERB)	\
 	DXX_OGL1_GRAPHICS_MENU(VERB)	\
+	DXX_MENUITEM(VERB, CHECK, "Smooth Object Lighting", opt_gr_objlightprobes, PlayerCfg.ObjectLightProbes)	\
 	DXX_MENUITEM(VERB, CHECK, "FPS Counter", opt_gr_fpsindi, CGameCfg.FPSIndicator)	\
 
 struct graphics_config_menu_items
@@ -2132,6 +2133,7 @@ window_event_result graphics_config_menu::event_handler(const d_event &event)
 			CGameCfg.VSync = m[opt_gr_vsync].value;
 			CGameCfg.Multisample = m[opt_gr_multisample].value;
 #endif
+			PlayerCfg.ObjectLightProbes = m[opt_gr_objlightprobes].value;
 			CGameCfg.GammaLevel = m[opt_gr_brightness].value;
 			CGameCfg.FPSIndicator = m[opt_gr_fpsindi].value;
 			reset_cockpit();
@@ -56,6 +56,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"
 #include "key.h"
 #include "playsave.h"
+#include "lighting.h"
 #include "timer.h"
 #include "digi.h"
 #include "sounds.h"
@@ -250,6 +251,11 @@ constexpr int message_length[] = {
 	for_each_multiplayer_command(define_message_length)
 };
 
+constexpr const char *message_name[] = {
+#define define_message_name(NAME,SIZE)	#NAME,
+	for_each_multiplayer_command(define_message_name)
+};
+
 }
 
 }
@@ -593,6 +599,30 @@ void multi_make_ghost_player(const playernum_t playernum)
 		init_player_stats_new_ship(playernum);
 }
 
+/* Whether the pilot in playernum only watches the game: the pilot of a
+ * -dedicated host, in slot 0, or a relay started with -udp_relay.
+ */
+bool multi_is_observer(const playernum_t playernum)
+{
+	if (!(Game_mode & GM_MULTI) || playernum >= MAX_PLAYERS)
+		return false;
+	return (playernum == 0 && Netgame.DedicatedHost) || (Netgame.ObserverPlayers & (1u << playernum));
+}
+
+/* Nobody flies the ship of an observer.  Keep the ship a ghost on every
+ * peer, so that it cannot be hit and takes no spawn from a player.
+ */
+void multi_make_observer_ghost(const playernum_t playernum)
+{
+	auto &Objects = LevelUniqueObjectState.Objects;
+	auto &vmobjptr = Objects.vmptr;
+	auto &obj = *vmobjptr(vcplayerptr(playernum)->objnum);
+	obj.type = OBJ_GHOST;
+	obj.render_type = RT_NONE;
+	obj.movement_source = object::movement_type::None;
+	multi_reset_player_object(obj);
+}
+
 }
 
 int multi_get_kill_list(playernum_array_t &plist)
@@ -2458,6 +2488,16 @@ static void multi_reset_object_texture(object_base &objp)
 
 }
 
+unsigned multi_message_length(const uint8_t type)
+{
+	return type < std::size(message_length) ? message_length[type] : 0;
+}
+
+const char *multi_message_name(const uint8_t type)
+{
+	return type < std::size(message_name) ? message_name[type] : nullptr;
+}
+
 void multi_process_bigdata(const playernum_t pnum, const uint8_t *const buf, const uint_fast32_t len)
 {
 	// Takes a bunch of messages, check them for validity,
@@ -3569,6 +3609,7 @@ void multi_apply_goal_textures()
 			continue;
 		apply_segment_goal_texture(LevelUniqueTmapInfoState, seg, tex);
 	}
+	invalidate_light_probes();
 }
 #endif
 
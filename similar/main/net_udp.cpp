@@ -28,6 +28,9 @@
 #include "player.h"
 #include "gameseq.h"
 #include "net_udp.h"
+#include "net_udp_async.h"
+#include "net_udp_relay.h"
+#include "delta_codec.h"
 #include "game.h"
 #include "gauges.h"
 #include "multi.h"
@@ -39,10 +42,12 @@
 #include "text.h"
 #include "newdemo.h"
 #include "multibot.h"
+#include "multiinternal.h"
 #include "state.h"
 #include "wall.h"
 #include "bm.h"
 #include "effects.h"
+#include "endlevel.h"
 #include "physics.h"
 #include "hudmsg.h"
 #include "switch.h"
@@ -53,15 +58,19 @@
 #include "vers_id.h"
 #include "u_mem.h"
 #include "weapon.h"
+#include "cmd.h"
+#include "physfsx.h"
 
 #include "compiler-cf_assert.h"
 #include "compiler-range_for.h"
 #include "d_enumerate.h"
 #include "d_levelstate.h"
+#include "state_hash.h"
 #include "d_range.h"
 #include "d_zip.h"
 #include "partial_range.h"
 #include <array>
+#include <deque>
 #include <utility>
 
 #if defined(DXX_BUILD_DESCENT_I)
@@ -265,6 +274,7 @@ window_event_result net_udp_select_teams_menu::event_handler(const d_event &even
 static void net_udp_init();
 static void net_udp_close();
 static void net_udp_listen();
+static void net_udp_async_poll();
 namespace dsx {
 namespace multi {
 namespace udp {
@@ -289,6 +299,9 @@ static void net_udp_send_mdata(int needack, fix64 time);
 static void net_udp_process_mdata (uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr, int needack);
 static void net_udp_send_pdata();
 static void net_udp_process_pdata (const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_process_pdata_delta(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_process_pdata_ack(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_pdata_delta_clear_peer(unsigned pnum);
 static void net_udp_read_pdata_packet(UDP_frame_info *pd);
 static void net_udp_timeout_check(fix64 time);
 static int net_udp_get_new_player_num ();
@@ -296,6 +309,24 @@ static void net_udp_noloss_got_ack(const uint8_t *data, uint_fast32_t data_len);
 static void net_udp_noloss_init_mdata_queue(void);
 static void net_udp_noloss_clear_mdata_trace(ubyte player_num);
 static void net_udp_noloss_process_queue(fix64 time);
+static void net_udp_bundle_send(unsigned pnum, const uint8_t *data, uint_fast32_t data_len);
+static void net_udp_bundle_flush_all();
+static void net_udp_bundle_announce();
+static void net_udp_bundle_clear_peer(unsigned pnum);
+static void net_udp_process_bundle(uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_telemetry_out(unsigned pnum, const uint8_t *data, uint_fast32_t data_len, bool resend);
+static void net_udp_telemetry_in(const _sockaddr &sender_addr, const uint8_t *data, uint_fast32_t data_len);
+static void net_udp_telemetry_frame(fix64 time);
+static void net_udp_telemetry_reset();
+static void net_udp_interest_clear();
+static void net_udp_state_hash_clear();
+static void net_udp_state_hash_frame();
+static void net_udp_process_state_hash(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr);
+static void net_udp_interest_send_mdata(unsigned pnum, const uint8_t *data, unsigned data_len, fix64 time);
+namespace dsx {
+static void net_udp_relay_frame(fix64 time);
+}
+static void net_udp_relay_close();
 namespace dsx {
 static void net_udp_send_extras ();
 }
@@ -306,17 +337,29 @@ static void net_udp_process_game_info(const uint8_t *data, uint_fast32_t data_le
 static int net_udp_start_game(void);
 
 // Variables
-static int UDP_num_sendto, UDP_len_sendto, UDP_num_recvfrom, UDP_len_recvfrom;
+static int UDP_num_sendto, UDP_len_sendto, UDP_num_recvfrom, UDP_len_recvfrom, UDP_num_bundled;
+static int UDP_len_pdata, UDP_len_pdata_full; // bytes sent for position updates, and what they would have cost as UPID_PDATA
+static unsigned UDP_len_pdata_game, UDP_len_pdata_full_game;
 static UDP_mdata_info		UDP_MData;
 static UDP_sequence_packet UDP_Seq;
-static unsigned UDP_mdata_queue_highest;
+static unsigned UDP_mdata_queue_head, UDP_mdata_queue_count; // oldest packet and number of slots from there to the newest
 static std::array<UDP_mdata_store, UDP_MDATA_STOR_QUEUE_SIZE> UDP_mdata_queue;
+static std::array<UDP_mdata_wheel_slot, UDP_MDATA_WHEEL_SIZE> UDP_mdata_wheel; // packets to resend by resend time
+static fix64 UDP_mdata_wheel_tick; // next timer wheel tick to process
 static std::array<UDP_mdata_check, MAX_PLAYERS> UDP_mdata_trace;
+static std::array<UDP_bundle_peer, MAX_PLAYERS> UDP_bundle;
 static UDP_sequence_packet UDP_sync_player; // For rejoin object syncing
 static std::array<UDP_netgame_info_lite, UDP_MAX_NETGAMES> Active_udp_games;
 static unsigned num_active_udp_games;
 static int num_active_udp_changed;
 static uint16_t UDP_MyPort;
+static udp_async_io UDP_async; // name resolution and tracker traffic, off the game thread
+static struct
+{
+	unsigned id; // request resolving the host of the manual join menu, 0 if none
+	bool done;
+	udp_async_completion result;
+} UDP_join_resolve;
 static sockaddr_in GBcast; // global Broadcast address clients and hosts will use for lite_info exchange over LAN
 #define UDP_BCAST_ADDR "255.255.255.255"
 #if DXX_USE_IPv6
@@ -337,11 +380,14 @@ enum class TrackerAckState : uint8_t
 };
 static TrackerAckState TrackerAckStatus;
 static fix64 TrackerAckTime;
+static unsigned TrackerResolveId; // request resolving the tracker, 0 once it completed
 static int udp_tracker_init();
-static int udp_tracker_unregister();
+static void udp_tracker_resolved(const udp_async_completion &c);
+static void udp_tracker_send(const uint8_t *buf, std::size_t len);
+static void udp_tracker_unregister();
 namespace dsx {
-static int udp_tracker_register();
-static int udp_tracker_reqgames();
+static void udp_tracker_register();
+static void udp_tracker_reqgames();
 }
 static int udp_tracker_process_game( ubyte *data, int data_len, const _sockaddr &sender_addr );
 static void udp_tracker_process_ack( ubyte *data, int data_len, const _sockaddr &sender_addr );
@@ -531,6 +577,58 @@ uint8_t get_effective_netgame_status(const d_level_unique_control_center_state &
 
 static std::array<RAIIsocket, 2> UDP_Socket;
 
+struct UDP_relay_entry
+{
+	uint32_t seq;
+	udp_relay_kind kind;
+	fix64 time; // when it was recorded; spectators get it CGameArg.MplUdpRelayDelay seconds later
+	std::vector<uint8_t> data;
+};
+
+struct UDP_relay_viewer
+{
+	_sockaddr addr;
+	fix64 last_heard, last_progress;
+	uint32_t start;		// entry the viewer started watching from, which it gets with its data
+	uint32_t next;		// entry to send next
+	uint32_t acked;		// entry the viewer asked for last
+	bool started;
+};
+
+static struct
+{
+	RAIIsocket socket;
+	bool failed; // do not try to open the socket again
+	newdemo_relay_tap tap;
+	std::deque<UDP_relay_entry> entries; // consecutive sequence numbers, ending with seq
+	std::vector<UDP_relay_viewer> viewers;
+	uint32_t seq; // last entry made; not reset, so spectators notice when the relay starts over
+	std::vector<uint8_t> prev_frame; // what the next delta is the difference to, empty after a header
+	fix64 last_keyframe;
+	uint64_t secret; // key of the cookies spectators subscribe with, new for each socket
+	unsigned followed; // slot of the player the recording is seen from
+} UDP_relay;
+
+static struct
+{
+	RAIIsocket socket;
+	unsigned resolve_id;
+	bool resolved;
+	_sockaddr relay_addr;
+	uint32_t cookie;	// from UPID_RELAY_CHALLENGE; 0 until the relay sent one
+	fix64 last_subscribe;
+	uint32_t next;		// entry to ask for next; 0 to ask for a header
+	uint32_t parts_seq;	// entry whose parts are collected in parts
+	std::vector<std::vector<uint8_t>> parts;
+	unsigned parts_have;
+	std::vector<uint8_t> prev_frame;
+	RAIIPHYSFS_File file;	// UDP_RELAY_DEMO, open from the header on
+	PHYSFS_sint64 written;
+	std::array<PHYSFS_sint64, 2> frame_end; // end of the frames before last and last written
+	unsigned frames;
+	bool restart;		// playback must start over from a new header
+} UDP_relay_watch;
+
 static bool operator==(const _sockaddr &l, const _sockaddr &r)
 {
 	return !memcmp(&l, &r, sizeof(l));
@@ -751,6 +849,47 @@ ssize_t dxx_recvfrom_t::apply(int sockfd, void *buf, size_t len, int flags, sock
 constexpr csockaddr_dispatch_t<socket_array_dispatch_t<dxx_sendto_t>> dxx_sendto{};
 constexpr sockaddr_dispatch_t<dxx_recvfrom_t> dxx_recvfrom{};
 
+#ifdef DXX_HAVE_RECVMMSG
+/* Fill in one message of a batch for sendmmsg, picking the address size the same way as dxx_sendto. */
+class dxx_prepare_sendmmsg_t
+{
+public:
+	void operator()(const sockaddr &to, socklen_t tolen, mmsghdr &msg, iovec &iov, const void *buf, size_t len) const
+	{
+		iov.iov_base = const_cast<void *>(buf);
+		iov.iov_len = len;
+		msg = {};
+		msg.msg_hdr.msg_name = const_cast<sockaddr *>(&to);
+		msg.msg_hdr.msg_namelen = tolen;
+		msg.msg_hdr.msg_iov = &iov;
+		msg.msg_hdr.msg_iovlen = 1;
+	}
+};
+
+constexpr csockaddr_dispatch_t<dxx_prepare_sendmmsg_t> dxx_prepare_sendmmsg{};
+
+/* Send a batch of prepared messages, one system call for as many as the kernel takes. */
+static void dxx_sendmmsg(int sockfd, mmsghdr *msgs, unsigned count)
+{
+	while (count)
+	{
+		const int sent = sendmmsg(sockfd, msgs, count, 0);
+		/* On an error, sendmmsg reports it for the first message.
+		 * Like a failed sendto, that message is dropped.
+		 */
+		const unsigned done = sent > 0 ? sent : 1;
+		for (unsigned i = 0; i < done; ++i)
+		{
+			UDP_num_sendto++;
+			if (sent > 0)
+				UDP_len_sendto += msgs[i].msg_len;
+		}
+		msgs += done;
+		count -= done;
+	}
+}
+#endif
+
 }
 
 static void udp_traffic_stat()
@@ -760,8 +899,10 @@ static void udp_traffic_stat()
 	if (timer_query() >= last_traf_time + F1_0)
 	{
 		last_traf_time = timer_query();
-		con_printf(CON_DEBUG, "P#%u TRAFFIC - OUT: %fKB/s %iPPS IN: %fKB/s %iPPS",Player_num, static_cast<float>(UDP_len_sendto)/1024, UDP_num_sendto, static_cast<float>(UDP_len_recvfrom)/1024, UDP_num_recvfrom);
-		UDP_num_sendto = UDP_len_sendto = UDP_num_recvfrom = UDP_len_recvfrom = 0;
+		con_printf(CON_DEBUG, "P#%u TRAFFIC - OUT: %fKB/s %iPPS (%i bundled) IN: %fKB/s %iPPS",Player_num, static_cast<float>(UDP_len_sendto)/1024, UDP_num_sendto, UDP_num_bundled, static_cast<float>(UDP_len_recvfrom)/1024, UDP_num_recvfrom);
+		con_printf(CON_DEBUG, "P#%u PDATA - OUT: %fKB/s (%fKB/s as full updates)",Player_num, static_cast<float>(UDP_len_pdata)/1024, static_cast<float>(UDP_len_pdata_full)/1024);
+		UDP_num_sendto = UDP_len_sendto = UDP_num_recvfrom = UDP_len_recvfrom = UDP_num_bundled = 0;
+		UDP_len_pdata = UDP_len_pdata_full = 0;
 	}
 }
 
@@ -1005,6 +1146,7 @@ struct direct_join
 	enum class connect_type : uint8_t
 	{
 		idle,
+		resolving,
 		connecting,
 		request_join,
 	};
@@ -1198,13 +1340,42 @@ window_event_result manual_join_menu::event_handler(const d_event &event)
 			if (connecting != direct_join::connect_type::idle && event_key_get(event) == KEY_ESC)
 			{
 				connecting = direct_join::connect_type::idle;
+				UDP_join_resolve.id = 0;
 				nm_set_item_text(m[label_status_text], "");
 				return window_event_result::handled;
 			}
 			break;
 			
 		case EVENT_IDLE:
-			if (connecting != direct_join::connect_type::idle)
+			if (connecting == direct_join::connect_type::resolving)
+			{
+				net_udp_async_poll();
+				if (!UDP_join_resolve.done)
+					break;
+				UDP_join_resolve.done = false;
+				auto &r = UDP_join_resolve.result;
+				if (r.resolve_error || r.addrlen > sizeof(host_addr))
+				{
+					con_printf(CON_URGENT, "udp_dns_filladdr (getaddrinfo) failed for host %s", &hostaddrbuf[0]);
+					connecting = direct_join::connect_type::idle;
+					nm_set_item_text(m[label_status_text], "");
+					nm_messagebox(menu_title{TXT_ERROR}, 1, TXT_OK, "Could not resolve address\n%s", &hostaddrbuf[0]);
+					break;
+				}
+				host_addr = {};
+				memcpy(&host_addr, &r.addr, r.addrlen);
+				s_last_inputs = *this;
+				multi_new_game();
+				N_players = 0;
+				change_playernum_to(1);
+				start_time = timer_query();
+				last_time = 0;
+				
+				Netgame.players[0].protocol.udp.addr = host_addr;
+				connecting = direct_join::connect_type::connecting;
+				nm_set_item_text(m[label_status_text], "Connecting...");
+			}
+			else if (connecting != direct_join::connect_type::idle)
 			{
 				if (net_udp_game_connect(this))
 					return window_event_result::close;	// Success!
@@ -1226,23 +1397,12 @@ window_event_result manual_join_menu::event_handler(const d_event &event)
 			uint16_t hostport;
 			if (!convert_text_portstring(hostportbuf, hostport, true, false))
 				return window_event_result::handled;
-			// Resolve address
-			if (udp_dns_filladdr(host_addr, &hostaddrbuf[0], hostport, false, false) < 0)
-				return window_event_result::handled;
-			else
-			{
-				s_last_inputs = *this;
-				multi_new_game();
-				N_players = 0;
-				change_playernum_to(1);
-				start_time = timer_query();
-				last_time = 0;
-				
-				Netgame.players[0].protocol.udp.addr = host_addr;
-				connecting = direct_join::connect_type::connecting;
-				nm_set_item_text(m[label_status_text], "Connecting...");
-				return window_event_result::handled;
-			}
+			// Resolve address on the worker.  EVENT_IDLE starts connecting once it is known.
+			UDP_join_resolve = {};
+			UDP_join_resolve.id = UDP_async.resolve(&hostaddrbuf[0], hostport, _sockaddr::address_family(), false);
+			connecting = direct_join::connect_type::resolving;
+			nm_set_item_text(m[label_status_text], "Resolving...");
+			return window_event_result::handled;
 		}
 			
 		case EVENT_WINDOW_CLOSE:
@@ -1558,6 +1718,7 @@ static void net_udp_send_sequence_packet(UDP_sequence_packet seq, const _sockadd
 	memcpy(&buf[len], seq.player.callsign.buffer(), CALLSIGN_LEN+1);		len += CALLSIGN_LEN+1;
 	buf[len] = seq.player.connected;				len++;
 	buf[len] = underlying_value(seq.player.rank);					len++;
+	buf[len] = seq.observer;					len++;
 	dxx_sendto(recv_addr, UDP_Socket[0], buf, 0);
 }
 
@@ -1569,6 +1730,7 @@ static void net_udp_receive_sequence_packet(ubyte *data, UDP_sequence_packet *se
 	memcpy(seq->player.callsign.buffer(), &(data[len]), CALLSIGN_LEN+1);	len += CALLSIGN_LEN+1;
 	seq->player.connected = data[len];				len++;
 	memcpy (&(seq->player.rank),&(data[len]),1);			len++;
+	seq->observer = !!data[len];					len++;
 	
 	if (multi_i_am_master())
 		seq->player.protocol.udp.addr = sender_addr;
@@ -1592,11 +1754,14 @@ void net_udp_init()
 	Netgame = {};
 	UDP_Seq = {};
 	UDP_MData = {};
+	UDP_len_pdata_game = UDP_len_pdata_full_game = 0;
+	net_udp_telemetry_reset();
 	net_udp_noloss_init_mdata_queue();
 	UDP_Seq.type = UPID_REQUEST;
 	UDP_Seq.player.callsign = InterfaceUniqueState.PilotName;
 
 	UDP_Seq.player.rank=GetMyNetRanking();	
+	UDP_Seq.observer = CGameArg.MplUdpRelay;
 
 	multi_new_game();
 	net_udp_flush();
@@ -1609,7 +1774,11 @@ void net_udp_init()
 
 void net_udp_close()
 {
+	net_udp_bundle_flush_all();
+	// Drop what the worker has not sent yet, rather than wait for it, so that it does not use the sockets any more.
+	UDP_async.cancel_sends();
 	UDP_Socket = {};
+	net_udp_relay_close();
 #ifdef _WIN32
 	WSACleanup();
 #endif
@@ -1726,6 +1895,17 @@ void dispatch_table::disconnect_player(int playernum) const
 }
 }
 
+/* Record in the netgame whether the pilot in slot pnum is an observer.
+ */
+static void net_udp_set_observer(const unsigned pnum, const bool observer)
+{
+	const uint8_t bit = 1u << pnum;
+	if (observer)
+		Netgame.ObserverPlayers |= bit;
+	else
+		Netgame.ObserverPlayers &= ~bit;
+}
+
 static void net_udp_new_player(UDP_sequence_packet *const their)
 {
 	auto &Objects = LevelUniqueObjectState.Objects;
@@ -1772,7 +1952,11 @@ static void net_udp_new_player(UDP_sequence_packet *const their)
 	const auto &&rankstr = GetRankStringWithSpace(their->player.rank);
 	HUD_init_message(HM_MULTI, "%s%s'%s' %s", rankstr.first, rankstr.second, static_cast<const char *>(their->player.callsign), TXT_JOINING);
 	
-	multi_make_ghost_player(pnum);
+	net_udp_set_observer(pnum, their->observer);
+	if (multi_is_observer(pnum))
+		multi_make_observer_ghost(pnum);
+	else
+		multi_make_ghost_player(pnum);
 
 	multi_send_score();
 #if defined(DXX_BUILD_DESCENT_II)
@@ -1810,7 +1994,7 @@ static void net_udp_welcome_player(UDP_sequence_packet *their)
 
 	// Joining a running game will need quite a few packets on the mdata-queue, so let players only join if we have enough space.
 	if (Netgame.PacketLossPrevention)
-		if ((UDP_MDATA_STOR_QUEUE_SIZE - UDP_mdata_queue_highest) < UDP_MDATA_STOR_MIN_FREE_2JOIN)
+		if ((UDP_MDATA_STOR_QUEUE_SIZE - UDP_mdata_queue_count) < UDP_MDATA_STOR_MIN_FREE_2JOIN)
 			return;
 
 	if (their->player.connected != Current_level_num)
@@ -2368,6 +2552,14 @@ static void net_udp_read_object_packet( ubyte *data )
 	} // For each object in packet
 }
 
+/* The level time sent to a player who joins, with the hours, so that the
+ * level clocks of every peer agree.  A fix holds a little over nine hours.
+ */
+static fix net_udp_level_time(const player &plr)
+{
+	return std::min<fix64>(static_cast<fix64>(plr.hours_level) * i2f(3600) + plr.time_level, INT32_MAX);
+}
+
 namespace dsx {
 
 void net_udp_send_rejoin_sync(const unsigned player_num)
@@ -2418,7 +2610,7 @@ void net_udp_send_rejoin_sync(const unsigned player_num)
 		Netgame.player_score[j] = player_info.mission.score;
 	}
 
-	Netgame.level_time = get_local_player().time_level;
+	Netgame.level_time = net_udp_level_time(get_local_player());
 	Netgame.monitor_vector = net_udp_create_monitor_vector();
 
 	net_udp_send_game_info(UDP_sync_player.player.protocol.udp.addr, &UDP_sync_player.player.protocol.udp.addr, UPID_SYNC);
@@ -2450,7 +2642,7 @@ static void net_udp_resend_sync_due_to_packet_loss()
 		Netgame.player_score[j] = player_info.mission.score;
 	}
 
-	Netgame.level_time = get_local_player().time_level;
+	Netgame.level_time = net_udp_level_time(get_local_player());
 	Netgame.monitor_vector = net_udp_create_monitor_vector();
 
 	net_udp_send_game_info(UDP_sync_player.player.protocol.udp.addr, &UDP_sync_player.player.protocol.udp.addr, UPID_SYNC);
@@ -2478,6 +2670,7 @@ static void net_udp_add_player(UDP_sequence_packet *p)
 	Netgame.players[N_players].protocol.udp.addr = p->player.protocol.udp.addr;
 	Netgame.players[N_players].rank=p->player.rank;
 	Netgame.players[N_players].connected = CONNECT_PLAYING;
+	net_udp_set_observer(N_players, p->observer);
 	auto &obj = *vmobjptr(vcplayerptr(N_players)->objnum);
 	auto &player_info = obj.ctype.player_info;
 	player_info.KillGoalCount = 0;
@@ -2513,9 +2706,11 @@ static void net_udp_remove_player(UDP_sequence_packet *p)
 		Netgame.players[i].callsign = Netgame.players[i+1].callsign;
 		Netgame.players[i].protocol.udp.addr = Netgame.players[i+1].protocol.udp.addr;
 		Netgame.players[i].rank=Netgame.players[i+1].rank;
+		net_udp_set_observer(i, Netgame.ObserverPlayers & (1u << (i + 1)));
 	}
 		
 	N_players--;
+	net_udp_set_observer(N_players, false);
 	Netgame.numplayers = N_players;
 
 	net_udp_send_netgame_update();
@@ -2786,6 +2981,8 @@ static uint_fast32_t net_udp_prepare_heavy_game_info(const _sockaddr *addr, ubyt
 		buf[len++] = Netgame.ShowEnemyNames;
 		buf[len++] = Netgame.BrightPlayers;
 		buf[len++] = Netgame.InvulAppear;
+		buf[len++] = Netgame.DedicatedHost;
+		buf[len++] = Netgame.ObserverPlayers;
 		range_for (const auto &i, Netgame.team_name)
 		{
 			memcpy(&buf[len], static_cast<const char *>(i), (CALLSIGN_LEN+1));
@@ -3030,6 +3227,8 @@ static void net_udp_process_game_info(const uint8_t *data, uint_fast32_t, const
 		Netgame.ShowEnemyNames = data[len];				len += 1;
 		Netgame.BrightPlayers = data[len];				len += 1;
 		Netgame.InvulAppear = data[len];				len += 1;
+		Netgame.DedicatedHost = data[len];				len += 1;
+		Netgame.ObserverPlayers = data[len];				len += 1;
 		range_for (auto &i, Netgame.team_name)
 		{
 			i.copy(reinterpret_cast<const char *>(&data[len]), (CALLSIGN_LEN+1));
@@ -3136,6 +3335,7 @@ static void net_udp_process_packet(ubyte *data, const _sockaddr &sender_addr, in
 {
 	UDP_sequence_packet their{};
 
+	net_udp_telemetry_in(sender_addr, data, length);
 	switch (data[0])
 	{
 		case UPID_VERSION_DENY:
@@ -3265,6 +3465,18 @@ static void net_udp_process_packet(ubyte *data, const _sockaddr &sender_addr, in
 		case UPID_MDATA_ACK:
 			net_udp_noloss_got_ack(data, length);
 			break;
+		case UPID_BUNDLE:
+			net_udp_process_bundle(data, length, sender_addr);
+			break;
+		case UPID_PDATA_DELTA:
+			net_udp_process_pdata_delta(data, length, sender_addr);
+			break;
+		case UPID_PDATA_ACK:
+			net_udp_process_pdata_ack(data, length, sender_addr);
+			break;
+		case UPID_STATE_HASH:
+			net_udp_process_state_hash(data, length, sender_addr);
+			break;
 #if DXX_USE_TRACKER
 		case UPID_TRACKER_GAMEINFO:
 			udp_tracker_process_game( data, length, sender_addr );
@@ -3379,7 +3591,7 @@ static int net_udp_sync_poll( newmenu *,const d_event &event, const unused_newme
 	static fix64 t1 = 0;
 	int rval = 0;
 
-	if (event.type != EVENT_WINDOW_DRAW)
+	if (!event_is_frame(event))
 		return 0;
 	net_udp_listen();
 
@@ -3406,7 +3618,7 @@ static int net_udp_sync_poll( newmenu *,const d_event &event, const unused_newme
 
 static int net_udp_start_poll(newmenu *, const d_event &event, start_poll_menu_items *const items)
 {
-	if (event.type != EVENT_WINDOW_DRAW)
+	if (!event_is_frame(event))
 		return 0;
 	Assert(Network_status == NETSTAT_STARTING);
 
@@ -4135,12 +4347,11 @@ static int net_udp_game_param_handler( newmenu *menu,const d_event &event, param
 	return 0;
 }
 
-window_event_result net_udp_setup_game()
+/* Set up Netgame for the host, from the defaults and the netgame
+ * profile of the pilot, for the first level of Current_mission.
+ */
+static void net_udp_init_host_netgame()
 {
-	param_opt opt;
-	auto &m = opt.m;
-	char level_text[32];
-
 	net_udp_init();
 
 	multi_new_game();
@@ -4170,6 +4381,8 @@ window_event_result net_udp_setup_game()
 	Netgame.ShufflePowerupSeed = 0;
 	Netgame.BrightPlayers = 1;
 	Netgame.InvulAppear = 4;
+	Netgame.DedicatedHost = CGameArg.MplDedicated;
+	Netgame.ObserverPlayers = CGameArg.MplUdpRelay;
 	Netgame.SecludedSpawns = MAX_PLAYERS - 1;
 	Netgame.AllowedItems = Netgame.MaskAllKnownAllowedItems;
 	Netgame.PacketLossPrevention = 1;
@@ -4191,6 +4404,15 @@ window_event_result net_udp_setup_game()
 	Netgame.mission_title = Current_mission->mission_name;
 
 	Netgame.levelnum = 1;
+}
+
+window_event_result net_udp_setup_game()
+{
+	param_opt opt;
+	auto &m = opt.m;
+	char level_text[32];
+
+	net_udp_init_host_netgame();
 
 	unsigned optnum = 0;
 	opt.start_game=optnum;
@@ -4397,7 +4619,9 @@ void net_udp_read_sync_packet(const uint8_t * data, uint_fast32_t data_len, cons
 	if (Network_rejoined)
 	{
 		net_udp_process_monitor_vector(Netgame.monitor_vector);
-		plr.time_level = Netgame.level_time;
+		/* Netgame.level_time has the hours, see net_udp_level_time. */
+		plr.hours_level = f2i(Netgame.level_time) / 3600;
+		plr.time_level = Netgame.level_time - i2f(plr.hours_level * 3600);
 	}
 
 	team_kills = Netgame.team_kills;
@@ -4514,6 +4738,28 @@ static int net_udp_select_players()
 	}
 
 	net_udp_add_player( &UDP_Seq );
+	if (CGameArg.MplDedicated)
+	{
+		/* Nobody is asked to join.  Players join the running game as
+		 * they find it.
+		 */
+#if DXX_USE_TRACKER
+		if (Netgame.Tracker)
+		{
+			TrackerAckStatus = TrackerAckState::TACK_NOCONNECTION;
+			TrackerAckTime = timer_query();
+			udp_tracker_register();
+		}
+#endif
+		N_players = 1;
+		vmplayerptr(0u)->connected = CONNECT_PLAYING;
+		range_for (auto &i, partial_range(Netgame.players, 1u, Netgame.players.size()))
+		{
+			i.callsign = {};
+			i.rank = netplayer_info::player_rank::None;
+		}
+		return 1;
+	}
 	start_poll_menu_items spd;
 		
 	for (int i=0; i< MAX_PLAYERS+4; i++ ) {
@@ -4593,6 +4839,7 @@ abort:
 			{
 				Netgame.players[N_players].callsign = Netgame.players[i].callsign;
 				Netgame.players[N_players].rank=Netgame.players[i].rank;
+				net_udp_set_observer(N_players, Netgame.ObserverPlayers & (1u << i));
 			}
 			vmplayerptr(N_players)->connected = CONNECT_PLAYING;
 			N_players++;
@@ -4608,6 +4855,8 @@ abort:
 		i.callsign = {};
 		i.rank = netplayer_info::player_rank::None;
 	}
+	for (unsigned i = N_players; i < MAX_PLAYERS; ++i)
+		net_udp_set_observer(i, false);
 
 #if defined(DXX_BUILD_DESCENT_I)
 	if (Netgame.gamemode == network_game_type::team_anarchy)
@@ -4664,6 +4913,28 @@ static int net_udp_start_game(void)
 	return 1;	// don't keep params menu or mission listbox (may want to join a game next time)
 }
 
+namespace dsx {
+int net_udp_start_dedicated_game(const int levelnum, const network_game_type *const mode, const char *const name)
+{
+	net_udp_init_host_netgame();
+	if (mode)
+		Netgame.gamemode = *mode;
+	if (name)
+		snprintf(Netgame.game_name.data(), Netgame.game_name.size(), "%s", name);
+	if (levelnum < 1 || levelnum > Current_mission->last_level)
+	{
+		con_printf(CON_URGENT, "dedicated: level %i is not in mission %s", levelnum, &*Current_mission->filename);
+		return 0;
+	}
+	Netgame.levelnum = levelnum;
+	/* A dedicated host always admits players who ask to join. */
+	Netgame.max_numplayers = MAX_PLAYERS;
+	Netgame.game_flag.closed = 0;
+	Netgame.RefusePlayers = 0;
+	return net_udp_start_game();
+}
+}
+
 static int net_udp_wait_for_sync(void)
 {
 	char text[60];
@@ -4706,7 +4977,7 @@ static int net_udp_request_poll( newmenu *,const d_event &event, const unused_ne
 	// Polling loop for waiting-for-requests menu
 	int num_ready = 0;
 
-	if (event.type != EVENT_WINDOW_DRAW)
+	if (!event_is_frame(event))
 		return 0;
 	net_udp_listen();
 	net_udp_timeout_check(timer_query());
@@ -4778,6 +5049,8 @@ window_event_result dispatch_table::level_sync() const
 
 	UDP_MData = {};
 	net_udp_noloss_init_mdata_queue();
+	net_udp_interest_clear();
+	net_udp_state_hash_clear();
 
 	net_udp_flush(); // Flush any old packets
 
@@ -4959,6 +5232,9 @@ void dispatch_table::leave_game() const
 #endif
 	}
 
+	if (UDP_len_pdata_full_game)
+		con_printf(CON_VERBOSE, "P#%u: Sent %u bytes of position updates, %u%% of the %u bytes full updates would have taken", Player_num, UDP_len_pdata_game, static_cast<unsigned>(static_cast<uint64_t>(UDP_len_pdata_game) * 100 / UDP_len_pdata_full_game), UDP_len_pdata_full_game);
+
 	get_local_player().connected = CONNECT_DISCONNECTED;
 	change_playernum_to(0);
 #if defined(DXX_BUILD_DESCENT_II)
@@ -4991,6 +5267,50 @@ void net_udp_flush()
 		net_udp_flush(s);
 }
 
+#ifdef DXX_HAVE_RECVMMSG
+/* Like udp_receive_packet, but take up to a full batch of waiting packets with each system call. */
+static void net_udp_listen(RAIIsocket &sock)
+{
+	constexpr std::size_t batch = 16;
+	std::array<std::array<uint8_t, UPID_MAX_SIZE>, batch> packets;
+	std::array<_sockaddr, batch> senders;
+	std::array<iovec, batch> iov;
+	std::array<mmsghdr, batch> msgs;
+	while (sock)
+	{
+		for (std::size_t i = 0; i < batch; ++i)
+		{
+			iov[i].iov_base = packets[i].data();
+			iov[i].iov_len = packets[i].size();
+			auto &from = senders[i];
+			msgs[i] = {};
+			msgs[i].msg_hdr.msg_name = &dispatch_sockaddr_from;
+			msgs[i].msg_hdr.msg_namelen = sizeof(dispatch_sockaddr_from);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		const int received = recvmmsg(sock, msgs.data(), batch, MSG_DONTWAIT, nullptr);
+		if (!(received > 0))
+			break;
+		for (int i = 0; i < received; ++i)
+		{
+			// Processing a packet may leave the game and close the socket.
+			if (!sock)
+				return;
+			const unsigned size = msgs[i].msg_len;
+			UDP_num_recvfrom++;
+			UDP_len_recvfrom += size;
+			if (!size)
+				continue;
+			if (size < packets[i].size())
+				packets[i][size] = 0;
+			net_udp_process_packet(packets[i].data(), senders[i], size);
+		}
+		if (static_cast<std::size_t>(received) < batch)
+			break;
+	}
+}
+#else
 static void net_udp_listen(RAIIsocket &sock)
 {
 	if (!sock)
@@ -5005,11 +5325,55 @@ static void net_udp_listen(RAIIsocket &sock)
 		net_udp_process_packet(packet.data(), sender_addr, size);
 	}
 }
+#endif
 
 void net_udp_listen()
 {
+	net_udp_async_poll();
 	range_for (auto &s, UDP_Socket)
 		net_udp_listen(s);
+	// Send the ACKs and relays caused by what we just received together with anything queued earlier this frame.
+	net_udp_bundle_flush_all();
+}
+
+/* Take what the worker finished since the last call. */
+void net_udp_async_poll()
+{
+	static std::vector<udp_async_completion> done;
+	done.clear();
+	if (!UDP_async.poll(done))
+		return;
+	for (const auto &c : done)
+	{
+		if (c.sent > 0)
+		{
+			UDP_num_sendto++;
+			UDP_len_sendto += c.sent;
+		}
+#if DXX_USE_TRACKER
+		if (c.id == TrackerResolveId)
+			udp_tracker_resolved(c);
+		else
+#endif
+		if (c.id == UDP_join_resolve.id)
+		{
+			UDP_join_resolve.id = 0;
+			UDP_join_resolve.done = true;
+			UDP_join_resolve.result = c;
+		}
+		else if (c.id == UDP_relay_watch.resolve_id)
+		{
+			UDP_relay_watch.resolve_id = 0;
+			if (c.resolve_error || c.addrlen > sizeof(UDP_relay_watch.relay_addr))
+				con_printf(CON_URGENT, "relay: cannot resolve host %s", CGameArg.MplUdpRelayWatch.c_str());
+			else
+			{
+				UDP_relay_watch.relay_addr = {};
+				memcpy(&UDP_relay_watch.relay_addr, &c.addr, c.addrlen);
+				UDP_relay_watch.resolved = true;
+			}
+		}
+	}
 }
 
 void net_udp_send_data(const uint8_t *const ptr, const unsigned len, const int priority)
@@ -5068,7 +5432,7 @@ namespace udp {
 void dispatch_table::do_protocol_frame(int force, int listen) const
 {
 	auto &LevelUniqueControlCenterState = LevelUniqueObjectState.ControlCenterState;
-	static fix64 last_pdata_time = 0, last_mdata_time = 16, last_endlevel_time = 32, last_bcast_time = 48, last_resync_time = 64;
+	static fix64 last_pdata_time = 0, last_mdata_time = 16, last_endlevel_time = 32, last_bcast_time = 48, last_resync_time = 64, last_bundle_time = 80;
 
 	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
 		return;
@@ -5121,10 +5485,18 @@ void dispatch_table::do_protocol_frame(int force, int listen) const
 	}
 
 	net_udp_ping_frame(time);
+	net_udp_state_hash_frame();
 #if DXX_USE_TRACKER
 	udp_tracker_verify_ack_timeout();
 #endif
 
+	// offer bundling to peers which have not offered it to us yet
+	if (time >= last_bundle_time + F1_0)
+	{
+		last_bundle_time = time;
+		net_udp_bundle_announce();
+	}
+
 	if (listen)
 	{
 		net_udp_timeout_check(time);
@@ -5135,7 +5507,11 @@ void dispatch_table::do_protocol_frame(int force, int listen) const
 			net_udp_send_extras();
 	}
 
+	net_udp_bundle_flush_all();
 	udp_traffic_stat();
+	net_udp_telemetry_frame(time);
+	if (CGameArg.MplUdpRelay)
+		net_udp_relay_frame(time);
 }
 }
 }
@@ -5143,6 +5519,73 @@ void dispatch_table::do_protocol_frame(int force, int listen) const
 
 /* CODE FOR PACKET LOSS PREVENTION - START */
 /* This code tries to make sure that packets with opcode UPID_MDATA_PNEEDACK aren't lost and sent and received in order. */
+/*
+ * The store is a ring: new packets go behind the newest one and the oldest are removed from the front once they are ACK'd or timed out.
+ * Packets waiting for ACKs are also linked into a timer wheel slot for their next resend time, so each frame only looks at packets which are due.
+ */
+static void net_udp_noloss_wheel_link(const unsigned slot)
+{
+	auto &e = UDP_mdata_queue[slot];
+	auto &w = UDP_mdata_wheel[((e.pkt_timestamp + UDP_MDATA_RESEND_TIME) / UDP_MDATA_WHEEL_TICK) % UDP_MDATA_WHEEL_SIZE];
+	e.wheel_prev = w.tail;
+	e.wheel_next = UDP_MDATA_STOR_QUEUE_SIZE;
+	if (w.tail == UDP_MDATA_STOR_QUEUE_SIZE)
+		w.head = slot;
+	else
+		UDP_mdata_queue[w.tail].wheel_next = slot;
+	w.tail = slot;
+}
+
+static void net_udp_noloss_wheel_unlink(const unsigned slot)
+{
+	auto &e = UDP_mdata_queue[slot];
+	auto &w = UDP_mdata_wheel[((e.pkt_timestamp + UDP_MDATA_RESEND_TIME) / UDP_MDATA_WHEEL_TICK) % UDP_MDATA_WHEEL_SIZE];
+	if (e.wheel_prev == UDP_MDATA_STOR_QUEUE_SIZE)
+		w.head = e.wheel_next;
+	else
+		UDP_mdata_queue[e.wheel_prev].wheel_next = e.wheel_next;
+	if (e.wheel_next == UDP_MDATA_STOR_QUEUE_SIZE)
+		w.tail = e.wheel_prev;
+	else
+		UDP_mdata_queue[e.wheel_next].wheel_prev = e.wheel_prev;
+}
+
+/* Remove a packet from the store, and every unused one from the front. */
+static void net_udp_noloss_remove_queue_pkt(const unsigned slot)
+{
+	auto &e = UDP_mdata_queue[slot];
+	con_printf(CON_VERBOSE, "P#%u: Removing stored pkt_num [%i,%i,%i,%i,%i,%i,%i,%i] - missing ACKs: %u",Player_num, e.pkt_num[0], e.pkt_num[1], e.pkt_num[2], e.pkt_num[3], e.pkt_num[4], e.pkt_num[5], e.pkt_num[6], e.pkt_num[7], static_cast<unsigned>(e.player_ack_pending.count()));
+	net_udp_noloss_wheel_unlink(slot);
+	e.used = 0;
+	while (UDP_mdata_queue_count && !UDP_mdata_queue[UDP_mdata_queue_head].used)
+	{
+		UDP_mdata_queue_head = (UDP_mdata_queue_head + 1) % UDP_MDATA_STOR_QUEUE_SIZE;
+		UDP_mdata_queue_count--;
+	}
+}
+
+/* A client failed to get important packets to the host, so it leaves. */
+static void net_udp_noloss_client_give_up()
+{
+	Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
+	const auto g = Game_wind;
+	if (g)
+		g->set_visible(0);
+	nm_messagebox_str(menu_title{nullptr}, nm_messagebox_tie(TXT_OK), menu_subtitle{"You left the game. You failed\nsending important packets.\nSorry."});
+	if (g)
+		g->set_visible(1);
+	multi_quit_game = 1;
+	game_leave_menus();
+}
+
+/* If player is not playing anymore, we can remove him from the list. Also remove *me* (even if that should have been done already). Also make sure Clients do not send to anyone else than Host. */
+static void net_udp_noloss_drop_absent_players(UDP_mdata_store &e)
+{
+	for (unsigned plc = 0; plc < MAX_PLAYERS; ++plc)
+		if ((vcplayerptr(plc)->connected != CONNECT_PLAYING || plc == Player_num) || (!multi_i_am_master() && plc > 0))
+			e.player_ack_pending.reset(plc);
+}
+
 /*
  * Adds a packet to our queue. Should be called when an IMPORTANT mdata packet is created.
  * player_ack is an array which should contain 0 for each player that needs to send an ACK signal.
@@ -5155,52 +5598,51 @@ static void net_udp_noloss_add_queue_pkt(fix64 time, const ubyte *data, ushort d
 	if (!Netgame.PacketLossPrevention)
 		return;
 
-	if (UDP_mdata_queue_highest == UDP_MDATA_STOR_QUEUE_SIZE) // The list is full. That should not happen. But if it does, we must do something.
+	if (UDP_mdata_queue_count == UDP_MDATA_STOR_QUEUE_SIZE) // The list is full. That should not happen. But if it does, we must do something.
 	{
 		con_printf(CON_VERBOSE, "P#%u: MData store list is full!", Player_num);
 		if (multi_i_am_master()) // I am host. I will kick everyone who did not ACK the first packet and then remove it.
 		{
+			const auto oldest = UDP_mdata_queue_head;
 			for ( int i=1; i<N_players; i++ )
-				if (UDP_mdata_queue[0].player_ack[i] == 0)
+				if (UDP_mdata_queue[oldest].player_ack_pending.test(i))
 					multi::udp::dispatch->kick_player(Netgame.players[i].protocol.udp.addr, DUMP_PKTTIMEOUT);
-			std::move(std::next(UDP_mdata_queue.begin()), UDP_mdata_queue.end(), UDP_mdata_queue.begin());
-			UDP_mdata_queue[UDP_MDATA_STOR_QUEUE_SIZE - 1] = {};
-			UDP_mdata_queue_highest--;
+			net_udp_noloss_remove_queue_pkt(oldest);
 		}
 		else // I am just a client. I gotta go.
 		{
-			Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
-			const auto g = Game_wind;
-			if (g)
-				g->set_visible(0);
-			nm_messagebox_str(menu_title{nullptr}, nm_messagebox_tie(TXT_OK), menu_subtitle{"You left the game. You failed\nsending important packets.\nSorry."});
-			if (g)
-				g->set_visible(1);
-			multi_quit_game = 1;
-			game_leave_menus();
+			net_udp_noloss_client_give_up();
+			return;
 		}
-		Assert(UDP_mdata_queue_highest == (UDP_MDATA_STOR_QUEUE_SIZE - 1));
 	}
 
 	con_printf(CON_VERBOSE, "P#%u: Adding MData pkt_num [%i,%i,%i,%i,%i,%i,%i,%i], type %i from P#%i to MData store list", Player_num, UDP_mdata_trace[0].pkt_num_tosend,UDP_mdata_trace[1].pkt_num_tosend,UDP_mdata_trace[2].pkt_num_tosend,UDP_mdata_trace[3].pkt_num_tosend,UDP_mdata_trace[4].pkt_num_tosend,UDP_mdata_trace[5].pkt_num_tosend,UDP_mdata_trace[6].pkt_num_tosend,UDP_mdata_trace[7].pkt_num_tosend, data[0], pnum);
-	UDP_mdata_queue[UDP_mdata_queue_highest].used = 1;
-	UDP_mdata_queue[UDP_mdata_queue_highest].pkt_initial_timestamp = time;
+	const unsigned slot = (UDP_mdata_queue_head + UDP_mdata_queue_count) % UDP_MDATA_STOR_QUEUE_SIZE;
+	UDP_mdata_queue_count++;
+	auto &e = UDP_mdata_queue[slot];
+	e.used = 1;
+	e.pkt_initial_timestamp = time;
+	e.pkt_timestamp = time;
+	e.pkt_num = {};
+	e.player_ack_pending.reset();
 	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
 	{
 		if (i == Player_num || player_ack[i] || vcplayerptr(i)->connected == CONNECT_DISCONNECTED) // if player me, is not playing or does not require an ACK, do not add timestamp or increment pkt_num
 			continue;
 		
-		UDP_mdata_queue[UDP_mdata_queue_highest].pkt_timestamp[i] = time;
-		UDP_mdata_queue[UDP_mdata_queue_highest].pkt_num[i] = UDP_mdata_trace[i].pkt_num_tosend;
+		e.player_ack_pending.set(i);
+		e.pkt_num[i] = UDP_mdata_trace[i].pkt_num_tosend;
+		UDP_mdata_trace[i].pkt_queue_slot[UDP_mdata_trace[i].pkt_num_tosend % UDP_MDATA_STOR_QUEUE_SIZE] = slot;
 		UDP_mdata_trace[i].pkt_num_tosend++;
 		if (UDP_mdata_trace[i].pkt_num_tosend > UDP_MDATA_PKT_NUM_MAX)
 			UDP_mdata_trace[i].pkt_num_tosend = UDP_MDATA_PKT_NUM_MIN;
 	}
-	UDP_mdata_queue[UDP_mdata_queue_highest].Player_num = pnum;
-	memcpy( &UDP_mdata_queue[UDP_mdata_queue_highest].player_ack, player_ack, sizeof(ubyte)*MAX_PLAYERS); 
-	memcpy( &UDP_mdata_queue[UDP_mdata_queue_highest].data, data, sizeof(char)*data_size );
-	UDP_mdata_queue[UDP_mdata_queue_highest].data_size = data_size;
-	UDP_mdata_queue_highest++;
+	e.Player_num = pnum;
+	memcpy(e.data.data(), data, sizeof(char)*data_size);
+	e.data_size = data_size;
+	net_udp_noloss_wheel_link(slot);
+	if (e.player_ack_pending.none())
+		net_udp_noloss_remove_queue_pkt(slot);
 }
 
 /*
@@ -5228,32 +5670,32 @@ static int net_udp_noloss_validate_mdata(uint32_t pkt_num, ubyte sender_pnum, co
         buf[len] = pkt_sender_pnum;											len++;
 	PUT_INTEL_INT(&buf[len], pkt_num);										len += 4;
 
+	auto &trace = UDP_mdata_trace[sender_pnum];
         // Make sure this is the packet we are expecting!
-        if (UDP_mdata_trace[sender_pnum].pkt_num_torecv != pkt_num)
+        if (trace.pkt_num_torecv != pkt_num)
         {
-                range_for (auto &i, partial_const_range(UDP_mdata_trace[sender_pnum].pkt_num, static_cast<uint32_t>(UDP_MDATA_STOR_QUEUE_SIZE)))
+		// Packets are only taken in order, so the ones we got recently are those just before pkt_num_torecv.
+		const uint32_t behind = (pkt_num < trace.pkt_num_torecv)
+			? trace.pkt_num_torecv - pkt_num
+			: trace.pkt_num_torecv + (UDP_MDATA_PKT_NUM_MAX - UDP_MDATA_PKT_NUM_MIN + 1) - pkt_num;
+                if (behind <= trace.pkt_num_received) // We got this packet already - need to REsend ACK
                 {
-                        if (pkt_num == i) // We got this packet already - need to REsend ACK
-                        {
-                                con_printf(CON_VERBOSE, "P#%u: Resending MData ACK for pkt %i we already got by pnum %i",Player_num, pkt_num, sender_pnum);
-                                dxx_sendto(sender_addr, UDP_Socket[0], buf, 0);
-                                return 0;
-                        }
+                        con_printf(CON_VERBOSE, "P#%u: Resending MData ACK for pkt %i we already got by pnum %i",Player_num, pkt_num, sender_pnum);
+                        net_udp_bundle_send(sender_pnum, buf.data(), buf.size());
+                        return 0;
                 }
-                con_printf(CON_VERBOSE, "P#%u: Rejecting MData pkt %i - expected %i by pnum %i",Player_num, pkt_num, UDP_mdata_trace[sender_pnum].pkt_num_torecv, sender_pnum);
+                con_printf(CON_VERBOSE, "P#%u: Rejecting MData pkt %i - expected %i by pnum %i",Player_num, pkt_num, trace.pkt_num_torecv, sender_pnum);
                 return 0; // Not the right packet and we haven't gotten it, yet either. So bail out and wait for the right one.
         }
 
 	con_printf(CON_VERBOSE, "P#%u: Sending MData ACK for pkt %i by pnum %i",Player_num, pkt_num, sender_pnum);
-	dxx_sendto(sender_addr, UDP_Socket[0], buf, 0);
+	net_udp_bundle_send(sender_pnum, buf.data(), buf.size());
 
-	UDP_mdata_trace[sender_pnum].cur_slot++;
-	if (UDP_mdata_trace[sender_pnum].cur_slot >= UDP_MDATA_STOR_QUEUE_SIZE)
-		UDP_mdata_trace[sender_pnum].cur_slot = 0;
-	UDP_mdata_trace[sender_pnum].pkt_num[UDP_mdata_trace[sender_pnum].cur_slot] = pkt_num;
-	UDP_mdata_trace[sender_pnum].pkt_num_torecv++;
-	if (UDP_mdata_trace[sender_pnum].pkt_num_torecv > UDP_MDATA_PKT_NUM_MAX)
-		UDP_mdata_trace[sender_pnum].pkt_num_torecv = UDP_MDATA_PKT_NUM_MIN;
+	if (trace.pkt_num_received < UDP_MDATA_STOR_QUEUE_SIZE)
+		trace.pkt_num_received++;
+	trace.pkt_num_torecv++;
+	if (trace.pkt_num_torecv > UDP_MDATA_PKT_NUM_MAX)
+		trace.pkt_num_torecv = UDP_MDATA_PKT_NUM_MIN;
 	return 1;
 }
 
@@ -5272,23 +5714,27 @@ void net_udp_noloss_got_ack(const uint8_t *data, uint_fast32_t data_len)
 	dest_pnum = data[len];												len++;
 	pkt_num = GET_INTEL_INT(&data[len]);										len += 4;
 
-	for (int i = 0; i < UDP_mdata_queue_highest; i++)
-	{
-		if ((pkt_num == UDP_mdata_queue[i].pkt_num[sender_pnum]) && (dest_pnum == UDP_mdata_queue[i].Player_num))
-		{
-			con_printf(CON_VERBOSE, "P#%u: Got MData ACK for pkt_num %i from pnum %i for pnum %i",Player_num, pkt_num, sender_pnum, dest_pnum);
-			UDP_mdata_queue[i].player_ack[sender_pnum] = 1;
-			break;
-		}
-	}
+	if (sender_pnum >= MAX_PLAYERS)
+		return;
+
+	const unsigned slot = UDP_mdata_trace[sender_pnum].pkt_queue_slot[pkt_num % UDP_MDATA_STOR_QUEUE_SIZE];
+	auto &e = UDP_mdata_queue[slot];
+	if (!e.used || !e.player_ack_pending.test(sender_pnum) || pkt_num != e.pkt_num[sender_pnum] || dest_pnum != e.Player_num)
+		return;
+	con_printf(CON_VERBOSE, "P#%u: Got MData ACK for pkt_num %i from pnum %i for pnum %i",Player_num, pkt_num, sender_pnum, dest_pnum);
+	e.player_ack_pending.reset(sender_pnum);
+	if (e.player_ack_pending.none())
+		net_udp_noloss_remove_queue_pkt(slot);
 }
 
 /* Init/Free the queue. Call at start and end of a game or level. */
 void net_udp_noloss_init_mdata_queue(void)
 {
-	UDP_mdata_queue_highest=0;
+	UDP_mdata_queue_head = UDP_mdata_queue_count = 0;
 	con_printf(CON_VERBOSE, "P#%u: Clearing MData store/trace list",Player_num);
 	UDP_mdata_queue = {};
+	UDP_mdata_wheel.fill({UDP_MDATA_STOR_QUEUE_SIZE, UDP_MDATA_STOR_QUEUE_SIZE});
+	UDP_mdata_wheel_tick = 0;
 	for (int i = 0; i < MAX_PLAYERS; i++)
 		net_udp_noloss_clear_mdata_trace(i);
 }
@@ -5297,15 +5743,17 @@ void net_udp_noloss_init_mdata_queue(void)
 void net_udp_noloss_clear_mdata_trace(ubyte player_num)
 {
 	con_printf(CON_VERBOSE, "P#%u: Clearing trace list for %i",Player_num, player_num);
-	UDP_mdata_trace[player_num].pkt_num = {};
-	UDP_mdata_trace[player_num].cur_slot = 0;
+	UDP_mdata_trace[player_num].pkt_num_received = 0;
 	UDP_mdata_trace[player_num].pkt_num_torecv = UDP_MDATA_PKT_NUM_MIN;
 	UDP_mdata_trace[player_num].pkt_num_tosend = UDP_MDATA_PKT_NUM_MIN;
+	// A new or returning player may run an older build, so it must offer bundling again.
+	net_udp_bundle_clear_peer(player_num);
+	net_udp_pdata_delta_clear_peer(player_num);
 }
 
 /*
  * The main queue-process function.
- * Check if we can remove a packet from queue, and check if there are packets in queue which we need to re-send
+ * Remove packets which timed out, and re-send the packets in the timer wheel slots which are due.
  */
 void net_udp_noloss_process_queue(fix64 time)
 {
@@ -5317,138 +5765,1225 @@ void net_udp_noloss_process_queue(fix64 time)
 	if (!Netgame.PacketLossPrevention)
 		return;
 
-	for (int queuec = 0; queuec < UDP_mdata_queue_highest; queuec++)
+	// Packets are stored in the order they were created, so only the front can have timed out.
+	while (UDP_mdata_queue_count)
 	{
-		int needack = 0;
-
-		// This might happen if we get out ACK's in the wrong order. So ignore that packet for now. It'll resolve itself.
-		if (!UDP_mdata_queue[queuec].used)
-			continue;
-
-		// Check if at least one connected player has not ACK'd the packet
-		for (unsigned plc = 0; plc < MAX_PLAYERS; ++plc)
+		const auto slot = UDP_mdata_queue_head;
+		auto &e = UDP_mdata_queue[slot];
+		if (e.pkt_initial_timestamp + UDP_TIMEOUT > time)
+			break;
+		net_udp_noloss_drop_absent_players(e);
+		if (e.player_ack_pending.any()) // packet timed out but still not all have ack'd.
 		{
-			// If player is not playing anymore, we can remove him from list. Also remove *me* (even if that should have been done already). Also make sure Clients do not send to anyone else than Host
-			if ((vcplayerptr(plc)->connected != CONNECT_PLAYING || plc == Player_num) || (!multi_i_am_master() && plc > 0))
-				UDP_mdata_queue[queuec].player_ack[plc] = 1;
-
-			if (!UDP_mdata_queue[queuec].player_ack[plc])
+			if (multi_i_am_master()) // We are host, so we kick the remaining players.
 			{
-				// Resend if enough time has passed.
-				if (UDP_mdata_queue[queuec].pkt_timestamp[plc] + (F1_0/4) <= time)
-				{
-					ubyte buf[sizeof(UDP_mdata_info)];
-					int len = 0;
-					
-					con_printf(CON_VERBOSE, "P#%u: Resending pkt_num %i from pnum %i to pnum %i",Player_num, UDP_mdata_queue[queuec].pkt_num[plc], UDP_mdata_queue[queuec].Player_num, plc);
-					
-					UDP_mdata_queue[queuec].pkt_timestamp[plc] = time;
-					memset(&buf, 0, sizeof(UDP_mdata_info));
-					
-					// Prepare the packet and send it
-					buf[len] = UPID_MDATA_PNEEDACK;													len++;
-					buf[len] = UDP_mdata_queue[queuec].Player_num;								len++;
-					PUT_INTEL_INT(buf + len, UDP_mdata_queue[queuec].pkt_num[plc]);					len += 4;
-					memcpy(&buf[len], UDP_mdata_queue[queuec].data.data(), sizeof(char)*UDP_mdata_queue[queuec].data_size);
-																								len += UDP_mdata_queue[queuec].data_size;
-					dxx_sendto(Netgame.players[plc].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
-					total_len += len;
-				}
-				needack++;
+				for ( int plc=1; plc<N_players; plc++ )
+					if (e.player_ack_pending.test(plc))
+						multi::udp::dispatch->kick_player(Netgame.players[plc].protocol.udp.addr, DUMP_PKTTIMEOUT);
+			}
+			else // We are client, so we gotta go.
+			{
+				net_udp_noloss_client_give_up();
+				return;
 			}
 		}
+		net_udp_noloss_remove_queue_pkt(slot);
+	}
 
-		// Check if we can remove that packet due to to it had no resend's or Timeout
-		if (needack==0 || (UDP_mdata_queue[queuec].pkt_initial_timestamp + UDP_TIMEOUT <= time))
+	// Each wheel slot is due at most once per turn of the wheel, so skip turns we missed entirely.
+	const fix64 current_tick = time / UDP_MDATA_WHEEL_TICK;
+	if (UDP_mdata_wheel_tick + UDP_MDATA_WHEEL_SIZE <= current_tick)
+		UDP_mdata_wheel_tick = current_tick - UDP_MDATA_WHEEL_SIZE + 1;
+	for (;; ++UDP_mdata_wheel_tick)
+	{
+		for (unsigned slot = UDP_mdata_wheel[UDP_mdata_wheel_tick % UDP_MDATA_WHEEL_SIZE].head; slot != UDP_MDATA_STOR_QUEUE_SIZE;)
 		{
-			if (needack) // packet timed out but still not all have ack'd.
+			auto &e = UDP_mdata_queue[slot];
+			const unsigned next = e.wheel_next;
+			// Resend if enough time has passed. Packets in this slot for a later turn of the wheel stay.
+			if (e.pkt_timestamp + UDP_MDATA_RESEND_TIME <= time)
 			{
-				if (multi_i_am_master()) // We are host, so we kick the remaining players.
-				{
-					for ( int plc=1; plc<N_players; plc++ )
-						if (UDP_mdata_queue[queuec].player_ack[plc] == 0)
-							multi::udp::dispatch->kick_player(Netgame.players[plc].protocol.udp.addr, DUMP_PKTTIMEOUT);
-				}
-				else // We are client, so we gotta go.
+				net_udp_noloss_drop_absent_players(e);
+				if (e.player_ack_pending.none())
+					net_udp_noloss_remove_queue_pkt(slot);
+				else
 				{
-					Netgame.PacketLossPrevention = 0; // Disable PLP - otherwise we get stuck in an infinite loop here. NOTE: We could as well clean the whole queue to continue protect our disconnect signal bit it's not that important - we just wanna leave.
-					const auto g = Game_wind;
-					if (g)
-						g->set_visible(0);
-					nm_messagebox_str(menu_title{nullptr}, nm_messagebox_tie(TXT_OK), menu_subtitle{"You left the game. You failed\nsending important packets.\nSorry."});
-					if (g)
-						g->set_visible(1);
-					multi_quit_game = 1;
-					game_leave_menus();
+					net_udp_noloss_wheel_unlink(slot);
+					e.pkt_timestamp = time;
+					net_udp_noloss_wheel_link(slot);
+					for (unsigned plc = 0; plc < MAX_PLAYERS; ++plc)
+					{
+						if (!e.player_ack_pending.test(plc))
+							continue;
+						ubyte buf[sizeof(UDP_mdata_info)];
+						int len = 0;
+
+						con_printf(CON_VERBOSE, "P#%u: Resending pkt_num %i from pnum %i to pnum %i",Player_num, e.pkt_num[plc], e.Player_num, plc);
+
+						// Prepare the packet and send it
+						buf[len] = UPID_MDATA_PNEEDACK;													len++;
+						buf[len] = e.Player_num;								len++;
+						PUT_INTEL_INT(buf + len, e.pkt_num[plc]);					len += 4;
+						memcpy(&buf[len], e.data.data(), sizeof(char)*e.data_size);
+																									len += e.data_size;
+						net_udp_bundle_send(plc, buf, len);
+						net_udp_telemetry_out(plc, buf, len, true);
+						total_len += len;
+					}
+					// Send up to half our max packet size. The rest of this slot is still due next frame.
+					if (total_len >= (UPID_MAX_SIZE/2))
+						return;
 				}
 			}
-			con_printf(CON_VERBOSE, "P#%u: Removing stored pkt_num [%i,%i,%i,%i,%i,%i,%i,%i] - missing ACKs: %i",Player_num, UDP_mdata_queue[queuec].pkt_num[0],UDP_mdata_queue[queuec].pkt_num[1],UDP_mdata_queue[queuec].pkt_num[2],UDP_mdata_queue[queuec].pkt_num[3],UDP_mdata_queue[queuec].pkt_num[4],UDP_mdata_queue[queuec].pkt_num[5],UDP_mdata_queue[queuec].pkt_num[6],UDP_mdata_queue[queuec].pkt_num[7], needack); // Just *marked* for removal. The actual process happens further below.
-			UDP_mdata_queue[queuec].used = 0;
+			slot = next;
 		}
-
-		// Send up to half our max packet size
-		if (total_len >= (UPID_MAX_SIZE/2))
+		// The current slot may still get due packets, so look at it again next frame.
+		if (UDP_mdata_wheel_tick >= current_tick)
 			break;
 	}
-
-	// Now that we are done processing the queue, actually remove all unused packets from the top of the list.
-	while (!UDP_mdata_queue[0].used && UDP_mdata_queue_highest > 0)
-	{
-		std::move(std::next(UDP_mdata_queue.begin()), UDP_mdata_queue.end(), UDP_mdata_queue.begin());
-		UDP_mdata_queue[UDP_MDATA_STOR_QUEUE_SIZE - 1] = {};
-		UDP_mdata_queue_highest--;
-	}
 }
 /* CODE FOR PACKET LOSS PREVENTION - END */
 
-void net_udp_send_mdata_direct(const ubyte *data, int data_len, int pnum, int needack)
+/* CODE FOR PACKET BUNDLING - START */
+/*
+ * Hosting providers limit packets per second rather than bytes, so all PDATA, MDATA and ACK packets for one peer are collected during a network frame and sent as one UPID_BUNDLE datagram.
+ * Bundling is only used towards a peer after it sent us a UPID_BUNDLE of our UPID_BUNDLE_VERSION. Until then, that peer gets plain packets and an empty bundle once per second as an offer.
+ * Builds which do not know UPID_BUNDLE ignore the offer, so they keep getting plain packets.
+ */
+static void net_udp_bundle_flush(unsigned pnum)
 {
-	ubyte buf[sizeof(UDP_mdata_info)];
-	ubyte pack[MAX_PLAYERS];
-	int len = 0;
-	
-	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
+	auto &b = UDP_bundle[pnum];
+	if (!b.count)
 		return;
+	net_udp_telemetry_out(pnum, b.buf.data(), b.len, false);
+	dxx_sendto(Netgame.players[pnum].protocol.udp.addr, UDP_Socket[0], b.buf.data(), b.len, 0);
+	b.count = 0;
+	b.len = 0;
+}
 
-	if (!(data_len > 0))
+/* Send a packet to a player, either as part of the bundle for this frame or on its own if that player cannot read bundles. */
+void net_udp_bundle_send(unsigned pnum, const uint8_t *data, uint_fast32_t data_len)
+{
+	auto &b = UDP_bundle[pnum];
+	net_udp_telemetry_out(pnum, data, data_len, false);
+	if (!b.capable || data_len + 2 > b.buf.size() - UPID_BUNDLE_HEADER_SIZE)
+	{
+		// keep the order of packets sent to this player
+		net_udp_bundle_flush(pnum);
+		dxx_sendto(Netgame.players[pnum].protocol.udp.addr, UDP_Socket[0], data, data_len, 0);
 		return;
-
-	if (!multi_i_am_master() && pnum != 0)
-		Error("Client sent direct data to non-Host in net_udp_send_mdata_direct()!\n");
-
-	if (!Netgame.PacketLossPrevention)
-		needack = 0;
-
-	memset(&buf, 0, sizeof(UDP_mdata_info));
-	memset(&pack, 1, sizeof(ubyte)*MAX_PLAYERS);
-
-	pack[pnum] = 0;
-
-	if (needack)
-		buf[len] = UPID_MDATA_PNEEDACK;
-	else
-		buf[len] = UPID_MDATA_PNORM;
-														len++;
-	buf[len] = Player_num;											len++;
-	if (needack)
+	}
+	if (!udp_bundle_append(b.buf, b.len, UPID_BUNDLE_FEATURE_PDATA_DELTA, data, data_len))
 	{
-		PUT_INTEL_INT(buf + len, UDP_mdata_trace[pnum].pkt_num_tosend);					len += 4;
+		net_udp_bundle_flush(pnum);
+		udp_bundle_append(b.buf, b.len, UPID_BUNDLE_FEATURE_PDATA_DELTA, data, data_len);
 	}
-	memcpy(&buf[len], data, sizeof(char)*data_len);								len += data_len;
-
-	dxx_sendto(Netgame.players[pnum].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
-
-	if (needack)
-		net_udp_noloss_add_queue_pkt(timer_query(), data, data_len, Player_num, pack);
+	b.count++;
+	UDP_num_bundled++;
 }
 
-void net_udp_send_mdata(int needack, fix64 time)
+/* Send everything collected this frame. */
+void net_udp_bundle_flush_all()
 {
-	ubyte buf[sizeof(UDP_mdata_info)];
-	ubyte pack[MAX_PLAYERS];
-	int len = 0;
-	
-	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
+	if (!UDP_Socket[0])
+		return;
+#ifdef DXX_HAVE_RECVMMSG
+	std::array<mmsghdr, MAX_PLAYERS> msgs;
+	std::array<iovec, MAX_PLAYERS> iov;
+	unsigned count = 0;
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		auto &b = UDP_bundle[i];
+		if (!b.count)
+			continue;
+		dxx_prepare_sendmmsg(Netgame.players[i].protocol.udp.addr, msgs[count], iov[count], b.buf.data(), b.len);
+		net_udp_telemetry_out(i, b.buf.data(), b.len, false);
+		count++;
+	}
+	dxx_sendmmsg(UDP_Socket[0], msgs.data(), count);
+	for (auto &b : UDP_bundle)
+	{
+		b.count = 0;
+		b.len = 0;
+	}
+#else
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+		net_udp_bundle_flush(i);
+#endif
+}
+
+/* Offer bundling to every peer we talk to which has not offered it to us. */
+void net_udp_bundle_announce()
+{
+	std::array<uint8_t, UPID_BUNDLE_HEADER_SIZE> buf{{UPID_BUNDLE, UPID_BUNDLE_VERSION, UPID_BUNDLE_FEATURE_PDATA_DELTA}};
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (i == Player_num || UDP_bundle[i].capable || vcplayerptr(i)->connected == CONNECT_DISCONNECTED)
+			continue;
+		if (!multi_i_am_master() && i > 0) // Clients only talk to the host.
+			break;
+		dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], buf, 0);
+	}
+}
+
+void net_udp_bundle_clear_peer(unsigned pnum)
+{
+	UDP_bundle[pnum].capable = 0;
+	UDP_bundle[pnum].features = 0;
+	UDP_bundle[pnum].count = 0;
+	UDP_bundle[pnum].len = 0;
+}
+
+/* We got a bundle. Remember the sender can read them, too, and process each packet in it as if it arrived on its own. */
+void net_udp_process_bundle(uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	if (!(Game_mode & GM_NETWORK) || data_len < UPID_BUNDLE_HEADER_SIZE || data[1] != UPID_BUNDLE_VERSION)
+		return;
+
+	unsigned pnum = 0;
+	if (multi_i_am_master())
+	{
+		for (pnum = 1; pnum < MAX_PLAYERS; ++pnum)
+			if (vcplayerptr(pnum)->connected != CONNECT_DISCONNECTED && sender_addr == Netgame.players[pnum].protocol.udp.addr)
+				break;
+		if (pnum == MAX_PLAYERS)
+			return;
+	}
+	else if (sender_addr != Netgame.players[0].protocol.udp.addr)
+		return;
+	UDP_bundle[pnum].capable = 1;
+	UDP_bundle[pnum].features = data[2];
+
+	udp_bundle_for_each(data, data_len, [&sender_addr](uint8_t *const packet, const std::size_t packet_len) {
+		switch (packet[0])
+		{
+			case UPID_PDATA:
+			case UPID_MDATA_PNORM:
+			case UPID_MDATA_PNEEDACK:
+			case UPID_MDATA_ACK:
+			case UPID_PDATA_DELTA:
+			case UPID_PDATA_ACK:
+			case UPID_STATE_HASH:
+				net_udp_process_packet(packet, sender_addr, packet_len);
+				break;
+			default:
+				con_printf(CON_DEBUG, "unexpected packet type in bundle - type %i", packet[0]);
+				break;
+		}
+	});
+}
+/* CODE FOR PACKET BUNDLING - END */
+
+/* CODE FOR TELEMETRY - START */
+/*
+ * Bytes, packets and resends of the game traffic by type and by peer, to tune PacketsPerSec and to find chatty multi messages.
+ * Outgoing packets are counted when they are given to net_udp_bundle_send, incoming ones when they are processed. The MULTI_* messages in MDATA packets are counted by their own type, too.
+ * A bundle is counted as UPID_BUNDLE and again as the packets in it, so the totals of each peer and the overlay leave UPID_BUNDLE out. The overlay only ranks packet types, since the messages are already in their MDATA packets.
+ * The console command net_stats shows the totals since the last reset, turns the overlay on or off and writes the counters to netstats.csv every few seconds.
+ */
+namespace {
+
+enum class UDP_telemetry_kind : uint8_t
+{
+	packet,
+	message,
+};
+
+enum class UDP_telemetry_dir : uint8_t
+{
+	out,
+	in,
+};
+
+constexpr std::array<const char *, 29> UDP_packet_name{{
+	nullptr,
+	"UPID_VERSION_DENY",
+	"UPID_GAME_INFO_REQ",
+	"UPID_GAME_INFO",
+	"UPID_GAME_INFO_LITE_REQ",
+	"UPID_GAME_INFO_LITE",
+	"UPID_DUMP",
+	"UPID_ADDPLAYER",
+	"UPID_REQUEST",
+	"UPID_QUIT_JOINING",
+	"UPID_SYNC",
+	"UPID_OBJECT_DATA",
+	"UPID_PING",
+	"UPID_PONG",
+	"UPID_ENDLEVEL_H",
+	"UPID_ENDLEVEL_C",
+	"UPID_PDATA",
+	"UPID_MDATA_PNORM",
+	"UPID_MDATA_PNEEDACK",
+	"UPID_MDATA_ACK",
+	"UPID_BUNDLE",
+	"UPID_TRACKER_REGISTER",
+	"UPID_TRACKER_REMOVE",
+	"UPID_TRACKER_REQGAMES",
+	"UPID_TRACKER_GAMEINFO",
+	"UPID_TRACKER_ACK",
+	"UPID_TRACKER_HOLEPUNCH",
+	"UPID_PDATA_DELTA",
+	"UPID_PDATA_ACK",
+}};
+
+}
+
+static std::array<std::array<UDP_telemetry_table, 2>, 2> UDP_telemetry; // [kind][direction], since the last reset
+static std::array<std::array<UDP_telemetry_table, 2>, 2> UDP_telemetry_csv_base; // UDP_telemetry at the last CSV dump
+static std::array<UDP_telemetry_counter, UDP_TELEMETRY_TYPES> UDP_telemetry_second; // [type] of packets, totals at the start of this second
+static fix64 UDP_telemetry_reset_time, UDP_telemetry_second_time, UDP_telemetry_csv_time;
+static unsigned UDP_telemetry_csv_interval; // seconds between dumps to netstats.csv, 0 for none
+uint8_t UDP_telemetry_overlay;
+std::array<UDP_telemetry_rate, UDP_TELEMETRY_TOP> UDP_telemetry_top;
+unsigned UDP_telemetry_top_count;
+
+static const char *net_udp_telemetry_name(const UDP_telemetry_kind kind, const unsigned type)
+{
+	const char *name = kind == UDP_telemetry_kind::message
+		? multi_message_name(type)
+		: (type < UDP_packet_name.size() ? UDP_packet_name[type] : nullptr);
+	return name ? name : "?";
+}
+
+static void net_udp_telemetry_count(const UDP_telemetry_kind kind, const UDP_telemetry_dir dir, const unsigned peer, const unsigned type, const uint_fast32_t len, const bool resend)
+{
+	if (type >= UDP_TELEMETRY_TYPES || peer >= UDP_TELEMETRY_PEERS)
+		return;
+	auto &c = UDP_telemetry[static_cast<unsigned>(kind)][static_cast<unsigned>(dir)][peer][type];
+	if (resend)
+		c.resends++;
+	else
+	{
+		c.packets++;
+		c.bytes += len;
+	}
+}
+
+/* Count each multi message in an MDATA packet. */
+static void net_udp_telemetry_count_mdata(const UDP_telemetry_dir dir, const unsigned peer, const uint8_t *const data, const uint_fast32_t data_len, const bool resend)
+{
+	for (uint_fast32_t len = data[0] == UPID_MDATA_PNEEDACK ? 6 : 2; len < data_len;)
+	{
+		const uint8_t type = data[len];
+		const unsigned sub_len = multi_message_length(type);
+		if (!sub_len || sub_len > data_len - len)
+			break;
+		net_udp_telemetry_count(UDP_telemetry_kind::message, dir, peer, type, sub_len, resend);
+		len += sub_len;
+	}
+}
+
+static void net_udp_telemetry_out(const unsigned pnum, const uint8_t *const data, const uint_fast32_t data_len, const bool resend)
+{
+	net_udp_telemetry_count(UDP_telemetry_kind::packet, UDP_telemetry_dir::out, pnum, data[0], data_len, resend);
+	if (data[0] == UPID_MDATA_PNORM || data[0] == UPID_MDATA_PNEEDACK)
+		net_udp_telemetry_count_mdata(UDP_telemetry_dir::out, pnum, data, data_len, resend);
+}
+
+static void net_udp_telemetry_in(const _sockaddr &sender_addr, const uint8_t *const data, const uint_fast32_t data_len)
+{
+	unsigned peer = MAX_PLAYERS;
+	if (Game_mode & GM_NETWORK)
+		for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+			if (i != Player_num && sender_addr == Netgame.players[i].protocol.udp.addr)
+			{
+				peer = i;
+				break;
+			}
+	net_udp_telemetry_count(UDP_telemetry_kind::packet, UDP_telemetry_dir::in, peer, data[0], data_len, false);
+	if (data[0] == UPID_MDATA_PNORM || data[0] == UPID_MDATA_PNEEDACK)
+		net_udp_telemetry_count_mdata(UDP_telemetry_dir::in, peer, data, data_len, false);
+}
+
+static void net_udp_telemetry_reset()
+{
+	UDP_telemetry = {};
+	UDP_telemetry_csv_base = {};
+	UDP_telemetry_second = {};
+	UDP_telemetry_top_count = 0;
+	UDP_telemetry_reset_time = UDP_telemetry_second_time = UDP_telemetry_csv_time = timer_query();
+}
+
+/* Append every counter which changed since the last dump to netstats.csv. */
+static void net_udp_telemetry_write_csv(const fix64 time)
+{
+	const auto exists = PHYSFS_exists("netstats.csv");
+	RAIIPHYSFS_File fp{PHYSFS_openAppend("netstats.csv")};
+	if (!fp)
+	{
+		con_printf(CON_URGENT, "net_stats: cannot write netstats.csv, not dumping any more");
+		UDP_telemetry_csv_interval = 0;
+		return;
+	}
+	if (!exists)
+		PHYSFSX_printf(fp, "seconds,kind,direction,peer,type,packets,bytes,resends\n");
+	const auto seconds = static_cast<double>(time - UDP_telemetry_reset_time) / F1_0;
+	for (unsigned kind = 0; kind < 2; ++kind)
+		for (unsigned dir = 0; dir < 2; ++dir)
+			for (unsigned peer = 0; peer < UDP_TELEMETRY_PEERS; ++peer)
+				for (unsigned type = 0; type < UDP_TELEMETRY_TYPES; ++type)
+				{
+					const auto &c = UDP_telemetry[kind][dir][peer][type];
+					const auto &b = UDP_telemetry_csv_base[kind][dir][peer][type];
+					if (c.packets == b.packets && c.resends == b.resends)
+						continue;
+					PHYSFSX_printf(fp, "%.1f,%s,%s,%u,%s,%u,%u,%u\n", seconds, kind ? "message" : "packet", dir ? "in" : "out", peer, net_udp_telemetry_name(static_cast<UDP_telemetry_kind>(kind), type), c.packets - b.packets, c.bytes - b.bytes, c.resends - b.resends);
+				}
+	UDP_telemetry_csv_base = UDP_telemetry;
+}
+
+/* Once a second, find the busiest types for the overlay and write the CSV dump if one is due. */
+static void net_udp_telemetry_frame(const fix64 time)
+{
+	if (time < UDP_telemetry_second_time + F1_0)
+		return;
+	UDP_telemetry_second_time = time;
+	std::array<UDP_telemetry_rate, UDP_TELEMETRY_TYPES> rates;
+	unsigned count = 0;
+	constexpr auto kind = static_cast<unsigned>(UDP_telemetry_kind::packet);
+	for (unsigned type = 0; type < UDP_TELEMETRY_TYPES; ++type)
+	{
+		if (type == UPID_BUNDLE)
+			continue;
+		UDP_telemetry_counter total{};
+		for (auto &d : UDP_telemetry[kind])
+			for (auto &p : d)
+			{
+				total.packets += p[type].packets;
+				total.bytes += p[type].bytes;
+				total.resends += p[type].resends;
+			}
+		auto &last = UDP_telemetry_second[type];
+		if (total.packets != last.packets || total.resends != last.resends)
+			rates[count++] = {net_udp_telemetry_name(UDP_telemetry_kind::packet, type), total.packets - last.packets, total.bytes - last.bytes, total.resends - last.resends};
+		last = total;
+	}
+	UDP_telemetry_top_count = std::min<unsigned>(count, UDP_TELEMETRY_TOP);
+	std::partial_sort(rates.begin(), rates.begin() + UDP_telemetry_top_count, rates.begin() + count, [](const UDP_telemetry_rate &a, const UDP_telemetry_rate &b) { return a.bytes > b.bytes; });
+	std::copy_n(rates.begin(), UDP_telemetry_top_count, UDP_telemetry_top.begin());
+	if (UDP_telemetry_csv_interval && time >= UDP_telemetry_csv_time + UDP_telemetry_csv_interval * F1_0)
+	{
+		UDP_telemetry_csv_time = time;
+		net_udp_telemetry_write_csv(time);
+	}
+}
+
+/* Print the totals of each type, or of each type for one peer, and of each peer. */
+static void net_udp_telemetry_print(const unsigned only_peer)
+{
+	const auto seconds = static_cast<double>(timer_query() - UDP_telemetry_reset_time) / F1_0;
+	con_printf(CON_NORMAL, "net_stats: %.1f seconds%s", seconds, only_peer < UDP_TELEMETRY_PEERS ? " for one peer" : "");
+	con_printf(CON_NORMAL, "%-28s %10s %8s %10s %8s %7s", "type", "out bytes", "out pkts", "in bytes", "in pkts", "resent");
+	for (unsigned kind = 0; kind < 2; ++kind)
+		for (unsigned type = 0; type < UDP_TELEMETRY_TYPES; ++type)
+		{
+			std::array<UDP_telemetry_counter, 2> total{};
+			for (unsigned dir = 0; dir < 2; ++dir)
+				for (unsigned peer = 0; peer < UDP_TELEMETRY_PEERS; ++peer)
+				{
+					if (only_peer < UDP_TELEMETRY_PEERS && peer != only_peer)
+						continue;
+					auto &c = UDP_telemetry[kind][dir][peer][type];
+					total[dir].packets += c.packets;
+					total[dir].bytes += c.bytes;
+					total[dir].resends += c.resends;
+				}
+			if (!total[0].packets && !total[1].packets)
+				continue;
+			con_printf(CON_NORMAL, "%-28s %10u %8u %10u %8u %7u", net_udp_telemetry_name(static_cast<UDP_telemetry_kind>(kind), type), total[0].bytes, total[0].packets, total[1].bytes, total[1].packets, total[0].resends);
+		}
+	if (only_peer < UDP_TELEMETRY_PEERS)
+		return;
+	for (unsigned peer = 0; peer < UDP_TELEMETRY_PEERS; ++peer)
+	{
+		std::array<UDP_telemetry_counter, 2> total{};
+		for (unsigned dir = 0; dir < 2; ++dir)
+			for (auto &&[type, c] : enumerate(UDP_telemetry[static_cast<unsigned>(UDP_telemetry_kind::packet)][dir][peer]))
+			{
+				// the packets in a bundle are counted by their own type
+				if (type == UPID_BUNDLE)
+					continue;
+				total[dir].packets += c.packets;
+				total[dir].bytes += c.bytes;
+				total[dir].resends += c.resends;
+			}
+		if (!total[0].packets && !total[1].packets)
+			continue;
+		con_printf(CON_NORMAL, "peer %u %-21s %10u %8u %10u %8u %7u", peer, peer < MAX_PLAYERS ? static_cast<const char *>(Netgame.players[peer].callsign) : "(not in game)", total[0].bytes, total[0].packets, total[1].bytes, total[1].packets, total[0].resends);
+	}
+}
+
+static void net_udp_telemetry_cmd(unsigned long argc, const char *const *const argv)
+{
+	if (argc < 2)
+		net_udp_telemetry_print(UDP_TELEMETRY_PEERS);
+	else if (!d_stricmp(argv[1], "reset"))
+		net_udp_telemetry_reset();
+	else if (!d_stricmp(argv[1], "overlay"))
+		UDP_telemetry_overlay = argc > 2 ? !!atoi(argv[2]) : !UDP_telemetry_overlay;
+	else if (!d_stricmp(argv[1], "csv"))
+	{
+		UDP_telemetry_csv_interval = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+		UDP_telemetry_csv_time = timer_query();
+		UDP_telemetry_csv_base = UDP_telemetry;
+		if (UDP_telemetry_csv_interval)
+			con_printf(CON_NORMAL, "net_stats: writing netstats.csv every %u seconds", UDP_telemetry_csv_interval);
+	}
+	else if (const auto peer = strtoul(argv[1], nullptr, 10); peer < UDP_TELEMETRY_PEERS && isdigit(static_cast<unsigned char>(argv[1][0])))
+		net_udp_telemetry_print(peer);
+	else
+		cmd_insertf("help %s", argv[0]);
+}
+
+void net_udp_telemetry_init()
+{
+	cmd_addcommand("net_stats", net_udp_telemetry_cmd, "net_stats [<peer>|reset|overlay [0|1]|csv <seconds>]\n"
+		"    show bytes, packets and resends of the network game traffic by type, for all peers or one\n"
+		"    reset: start counting again\n"
+		"    overlay: show the busiest packet types of the last second in the game\n"
+		"    csv: append the counters to netstats.csv every <seconds>, or stop with 0");
+	net_udp_telemetry_reset();
+}
+/* CODE FOR TELEMETRY - END */
+
+/* CODE FOR INTEREST MANAGEMENT - START */
+/*
+ * In co-op games on big levels, robot positions are most of what the host sends. With -udp_interest, the host sends the position of a robot to a player at most every UDP_INTEREST_FAR_INTERVAL, unless the robot is near that player:
+ * at most UDP_INTEREST_DEPTH segments away, counting through every connection like the automap does, or closer than UDP_INTEREST_DISTANCE.
+ * Only MULTI_ROBOT_POSITION in MDATA sent without ACK is filtered. Everything else, such as kills, doors and robot fire, still goes to every player.
+ */
+namespace {
+
+struct UDP_interest_peer
+{
+	segnum_t depth_segnum;				// segment of the player the depths were computed for, segment_none if none
+	segment_depth_array_t depth;			// distance in segments from the player plus one, 0 if not reached
+	std::array<fix64, MAX_OBJECTS> robot_sent;	// when this player last got the position of each robot
+};
+
+}
+
+static std::array<UDP_interest_peer, MAX_PLAYERS> UDP_interest;
+
+static void net_udp_interest_clear()
+{
+	for (auto &i : UDP_interest)
+	{
+		i.depth_segnum = segment_none;
+		i.robot_sent = {};
+	}
+}
+
+/* Returns whether the player of interest gets this MULTI_ROBOT_POSITION now. */
+static bool net_udp_interest_wanted(UDP_interest_peer &interest, const object_base &plrobj, const uint8_t *const msg, const fix64 time)
+{
+	auto &Objects = LevelUniqueObjectState.Objects;
+	const auto objnum = objnum_remote_to_local(GET_INTEL_SHORT(&msg[2]), static_cast<int8_t>(msg[4]));
+	if (objnum >= MAX_OBJECTS || objnum > Objects.get_count() - 1)
+		return true;
+	const auto &robot = *Objects.vcptr(objnum);
+	auto &sent = interest.robot_sent[objnum];
+	const unsigned depth = robot.segnum < interest.depth.size() ? interest.depth[robot.segnum] : 0;
+	if (sent > time || time - sent >= UDP_INTEREST_FAR_INTERVAL || (depth && depth <= UDP_INTEREST_DEPTH + 1) || vm_vec_dist_quick(robot.pos, plrobj.pos) < UDP_INTEREST_DISTANCE)
+	{
+		sent = time;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Copy an MDATA packet for player pnum to out, without the positions of robots that player does not need now.
+ * Returns the length of the copy, which is only the header if nothing is left.
+ */
+static unsigned net_udp_interest_filter(const unsigned pnum, const uint8_t *const data, const unsigned data_len, uint8_t *const out, const fix64 time)
+{
+	auto &Objects = LevelUniqueObjectState.Objects;
+	const auto &plrobj = *Objects.vcptr(vcplayerptr(pnum)->objnum);
+	auto &interest = UDP_interest[pnum];
+	if (interest.depth_segnum != plrobj.segnum)
+	{
+		interest.depth = {};
+		set_segment_depths(plrobj.segnum, nullptr, interest.depth);
+		interest.depth_segnum = plrobj.segnum;
+	}
+	const unsigned header = data[0] == UPID_MDATA_PNEEDACK ? 6 : 2;
+	memcpy(out, data, header);
+	unsigned len = header;
+	for (unsigned pos = header; pos < data_len;)
+	{
+		const uint8_t type = data[pos];
+		const unsigned sub_len = multi_message_length(type);
+		if (!sub_len || sub_len > data_len - pos)
+		{
+			// leave anything we cannot read to the receiver
+			memcpy(&out[len], &data[pos], data_len - pos);
+			len += data_len - pos;
+			break;
+		}
+		if (type != MULTI_ROBOT_POSITION || net_udp_interest_wanted(interest, plrobj, &data[pos], time))
+		{
+			memcpy(&out[len], &data[pos], sub_len);
+			len += sub_len;
+		}
+		pos += sub_len;
+	}
+	return len;
+}
+
+/* Send an MDATA packet without ACK to player pnum, filtered if -udp_interest is on. */
+static void net_udp_interest_send_mdata(const unsigned pnum, const uint8_t *const data, const unsigned data_len, const fix64 time)
+{
+	if (!CGameArg.MplUdpInterest || !(Game_mode & GM_MULTI_ROBOTS))
+	{
+		net_udp_bundle_send(pnum, data, data_len);
+		return;
+	}
+	std::array<uint8_t, UPID_MAX_SIZE> buf;
+	if (data_len > buf.size())
+		return;
+	const auto len = net_udp_interest_filter(pnum, data, data_len, buf.data(), time);
+	if (len > 2)
+		net_udp_bundle_send(pnum, buf.data(), len);
+}
+/* CODE FOR INTEREST MANAGEMENT - END */
+
+/* CODE FOR STATE HASHES - START */
+/*
+ * With -state_hash, every peer hashes the state every few seconds of the level time, and keeps the last STATE_HASH_HISTORY hashes.
+ * A player who joins a running game takes the level time from the host, so the intervals of every peer have the same numbers.
+ * Clients send theirs to the host, and the host sends its own to every client, so that both sides of a desync report it and dump what differs.
+ * A hash is compared with ours of the same interval, which may not exist yet when it arrives, since the peers are not exactly in step.
+ */
+static std::array<state_hash_source, MAX_PLAYERS> UDP_state_hash;
+static_assert(UPID_STATE_HASH_SIZE == 6 + 4 * state_hash_subsystems, "UPID_STATE_HASH_SIZE must fit every subsystem");
+
+static void net_udp_state_hash_clear()
+{
+	UDP_state_hash = {};
+}
+
+static void net_udp_state_hash_frame()
+{
+	uint32_t seq;
+	state_hash hash;
+	if (Network_status != NETSTAT_PLAYING || !state_hash_poll(seq, hash))
+		return;
+	std::array<uint8_t, UPID_STATE_HASH_SIZE> buf;
+	buf[0] = UPID_STATE_HASH;
+	buf[1] = Player_num;
+	PUT_INTEL_INT(&buf[2], seq);
+	for (std::size_t i = 0; i < hash.size(); ++i)
+		PUT_INTEL_INT(&buf[6 + 4 * i], hash[i]);
+	if (!multi_i_am_master())
+	{
+		net_udp_bundle_send(0, buf.data(), buf.size());
+		state_hash_match(UDP_state_hash[0], vcplayerptr(0u)->callsign);
+		return;
+	}
+	for (unsigned i = 1; i < N_players; ++i)
+	{
+		if (vcplayerptr(i)->connected != CONNECT_PLAYING)
+			continue;
+		net_udp_bundle_send(i, buf.data(), buf.size());
+		state_hash_match(UDP_state_hash[i], vcplayerptr(i)->callsign);
+	}
+}
+
+static void net_udp_process_state_hash(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	if (data_len != UPID_STATE_HASH_SIZE || Network_status != NETSTAT_PLAYING)
+		return;
+	const unsigned pnum = data[1];
+	if (pnum >= MAX_PLAYERS || (multi_i_am_master() ? pnum == 0 : pnum != 0))
+		return;
+	if (sender_addr != Netgame.players[pnum].protocol.udp.addr)
+		return;
+	auto &source = UDP_state_hash[pnum];
+	source.has_pending = true;
+	source.pending_seq = GET_INTEL_INT(&data[2]);
+	for (std::size_t i = 0; i < source.pending.size(); ++i)
+		source.pending[i] = GET_INTEL_INT(&data[6 + 4 * i]);
+	state_hash_match(source, vcplayerptr(pnum)->callsign);
+}
+/* CODE FOR STATE HASHES - END */
+
+/* CODE FOR SPECTATOR RELAY - START */
+/*
+ * With -udp_relay, a player of the game records it as a demo and sends the recording to spectators who watch with -udp_relay_watch.
+ * The relay joins as an observer: every peer keeps its ship a ghost, and it records the game as seen from the ship of a player. It keeps the demo, too.
+ * The recording is cut into entries: a header, where playback can start, and the frames which follow it, each as the difference to the frame before it.
+ * Every UDP_RELAY_KEYFRAME_INTERVAL the relay writes another header, so a spectator can start watching without the frames from the beginning of the game. Spectators already watching get only its sequence number.
+ * Spectators ask for the entry they need next every UDP_RELAY_SUBSCRIBE_INTERVAL, which is the ACK of everything before it. The relay sends again from there if that did not change for UDP_RELAY_RESEND_INTERVAL.
+ * A spectator subscribes with the cookie the relay answered its first request with, so the relay streams only to addresses which receive what it sends. It sends at most UDP_RELAY_MAX_UNACKED bytes beyond the last ACK.
+ * The spectator writes what it receives to UDP_RELAY_DEMO and plays it while it grows.
+ */
+namespace {
+
+// packets the relay sends each spectator in one frame at most
+constexpr unsigned UDP_relay_burst = 64;
+constexpr std::size_t UDP_relay_part_size = UPID_MAX_SIZE - UPID_RELAY_DATA_HEADER_SIZE;
+
+bool udp_relay_is_header(const udp_relay_kind kind)
+{
+	return kind == udp_relay_kind::keyframe || kind == udp_relay_kind::restart;
+}
+
+}
+
+static void net_udp_relay_push(const udp_relay_kind kind, const fix64 time, std::vector<uint8_t> data)
+{
+	UDP_relay.entries.push_back({++UDP_relay.seq, kind, time, std::move(data)});
+}
+
+namespace dsx {
+
+/* Move what the recording wrote since the last frame from the tap to the entries. */
+static void net_udp_relay_collect(const fix64 time)
+{
+	auto &r = UDP_relay;
+	auto &tap = r.tap;
+	if (tap.restarted)
+	{
+		tap.restarted = false;
+		const auto h = tap.header_end;
+		net_udp_relay_push(udp_relay_kind::restart, time, {tap.stream.begin(), std::next(tap.stream.begin(), h)});
+		tap.stream.erase(tap.stream.begin(), std::next(tap.stream.begin(), h));
+		tap.frame_end = tap.frame_end > h ? tap.frame_end - h : 0;
+		tap.header_end = 0;
+		r.prev_frame.clear();
+		r.last_keyframe = time;
+	}
+	if (!tap.frame_end)
+		return;
+	// Cut right after the header of the newest frame, so a spectator never reads a frame it does not have all of.
+	std::vector<uint8_t> frame(tap.stream.begin(), std::next(tap.stream.begin(), tap.frame_end));
+	tap.stream.erase(tap.stream.begin(), std::next(tap.stream.begin(), tap.frame_end));
+	tap.frame_end = 0;
+	std::vector<uint8_t> data;
+	delta_encode(r.prev_frame.data(), r.prev_frame.size(), frame.data(), frame.size(), data);
+	net_udp_relay_push(r.prev_frame.empty() ? udp_relay_kind::intra : udp_relay_kind::delta, time, std::move(data));
+	r.prev_frame = std::move(frame);
+	if (time >= r.last_keyframe + UDP_RELAY_KEYFRAME_INTERVAL && Newdemo_state == ND_STATE_RECORDING)
+	{
+		r.last_keyframe = time;
+		std::vector<uint8_t> header;
+		newdemo_relay_keyframe(header);
+		net_udp_relay_push(udp_relay_kind::keyframe, time, std::move(header));
+		r.prev_frame.clear();
+	}
+}
+
+}
+
+static void net_udp_relay_listen(const fix64 time)
+{
+	auto &r = UDP_relay;
+	std::array<uint8_t, UPID_MAX_SIZE> packet;
+	for (;;)
+	{
+		// zeroed, since the cookie covers all of it
+		_sockaddr sender_addr{};
+		const int size = udp_receive_packet(r.socket, packet.data(), packet.size(), &sender_addr);
+		if (size <= 0)
+			break;
+		if (size != UPID_RELAY_SUBSCRIBE_SIZE || packet[0] != UPID_RELAY_SUBSCRIBE || packet[1] != UDP_RELAY_VERSION)
+			continue;
+		const uint32_t cookie = udp_relay_cookie(r.secret, &sender_addr, sizeof(sender_addr));
+		if (GET_INTEL_INT(&packet[6]) != cookie)
+		{
+			/* Answer with the cookie, and nothing else until it comes
+			 * back.  The answer is smaller than the request, so a
+			 * forged sender gets less than it sent.
+			 */
+			std::array<uint8_t, UPID_RELAY_CHALLENGE_SIZE> buf;
+			buf[0] = UPID_RELAY_CHALLENGE;
+			buf[1] = UDP_RELAY_VERSION;
+			PUT_INTEL_INT(&buf[2], cookie);
+			dxx_sendto(sender_addr, r.socket, buf, 0);
+			continue;
+		}
+		const uint32_t want = GET_INTEL_INT(&packet[2]);
+		auto i = std::find_if(r.viewers.begin(), r.viewers.end(), [&sender_addr](const UDP_relay_viewer &v) { return v.addr == sender_addr; });
+		if (i == r.viewers.end())
+		{
+			if (r.viewers.size() >= UDP_RELAY_MAX_VIEWERS)
+				continue;
+			i = r.viewers.insert(i, UDP_relay_viewer{});
+			i->addr = sender_addr;
+			con_printf(CON_NORMAL, "relay: spectator %u started watching", static_cast<unsigned>(r.viewers.size()));
+		}
+		auto &v = *i;
+		v.last_heard = time;
+		if (want && !r.entries.empty() && want >= r.entries.front().seq && want <= r.seq + 1)
+		{
+			if (!v.started)
+			{
+				// a spectator the relay forgot, which still has what it asks for
+				v.started = true;
+				v.start = 0;
+				v.next = v.acked = want;
+				v.last_progress = time;
+			}
+			else if (want > v.acked)
+			{
+				v.acked = want;
+				v.last_progress = time;
+				if (v.next < want)
+					v.next = want;
+			}
+		}
+		/* The spectator needs a header.  Until the one the relay sent
+		 * could have arrived, this is an older request.
+		 */
+		else if (time >= v.last_progress + UDP_RELAY_RESEND_INTERVAL)
+			v.started = false;
+	}
+}
+
+static void net_udp_relay_send(const fix64 time)
+{
+	auto &r = UDP_relay;
+	const fix64 released = time - static_cast<fix64>(CGameArg.MplUdpRelayDelay) * F1_0;
+	const UDP_relay_entry *start = nullptr;
+	range_for (auto &e, r.entries)
+	{
+		if (e.time > released)
+			break;
+		if (udp_relay_is_header(e.kind))
+			start = &e;
+	}
+	std::array<uint8_t, UPID_MAX_SIZE> buf;
+	buf[0] = UPID_RELAY_DATA;
+	for (auto i = r.viewers.begin(); i != r.viewers.end();)
+	{
+		auto &v = *i;
+		if (time >= v.last_heard + UDP_RELAY_TIMEOUT)
+		{
+			con_puts(CON_NORMAL, "relay: a spectator stopped watching");
+			i = r.viewers.erase(i);
+			continue;
+		}
+		++i;
+		if (!v.started)
+		{
+			if (!start)
+				continue;
+			v.started = true;
+			v.start = v.next = v.acked = start->seq;
+			v.last_progress = time;
+		}
+		else if (v.next > v.acked && time >= v.last_progress + UDP_RELAY_RESEND_INTERVAL)
+		{
+			v.next = v.acked;
+			v.last_progress = time;
+		}
+		if (r.entries.empty())
+			continue;
+		const auto first = r.entries.front().seq;
+		// Other headers are only a sequence number to a spectator which is watching already.
+		const auto entry_size = [&v](const UDP_relay_entry &e) -> std::size_t {
+			return (e.kind == udp_relay_kind::keyframe && e.seq != v.start) ? 0 : e.data.size();
+		};
+		std::size_t unacked = 0;
+		for (auto s = std::max(v.acked, first); s < v.next && s <= r.seq; ++s)
+			unacked += entry_size(r.entries[s - first]);
+		for (unsigned budget = UDP_relay_burst; budget && v.next <= r.seq;)
+		{
+			const auto &e = r.entries[v.next - first];
+			if (e.time > released)
+				break;
+			const std::size_t size = entry_size(e);
+			const unsigned parts = (size + UDP_relay_part_size - 1) / UDP_relay_part_size;
+			if (parts > budget && budget < UDP_relay_burst)
+				break;
+			// An entry bigger than the limit still goes alone.
+			if (unacked && unacked + size > UDP_RELAY_MAX_UNACKED)
+				break;
+			unacked += size;
+			buf[1] = static_cast<uint8_t>(e.kind);
+			PUT_INTEL_INT(&buf[2], e.seq);
+			PUT_INTEL_SHORT(&buf[8], static_cast<uint16_t>(parts));
+			unsigned part = 0;
+			do {
+				const std::size_t offset = part * UDP_relay_part_size;
+				const std::size_t len = std::min(UDP_relay_part_size, size - offset);
+				PUT_INTEL_SHORT(&buf[6], static_cast<uint16_t>(part));
+				if (len)
+					memcpy(&buf[UPID_RELAY_DATA_HEADER_SIZE], &e.data[offset], len);
+				dxx_sendto(v.addr, r.socket, buf.data(), UPID_RELAY_DATA_HEADER_SIZE + len, 0);
+			} while (++part < parts);
+			budget -= std::min(budget, std::max(parts, 1u));
+			++v.next;
+		}
+	}
+	/* Keep the newest header spectators may start from, and what the
+	 * spectators watching already did not ACK.
+	 */
+	if (!start)
+		return;
+	uint32_t keep = start->seq;
+	range_for (auto &v, r.viewers)
+		if (v.started && v.acked < keep)
+			keep = v.acked;
+	while (!r.entries.empty() && r.entries.front().seq < keep)
+		r.entries.pop_front();
+}
+
+namespace dsx {
+
+/* The relay has no ship, so view the game from the player it follows
+ * while that one flies, otherwise from the next one in slot order.  With
+ * nobody flying, view it from the ghost of the relay, where it spawned.
+ */
+static void net_udp_relay_follow()
+{
+	if (Network_status != NETSTAT_PLAYING || Endlevel_sequence || !multi_is_observer(Player_num))
+		return;
+	auto &Objects = LevelUniqueObjectState.Objects;
+	auto &vcobjptr = Objects.vcptr;
+	auto &followed = UDP_relay.followed;
+	for (unsigned n = 0; n < N_players; ++n)
+	{
+		const unsigned pnum = (followed + n) % N_players;
+		auto &plr = *vcplayerptr(pnum);
+		if (plr.connected != CONNECT_PLAYING || multi_is_observer(pnum))
+			continue;
+		auto &obj = *vcobjptr(plr.objnum);
+		if (obj.type != OBJ_PLAYER)
+			continue;
+		followed = pnum;
+		Viewer = &obj;
+		return;
+	}
+	Viewer = ConsoleObject;
+}
+
+static void net_udp_relay_frame(const fix64 time)
+{
+	auto &r = UDP_relay;
+	if (!r.socket)
+	{
+		if (r.failed)
+			return;
+		if (udp_open_socket(r.socket, CGameArg.MplUdpRelayPort) < 0)
+		{
+			r.failed = true;
+			return;
+		}
+		con_printf(CON_NORMAL, "relay: sending the game to spectators on port %hu", CGameArg.MplUdpRelayPort);
+		try {
+			std::random_device rd;
+			r.secret = (uint64_t{rd()} << 32) | rd();
+		} catch (const std::exception &) {
+			/* A secret which can be guessed still keeps the relay
+			 * from streaming to spectators who asked by mistake.
+			 */
+			r.secret = timer_query();
+		}
+	}
+	Newdemo_relay_tap = &r.tap;
+	net_udp_relay_follow();
+	if (Newdemo_state == ND_STATE_NORMAL && Network_status == NETSTAT_PLAYING && Game_wind)
+		newdemo_start_recording();
+	net_udp_relay_collect(time);
+	net_udp_relay_listen(time);
+	net_udp_relay_send(time);
+}
+
+}
+
+static void net_udp_relay_close()
+{
+	Newdemo_relay_tap = nullptr;
+	auto &r = UDP_relay;
+	r.socket.reset();
+	r.failed = false;
+	r.tap = {};
+	r.entries.clear();
+	r.viewers.clear();
+	r.prev_frame.clear();
+}
+
+static void net_udp_relay_watch_write(const std::vector<uint8_t> &data)
+{
+	auto &w = UDP_relay_watch;
+	if (PHYSFS_write(w.file, data.data(), 1, data.size()) != static_cast<PHYSFS_sint64>(data.size()))
+	{
+		con_printf(CON_URGENT, "relay: cannot write " DEMO_DIR UDP_RELAY_DEMO ": %s", PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
+		w.file.reset();
+		w.next = 0;
+		return;
+	}
+	PHYSFS_flush(w.file);
+	w.written += data.size();
+}
+
+namespace dsx {
+
+static void net_udp_relay_watch_entry(const udp_relay_kind kind, const uint32_t seq, std::vector<uint8_t> &data)
+{
+	auto &w = UDP_relay_watch;
+	if (udp_relay_is_header(kind))
+	{
+		/* The file cannot start over while it is played.  The relay
+		 * sends the header again after playback stopped.
+		 */
+		if (Newdemo_state == ND_STATE_PLAYBACK)
+		{
+			w.restart = true;
+			return;
+		}
+		PHYSFS_mkdir(DEMO_DIR);
+		w.file = PHYSFSX_openWriteBuffered(DEMO_DIR UDP_RELAY_DEMO).first;
+		if (!w.file)
+		{
+			con_printf(CON_URGENT, "relay: cannot write " DEMO_DIR UDP_RELAY_DEMO ": %s", PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode()));
+			return;
+		}
+		w.written = 0;
+		w.frames = 0;
+		w.prev_frame.clear();
+		net_udp_relay_watch_write(data);
+		w.frame_end = {{w.written, w.written}};
+		w.next = seq + 1;
+		return;
+	}
+	std::vector<uint8_t> frame;
+	if (!delta_decode(w.prev_frame.data(), w.prev_frame.size(), data.data(), data.size(), frame))
+	{
+		con_puts(CON_URGENT, "relay: received a damaged frame, waiting for a new header");
+		w.next = 0;
+		return;
+	}
+	net_udp_relay_watch_write(frame);
+	if (!w.file)
+		return;
+	w.prev_frame = std::move(frame);
+	w.next = seq + 1;
+	++w.frames;
+	w.frame_end[0] = w.frame_end[1];
+	w.frame_end[1] = w.written;
+	// Playback must not reach the end of the file, where newdemo takes the file to be cut off.
+	if (Newdemo_state == ND_STATE_PLAYBACK)
+		Newdemo_live_end = w.frame_end[0];
+}
+
+static void net_udp_relay_watch_data(const uint8_t *const data, const std::size_t data_len)
+{
+	auto &w = UDP_relay_watch;
+	if (data_len < UPID_RELAY_DATA_HEADER_SIZE || w.restart)
+		return;
+	const auto kind = static_cast<udp_relay_kind>(data[1]);
+	const uint32_t seq = GET_INTEL_INT(&data[2]);
+	const unsigned part = GET_INTEL_SHORT(&data[6]);
+	const unsigned parts = GET_INTEL_SHORT(&data[8]);
+	if (kind > udp_relay_kind::delta)
+		return;
+	if (!parts)
+	{
+		// a header for other spectators
+		if (kind == udp_relay_kind::keyframe && w.file && seq == w.next)
+		{
+			w.prev_frame.clear();
+			++w.next;
+		}
+		return;
+	}
+	if (udp_relay_is_header(kind))
+	{
+		// A header which is not the next entry means the relay started this spectator over.
+		if (w.next && seq < w.next)
+			return;
+	}
+	else if (!w.next || !w.file || seq != w.next)
+		return;
+	if (part >= parts || data_len == UPID_RELAY_DATA_HEADER_SIZE)
+		return;
+	if (w.parts_seq != seq || w.parts.size() != parts)
+	{
+		w.parts_seq = seq;
+		w.parts.assign(parts, {});
+		w.parts_have = 0;
+	}
+	auto &p = w.parts[part];
+	if (!p.empty())
+		return;
+	p.assign(&data[UPID_RELAY_DATA_HEADER_SIZE], &data[data_len]);
+	if (++w.parts_have < parts)
+		return;
+	std::vector<uint8_t> entry;
+	range_for (auto &i, w.parts)
+		entry.insert(entry.end(), i.begin(), i.end());
+	w.parts.clear();
+	w.parts_seq = 0;
+	net_udp_relay_watch_entry(kind, seq, entry);
+}
+
+static void net_udp_relay_watch_pump()
+{
+	auto &w = UDP_relay_watch;
+	net_udp_async_poll();
+	if (!w.resolved)
+		return;
+	std::array<uint8_t, UPID_MAX_SIZE> packet;
+	_sockaddr sender_addr{};
+	for (int size; (size = udp_receive_packet(w.socket, packet.data(), packet.size(), &sender_addr)) > 0;)
+	{
+		if (packet[0] == UPID_RELAY_DATA)
+			net_udp_relay_watch_data(packet.data(), size);
+		else if (packet[0] == UPID_RELAY_CHALLENGE && size == UPID_RELAY_CHALLENGE_SIZE && packet[1] == UDP_RELAY_VERSION && sender_addr == w.relay_addr)
+		{
+			w.cookie = GET_INTEL_INT(&packet[2]);
+			// Subscribe with it now, rather than at the next interval.
+			w.last_subscribe = 0;
+		}
+	}
+	const fix64 time = timer_query();
+	if (time < w.last_subscribe + UDP_RELAY_SUBSCRIBE_INTERVAL)
+		return;
+	w.last_subscribe = time;
+	std::array<uint8_t, UPID_RELAY_SUBSCRIBE_SIZE> buf;
+	buf[0] = UPID_RELAY_SUBSCRIBE;
+	buf[1] = UDP_RELAY_VERSION;
+	PUT_INTEL_INT(&buf[2], w.file ? w.next : 0);
+	PUT_INTEL_INT(&buf[6], w.cookie);
+	dxx_sendto(w.relay_addr, w.socket, buf, 0);
+}
+
+static bool net_udp_relay_watch_ready()
+{
+	auto &w = UDP_relay_watch;
+	return w.file && w.frames >= UDP_RELAY_WATCH_PREROLL;
+}
+
+static int net_udp_relay_watch_poll(newmenu *, const d_event &event, const unused_newmenu_userdata_t *)
+{
+	if (!event_is_frame(event))
+		return 0;
+	net_udp_relay_watch_pump();
+	if (!UDP_relay_watch.resolved && !UDP_relay_watch.resolve_id)
+		return -2;
+	return net_udp_relay_watch_ready() ? -2 : 0;
+}
+
+/* Show a menu until enough of the game arrived to start playing it.
+ * Returns false if the user cancelled or the relay cannot be found.
+ */
+static bool net_udp_relay_watch_wait()
+{
+	auto &w = UDP_relay_watch;
+	if (w.restart)
+	{
+		w.restart = false;
+		w.file.reset();
+		w.frames = 0;
+	}
+	char text[96];
+	snprintf(text, sizeof(text), "Waiting for the game from\n%s", CGameArg.MplUdpRelayWatch.c_str());
+	std::array<newmenu_item, 1> m{{
+		newmenu_item::nm_item_text{text},
+	}};
+	for (int choice = 0; choice > -1 && !net_udp_relay_watch_ready() && (w.resolved || w.resolve_id);)
+	{
+		timer_update();
+		choice = newmenu_do2(menu_title{nullptr}, menu_subtitle{TXT_WAIT}, m, net_udp_relay_watch_poll, unused_newmenu_userdata);
+	}
+	if (!w.resolved)
+		nm_messagebox(menu_title{TXT_ERROR}, 1, TXT_OK, "Could not resolve address\n%s", CGameArg.MplUdpRelayWatch.c_str());
+	return net_udp_relay_watch_ready();
+}
+
+void net_udp_relay_watch()
+{
+	auto &w = UDP_relay_watch;
+	net_udp_init();
+	if (udp_open_socket(w.socket, 0) < 0)
+	{
+		net_udp_close();
+		return;
+	}
+	w.resolve_id = UDP_async.resolve(CGameArg.MplUdpRelayWatch.c_str(), CGameArg.MplUdpRelayPort, _sockaddr::address_family(), false);
+	do {
+		if (!net_udp_relay_watch_wait())
+			break;
+		Newdemo_live_end = w.frame_end[0];
+		newdemo_start_playback(UDP_RELAY_DEMO);
+		if (Newdemo_state != ND_STATE_PLAYBACK)
+		{
+			Newdemo_live_end = 0;
+			break;
+		}
+		while (window_get_front())
+			event_process();
+	} while (w.restart);
+	w = {};
+	net_udp_close();
+}
+
+window_event_result net_udp_relay_watch_frame()
+{
+	if (!UDP_relay_watch.socket)
+		return window_event_result::ignored;
+	net_udp_relay_watch_pump();
+	if (!UDP_relay_watch.restart)
+		return window_event_result::ignored;
+	newdemo_stop_playback();
+	return window_event_result::close;
+}
+
+}
+/* CODE FOR SPECTATOR RELAY - END */
+
+void net_udp_send_mdata_direct(const ubyte *data, int data_len, int pnum, int needack)
+{
+	ubyte buf[sizeof(UDP_mdata_info)];
+	ubyte pack[MAX_PLAYERS];
+	int len = 0;
+	
+	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
+		return;
+
+	if (!(data_len > 0))
+		return;
+
+	if (!multi_i_am_master() && pnum != 0)
+		Error("Client sent direct data to non-Host in net_udp_send_mdata_direct()!\n");
+
+	if (!Netgame.PacketLossPrevention)
+		needack = 0;
+
+	memset(&buf, 0, sizeof(UDP_mdata_info));
+	memset(&pack, 1, sizeof(ubyte)*MAX_PLAYERS);
+
+	pack[pnum] = 0;
+
+	if (needack)
+		buf[len] = UPID_MDATA_PNEEDACK;
+	else
+		buf[len] = UPID_MDATA_PNORM;
+														len++;
+	buf[len] = Player_num;											len++;
+	if (needack)
+	{
+		PUT_INTEL_INT(buf + len, UDP_mdata_trace[pnum].pkt_num_tosend);					len += 4;
+	}
+	memcpy(&buf[len], data, sizeof(char)*data_len);								len += data_len;
+
+	net_udp_bundle_send(pnum, buf, len);
+
+	if (needack)
+		net_udp_noloss_add_queue_pkt(timer_query(), data, data_len, Player_num, pack);
+}
+
+void net_udp_send_mdata(int needack, fix64 time)
+{
+	ubyte buf[sizeof(UDP_mdata_info)];
+	ubyte pack[MAX_PLAYERS];
+	int len = 0;
+	
+	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
 		return;
 
 	if (!(UDP_MData.mbuf_size > 0))
@@ -5477,8 +7012,12 @@ void net_udp_send_mdata(int needack, fix64 time)
 			if (vcplayerptr(i)->connected == CONNECT_PLAYING)
 			{
 				if (needack) // assign pkt_num
+				{
 					PUT_INTEL_INT(buf + 2, UDP_mdata_trace[i].pkt_num_tosend);
-				dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
+					net_udp_bundle_send(i, buf, len);
+				}
+				else
+					net_udp_interest_send_mdata(i, buf, len, time);
 				pack[i] = 0;
 			}
 		}
@@ -5487,7 +7026,7 @@ void net_udp_send_mdata(int needack, fix64 time)
 	{
 		if (needack) // assign pkt_num
 			PUT_INTEL_INT(buf + 2, UDP_mdata_trace[0].pkt_num_tosend);
-		dxx_sendto(Netgame.players[0].protocol.udp.addr, UDP_Socket[0], buf, len, 0);
+		net_udp_bundle_send(0, buf, len);
 		pack[0] = 0;
 	}
 	
@@ -5546,8 +7085,10 @@ void net_udp_process_mdata(uint8_t *data, uint_fast32_t data_len, const _sockadd
 				{
 					pack[i] = 0;
 					PUT_INTEL_INT(data + 2, UDP_mdata_trace[i].pkt_num_tosend);
+					net_udp_bundle_send(i, data, data_len);
 				}
-				dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], data, data_len, 0);
+				else
+					net_udp_interest_send_mdata(i, data, data_len, timer_query());
 				
 			}
 		}
@@ -5567,12 +7108,151 @@ void net_udp_process_mdata(uint8_t *data, uint_fast32_t data_len, const _sockadd
 	multi_process_bigdata(pnum, data+dataoffset, data_len-dataoffset );
 }
 
+/* CODE FOR POSITION DELTAS - START */
+/*
+ * If enabled with -udp_deltapos, position updates to peers which can read them are sent as UPID_PDATA_DELTA: the difference of each field to the newest state that peer ACK'd.
+ * Unchanged fields are left out. Differences in position, velocity and rotational velocity are rounded to 1/4096 of a unit. The sender keeps the rounded result as the state the receiver has, so the error does not add up.
+ * If no recent state was ACK'd, for example because of packet loss, the difference is taken to a zero state, which makes it a full update again.
+ */
+namespace {
+
+struct UDP_pdata_state
+{
+	uint16_t seq;				// 0 if unused
+	quaternionpos qpp;
+};
+
+struct UDP_pdata_stream
+{
+	uint16_t next_seq;			// seq of the next state we send, never 0
+	uint16_t acked_seq;			// newest state the receiver ACK'd, 0 if none
+	std::array<UDP_pdata_state, UDP_PDATA_HISTORY> sent;
+};
+
+}
+
+static std::array<std::array<UDP_pdata_stream, MAX_PLAYERS>, MAX_PLAYERS> UDP_pdata_send;	// [player the state belongs to][player we send it to]
+static std::array<std::array<UDP_pdata_state, UDP_PDATA_HISTORY>, MAX_PLAYERS> UDP_pdata_recv;	// [player the state belongs to]
+
+static pdata_delta_values pdata_delta_split(const quaternionpos &qpp)
+{
+	return {{
+		qpp.orient.w, qpp.orient.x, qpp.orient.y, qpp.orient.z,
+		qpp.pos.x, qpp.pos.y, qpp.pos.z,
+		qpp.segment,
+		qpp.vel.x, qpp.vel.y, qpp.vel.z,
+		qpp.rotvel.x, qpp.rotvel.y, qpp.rotvel.z,
+	}};
+}
+
+static void pdata_delta_join(quaternionpos &qpp, const pdata_delta_values &v)
+{
+	qpp.orient.w = static_cast<int16_t>(v[0]);
+	qpp.orient.x = static_cast<int16_t>(v[1]);
+	qpp.orient.y = static_cast<int16_t>(v[2]);
+	qpp.orient.z = static_cast<int16_t>(v[3]);
+	qpp.pos = {v[4], v[5], v[6]};
+	qpp.segment = static_cast<segnum_t>(v[7]);
+	qpp.vel = {v[8], v[9], v[10]};
+	qpp.rotvel = {v[11], v[12], v[13]};
+}
+
+/*
+ * Build a UPID_PDATA_DELTA of qpp against base, or against a zero state if there is no base.
+ * result gets the state the receiver will have after reading it.
+ */
+static unsigned net_udp_build_pdata_delta(std::array<uint8_t, UPID_PDATA_DELTA_SIZE_MAX> &buf, const unsigned pnum, const uint8_t connected, const uint16_t seq, const UDP_pdata_state *const base, const quaternionpos &qpp, quaternionpos &result)
+{
+	const auto &&from = base ? pdata_delta_split(base->qpp) : pdata_delta_values{};
+	pdata_delta_values rounded;
+	unsigned len = 0;
+
+	buf[len] = UPID_PDATA_DELTA;								len++;
+	buf[len] = pnum;									len++;
+	buf[len] = connected;									len++;
+	PUT_INTEL_SHORT(&buf[len], seq);							len += 2;
+	PUT_INTEL_SHORT(&buf[len], static_cast<uint16_t>(base ? base->seq : 0));		len += 2;
+	len += udp_write_pdata_delta(&buf[len], from, pdata_delta_split(qpp), rounded);
+	pdata_delta_join(result, rounded);
+	return len;
+}
+
+static int net_udp_read_pdata_delta(const uint8_t *data, uint_fast32_t data_len, const quaternionpos &base, quaternionpos &result)
+{
+	pdata_delta_values v;
+	if (data_len < UPID_PDATA_DELTA_HEADER_SIZE || !udp_read_pdata_delta(&data[UPID_PDATA_DELTA_HEADER_SIZE - 2], data_len - (UPID_PDATA_DELTA_HEADER_SIZE - 2), pdata_delta_split(base), v))
+		return 0;
+	pdata_delta_join(result, v);
+	return 1;
+}
+
+/* Forget every position state sent to or received from this player. */
+void net_udp_pdata_delta_clear_peer(unsigned pnum)
+{
+	range_for (auto &s, UDP_pdata_send)
+		s[pnum] = {};
+	UDP_pdata_send[pnum] = {};
+	UDP_pdata_recv[pnum] = {};
+}
+/* CODE FOR POSITION DELTAS - END */
+
+/* Send the position of player pnum to player dest, as UPID_PDATA_DELTA if we may and dest can read it, else as UPID_PDATA. */
+static void net_udp_send_pdata_to(const unsigned dest, const unsigned pnum, const uint8_t connected, const quaternionpos &qpp)
+{
+	unsigned len = 0;
+	if (CGameArg.MplUdpDeltaPos && (UDP_bundle[dest].features & UPID_BUNDLE_FEATURE_PDATA_DELTA))
+	{
+		auto &stream = UDP_pdata_send[pnum][dest];
+		if (!stream.next_seq)
+			stream.next_seq = 1;
+		const uint16_t seq = stream.next_seq;
+		if (!++stream.next_seq)
+			stream.next_seq = 1;
+		const UDP_pdata_state *base = nullptr;
+		if (stream.acked_seq && static_cast<uint16_t>(seq - stream.acked_seq) < UDP_PDATA_HISTORY)
+		{
+			auto &b = stream.sent[stream.acked_seq % UDP_PDATA_HISTORY];
+			if (b.seq == stream.acked_seq)
+				base = &b;
+		}
+		std::array<uint8_t, UPID_PDATA_DELTA_SIZE_MAX> buf;
+		auto &sent = stream.sent[seq % UDP_PDATA_HISTORY];
+		len = net_udp_build_pdata_delta(buf, pnum, connected, seq, base, qpp, sent.qpp);
+		sent.seq = seq;
+		net_udp_bundle_send(dest, buf.data(), len);
+	}
+	else
+	{
+		std::array<uint8_t, UPID_PDATA_SIZE> buf;
+		buf[len] = UPID_PDATA;									len++;
+		buf[len] = pnum;									len++;
+		buf[len] = connected;									len++;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.w);							len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.x);							len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.y);							len += 2;
+		PUT_INTEL_SHORT(&buf[len], qpp.orient.z);							len += 2;
+		PUT_INTEL_INT(&buf[len], qpp.pos.x);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.pos.y);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.pos.z);							len += 4;
+		PUT_INTEL_SHORT(&buf[len], qpp.segment);							len += 2;
+		PUT_INTEL_INT(&buf[len], qpp.vel.x);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.vel.y);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.vel.z);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.x);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.y);							len += 4;
+		PUT_INTEL_INT(&buf[len], qpp.rotvel.z);							len += 4; // 46 + 3 = 49
+		net_udp_bundle_send(dest, buf.data(), len);
+	}
+	UDP_len_pdata += len;
+	UDP_len_pdata_full += UPID_PDATA_SIZE;
+	UDP_len_pdata_game += len;
+	UDP_len_pdata_full_game += UPID_PDATA_SIZE;
+}
+
 void net_udp_send_pdata()
 {
 	auto &Objects = LevelUniqueObjectState.Objects;
 	auto &vmobjptr = Objects.vmptr;
-	std::array<uint8_t, 3 + quaternionpos::packed_size::value> buf;
-	int len = 0;
 
 	if (!(Game_mode&GM_NETWORK) || !UDP_Socket[0])
 		return;
@@ -5582,36 +7262,36 @@ void net_udp_send_pdata()
 	if ( !( Network_status == NETSTAT_PLAYING || Network_status == NETSTAT_ENDLEVEL ) )
 		return;
 
-	buf[len] = UPID_PDATA;									len++;
-	buf[len] = Player_num;									len++;
-	buf[len] = plr.connected;						len++;
-
 	quaternionpos qpp{};
 	create_quaternionpos(qpp, vmobjptr(plr.objnum));
-	PUT_INTEL_SHORT(&buf[len], qpp.orient.w);							len += 2;
-	PUT_INTEL_SHORT(&buf[len], qpp.orient.x);							len += 2;
-	PUT_INTEL_SHORT(&buf[len], qpp.orient.y);							len += 2;
-	PUT_INTEL_SHORT(&buf[len], qpp.orient.z);							len += 2;
-	PUT_INTEL_INT(&buf[len], qpp.pos.x);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.pos.y);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.pos.z);							len += 4;
-	PUT_INTEL_SHORT(&buf[len], qpp.segment);							len += 2;
-	PUT_INTEL_INT(&buf[len], qpp.vel.x);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.vel.y);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.vel.z);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.rotvel.x);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.rotvel.y);							len += 4;
-	PUT_INTEL_INT(&buf[len], qpp.rotvel.z);							len += 4; // 46 + 3 = 49
 
 	if (multi_i_am_master())
 	{
 		for (unsigned i = 1; i < MAX_PLAYERS; ++i)
 			if (vcplayerptr(i)->connected != CONNECT_DISCONNECTED)
-				dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], buf, 0);
+				net_udp_send_pdata_to(i, Player_num, plr.connected, qpp);
 	}
 	else
 	{
-		dxx_sendto(Netgame.players[0].protocol.udp.addr, UDP_Socket[0], buf, 0);
+		net_udp_send_pdata_to(0, Player_num, plr.connected, qpp);
+	}
+}
+
+/* I am host - must relay this position to others! */
+static void net_udp_relay_pdata(const UDP_frame_info &pd)
+{
+	const unsigned ppn = pd.Player_num;
+	if (ppn > 0 && ppn <= N_players && vcplayerptr(ppn)->connected == CONNECT_PLAYING) // some checking whether this packet is legal
+	{
+		for (unsigned i = 1; i < MAX_PLAYERS; ++i)
+		{
+			// not to sender or disconnected/waiting players - right.
+			if (i == ppn)
+				continue;
+			auto &iplr = *vcplayerptr(i);
+			if (iplr.connected != CONNECT_DISCONNECTED && iplr.connected != CONNECT_WAITING)
+				net_udp_send_pdata_to(i, ppn, pd.connected, pd.qpp);
+		}
 	}
 }
 
@@ -5652,26 +7332,84 @@ void net_udp_process_pdata(const uint8_t *data, uint_fast32_t data_len, const _s
 	pd.qpp.rotvel.y = GET_INTEL_INT(&data[len]);					len += 4;
 	pd.qpp.rotvel.z = GET_INTEL_INT(&data[len]);					len += 4;
 	
-	if (multi_i_am_master()) // I am host - must relay this packet to others!
-	{
-		const unsigned ppn = pd.Player_num;
-		if (ppn > 0 && ppn <= N_players && vcplayerptr(ppn)->connected == CONNECT_PLAYING) // some checking whether this packet is legal
-		{
-			for (unsigned i = 1; i < MAX_PLAYERS; ++i)
-			{
-				// not to sender or disconnected/waiting players - right.
-				if (i == ppn)
-					continue;
-				auto &iplr = *vcplayerptr(i);
-				if (iplr.connected != CONNECT_DISCONNECTED && iplr.connected != CONNECT_WAITING)
-					dxx_sendto(Netgame.players[i].protocol.udp.addr, UDP_Socket[0], data, data_len, 0);
-			}
-		}
-	}
+	if (multi_i_am_master())
+		net_udp_relay_pdata(pd);
 
 	net_udp_read_pdata_packet (&pd);
 }
 
+void net_udp_process_pdata_delta(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	if ( !( Game_mode & GM_NETWORK && ( Network_status == NETSTAT_PLAYING || Network_status == NETSTAT_ENDLEVEL ) ) )
+		return;
+
+	if (data_len < UPID_PDATA_DELTA_HEADER_SIZE || data_len > UPID_PDATA_DELTA_SIZE_MAX)
+		return;
+
+	const unsigned pnum = data[1];
+	if (pnum >= MAX_PLAYERS || (multi_i_am_master() && !pnum))
+		return;
+	// If we are a client, we get all our packets from the host.
+	const unsigned sender_pnum = multi_i_am_master() ? pnum : 0;
+	if (sender_addr != Netgame.players[sender_pnum].protocol.udp.addr)
+		return;
+
+	const uint16_t seq = GET_INTEL_SHORT(&data[3]);
+	const uint16_t base_seq = GET_INTEL_SHORT(&data[5]);
+	if (!seq)
+		return;
+	auto &history = UDP_pdata_recv[pnum];
+	UDP_frame_info pd{};
+	pd.Player_num = pnum;
+	pd.connected = data[2];
+	if (base_seq)
+	{
+		// If we no longer have the state this was made against, do not ACK. The sender falls back to a full update once its last ACK'd state is too old.
+		const auto &base = history[base_seq % UDP_PDATA_HISTORY];
+		if (base.seq != base_seq || !net_udp_read_pdata_delta(data, data_len, base.qpp, pd.qpp))
+			return;
+	}
+	else if (!net_udp_read_pdata_delta(data, data_len, quaternionpos{}, pd.qpp))
+		return;
+	auto &h = history[seq % UDP_PDATA_HISTORY];
+	h.seq = seq;
+	h.qpp = pd.qpp;
+
+	std::array<uint8_t, UPID_PDATA_ACK_SIZE> buf;
+	int len = 0;
+	buf[len] = UPID_PDATA_ACK;									len++;
+	buf[len] = Player_num;										len++;
+	buf[len] = pnum;										len++;
+	PUT_INTEL_SHORT(&buf[len], seq);								len += 2;
+	net_udp_bundle_send(sender_pnum, buf.data(), buf.size());
+
+	if (multi_i_am_master())
+		net_udp_relay_pdata(pd);
+
+	net_udp_read_pdata_packet(&pd);
+}
+
+/* We got an ACK for a UPID_PDATA_DELTA. Newer states can now be sent against the ACK'd one. */
+void net_udp_process_pdata_ack(const uint8_t *data, uint_fast32_t data_len, const _sockaddr &sender_addr)
+{
+	if (data_len != UPID_PDATA_ACK_SIZE)
+		return;
+	const unsigned sender_pnum = data[1], pnum = data[2];
+	if (sender_pnum >= MAX_PLAYERS || pnum >= MAX_PLAYERS)
+		return;
+	if (multi_i_am_master() ? sender_pnum == 0 : sender_pnum != 0)
+		return;
+	if (sender_addr != Netgame.players[sender_pnum].protocol.udp.addr)
+		return;
+	auto &stream = UDP_pdata_send[pnum][sender_pnum];
+	const uint16_t seq = GET_INTEL_SHORT(&data[3]);
+	// Only accept ACKs for states we still have.
+	if (!seq || stream.sent[seq % UDP_PDATA_HISTORY].seq != seq)
+		return;
+	if (!stream.acked_seq || static_cast<int16_t>(seq - stream.acked_seq) > 0)
+		stream.acked_seq = seq;
+}
+
 void net_udp_read_pdata_packet(UDP_frame_info *pd)
 {
 	auto &Objects = LevelUniqueObjectState.Objects;
@@ -6116,16 +7854,34 @@ static int udp_tracker_init()
 	TrackerAckStatus = TrackerAckState::TACK_NOCONNECTION;
 	TrackerAckTime = timer_query();
 
-	const char *tracker_addr = CGameArg.MplTrackerAddr.c_str();
-
-	// Fill the address
-	if (udp_dns_filladdr(TrackerSocket, tracker_addr, CGameArg.MplTrackerPort, false, true) < 0)
-		return -1;
+	// Resolve the address on the worker.  Until it is known, no packet is taken to be from the tracker.
+	TrackerSocket = {};
+	TrackerResolveId = UDP_async.resolve(CGameArg.MplTrackerAddr.c_str(), CGameArg.MplTrackerPort, _sockaddr::address_family(), false);
 
 	// Yay
 	return 0;
 }
 
+/* The worker resolved the tracker. */
+static void udp_tracker_resolved(const udp_async_completion &c)
+{
+	TrackerResolveId = 0;
+	if (c.resolve_error || c.addrlen > sizeof(TrackerSocket))
+	{
+		con_printf(CON_URGENT, "udp_dns_filladdr (getaddrinfo) failed for host %s", CGameArg.MplTrackerAddr.c_str());
+		return;
+	}
+	memcpy(&TrackerSocket, &c.addr, c.addrlen);
+}
+
+/* Queue a packet for the tracker.  The worker resolves the tracker first if it has to, so this never waits for the network. */
+static void udp_tracker_send(const uint8_t *const buf, const std::size_t len)
+{
+	if (CGameArg.MplTrackerAddr.empty() || !UDP_Socket[0])
+		return;
+	UDP_async.send(UDP_Socket[0], CGameArg.MplTrackerAddr.c_str(), CGameArg.MplTrackerPort, _sockaddr::address_family(), buf, len);
+}
+
 /* Compares sender to tracker. Returns 1 if address matches, Returns 2 is address and port matches. */
 static int sender_is_tracker(const _sockaddr &sender, const _sockaddr &tracker)
 {
@@ -6179,18 +7935,25 @@ static int sender_is_tracker(const _sockaddr &sender, const _sockaddr &tracker)
 }
 
 /* Unregister from the tracker */
-static int udp_tracker_unregister()
+static void udp_tracker_unregister()
 {
 	std::array<uint8_t, 1> pBuf;
 
 	pBuf[0] = UPID_TRACKER_REMOVE;
 
-	return dxx_sendto(TrackerSocket, UDP_Socket[0], &pBuf, 1, 0);
+	/* Once the tracker is resolved, send directly, so that closing the
+	 * sockets right after does not drop the packet from the queue of the
+	 * worker.
+	 */
+	if (TrackerSocket.sa.sa_family != AF_UNSPEC && UDP_Socket[0])
+		dxx_sendto(TrackerSocket, UDP_Socket[0], pBuf, 0);
+	else
+		udp_tracker_send(pBuf.data(), 1);
 }
 
 namespace dsx {
 /* Register or update (i.e. keep alive) a game on the tracker */
-static int udp_tracker_register()
+static void udp_tracker_register()
 {
 	net_udp_update_netgame();
 
@@ -6202,11 +7965,11 @@ static int udp_tracker_register()
 	len += snprintf(reinterpret_cast<char *>(&pBuf[1]), sizeof(pBuf)-1, "b=" UDP_REQ_ID DXX_VERSION_STR ".%hu,z=", MULTI_PROTO_VERSION );
 	memcpy(&pBuf[len], light.buf.data(), light_len);		len += light_len;
 
-	return dxx_sendto(TrackerSocket, UDP_Socket[0], &pBuf, len, 0);
+	udp_tracker_send(pBuf.data(), len);
 }
 
 /* Ask the tracker to send us a list of games */
-static int udp_tracker_reqgames()
+static void udp_tracker_reqgames()
 {
 	std::array<uint8_t, 2 + sizeof(UDP_REQ_ID) + sizeof("00000.00000.00000.00000")> pBuf = {};
 	int len = 1;
@@ -6214,7 +7977,7 @@ static int udp_tracker_reqgames()
 	pBuf[0] = UPID_TRACKER_REQGAMES;
 	len += snprintf(reinterpret_cast<char *>(&pBuf[1]), sizeof(pBuf)-1, UDP_REQ_ID DXX_VERSION_STR ".%hu", MULTI_PROTO_VERSION );
 
-	return dxx_sendto(TrackerSocket, UDP_Socket[0], &pBuf, len, 0);
+	udp_tracker_send(pBuf.data(), len);
 }
 }
 
@@ -6326,7 +8089,7 @@ static void udp_tracker_request_holepunch( uint16_t TrackerGameID )
 	PUT_INTEL_SHORT(&pBuf[1], TrackerGameID);
 
 	con_printf(CON_VERBOSE, "[Tracker] Sending hole-punch request for game [%i] to tracker.", TrackerGameID);
-	dxx_sendto(TrackerSocket, UDP_Socket[0], &pBuf, 3, 0);
+	udp_tracker_send(pBuf.data(), 3);
 }
 
 /* Tracker sent us an address from a client requesting hole punching.
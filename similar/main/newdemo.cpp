@@ -83,6 +83,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #include "compiler-range_for.h"
 #include "d_levelstate.h"
+#include "state_hash.h"
 #include "partial_range.h"
 #include <utility>
 
@@ -143,6 +144,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define ND_EVENT_LINK_SOUND_TO_OBJ		49	// record digi_link_sound_to_object3
 #define ND_EVENT_KILL_SOUND_TO_OBJ		50	// record digi_kill_sound_linked_to_object
 #endif
+#define ND_EVENT_STATE_HASH			51	// with -state_hash, followed by int hash of each state_hash_subsystem
 
 #define NORMAL_PLAYBACK 			0
 #define SKIP_PLAYBACK				1
@@ -178,6 +180,8 @@ int Newdemo_vcr_state = 0;
 int Newdemo_show_percentage=1;
 sbyte Newdemo_do_interpolate = 1;
 int Newdemo_num_written;
+newdemo_relay_tap *Newdemo_relay_tap;
+PHYSFS_sint64 Newdemo_live_end;
 #if defined(DXX_BUILD_DESCENT_II)
 ubyte DemoDoRight=0,DemoDoLeft=0;
 object DemoRightExtra,DemoLeftExtra;
@@ -198,6 +202,7 @@ static int nd_playback_v_framecount;
 static fix nd_playback_total, nd_recorded_total, nd_recorded_time;
 static sbyte nd_playback_v_style;
 static ubyte nd_playback_v_dead = 0, nd_playback_v_rear = 0;
+static state_hash_source nd_playback_v_state_hash;
 #if defined(DXX_BUILD_DESCENT_II)
 static ubyte nd_playback_v_guided = 0;
 int nd_playback_v_juststarted=0;
@@ -211,6 +216,7 @@ static short nd_record_v_framebytes_written = 0;
 static int nd_record_v_recordframe = 1;
 static fix64 nd_record_v_recordframe_last_time = 0;
 static sbyte nd_record_v_no_space;
+static std::vector<uint8_t> *nd_record_v_divert;	// newdemo_relay_keyframe writes here instead of to the file
 #if defined(DXX_BUILD_DESCENT_II)
 static int nd_record_v_juststarted = 0;
 static std::array<sbyte, MAX_OBJECTS> nd_record_v_objs,
@@ -224,6 +230,7 @@ static uint nd_record_v_player_flags = -1;
 static int nd_record_v_weapon_type = -1;
 static int nd_record_v_weapon_num = -1;
 static fix nd_record_v_homing_distance = -1;
+static uint32_t nd_record_v_state_hash_seq = UINT32_MAX;
 static int nd_record_v_primary_ammo = -1;
 static int nd_record_v_secondary_ammo = -1;
 
@@ -317,6 +324,13 @@ static int _newdemo_write(const void *buffer, int elsize, int nelem )
 {
 	int num_written, total_size;
 
+	if (unlikely(nd_record_v_divert))
+	{
+		const auto p = reinterpret_cast<const uint8_t *>(buffer);
+		nd_record_v_divert->insert(nd_record_v_divert->end(), p, p + elsize * nelem);
+		return nelem;
+	}
+
 	if (unlikely(nd_record_v_no_space))
 		return -1;
 
@@ -327,7 +341,14 @@ static int _newdemo_write(const void *buffer, int elsize, int nelem )
 	num_written = (PHYSFS_write)(outfile, buffer, elsize, nelem);
 
 	if (likely(num_written == nelem))
+	{
+		if (const auto tap = Newdemo_relay_tap)
+		{
+			const auto p = reinterpret_cast<const uint8_t *>(buffer);
+			tap->stream.insert(tap->stream.end(), p, p + total_size);
+		}
 		return num_written;
+	}
 
 	nd_record_v_no_space=2;
 	newdemo_stop_recording();
@@ -1078,6 +1099,12 @@ void newdemo_record_start_demo()
 	nd_record_v_recordframe_last_time=GameTime64-REC_DELAY; // make sure first frame is recorded!
 
 	pause_game_world_time p;
+	if (const auto tap = Newdemo_relay_tap; tap && !nd_record_v_divert)
+	{
+		tap->stream.clear();
+		tap->frame_end = 0;
+		tap->restarted = true;
+	}
 	nd_write_byte(ND_EVENT_START_DEMO);
 	nd_write_byte(DEMO_VERSION);
 	nd_write_byte(DEMO_GAME_TYPE);
@@ -1112,6 +1139,7 @@ void newdemo_record_start_demo()
 	nd_record_v_weapon_type = -1;
 	nd_record_v_weapon_num = -1;
 	nd_record_v_homing_distance = -1;
+	nd_record_v_state_hash_seq = UINT32_MAX;
 	nd_record_v_primary_ammo = -1;
 	nd_record_v_secondary_ammo = -1;
 
@@ -1144,6 +1172,56 @@ void newdemo_record_start_demo()
 #elif defined(DXX_BUILD_DESCENT_II)
 	newdemo_record_oneframeevent_update(0);
 #endif
+	if (const auto tap = Newdemo_relay_tap; tap && !nd_record_v_divert)
+		tap->header_end = tap->stream.size();
+}
+
+void newdemo_relay_keyframe(std::vector<uint8_t> &out)
+{
+	/* newdemo_record_start_demo resets the state which decides what the
+	 * recording in progress writes next.  Keep it, so the recording goes
+	 * on as if the header had not been written.
+	 */
+	const auto start_frame = nd_record_v_start_frame;
+	const auto frame_number = nd_record_v_frame_number;
+	const auto framebytes_written = nd_record_v_framebytes_written;
+	const auto recordframe_last_time = nd_record_v_recordframe_last_time;
+#if defined(DXX_BUILD_DESCENT_II)
+	const auto juststarted = nd_record_v_juststarted;
+	const auto player_afterburner = nd_record_v_player_afterburner;
+#endif
+	const auto player_energy = nd_record_v_player_energy;
+	const auto player_shields = nd_record_v_player_shields;
+	const auto player_flags = nd_record_v_player_flags;
+	const auto weapon_type = nd_record_v_weapon_type;
+	const auto weapon_num = nd_record_v_weapon_num;
+	const auto homing_distance = nd_record_v_homing_distance;
+	const auto state_hash_seq = nd_record_v_state_hash_seq;
+	const auto primary_ammo = nd_record_v_primary_ammo;
+	const auto secondary_ammo = nd_record_v_secondary_ammo;
+
+	out.clear();
+	nd_record_v_divert = &out;
+	newdemo_record_start_demo();
+	nd_record_v_divert = nullptr;
+
+	nd_record_v_start_frame = start_frame;
+	nd_record_v_frame_number = frame_number;
+	nd_record_v_framebytes_written = framebytes_written;
+	nd_record_v_recordframe_last_time = recordframe_last_time;
+#if defined(DXX_BUILD_DESCENT_II)
+	nd_record_v_juststarted = juststarted;
+	nd_record_v_player_afterburner = player_afterburner;
+#endif
+	nd_record_v_player_energy = player_energy;
+	nd_record_v_player_shields = player_shields;
+	nd_record_v_player_flags = player_flags;
+	nd_record_v_weapon_type = weapon_type;
+	nd_record_v_weapon_num = weapon_num;
+	nd_record_v_homing_distance = homing_distance;
+	nd_record_v_state_hash_seq = state_hash_seq;
+	nd_record_v_primary_ammo = primary_ammo;
+	nd_record_v_secondary_ammo = secondary_ammo;
 }
 
 void newdemo_record_start_frame(fix frame_time )
@@ -1190,6 +1268,19 @@ void newdemo_record_start_frame(fix frame_time )
 		nd_write_int(nd_record_v_frame_number);
 		nd_record_v_frame_number++;
 		nd_write_int(frame_time);
+		if (const auto tap = Newdemo_relay_tap)
+			tap->frame_end = tap->stream.size();
+		if (CGameArg.DbgStateHash)
+		{
+			const auto seq = state_hash_interval();
+			if (seq != nd_record_v_state_hash_seq)
+			{
+				nd_record_v_state_hash_seq = seq;
+				nd_write_byte(ND_EVENT_STATE_HASH);
+				range_for (const auto h, state_hash_compute())
+					nd_write_int(h);
+			}
+		}
 	}
 	else
 	{
@@ -2763,6 +2854,29 @@ static int newdemo_read_frame_information(int rewrite)
 			break;
 		}
 
+		case ND_EVENT_STATE_HASH: {
+			state_hash recorded;
+			range_for (auto &h, recorded)
+			{
+				int v;
+				nd_read_int(&v);
+				h = v;
+			}
+			if (rewrite)
+			{
+				range_for (const auto h, recorded)
+					nd_write_int(h);
+				break;
+			}
+			/* Playback moves only the objects which the demo shows, and
+			 * does not count down the reactor, so compare only walls and
+			 * whether the reactor is destroyed.
+			 */
+			if (Newdemo_vcr_state == ND_STATE_PLAYBACK)
+				state_hash_check(nd_playback_v_state_hash, "the demo", state_hash_compute(), recorded, state_hash_bit(state_hash_subsystem::walls) | state_hash_bit(state_hash_subsystem::reactor));
+			break;
+		}
+
 		case ND_EVENT_HOMING_DISTANCE: {
 			short distance;
 
@@ -3714,6 +3828,14 @@ static window_event_result interpolate_frame(fix d_play, fix d_recorded)
 	return result;
 }
 
+/* Whether the next frame of a relay stream has arrived.  Without a
+ * relay, every frame of the file has.
+ */
+static bool newdemo_live_frame_ready()
+{
+	return !Newdemo_live_end || PHYSFS_tell(infile) < Newdemo_live_end;
+}
+
 window_event_result newdemo_playback_one_frame()
 {
 	auto &LevelUniqueControlCenterState = LevelUniqueObjectState.ControlCenterState;
@@ -3773,6 +3895,8 @@ window_event_result newdemo_playback_one_frame()
 			range_for (const auto i, xrange(10u))
 			{
 				(void)i;
+				if (!newdemo_live_frame_ready())
+					break;
 				if (newdemo_read_frame_information(0) == -1)
 				{
 					if (nd_playback_v_at_eof)
@@ -3790,7 +3914,7 @@ window_event_result newdemo_playback_one_frame()
 			Newdemo_vcr_state = ND_STATE_PAUSED;
 	}
 	else if (Newdemo_vcr_state == ND_STATE_ONEFRAMEFORWARD) {
-		if (!nd_playback_v_at_eof) {
+		if (!nd_playback_v_at_eof && newdemo_live_frame_ready()) {
 			const int level = Current_level_num;
 			if (newdemo_read_frame_information(0) == -1) {
 				if (!nd_playback_v_at_eof)
@@ -3812,6 +3936,9 @@ window_event_result newdemo_playback_one_frame()
 		} else
 			Newdemo_vcr_state = ND_STATE_PAUSED;
 	}
+	else if (!newdemo_live_frame_ready())
+		/* Hold the picture until the relay sends more. */
+		return window_event_result::ignored;
 	else {
 
 		//  First, uptate the total playback time to date.  Then we check to see
@@ -3845,7 +3972,7 @@ window_event_result newdemo_playback_one_frame()
 			if (nd_recorded_total - nd_playback_total < FrameTime) {
 				d_recorded = nd_recorded_total - nd_playback_total;
 
-				while (nd_recorded_total - nd_playback_total < FrameTime) {
+				while (nd_recorded_total - nd_playback_total < FrameTime && newdemo_live_frame_ready()) {
 					unsigned num_objs;
 
 					num_objs = Highest_object_index;
@@ -3894,7 +4021,7 @@ window_event_result newdemo_playback_one_frame()
 				return window_event_result::close;
 			}
 			if (nd_playback_v_style == SKIP_PLAYBACK) {
-				while (nd_playback_total > nd_recorded_total) {
+				while (nd_playback_total > nd_recorded_total && newdemo_live_frame_ready()) {
 					if (newdemo_read_frame_information(0) == -1) {
 						newdemo_stop_playback();
 						return window_event_result::close;
@@ -4262,6 +4389,7 @@ void newdemo_start_playback(const char * filename)
 	nd_playback_v_at_eof = 0;
 	nd_playback_v_framecount = 0;
 	nd_playback_v_style = NORMAL_PLAYBACK;
+	nd_playback_v_state_hash = {};
 #if defined(DXX_BUILD_DESCENT_II)
 	init_seismic_disturbances();
 	//turn off 3d views on cockpit
@@ -4289,6 +4417,7 @@ namespace dsx {
 void newdemo_stop_playback()
 {
 	infile.reset();
+	Newdemo_live_end = 0;
 	Newdemo_state = ND_STATE_NORMAL;
 	change_playernum_to(0);             //this is reality
 	get_local_player().callsign = nd_playback_v_save_callsign;
@@ -179,6 +179,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define GRAPHICS_HEADER_TEXT "[graphics]"
 #define GRAPHICS_ALPHAEFFECTS_NAME_TEXT "alphaeffects"
 #define GRAPHICS_DYNLIGHTCOLOR_NAME_TEXT "dynlightcolor"
+#define GRAPHICS_OBJECTLIGHTPROBES_NAME_TEXT "objectlightprobes"
 #define PLX_VERSION_HEADER_TEXT "[plx version]"
 #define END_TEXT	"[end]"
 
@@ -273,6 +274,7 @@ void new_player_config()
         PlayerCfg.CloakInvulTimer = 0;
 	PlayerCfg.AlphaEffects = 0;
 	PlayerCfg.DynLightColor = 0;
+	PlayerCfg.ObjectLightProbes = 0;
 
 	// Default taunt macros
 #if defined(DXX_BUILD_DESCENT_I)
@@ -521,6 +523,8 @@ static void read_player_dxx(const char *filename)
 					PlayerCfg.AlphaEffects = atoi(value);
 				if(!strcmp(line,GRAPHICS_DYNLIGHTCOLOR_NAME_TEXT))
 					PlayerCfg.DynLightColor = atoi(value);
+				if(!strcmp(line,GRAPHICS_OBJECTLIGHTPROBES_NAME_TEXT))
+					PlayerCfg.ObjectLightProbes = atoi(value);
 			}
 		}
 		else if (!strcmp(line,PLX_VERSION_HEADER_TEXT)) // know the version this pilot was used last with - allow modifications
@@ -819,6 +823,7 @@ static int write_player_dxx(const char *filename)
 							);
 		PHYSFSX_printf(fout,GRAPHICS_ALPHAEFFECTS_NAME_TEXT "=%i\n",PlayerCfg.AlphaEffects);
 		PHYSFSX_printf(fout,GRAPHICS_DYNLIGHTCOLOR_NAME_TEXT "=%i\n",PlayerCfg.DynLightColor);
+		PHYSFSX_printf(fout,GRAPHICS_OBJECTLIGHTPROBES_NAME_TEXT "=%i\n",PlayerCfg.ObjectLightProbes);
 		PHYSFSX_puts_literal(fout, END_TEXT "\n"
 							PLX_VERSION_HEADER_TEXT "\n"
 							"plx version=" DXX_VERSION_STR "\n"
@@ -727,7 +727,28 @@ g3s_codes rotate_list(fvcvertptr &vcvertptr, const std::size_t nv, const vertnum
 		? 0.0f /* unused */
 		: 2.0f * (static_cast<float>(timer_query()) / F1_0);
 
-	range_for (const auto pnum, unchecked_partial_range(pointnumlist, nv))
+	/* Gather the points which need rotation into batches, so that they
+	 * can be rotated together, then scatter the results back to
+	 * Segment_points.
+	 */
+	g3s_point_batch batch;
+	std::array<g3s_point *, g3s_point_batch::capacity> batch_points;
+	std::size_t batch_count = 0;
+	const auto flush_batch = [&]() {
+		const std::size_t n = std::exchange(batch_count, 0);
+		g3_rotate_point_batch(batch, n);
+		for (const auto i : xrange(n))
+		{
+			auto &pnt = *batch_points[i];
+			pnt.p3_x = batch.x[i];
+			pnt.p3_y = batch.y[i];
+			pnt.p3_z = batch.z[i];
+			pnt.p3_codes = batch.codes[i];
+			pnt.p3_flags = 0;	//no projected
+		}
+	};
+	const auto &&points = unchecked_partial_range(pointnumlist, nv);
+	range_for (const auto pnum, points)
 	{
 		auto &pnt = Segment_points[pnum];
 		if (pnt.p3_last_generation != current_generation)
@@ -735,14 +756,30 @@ g3s_codes rotate_list(fvcvertptr &vcvertptr, const std::size_t nv, const vertnum
 			pnt.p3_last_generation = current_generation;
 			auto &v = *vcvertptr(pnum);
 			vertex tmpv;
-			g3_rotate_point(pnt, likely(!cheats_acid) ? v : (
+			const vms_vector &src = likely(!cheats_acid) ? v : (
 				tmpv = v,
 				tmpv.x += fl2f(sinf(f + f2fl(tmpv.x))),
 				tmpv.y += fl2f(sinf(f * 1.5f + f2fl(tmpv.y))),
 				tmpv.z += fl2f(sinf(f * 2.5f + f2fl(tmpv.z))),
 				tmpv
-			));
+			);
+			batch_points[batch_count] = &pnt;
+			batch.x[batch_count] = src.x;
+			batch.y[batch_count] = src.y;
+			batch.z[batch_count] = src.z;
+			if (++ batch_count == g3s_point_batch::capacity)
+				flush_batch();
 		}
+	}
+	if (batch_count)
+		flush_batch();
+	/* Codes are collected after all rotations finish, since a point
+	 * number which appears twice in the list may still be waiting in a
+	 * batch when its second occurrence is seen.
+	 */
+	range_for (const auto pnum, points)
+	{
+		auto &pnt = Segment_points[pnum];
 		cc.uand &= pnt.p3_codes;
 		cc.uor  |= pnt.p3_codes;
 	}
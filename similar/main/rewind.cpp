@@ -0,0 +1,250 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Rewinding a single player game.
+ *
+ * With -rewind, the game copies the state of the level into a snapshot
+ * every few seconds of game time, and keeps the snapshots in a ring
+ * bounded by -rewind_memory.  The console command rewind copies one back.
+ * Unlike a savegame, a snapshot holds the state in memory as it is, so
+ * it is taken and restored without reading the level again.  Snapshots
+ * belong to the level they were taken on, and are dropped on the next.
+ *
+ */
+
+#include <algorithm>
+#include <stdlib.h>
+#include "rewind.h"
+#include "rewind_buffer.h"
+#include "args.h"
+#include "cmd.h"
+#include "console.h"
+#include "controls.h"
+#include "fireball.h"
+#include "fuelcen.h"
+#include "game.h"
+#include "gameseq.h"
+#include "mission.h"
+#include "morph.h"
+#include "newdemo.h"
+#include "player.h"
+#include "segment.h"
+#include "state.h"
+#include "wall.h"
+#include "ai.h"
+#include "d_levelstate.h"
+#include "compiler-range_for.h"
+
+namespace dcx {
+
+namespace {
+
+rewind_buffer Rewind_buffer;
+/* Reused for each snapshot, so capture does not allocate once it grew. */
+std::vector<uint8_t> Rewind_snapshot;
+
+/* The level which the snapshots in Rewind_buffer belong to. */
+struct rewind_level
+{
+	const void *mission = nullptr;
+	int level = 0;
+	unsigned segments = 0;
+	bool operator==(const rewind_level &r) const
+	{
+		return mission == r.mission && level == r.level && segments == r.segments;
+	}
+};
+
+rewind_level Rewind_level;
+fix64 Rewind_last_capture;
+
+}
+
+}
+
+namespace dsx {
+
+namespace {
+
+/* Copy the whole array, so that entries past the count are freed too. */
+template <typename A>
+void rewind_managed_array(rewind_state &r, A &a)
+{
+	unsigned count = a.get_count();
+	r(count);
+	if (r.is_restoring())
+		a.set_count(std::min<std::size_t>(count, a.size()));
+	r(a.data(), a.size());
+}
+
+void rewind_visit(rewind_state &r)
+{
+	r(GameTime64);
+	/* The number of segments never changes within a level, and a level
+	 * is a few thousand of them at most, so copy only those in use.
+	 */
+	auto &Segments = LevelUniqueSegmentState.get_segments();
+	r(Segments.data(), Segments.get_count());
+	auto &o = LevelUniqueObjectState;
+	r(o.num_objects);
+	r(o.accumulated_robots);
+	r(o.total_hostages);
+	r(o.Debris_object_count);
+#if defined(DXX_BUILD_DESCENT_II)
+	r(o.BuddyState);
+	r(o.ThiefState);
+	r(o.Guided_missile);
+#endif
+	r(o.free_obj_list);
+	rewind_managed_array(r, o.Objects);
+	r(o.BossState);
+	r(o.ControlCenterState);
+	r(o.Level_path_created);
+	auto &w = LevelUniqueWallSubsystemState;
+	rewind_managed_array(r, w.Walls);
+	rewind_managed_array(r, w.ActiveDoors);
+	rewind_managed_array(r, w.Triggers);
+#if defined(DXX_BUILD_DESCENT_II)
+	rewind_managed_array(r, w.CloakingWalls);
+	r(LevelUniqueStuckObjectState);
+#endif
+	r(LevelUniqueFuelcenterState);
+	rewind_managed_array(r, Players);
+	ai_rewind_state(r);
+#if defined(DXX_BUILD_DESCENT_II)
+	r(Afterburner_charge);
+	r(Flash_effect);
+#endif
+}
+
+rewind_level rewind_current_level()
+{
+	rewind_level l;
+	l.mission = Current_mission.get();
+	l.level = Current_level_num;
+	l.segments = LevelUniqueSegmentState.get_segments().get_count();
+	return l;
+}
+
+/* Snapshots are taken and restored only where a savegame could be, and
+ * never while the player is dead or a demo records or plays.
+ */
+bool rewind_allowed()
+{
+	if (!Game_wind || (Game_mode & GM_MULTI))
+		return false;
+	if (Newdemo_state != ND_STATE_NORMAL || Player_dead_state != player_dead_state::no)
+		return false;
+	auto &Objects = LevelUniqueObjectState.Objects;
+	return deny_save_game(Objects.vcptr, LevelUniqueObjectState.ControlCenterState, GameUniqueState) == deny_save_result::allowed;
+}
+
+/* The morph data is not part of a snapshot.  Only robots morph, and
+ * always from AI and physics, so end each morph where it is.
+ */
+void rewind_finish_morphs()
+{
+	init_morphs();
+	auto &Objects = LevelUniqueObjectState.Objects;
+	range_for (const auto &&objp, Objects.vmptr)
+	{
+		if (objp->type == OBJ_NONE || objp->render_type != RT_MORPH)
+			continue;
+		objp->render_type = RT_POLYOBJ;
+		objp->control_source = object::control_type::ai;
+		objp->movement_source = object::movement_type::physics;
+	}
+}
+
+void rewind_cmd(unsigned long argc, const char *const *const argv)
+{
+	if (argc > 2)
+	{
+		cmd_insertf("help %s", argv[0]);
+		return;
+	}
+	if (!CGameArg.SysRewindInterval || !Rewind_buffer.capacity())
+	{
+		con_puts(CON_NORMAL, "rewind: start the game with -rewind <seconds> to keep snapshots");
+		return;
+	}
+	if (argc < 2)
+	{
+		con_printf(CON_NORMAL, "rewind: %zu snapshots %u seconds apart, in %zu of %zu KB", Rewind_buffer.size(), CGameArg.SysRewindInterval, Rewind_buffer.memory_used() / 1024, Rewind_buffer.capacity() / 1024);
+		return;
+	}
+	const auto steps = strtoul(argv[1], nullptr, 10);
+	if (!steps)
+	{
+		cmd_insertf("help %s", argv[0]);
+		return;
+	}
+	if (!rewind_allowed() || !(rewind_current_level() == Rewind_level))
+	{
+		con_puts(CON_NORMAL, "rewind: not possible now");
+		return;
+	}
+	/* The newest snapshot is the first step back. */
+	if (!Rewind_buffer.restore(steps - 1, Rewind_snapshot))
+	{
+		con_printf(CON_NORMAL, "rewind: only %zu snapshots are kept", Rewind_buffer.size());
+		return;
+	}
+	const auto now = GameTime64;
+	rewind_state r(Rewind_snapshot, true);
+	rewind_visit(r);
+	rewind_finish_morphs();
+	Rewind_last_capture = GameTime64;
+	con_printf(CON_NORMAL, "rewind: went back %i seconds", f2i(static_cast<fix>(now - GameTime64)));
+}
+
+}
+
+void rewind_poll_capture()
+{
+	if (!CGameArg.SysRewindInterval || !Rewind_buffer.capacity())
+		return;
+	if (!rewind_allowed())
+		return;
+	const auto level = rewind_current_level();
+	if (!(level == Rewind_level))
+	{
+		Rewind_buffer.clear();
+		Rewind_level = level;
+	}
+	/* GameTime64 goes back when a savegame of this level is loaded. */
+	else if (GameTime64 >= Rewind_last_capture && GameTime64 - Rewind_last_capture < i2f(CGameArg.SysRewindInterval))
+		return;
+	Rewind_last_capture = GameTime64;
+	Rewind_snapshot.clear();
+	rewind_state r(Rewind_snapshot, false);
+	rewind_visit(r);
+	if (!Rewind_buffer.push(Rewind_snapshot.data(), Rewind_snapshot.size()))
+	{
+		con_printf(CON_URGENT, "rewind: a snapshot of %zu KB does not fit in -rewind_memory %u, so rewind is off", Rewind_snapshot.size() / 1024, CGameArg.SysRewindMemory);
+		Rewind_buffer.reset(0, 1);
+	}
+}
+
+}
+
+namespace dcx {
+
+void rewind_init()
+{
+	if (!CGameArg.SysRewindInterval)
+		return;
+	/* A keyframe every 16 snapshots bounds the work of a rewind to
+	 * decoding that many.
+	 */
+	Rewind_buffer.reset(std::size_t{CGameArg.SysRewindMemory} << 20, 16);
+	cmd_addcommand("rewind", dsx::rewind_cmd, "rewind [<n>]\n"
+		"    go back <n> snapshots of -rewind seconds each, or show the snapshots kept");
+}
+
+}
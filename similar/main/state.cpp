@@ -27,6 +27,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <errno.h>
 
 #include "pstypes.h"
 #include "inferno.h"
@@ -81,8 +82,17 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "d_enumerate.h"
 #include "partial_range.h"
 #include "d_zip.h"
+#include <atomic>
+#include <bitset>
+#include <string>
+#include <system_error>
+#include <thread>
 #include <utility>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #if defined(DXX_BUILD_DESCENT_I)
 #define STATE_VERSION 7
 #define STATE_MATCEN_VERSION 25 // specific version of metcen info written into D1 savegames. Currenlty equal to GAME_VERSION (see gamesave.cpp). If changed, then only along with STATE_VERSION.
@@ -155,6 +165,8 @@ namespace dsx {
 
 namespace {
 
+grs_bitmap_ptr read_savegame_thumbnail(const char *filename);
+
 struct savegame_newmenu_items
 {
 	struct error_no_saves_found
@@ -168,6 +180,8 @@ struct savegame_newmenu_items
 	enumerated_array<d_game_unique_state::savegame_file_path, NUM_SAVES, d_game_unique_state::save_slot> savegame_file_paths;
 	enumerated_array<d_game_unique_state::savegame_description, NUM_SAVES, d_game_unique_state::save_slot> savegame_descriptions;
 	enumerated_array<grs_bitmap_ptr, NUM_SAVES, d_game_unique_state::save_slot> sc_bmp;
+	/* Thumbnails are read when their slot is first highlighted. */
+	std::bitset<NUM_SAVES> sc_bmp_read;
 	std::array<newmenu_item, NUM_SAVES + decorative_item_count> m;
 	/* For saving a game, savegame_description is a
 	 * caller-supplied buffer into which the user's text is placed, so
@@ -260,7 +274,14 @@ void savegame_chooser_newmenu::draw_handler()
 	const auto choice = build_save_slot_from_citem();
 	if (!sc_bmp.valid_index(choice))
 		return;
-	if (auto &bmp = sc_bmp[choice])
+	auto &bmp = sc_bmp[choice];
+	const std::size_t i = static_cast<std::size_t>(choice);
+	if (!sc_bmp_read[i])
+	{
+		sc_bmp_read.set(i);
+		bmp = read_savegame_thumbnail(savegame_file_paths[choice].data());
+	}
+	if (bmp)
 		draw_handler(w_canv, *bmp);
 }
 
@@ -877,6 +898,91 @@ namespace dcx {
 
 namespace {
 
+/* state_save_all_sub writes a savegame into the buffer of its file, which
+ * holds all of it, so that nothing reaches the disk during the save.  This
+ * then closes the file on a thread, which writes the buffer out, and
+ * renames the file over the old savegame.  The game goes on meanwhile, and
+ * a crash while writing leaves the old savegame as it was.
+ */
+class savegame_writer
+{
+	std::thread worker;
+	std::atomic<bool> done{false};
+	bool written;
+	bool autosave;
+	/* PhysFS keeps its error for each thread, so the worker saves the
+	 * error for wait to report.  The rename is not done by PhysFS, and
+	 * reports its error through the system instead.
+	 */
+	PHYSFS_ErrorCode close_error;
+	std::error_code rename_error;
+	std::string filename;
+public:
+	~savegame_writer()
+	{
+		wait();
+	}
+	void start(RAIIPHYSFS_File fp, std::string tmpname, std::string name)
+	{
+		wait();
+		filename = std::move(name);
+		autosave = false;
+		done.store(false, std::memory_order_relaxed);
+		worker = std::thread([this, tmpname = std::move(tmpname)](RAIIPHYSFS_File fp) {
+			close_error = PHYSFS_ERR_OK;
+			rename_error.clear();
+			written = fp.close();
+			if (!written)
+				close_error = PHYSFS_getLastErrorCode();
+			else
+			{
+#ifdef _WIN32
+				/* rename does not replace an existing file on Windows.
+				 * Deleting the old savegame first would lose both if
+				 * the game stopped in between, so replace it in one
+				 * step.
+				 */
+				std::array<char, PATH_MAX> from, to;
+				PHYSFSX_getRealPath(tmpname.c_str(), from);
+				PHYSFSX_getRealPath(filename.c_str(), to);
+				written = MoveFileExA(from.data(), to.data(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+				if (!written)
+					rename_error = std::error_code(GetLastError(), std::system_category());
+#else
+				written = PHYSFSX_rename(tmpname.c_str(), filename.c_str());
+				if (!written)
+					rename_error = std::error_code(errno, std::generic_category());
+#endif
+			}
+			done.store(true, std::memory_order_release);
+		}, std::move(fp));
+	}
+	void wait()
+	{
+		if (!worker.joinable())
+			return;
+		worker.join();
+		if (!written)
+			con_printf(CON_URGENT, "Failed to write savegame %s: %s", filename.c_str(), rename_error ? rename_error.message().c_str() : PHYSFS_getErrorByCode(close_error));
+		else if (autosave)
+			con_printf(CON_NORMAL, "Autosave written to \"%s\"", filename.c_str());
+	}
+	/* Report the savegame which is being written as an autosave once it
+	 * is on disk.
+	 */
+	void mark_autosave()
+	{
+		autosave = true;
+	}
+	void poll()
+	{
+		if (done.load(std::memory_order_acquire))
+			wait();
+	}
+};
+
+static savegame_writer Savegame_writer;
+
 void state_format_savegame_filename(d_game_unique_state::savegame_file_path &filename, const unsigned i)
 {
 	snprintf(filename.data(), filename.size(), PLAYER_DIRECTORY_STRING("%.8s.%cg%x"), static_cast<const char *>(InterfaceUniqueState.PilotName), (Game_mode & GM_MULTI_COOP) ? 'm' : 's', i);
@@ -904,65 +1010,180 @@ void state_autosave_game(const int multiplayer)
 		d_game_unique_state::savegame_file_path filename;
 		state_format_savegame_filename(filename, NUM_SAVES - 1);
 		if (state_save_all_sub(filename.data(), p))
-			con_printf(CON_NORMAL, "Autosave written to \"%s\"", filename.data());
+			Savegame_writer.mark_autosave();
 	}
 }
 
 }
 
+void state_wait_for_pending_save()
+{
+	Savegame_writer.wait();
+}
+
 }
 
 namespace dsx {
 
 namespace {
 
-uint8_t read_savegame_properties(const std::size_t savegame_index, d_game_unique_state::savegame_file_path &filename, d_game_unique_state::savegame_description *const dsc, grs_bitmap_ptr *const sc_bmp)
+constexpr char dgsi_id[4] = {'D', 'G', 'S', 'I'};
+constexpr uint32_t savegame_index_version = 1;
+
+/* What the chooser shows of one slot, and the size and time of the
+ * savegame it was read from.  A missing savegame has size -1.
+ */
+struct savegame_index_entry
+{
+	PHYSFS_sint64 filesize = -2;
+	PHYSFS_sint64 modtime = -1;
+	uint8_t valid = 0;
+	d_game_unique_state::savegame_description desc{};
+};
+
+/* The descriptions of all savegames of the pilot, kept in one small file
+ * beside them, so that opening the chooser reads that file and the size
+ * and time of each savegame, rather than the header of each savegame.
+ */
+struct savegame_index_cache
 {
-	state_format_savegame_filename(filename, savegame_index);
+	/* The time of the index file.  An entry is used only if its savegame
+	 * is older than the index, since a savegame replaced in the same
+	 * second as the index was written keeps its size and time.
+	 */
+	PHYSFS_sint64 modtime = -1;
+	std::array<savegame_index_entry, NUM_SAVES> entries;
+	bool changed = false;
+};
+
+void state_format_savegame_index_filename(d_game_unique_state::savegame_file_path &filename)
+{
+	snprintf(filename.data(), filename.size(), PLAYER_DIRECTORY_STRING("%.8s.%cgi"), static_cast<const char *>(InterfaceUniqueState.PilotName), (Game_mode & GM_MULTI_COOP) ? 'm' : 's');
+}
+
+savegame_index_cache read_savegame_index()
+{
+	savegame_index_cache index;
+	d_game_unique_state::savegame_file_path filename;
+	state_format_savegame_index_filename(filename);
+	PHYSFS_Stat st;
+	if (!PHYSFSX_stat(filename.data(), st))
+		return index;
 	const auto fp = PHYSFSX_openReadBuffered(filename.data()).first;
 	if (!fp)
-		return 0;
-	//Read id
+		return index;
 	char id[4]{};
-	if (PHYSFS_read(fp, id, sizeof(id), 1) != 1)
-		return 0;
-	if (memcmp(id, dgss_id, 4))
-		return 0;
-	//Read version
-	unsigned version;
-	if (PHYSFS_read(fp, &version, sizeof(version), 1) != 1)
-		return 0;
-	if (!(version >= STATE_COMPATIBLE_VERSION || SWAPINT(version) >= STATE_COMPATIBLE_VERSION))
-		return 0;
-	// In case it's Coop, handle state_game_id & callsign as well
-	if (Game_mode & GM_MULTI_COOP)
+	uint32_t version;
+	if (PHYSFS_read(fp, id, sizeof(id), 1) != 1 || memcmp(id, dgsi_id, sizeof(id)) || !PHYSFS_readULE32(fp, &version) || version != savegame_index_version)
+		return index;
+	std::array<savegame_index_entry, NUM_SAVES> entries;
+	range_for (auto &e, entries)
+	{
+		if (!PHYSFS_readSLE64(fp, &e.filesize) || !PHYSFS_readSLE64(fp, &e.modtime) ||
+			PHYSFS_read(fp, &e.valid, sizeof(e.valid), 1) != 1 ||
+			PHYSFS_read(fp, e.desc.data(), e.desc.size(), 1) != 1)
+			return index;
+		e.desc.back() = 0;
+	}
+	index.modtime = st.modtime;
+	index.entries = entries;
+	return index;
+}
+
+/* The index is only a cache, so a failure to write it is not reported. */
+void write_savegame_index(const savegame_index_cache &index)
+{
+	d_game_unique_state::savegame_file_path filename;
+	state_format_savegame_index_filename(filename);
+	const auto fp = PHYSFSX_openWriteBuffered(filename.data()).first;
+	if (!fp)
+		return;
+	PHYSFS_write(fp, dgsi_id, sizeof(dgsi_id), 1);
+	PHYSFS_writeULE32(fp, savegame_index_version);
+	range_for (auto &e, index.entries)
 	{
-		PHYSFS_seek(fp, PHYSFS_tell(fp) + sizeof(PHYSFS_sint32) + sizeof(char)*CALLSIGN_LEN+1); // skip state_game_id, callsign
+		PHYSFS_writeSLE64(fp, e.filesize);
+		PHYSFS_writeSLE64(fp, e.modtime);
+		PHYSFS_write(fp, &e.valid, sizeof(e.valid), 1);
+		PHYSFS_write(fp, e.desc.data(), e.desc.size(), 1);
 	}
-	d_game_unique_state::savegame_description desc_storage;
-	d_game_unique_state::savegame_description &desc = dsc ? *dsc : desc_storage;
-	// Read description
-	if (PHYSFS_read(fp, desc.data(), desc.size(), 1) != 1)
-		return 0;
+}
+
+/* Everything before the thumbnail is a few dozen bytes at the start of
+ * the savegame, so read it in one read, and without the buffer which
+ * PHYSFSX_openReadBuffered would fill with the whole savegame.
+ */
+RAIIPHYSFS_File read_savegame_header(const char *const filename, unsigned &version, d_game_unique_state::savegame_description &desc)
+{
+	auto fp = PHYSFSX_openReadUnbuffered(filename).first;
+	if (!fp)
+		return fp;
+	// In case it's Coop, skip state_game_id & callsign as well
+	constexpr std::size_t coop_size = sizeof(PHYSFS_sint32) + sizeof(char)*CALLSIGN_LEN+1;
+	const std::size_t skip = (Game_mode & GM_MULTI_COOP) ? coop_size : 0;
+	std::array<uint8_t, sizeof(dgss_id) + sizeof(version) + coop_size + std::tuple_size<d_game_unique_state::savegame_description>::value> header;
+	if (PHYSFS_read(fp, header.data(), header.size() - coop_size + skip, 1) != 1)
+		return nullptr;
+	if (memcmp(header.data(), dgss_id, sizeof(dgss_id)))
+		return nullptr;
+	memcpy(&version, &header[sizeof(dgss_id)], sizeof(version));
+	if (!(version >= STATE_COMPATIBLE_VERSION || SWAPINT(version) >= STATE_COMPATIBLE_VERSION))
+		return nullptr;
+	memcpy(desc.data(), &header[sizeof(dgss_id) + sizeof(version) + skip], desc.size());
 	desc.back() = 0;
-	if (sc_bmp)
-	{
-		// Read thumbnail
-		grs_bitmap_ptr bmp = gr_create_bitmap(THUMBNAIL_W, THUMBNAIL_H);
-		if (PHYSFS_read(fp, bmp->get_bitmap_data(), THUMBNAIL_W * THUMBNAIL_H, 1) != 1)
-			return 0;
+	return fp;
+}
+
+uint8_t read_savegame_properties(const std::size_t savegame_index, d_game_unique_state::savegame_file_path &filename, d_game_unique_state::savegame_description *const dsc)
+{
+	state_format_savegame_filename(filename, savegame_index);
+	unsigned version;
+	d_game_unique_state::savegame_description desc_storage;
+	return !!read_savegame_header(filename.data(), version, dsc ? *dsc : desc_storage);
+}
+
+uint8_t read_savegame_properties(savegame_index_cache &index, const std::size_t savegame_index, d_game_unique_state::savegame_file_path &filename, d_game_unique_state::savegame_description &desc)
+{
+	state_format_savegame_filename(filename, savegame_index);
+	auto &e = index.entries[savegame_index];
+	PHYSFS_Stat st;
+	if (!PHYSFSX_stat(filename.data(), st))
+		st.filesize = st.modtime = -1;
+	if (!(e.filesize == st.filesize && e.modtime == st.modtime && (st.filesize == -1 || e.modtime < index.modtime)))
+	{
+		index.changed = true;
+		e.filesize = st.filesize;
+		e.modtime = st.modtime;
+		unsigned version;
+		e.valid = st.filesize != -1 && read_savegame_header(filename.data(), version, e.desc);
+		if (!e.valid)
+			e.desc = {};
+	}
+	if (e.valid)
+		desc = e.desc;
+	return e.valid;
+}
+
+grs_bitmap_ptr read_savegame_thumbnail(const char *const filename)
+{
+	unsigned version;
+	d_game_unique_state::savegame_description desc;
+	const auto fp = read_savegame_header(filename, version, desc);
+	if (!fp)
+		return nullptr;
+	grs_bitmap_ptr bmp = gr_create_bitmap(THUMBNAIL_W, THUMBNAIL_H);
+	if (PHYSFS_read(fp, bmp->get_bitmap_data(), THUMBNAIL_W * THUMBNAIL_H, 1) != 1)
+		return nullptr;
 #if defined(DXX_BUILD_DESCENT_II)
-		if (version >= 9)
-		{
-			palette_array_t pal;
-			if (PHYSFS_read(fp, &pal[0], pal.size(), sizeof(pal[0])) != sizeof(pal[0]))
-				return 0;
-			gr_remap_bitmap_good(*bmp.get(), pal, -1, -1);
-		}
-#endif
-		*sc_bmp = std::move(bmp);
+	if (version >= 9)
+	{
+		palette_array_t pal;
+		if (PHYSFS_read(fp, &pal[0], pal.size(), sizeof(pal[0])) != sizeof(pal[0]))
+			return nullptr;
+		gr_remap_bitmap_good(*bmp.get(), pal, -1, -1);
 	}
-	return 1;
+#endif
+	return bmp;
 }
 
 savegame_newmenu_items::savegame_newmenu_items(d_game_unique_state::savegame_description *const savegame_description, d_game_unique_state::savegame_file_path &savegame_file_path, imenu_description_buffers_array *const user_entered_savegame_descriptions) :
@@ -977,17 +1198,22 @@ savegame_newmenu_items::savegame_newmenu_items(d_game_unique_state::savegame_des
 	 * last slot is reserved for autosaves.
 	 */
 	const unsigned max_slots_shown = get_count_valid_menuitem_entries(savegame_description);
-	for (const auto &&[savegame_index, mi, filename, desc, sc_bmp] : enumerate(zip(partial_range(m, decorative_item_count, max_slots_shown), savegame_file_paths, savegame_descriptions, sc_bmp)))
+	auto index = read_savegame_index();
+	for (const auto &&[savegame_index, mi, filename, desc] : enumerate(zip(partial_range(m, decorative_item_count, max_slots_shown), savegame_file_paths, savegame_descriptions)))
 	{
-		const auto existing_savegame_found = read_savegame_properties(savegame_index, filename, &desc, &sc_bmp);
+		const auto existing_savegame_found = read_savegame_properties(index, savegame_index, filename, desc);
 		if (existing_savegame_found)
 			++nsaves;
 		else
+		{
+			/* There is no thumbnail to read for an empty slot. */
+			sc_bmp_read.set(savegame_index);
 			/* Defer setting a default value to here.  This allows the
 			 * value to be written only if a better one was not
 			 * retrieved from a save game file.
 			 */
 			strcpy(desc.data(), TXT_EMPTY);
+		}
 		mi.text = desc.data();
 		mi.type = savegame_description
 			/* If saving, use input_menu so that the user can pick an
@@ -1004,6 +1230,8 @@ savegame_newmenu_items::savegame_newmenu_items(d_game_unique_state::savegame_des
 		if (user_entered_savegame_descriptions)
 			mi.initialize_imenu(desc, (*user_entered_savegame_descriptions)[savegame_index], nullptr);
 	}
+	if (index.changed)
+		write_savegame_index(index);
 	if (!savegame_description && nsaves < 1)
 		throw error_no_saves_found();
 	nm_set_item_text(m[0], "\n\n\n\n");
@@ -1029,6 +1257,7 @@ void state_set_next_autosave(d_game_unique_state &GameUniqueState, const autosav
 
 void state_poll_autosave_game(d_game_unique_state &GameUniqueState, const d_level_unique_object_state &LevelUniqueObjectState)
 {
+	Savegame_writer.poll();
 	const auto multiplayer = Game_mode & GM_MULTI;
 	if (multiplayer && !multi_i_am_master())
 		return;
@@ -1057,6 +1286,7 @@ void state_poll_autosave_game(d_game_unique_state &GameUniqueState, const d_leve
  */
 static d_game_unique_state::save_slot state_get_savegame_filename(grs_canvas &canvas, d_game_unique_state::savegame_file_path &fname, d_game_unique_state::savegame_description *const dsc, const menu_subtitle caption, const blind_save entry_blind)
 {
+	state_wait_for_pending_save();
 	const auto quicksave_selection = GameUniqueState.quicksave_selection;
 	if (entry_blind != blind_save::no &&
 		/* The user requested a non-blind save.  This block only handles
@@ -1066,7 +1296,7 @@ static d_game_unique_state::save_slot state_get_savegame_filename(grs_canvas &ca
 	{
 		/* The cached slot is valid, so a save/load might work.
 		 */
-		if (read_savegame_properties(static_cast<std::size_t>(quicksave_selection), fname, dsc, nullptr))
+		if (read_savegame_properties(static_cast<std::size_t>(quicksave_selection), fname, dsc))
 			/* The data was read from the savegame.  Return early and
 			 * skip the dialog.
 			 */
@@ -1236,6 +1466,11 @@ int state_save_all(const secret_save secret, const blind_save blind_save)
 	}
 
 	const int rval = state_save_all_sub(filename, desc.data());
+	if (secret != secret_save::none)
+		/* The level sequence looks for the secret level files as soon as
+		 * this returns.
+		 */
+		state_wait_for_pending_save();
 
 	if (rval && secret == secret_save::none)
 		HUD_init_message(HM_DEFAULT, "Game saved to \"%s\": \"%s\"", filename, desc.data());
@@ -1259,7 +1494,10 @@ int state_save_all_sub(const char *filename, const char *desc)
 		Int3();
 	#endif
 
-	auto &&[fp, physfserr] = PHYSFSX_openWriteBuffered(filename);
+	state_wait_for_pending_save();
+	std::string tmpname(filename);
+	tmpname += ".tmp";
+	auto &&[fp, physfserr] = PHYSFSX_openWriteBuffered(tmpname.c_str());
 	if (!fp)
 	{
 		const auto errstr = PHYSFS_getErrorByCode(physfserr);
@@ -1283,6 +1521,12 @@ int state_save_all_sub(const char *filename, const char *desc)
 		return 0;
 	}
 
+	/* Hold the whole savegame in memory until Savegame_writer closes the
+	 * file.  A savegame larger than this still saves, but the part which
+	 * does not fit goes to disk while the game waits.
+	 */
+	PHYSFS_setBuffer(fp, 8 * 1024 * 1024);
+
 	pause_game_world_time p;
 
 //Save id
@@ -1578,7 +1822,11 @@ int state_save_all_sub(const char *filename, const char *desc)
 			m = -1;
 		PHYSFS_write(fp, &m, sizeof(m), 1);
 	}
-	PHYSFS_seek(fp, PHYSFS_tell(fp) + (NUM_MARKERS)*(CALLSIGN_LEN+1)); // PHYSFS_write(fp, MarkerOwner, sizeof(MarkerOwner), 1); MarkerOwner is obsolete
+	{
+		// PHYSFS_write(fp, MarkerOwner, sizeof(MarkerOwner), 1); MarkerOwner is obsolete.  Write zeros, since seeking would flush the buffer.
+		const std::array<char, NUM_MARKERS * (CALLSIGN_LEN + 1)> MarkerOwner{};
+		PHYSFS_write(fp, MarkerOwner.data(), MarkerOwner.size(), 1);
+	}
 	range_for (const auto &m, MarkerState.message)
 		PHYSFS_write(fp, m.data(), m.size(), 1);
 
@@ -1676,6 +1924,7 @@ int state_save_all_sub(const char *filename, const char *desc)
 		PHYSFS_write(fp, &Netgame.numconnected, sizeof(ubyte), 1);
 		PHYSFS_write(fp, &Netgame.level_time, sizeof(int), 1);
 	}
+	Savegame_writer.start(std::move(fp), std::move(tmpname), filename);
 	return 1;
 }
 
@@ -1821,6 +2070,7 @@ int state_restore_all_sub(const d_level_shared_destructible_light_state &LevelSh
 		Int3();
 	#endif
 
+	state_wait_for_pending_save();
 	auto fp = PHYSFSX_openReadBuffered(filename).first;
 	if ( !fp ) return 0;
 
@@ -2561,6 +2811,7 @@ int state_get_game_id(const d_game_unique_state::savegame_file_path &filename)
 	if (!(Game_mode & GM_MULTI_COOP))
 		return 0;
 
+	state_wait_for_pending_save();
 	auto fp = PHYSFSX_openReadBuffered(filename.data()).first;
 	if ( !fp ) return 0;
 
@@ -0,0 +1,257 @@
+/*
+ * This file is part of the DXX-Rebirth project <https://www.dxx-rebirth.com/>.
+ * It is copyright by its individual contributors, as recorded in the
+ * project's Git history.  See COPYING.txt at the top level for license
+ * terms and a link to the Git history.
+ */
+/*
+ *
+ * Hashes of the game state, to find where two copies of a game went
+ * apart.
+ *
+ */
+
+#include "state_hash.h"
+#include "args.h"
+#include "console.h"
+#include "game.h"
+#include "gameseq.h"
+#include "maths.h"
+#include "object.h"
+#include "player.h"
+#include "robot.h"
+#include "switch.h"
+#include "wall.h"
+#include "d_levelstate.h"
+#include "compiler-range_for.h"
+
+namespace dcx {
+
+namespace {
+
+constexpr std::array<const char *, state_hash_subsystems> state_hash_name{{
+	"walls",
+	"triggers",
+	"reactor",
+	"robots",
+}};
+
+/* FNV-1a, which is enough to tell two states apart and costs little for
+ * the few thousand bytes hashed.
+ */
+class state_hasher
+{
+	uint32_t h = 2166136261u;
+public:
+	template <typename T>
+		void add(const T v)
+		{
+			for (std::size_t i = 0; i < sizeof(v); ++i)
+				h = (h ^ static_cast<uint8_t>(static_cast<uint64_t>(v) >> (8 * i))) * 16777619u;
+		}
+	uint32_t get() const
+	{
+		return h;
+	}
+};
+
+struct state_hash_entry
+{
+	int level;
+	uint32_t seq;
+	state_hash hash;
+};
+
+std::array<state_hash_entry, STATE_HASH_HISTORY> State_hash_history;
+int State_hash_level;
+uint32_t State_hash_seq;
+
+}
+
+}
+
+namespace dsx {
+
+namespace {
+
+uint32_t state_hash_walls()
+{
+	state_hasher h;
+	auto &Walls = LevelUniqueWallSubsystemState.Walls;
+	range_for (const auto &&w, Walls.vcptr)
+	{
+		h.add(w->type);
+		h.add(underlying_value(w->flags));
+		h.add(underlying_value(w->keys));
+	}
+	return h.get();
+}
+
+unsigned trigger_flags(const trigger &t)
+{
+#if defined(DXX_BUILD_DESCENT_I)
+	return t.flags;
+#elif defined(DXX_BUILD_DESCENT_II)
+	return underlying_value(t.flags);
+#endif
+}
+
+uint32_t state_hash_triggers()
+{
+	state_hasher h;
+	auto &Triggers = LevelUniqueWallSubsystemState.Triggers;
+	range_for (const auto &&t, Triggers.vcptr)
+		h.add(trigger_flags(*t));
+	return h.get();
+}
+
+uint32_t state_hash_reactor()
+{
+	state_hasher h;
+	auto &LevelUniqueControlCenterState = LevelUniqueObjectState.ControlCenterState;
+	h.add(LevelUniqueControlCenterState.Control_center_destroyed);
+	h.add(LevelUniqueControlCenterState.Control_center_present);
+	return h.get();
+}
+
+/* Robots are numbered differently by each peer, so hash how many of each
+ * kind are alive.
+ */
+uint32_t state_hash_robots()
+{
+	std::array<uint16_t, MAX_ROBOT_TYPES> alive{};
+	auto &Objects = LevelUniqueObjectState.Objects;
+	range_for (const auto &&objp, Objects.vcptr)
+	{
+		if (objp->type == OBJ_ROBOT && objp->id < alive.size())
+			++alive[objp->id];
+	}
+	state_hasher h;
+	range_for (const auto n, alive)
+		h.add(n);
+	return h.get();
+}
+
+void state_hash_dump(const state_hash_subsystem s)
+{
+	switch (s)
+	{
+		case state_hash_subsystem::walls:
+		{
+			auto &Walls = LevelUniqueWallSubsystemState.Walls;
+			range_for (const auto &&w, Walls.vcptridx)
+				con_printf(CON_NORMAL, "state hash: wall %hu segment %hu side %u type %u flags %#x keys %#x state %u hps %i", underlying_value(static_cast<wallnum_t>(w)), w->segnum, static_cast<unsigned>(w->sidenum), w->type, underlying_value(w->flags), underlying_value(w->keys), underlying_value(w->state), w->hps);
+			break;
+		}
+		case state_hash_subsystem::triggers:
+		{
+			auto &Triggers = LevelUniqueWallSubsystemState.Triggers;
+			range_for (const auto &&t, Triggers.vcptridx)
+				con_printf(CON_NORMAL, "state hash: trigger %u flags %#x", underlying_value(static_cast<trgnum_t>(t)), trigger_flags(*t));
+			break;
+		}
+		case state_hash_subsystem::reactor:
+		{
+			auto &LevelUniqueControlCenterState = LevelUniqueObjectState.ControlCenterState;
+			con_printf(CON_NORMAL, "state hash: reactor present %u destroyed %u countdown %i", LevelUniqueControlCenterState.Control_center_present, LevelUniqueControlCenterState.Control_center_destroyed, LevelUniqueControlCenterState.Countdown_seconds_left);
+			break;
+		}
+		case state_hash_subsystem::robots:
+		{
+			auto &Objects = LevelUniqueObjectState.Objects;
+			range_for (const auto &&objp, Objects.vcptridx)
+			{
+				if (objp->type != OBJ_ROBOT)
+					continue;
+				auto &ai = objp->ctype.ai_info;
+				const auto &p = objp->pos;
+				const auto &v = objp->mtype.phys_info.velocity;
+				con_printf(CON_NORMAL, "state hash: robot %hu kind %u segment %hu position %i %i %i velocity %i %i %i shields %i behavior %u mode %u", static_cast<uint16_t>(objp), objp->id, objp->segnum, p.x, p.y, p.z, v.x, v.y, v.z, objp->shields, underlying_value(ai.behavior), underlying_value(ai.ail.mode));
+			}
+			break;
+		}
+	}
+}
+
+}
+
+state_hash state_hash_compute()
+{
+	return {{
+		state_hash_walls(),
+		state_hash_triggers(),
+		state_hash_reactor(),
+		state_hash_robots(),
+	}};
+}
+
+uint32_t state_hash_interval()
+{
+	auto &plr = get_local_player();
+	return (static_cast<fix64>(plr.hours_level) * i2f(3600) + plr.time_level) / i2f(CGameArg.DbgStateHash);
+}
+
+bool state_hash_poll(uint32_t &seq, state_hash &hash)
+{
+	if (!CGameArg.DbgStateHash)
+		return false;
+	const auto now = state_hash_interval();
+	if (State_hash_level == Current_level_num && now == State_hash_seq)
+		return false;
+	State_hash_level = Current_level_num;
+	State_hash_seq = now;
+	hash = state_hash_compute();
+	State_hash_history[now % State_hash_history.size()] = {Current_level_num, now, hash};
+	seq = now;
+	return true;
+}
+
+const state_hash *state_hash_find(const uint32_t seq)
+{
+	auto &e = State_hash_history[seq % State_hash_history.size()];
+	if (e.level != Current_level_num || e.seq != seq)
+		return nullptr;
+	return &e.hash;
+}
+
+void state_hash_check(state_hash_source &source, const char *const source_name, const state_hash &ours, const state_hash &theirs, const unsigned mask)
+{
+	if (source.level != Current_level_num)
+	{
+		source.level = Current_level_num;
+		source.differing = source.reported = 0;
+	}
+	unsigned differing = 0;
+	for (std::size_t i = 0; i < state_hash_subsystems; ++i)
+		if (ours[i] != theirs[i])
+			differing |= 1u << i;
+	differing &= mask;
+	const auto persistent = differing & source.differing & ~source.reported;
+	source.differing = differing;
+	if (!persistent)
+		return;
+	/* Report only the first subsystem in the order above.  A door which
+	 * differs often explains a robot which differs later.
+	 */
+	const auto i = __builtin_ctz(persistent);
+	source.reported |= 1u << i;
+	con_printf(CON_URGENT, "state hash: %s state of %s differs from ours (ours %08x, theirs %08x, random seed %08x)", state_hash_name[i], source_name, ours[i], theirs[i], d_rand_state());
+	state_hash_dump(static_cast<state_hash_subsystem>(i));
+}
+
+void state_hash_match(state_hash_source &source, const char *const source_name)
+{
+	if (!source.has_pending)
+		return;
+	const auto ours = state_hash_find(source.pending_seq);
+	if (!ours)
+	{
+		if (State_hash_level == Current_level_num && static_cast<int32_t>(State_hash_seq - source.pending_seq) >= 0)
+			source.has_pending = false;
+		return;
+	}
+	source.has_pending = false;
+	state_hash_check(source, source_name, *ours, source.pending, state_hash_all);
+}
+
+}
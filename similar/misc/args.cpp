@@ -24,6 +24,7 @@
 #include "game.h"
 #include "console.h"
 #include "mission.h"
+#include "rewind.h"
 #if DXX_USE_UDP
 #include "net_udp.h"
 #endif
@@ -141,8 +142,12 @@ static void arg_port_number(Arglist::iterator &pp, Arglist::const_iterator end,
 static void InitGameArg()
 {
 	CGameArg.SysMaxFPS = MAXIMUM_FPS;
+	CGameArg.SysRewindMemory = REWIND_MEMORY_DEFAULT;
 #if DXX_USE_UDP
 	CGameArg.MplUdpHostAddr = UDP_MANUAL_ADDR_DEFAULT;
+	CGameArg.MplUdpRelayPort = UDP_RELAY_PORT_DEFAULT;
+	CGameArg.MplUdpRelayDelay = UDP_RELAY_DELAY_DEFAULT;
+	CGameArg.MplDedicatedTick = UDP_DEDICATED_TICK_DEFAULT;
 #if DXX_USE_TRACKER
 	CGameArg.MplTrackerAddr = TRACKER_ADDR_DEFAULT;
 	CGameArg.MplTrackerPort = TRACKER_PORT_DEFAULT;
@@ -222,6 +227,10 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 			CGameArg.SysUsePlayersDir = static_cast<int8_t>(- (sizeof(PLAYER_DIRECTORY_TEXT) - 1));
 		else if (!d_stricmp(p, "-lowmem"))
 			CGameArg.SysLowMem = true;
+		else if (!d_stricmp(p, "-rewind"))
+			CGameArg.SysRewindInterval = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-rewind_memory"))
+			CGameArg.SysRewindMemory = arg_integer(pp, end);
 		else if (!d_stricmp(p, "-pilot"))
 			CGameArg.SysPilot = arg_string(pp, end);
 		else if (!d_stricmp(p, "-record-demo-format"))
@@ -314,6 +323,25 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 		{
 			arg_port_number(pp, end, CGameArg.MplUdpMyPort, false);
 		}
+		else if (!d_stricmp(p, "-udp_deltapos"))
+			CGameArg.MplUdpDeltaPos = true;
+		else if (!d_stricmp(p, "-udp_interest"))
+			CGameArg.MplUdpInterest = true;
+		else if (!d_stricmp(p, "-udp_relay"))
+			CGameArg.MplUdpRelay = true;
+		else if (!d_stricmp(p, "-udp_relay_watch"))
+			CGameArg.MplUdpRelayWatch = arg_string(pp, end);
+		else if (!d_stricmp(p, "-udp_relay_port"))
+			arg_port_number(pp, end, CGameArg.MplUdpRelayPort, false);
+		else if (!d_stricmp(p, "-udp_relay_delay"))
+			CGameArg.MplUdpRelayDelay = arg_integer(pp, end);
+		else if (!d_stricmp(p, "-dedicated"))
+		{
+			CGameArg.MplDedicated = true;
+			CGameArg.MplDedicatedRotation = arg_string(pp, end);
+		}
+		else if (!d_stricmp(p, "-dedicated_tick"))
+			CGameArg.MplDedicatedTick = arg_integer(pp, end);
 		else if (!d_stricmp(p, "-no-tracker"))
 		{
 			/* Always recognized.  No-op if tracker support compiled
@@ -363,6 +391,10 @@ static void ReadCmdArgs(Inilist &ini, Arglist &Args)
 			CGameArg.DbgNoRun = true;
 		else if (!d_stricmp(p, "-renderstats"))
 			CGameArg.DbgRenderStats = true;
+		else if (!d_stricmp(p, "-olddynlight"))
+			CGameArg.DbgUseOldDynamicLight = true;
+		else if (!d_stricmp(p, "-state_hash"))
+			CGameArg.DbgStateHash = arg_integer(pp, end);
 		else if (!d_stricmp(p, "-text"))
 			CGameArg.DbgAltTex = arg_string(pp, end);
 		else if (!d_stricmp(p, "-showmeminfo"))
@@ -438,6 +470,34 @@ static void PostProcessGameArg()
 		sdl_disable_lock_keys[sizeof(sdl_disable_lock_keys) - 2] = '1';
 	SDL_putenv(sdl_disable_lock_keys);
 #endif
+#if DXX_USE_UDP
+	if (CGameArg.MplDedicated)
+	{
+		/* A dedicated host has no sound and no input.  It opens no
+		 * window, through the dummy video driver of SDL, and simulates
+		 * at a fixed tick.  Builds with OpenGL also skip creating a GL
+		 * context, which the dummy driver cannot give.
+		 */
+		CGameArg.SndNoSound = CGameArg.SndNoMusic = true;
+		CGameArg.CtlNoMouse = CGameArg.CtlNoCursor = true;
+#if DXX_MAX_JOYSTICKS
+		CGameArg.CtlNoJoystick = true;
+#endif
+		CGameArg.SysNoTitles = CGameArg.SysWindow = true;
+		CGameArg.SysAutoDemo = false;
+		if (CGameArg.MplDedicatedTick < MINIMUM_FPS)
+			CGameArg.MplDedicatedTick = MINIMUM_FPS;
+		else if (CGameArg.MplDedicatedTick > MAXIMUM_FPS)
+			CGameArg.MplDedicatedTick = MAXIMUM_FPS;
+		CGameArg.SysMaxFPS = CGameArg.MplDedicatedTick;
+#if SDL_MAJOR_VERSION == 1
+		static char sdl_video_driver_dummy[] = "SDL_VIDEODRIVER=dummy";
+		SDL_putenv(sdl_video_driver_dummy);
+#elif SDL_MAJOR_VERSION == 2
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+#endif
+	}
+#endif
 }
 
 static std::string ConstructIniStackExplanation(const Inilist &ini)
@@ -529,10 +529,18 @@ int PHYSFSX_exists_ignorecase(const char *filename)
 	return !PHYSFSEXT_locateCorrectCase(filename2);
 }
 
-//Open a file for reading, set up a buffer
-std::pair<RAIIPHYSFS_File, PHYSFS_ErrorCode> PHYSFSX_openReadBuffered(const char *filename)
+//Get the size and time of a file, ignoring case
+int PHYSFSX_stat(const char *filename, PHYSFS_Stat &stat)
+{
+	char filename2[PATH_MAX];
+	snprintf(filename2, sizeof(filename2), "%s", filename);
+	PHYSFSEXT_locateCorrectCase(filename2);
+	return PHYSFS_stat(filename2, &stat);
+}
+
+//Open a file for reading, without a buffer, for callers which read only a little of it
+std::pair<RAIIPHYSFS_File, PHYSFS_ErrorCode> PHYSFSX_openReadUnbuffered(const char *filename)
 {
-	PHYSFS_uint64 bufSize;
 	char filename2[PATH_MAX];
 #if 0
 	if (filename[0] == '\x01')
@@ -547,11 +555,21 @@ std::pair<RAIIPHYSFS_File, PHYSFS_ErrorCode> PHYSFSX_openReadBuffered(const char
 	RAIIPHYSFS_File fp{PHYSFS_openRead(filename2)};
 	if (!fp)
 		return {nullptr, PHYSFS_getLastErrorCode()};
+	return {std::move(fp), PHYSFS_ERR_OK};
+}
+
+//Open a file for reading, set up a buffer
+std::pair<RAIIPHYSFS_File, PHYSFS_ErrorCode> PHYSFSX_openReadBuffered(const char *filename)
+{
+	auto r = PHYSFSX_openReadUnbuffered(filename);
+	auto &fp = r.first;
+	if (!fp)
+		return r;
 	
-	bufSize = PHYSFS_fileLength(fp);
+	PHYSFS_uint64 bufSize = PHYSFS_fileLength(fp);
 	while (!PHYSFS_setBuffer(fp, bufSize) && bufSize)
 		bufSize /= 2;	// even if the error isn't memory full, for a 20MB file it'll only do this 8 times
-	return {std::move(fp), PHYSFS_ERR_OK};
+	return r;
 }
 
 //Open a file for writing, set up a buffer